@@ -1103,7 +1103,7 @@ AC_DEFUN([LIBZMQ_CHECK_POLLER], [{
     # Allow user to override poller autodetection
     AC_ARG_WITH([poller],
         [AS_HELP_STRING([--with-poller],
-        [choose I/O thread polling system manually. Valid values are 'kqueue', 'epoll', 'devpoll', 'pollset', 'poll', 'select', 'wepoll', or 'auto'. [default=auto]])])
+        [choose I/O thread polling system manually. Valid values are 'kqueue', 'epoll', 'uring', 'devpoll', 'pollset', 'poll', 'select', 'wepoll', or 'auto'. [default=auto]])])
 
     # Allow user to override poller autodetection
     AC_ARG_WITH([api_poller],
@@ -1157,6 +1157,18 @@ AC_DEFUN([LIBZMQ_CHECK_POLLER], [{
                         ;;
                 esac
             ;;
+            uring)
+                # io_uring can only be manually selected, and falls back to
+                # epoll at runtime if the kernel does not support it
+                AC_CHECK_HEADER([linux/io_uring.h], [
+                    LIBZMQ_CHECK_POLLER_EPOLL_CLOEXEC([
+                        AC_MSG_NOTICE([Using 'uring' I/O thread polling system])
+                        AC_DEFINE(ZMQ_IOTHREAD_POLLER_USE_URING, 1, [Use 'uring' I/O thread polling system])
+                        AC_DEFINE(ZMQ_IOTHREAD_POLLER_USE_EPOLL_CLOEXEC, 1, [Use 'epoll' I/O thread polling system with CLOEXEC])
+                        poller_found=1
+                    ])
+                ])
+            ;;
             devpoll)
                 LIBZMQ_CHECK_POLLER_DEVPOLL([
                     AC_MSG_NOTICE([Using 'devpoll' I/O thread polling system])
@@ -609,6 +609,10 @@ _Analysis_mode_ (_Analysis_code_type_user_code_)
 #undef _Ret_z_
 #endif
 #define _Ret_z_
+#ifdef _Ret_opt_bytecap_
+#undef _Ret_opt_bytecap_
+#endif
+#define _Ret_opt_bytecap_(s)
 #ifdef _Ret_writes_
 #undef _Ret_writes_
 #endif
@@ -1049,6 +1053,8 @@ _Analysis_mode_ (_Analysis_code_type_user_code_)
 #define _Pre_opt_valid_ _Pre_maybenull_ _Pre_ _Valid_
 #undef _Post_valid_
 #define _Post_valid_ _Post_ _Valid_
+#undef _Pre_invalid_
+#define _Pre_invalid_ _Pre_ _Notvalid_
 #undef _Post_invalid_
 #define _Post_invalid_ _Post_ _Deref_ _Notvalid_
 #undef _Post_ptr_invalid_
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifdef _MSC_VER
+#define MIN_CPP_VERSION 199711L
+#else
+#define MIN_CPP_VERSION 201103L
+#endif
+
+#if __cplusplus >= MIN_CPP_VERSION
+
+#include "../include/zmq.h"
+#include "command.hpp"
+#include "mailbox.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+//  Measures the latency of commands sent to a mailbox by many threads at
+//  once, the way the I/O threads get them under heavy connection churn.
+
+const int default_senders = 32;
+const int default_commands = 20000;
+
+static uint64_t now_ns ()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds> (
+             steady_clock::now ().time_since_epoch ())
+      .count ();
+}
+
+static void sender (zmq::mailbox_t *mailbox_, int commands_)
+{
+    zmq::command_t cmd;
+    cmd.destination = NULL;
+    cmd.type = zmq::command_t::activate_write;
+    for (int i = 0; i != commands_; ++i) {
+        cmd.args.activate_write.msgs_read = now_ns ();
+        mailbox_->send (cmd);
+    }
+}
+
+int ZMQ_CDECL main (int argc, char *argv[])
+{
+    const int senders = argc > 1 ? atoi (argv[1]) : default_senders;
+    const int commands = argc > 2 ? atoi (argv[2]) : default_commands;
+    if (senders <= 0 || commands <= 0) {
+        std::printf ("usage: benchmark_mailbox [senders] [commands]\n");
+        return 1;
+    }
+
+    zmq::mailbox_t mailbox;
+    std::vector<uint64_t> latencies;
+    latencies.reserve (static_cast<size_t> (senders) * commands);
+
+    const uint64_t start = now_ns ();
+    std::vector<std::thread> threads;
+    for (int i = 0; i != senders; ++i)
+        threads.emplace_back (sender, &mailbox, commands);
+
+    zmq::command_t cmd;
+    while (latencies.size () != latencies.capacity ()) {
+        const int rc = mailbox.recv (&cmd, -1);
+        if (rc == 0)
+            latencies.push_back (now_ns ()
+                                 - cmd.args.activate_write.msgs_read);
+    }
+    const uint64_t elapsed = now_ns () - start;
+
+    for (auto &thread : threads)
+        thread.join ();
+
+    std::sort (latencies.begin (), latencies.end ());
+    uint64_t sum = 0;
+    for (const auto latency : latencies)
+        sum += latency;
+    const size_t count = latencies.size ();
+
+    std::printf ("senders: %d\n", senders);
+    std::printf ("commands: %zu\n", count);
+    std::printf ("throughput: %.0f [cmd/s]\n",
+                 static_cast<double> (count) * 1e9 / elapsed);
+    std::printf ("mean latency: %.1f [us]\n",
+                 static_cast<double> (sum) / count / 1000);
+    std::printf ("median latency: %.1f [us]\n",
+                 static_cast<double> (latencies[count / 2]) / 1000);
+    std::printf ("99th percentile latency: %.1f [us]\n",
+                 static_cast<double> (latencies[count * 99 / 100]) / 1000);
+    std::printf ("max latency: %.1f [us]\n",
+                 static_cast<double> (latencies.back ()) / 1000);
+    return 0;
+}
+
+#else
+
+int ZMQ_CDECL main ()
+{
+}
+
+#endif
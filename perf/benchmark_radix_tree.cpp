@@ -8,12 +8,16 @@
 
 #if __cplusplus >= MIN_CPP_VERSION
 
+#include "../include/zmq.h"
 #include "radix_tree.hpp"
 #include "trie.hpp"
+#include "generic_mtrie_impl.hpp"
+#include "compact_mtrie_impl.hpp"
 
 #include <chrono>
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <random>
 #include <ratio>
 #include <vector>
@@ -61,6 +65,96 @@ void benchmark_lookup (T &subscriptions_,
                  static_cast<double> (sum) / samples);
 }
 
+static void count_match (int *value_, std::size_t *count_)
+{
+    (void) value_;
+    ++*count_;
+}
+
+//  Same as benchmark_lookup for the multi-tries used by XPUB sockets.
+template <class T>
+void benchmark_match (T &subscriptions_, std::vector<unsigned char *> &queries_)
+{
+    using namespace std::chrono;
+    std::vector<duration<long, std::nano> > samples_vec;
+    samples_vec.reserve (samples);
+
+    for (std::size_t run = 0; run < warmup_runs; ++run) {
+        for (auto &query : queries_) {
+            std::size_t count = 0;
+            subscriptions_.match (query, key_length, count_match, &count);
+            if (!count) {
+                std::puts ("Key not found error :(");
+                return;
+            }
+        }
+    }
+
+    for (std::size_t run = 0; run < samples; ++run) {
+        duration<long, std::nano> interval (0);
+        for (auto &query : queries_) {
+            std::size_t count = 0;
+            auto start = steady_clock::now ();
+            subscriptions_.match (query, key_length, count_match, &count);
+            auto end = steady_clock::now ();
+            interval += end - start;
+        }
+        samples_vec.push_back (interval / queries_.size ());
+    }
+
+    std::size_t sum = 0;
+    for (const auto &sample : samples_vec)
+        sum += sample.count ();
+    std::printf ("Average lookup time = %.1lf ns\n",
+                 static_cast<double> (sum) / samples);
+}
+
+//  Reports the lookup rate for keys of the given length sharing all but
+//  their last bytes with each other, like the topics of a market data
+//  feed do.
+template <class T> void benchmark_prefix_length (std::size_t length_)
+{
+    const char *topic = "md.equities.us.nasdaq.";
+    const std::size_t topic_length = std::strlen (topic);
+    const std::size_t suffix_length = length_ < 6 ? length_ : 6;
+
+    std::minstd_rand rng;
+    std::vector<std::vector<unsigned char> > keys (nkeys);
+    T subscriptions;
+    for (auto &key : keys) {
+        key.resize (length_);
+        for (std::size_t j = 0; j < length_ - suffix_length; j++)
+            key[j] = static_cast<unsigned char> (topic[j % topic_length]);
+        for (std::size_t j = length_ - suffix_length; j < length_; j++)
+            key[j] = static_cast<unsigned char> (chars[rng () % chars_len]);
+        subscriptions.add (&key[0], length_);
+    }
+    std::vector<const unsigned char *> queries;
+    queries.reserve (nqueries);
+    for (std::size_t i = 0; i < nqueries; ++i)
+        queries.push_back (&keys[rng () % nkeys][0]);
+
+    using namespace std::chrono;
+    std::size_t found = 0;
+    for (std::size_t run = 0; run < warmup_runs; ++run)
+        for (auto &query : queries)
+            found += subscriptions.check (query, length_);
+
+    const auto start = steady_clock::now ();
+    for (std::size_t run = 0; run < samples; ++run)
+        for (auto &query : queries)
+            found += subscriptions.check (query, length_);
+    const duration<double> elapsed = steady_clock::now () - start;
+
+    if (found != (warmup_runs + samples) * nqueries) {
+        std::puts ("Key not found error :(");
+        return;
+    }
+    std::printf ("key size = %3llu: %.1lf M matches/s\n",
+                 static_cast<unsigned long long> (length_),
+                 samples * nqueries / elapsed.count () / 1e6);
+}
+
 int
 #ifdef _MSC_VER
   __cdecl
@@ -87,11 +181,16 @@ int
     //
     // Keeping initialization out of the benchmarking function helps
     // heaptrack detect peak memory consumption of the radix tree.
+    int pipe;
     zmq::trie_t trie;
     zmq::radix_tree_t radix_tree;
+    zmq::generic_mtrie_t<int> mtrie;
+    zmq::compact_mtrie_t<int> compact_mtrie;
     for (auto &key : input_set) {
         trie.add (key, key_length);
         radix_tree.add (key, key_length);
+        mtrie.add (key, key_length, &pipe);
+        compact_mtrie.add (key, key_length, &pipe);
     }
 
     // Create a benchmark.
@@ -105,6 +204,24 @@ int
     std::puts ("[radix_tree]");
     benchmark_lookup (radix_tree, queries);
 
+    radix_tree.compact ();
+    std::puts ("[radix_tree, compacted]");
+    benchmark_lookup (radix_tree, queries);
+
+    std::puts ("[mtrie]");
+    benchmark_match (mtrie, queries);
+
+    std::puts ("[compact_mtrie]");
+    benchmark_match (compact_mtrie, queries);
+
+    const std::size_t prefix_lengths[] = {8, 16, 32, 64, 128};
+    std::puts ("[trie, shared prefixes]");
+    for (auto length : prefix_lengths)
+        benchmark_prefix_length<zmq::trie_t> (length);
+    std::puts ("[radix_tree, shared prefixes]");
+    for (auto length : prefix_lengths)
+        benchmark_prefix_length<zmq::radix_tree_t> (length);
+
     for (auto &op : input_set)
         delete[] op;
 }
@@ -17,6 +17,83 @@
 
 static int message_count;
 static size_t message_size;
+static int batch_size = 1;
+
+#if defined ZMQ_BUILD_DRAFT_API
+static void send_batched (void *s_)
+{
+    zmq_msg_t *msgs =
+      static_cast<zmq_msg_t *> (malloc (batch_size * sizeof (zmq_msg_t)));
+    if (!msgs) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+
+    for (int i = 0; i < message_count;) {
+        const int count =
+          message_count - i < batch_size ? message_count - i : batch_size;
+        for (int j = 0; j != count; j++) {
+            int rc = zmq_msg_init_size (&msgs[j], message_size);
+            if (rc != 0) {
+                printf ("error in zmq_msg_init_size: %s\n",
+                        zmq_strerror (errno));
+                exit (1);
+            }
+#if defined ZMQ_MAKE_VALGRIND_HAPPY
+            memset (zmq_msg_data (&msgs[j]), 0, message_size);
+#endif
+        }
+
+        //  A batch may be sent partially; resubmit the remainder.
+        for (int sent = 0; sent != count;) {
+            const int rc =
+              zmq_msg_send_batch (msgs + sent, count - sent, s_, 0);
+            if (rc < 0) {
+                printf ("error in zmq_msg_send_batch: %s\n",
+                        zmq_strerror (errno));
+                exit (1);
+            }
+            sent += rc;
+        }
+        i += count;
+    }
+
+    free (msgs);
+}
+
+static int recv_batched (void *s_, int count_)
+{
+    zmq_msg_t *msgs =
+      static_cast<zmq_msg_t *> (malloc (batch_size * sizeof (zmq_msg_t)));
+    if (!msgs) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+    for (int j = 0; j != batch_size; j++)
+        zmq_msg_init (&msgs[j]);
+
+    for (int i = 0; i < count_;) {
+        const int count = count_ - i < batch_size ? count_ - i : batch_size;
+        const int rc = zmq_msg_recv_batch (msgs, count, s_, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv_batch: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        for (int j = 0; j != rc; j++) {
+            if (zmq_msg_size (&msgs[j]) != message_size) {
+                printf ("message of incorrect size received\n");
+                return -1;
+            }
+        }
+        i += rc;
+    }
+
+    for (int j = 0; j != batch_size; j++)
+        zmq_msg_close (&msgs[j]);
+    free (msgs);
+    return 0;
+}
+#endif
 
 #if defined ZMQ_HAVE_WINDOWS
 static unsigned int __stdcall worker (void *ctx_)
@@ -41,6 +118,11 @@ static void *worker (void *ctx_)
         exit (1);
     }
 
+#if defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1)
+        send_batched (s);
+    else
+#endif
     for (i = 0; i != message_count; i++) {
         rc = zmq_msg_init_size (&msg, message_size);
         if (rc != 0) {
@@ -93,13 +175,24 @@ int ZMQ_CDECL main (int argc, char *argv[])
     unsigned long throughput;
     double megabits;
 
-    if (argc != 3) {
-        printf ("usage: inproc_thr <message-size> <message-count>\n");
+    if (argc != 3 && argc != 4) {
+        printf ("usage: inproc_thr <message-size> <message-count> "
+                "[<batch-size>]\n");
         return 1;
     }
 
     message_size = atoi (argv[1]);
     message_count = atoi (argv[2]);
+    if (argc >= 4)
+        batch_size = atoi (argv[3]);
+#if !defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        printf ("batching requires the DRAFT API\n");
+        return 1;
+    }
+#endif
+    if (batch_size < 1)
+        batch_size = 1;
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -141,6 +234,8 @@ int ZMQ_CDECL main (int argc, char *argv[])
 
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("message count: %d\n", (int) message_count);
+    if (batch_size > 1)
+        printf ("batch size: %d\n", batch_size);
 
     rc = zmq_recvmsg (s, &msg, 0);
     if (rc < 0) {
@@ -154,6 +249,12 @@ int ZMQ_CDECL main (int argc, char *argv[])
 
     watch = zmq_stopwatch_start ();
 
+#if defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        if (recv_batched (s, message_count - 1) != 0)
+            return -1;
+    } else
+#endif
     for (i = 0; i != message_count - 1; i++) {
         rc = zmq_recvmsg (s, &msg, 0);
         if (rc < 0) {
@@ -7,6 +7,42 @@
 // keys are arbitrary but must match remote_lat.cpp
 const char server_prvkey[] = "{X}#>t#jRGaQ}gMhv=30r(Mw+87YGs+5%kh=i@f8";
 
+#if defined ZMQ_BUILD_DRAFT_API
+static int
+recv_batched (void *s_, int count_, size_t message_size_, int batch_size_)
+{
+    zmq_msg_t *msgs =
+      static_cast<zmq_msg_t *> (malloc (batch_size_ * sizeof (zmq_msg_t)));
+    if (!msgs) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+    for (int j = 0; j != batch_size_; j++)
+        zmq_msg_init (&msgs[j]);
+
+    for (int i = 0; i < count_;) {
+        const int count = count_ - i < batch_size_ ? count_ - i : batch_size_;
+        const int rc = zmq_msg_recv_batch (msgs, count, s_, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv_batch: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        for (int j = 0; j != rc; j++) {
+            if (zmq_msg_size (&msgs[j]) != message_size_) {
+                printf ("message of incorrect size received\n");
+                return -1;
+            }
+        }
+        i += rc;
+    }
+
+    for (int j = 0; j != batch_size_; j++)
+        zmq_msg_close (&msgs[j]);
+    free (msgs);
+    return 0;
+}
+#endif
+
 int ZMQ_CDECL main (int argc, char *argv[])
 {
     const char *bind_to;
@@ -22,10 +58,11 @@ int ZMQ_CDECL main (int argc, char *argv[])
     double throughput;
     double megabits;
     int curve = 0;
+    int batch_size = 1;
 
-    if (argc != 4 && argc != 5) {
+    if (argc < 4 || argc > 6) {
         printf ("usage: local_thr <bind-to> <message-size> <message-count> "
-                "[<enable_curve>]\n");
+                "[<enable_curve> [<batch-size>]]\n");
         return 1;
     }
     bind_to = argv[1];
@@ -34,6 +71,14 @@ int ZMQ_CDECL main (int argc, char *argv[])
     if (argc >= 5 && atoi (argv[4])) {
         curve = 1;
     }
+    if (argc >= 6)
+        batch_size = atoi (argv[5]);
+#if !defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        printf ("batching requires the DRAFT API\n");
+        return 1;
+    }
+#endif
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -88,6 +133,12 @@ int ZMQ_CDECL main (int argc, char *argv[])
 
     watch = zmq_stopwatch_start ();
 
+#if defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        if (recv_batched (s, message_count - 1, message_size, batch_size) != 0)
+            return -1;
+    } else
+#endif
     for (i = 0; i != message_count - 1; i++) {
         rc = zmq_recvmsg (s, &msg, 0);
         if (rc < 0) {
@@ -115,6 +166,8 @@ int ZMQ_CDECL main (int argc, char *argv[])
 
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("message count: %d\n", (int) message_count);
+    if (batch_size > 1)
+        printf ("batch size: %d\n", batch_size);
     printf ("mean throughput: %d [msg/s]\n", (int) throughput);
     printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
 
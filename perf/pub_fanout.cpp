@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+//  Measures how fast a PUB socket fans messages out to many subscribers
+//  when a given share of them matches every message. Subscribers are
+//  drained between batches, outside of the timed sends, so the results
+//  show the cost of matching and distributing on the publisher. An optional
+//  shard count splits large fan-outs across that many threads.
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+static const int batch_size = 100;
+
+static void check (int rc_, const char *what_)
+{
+    if (rc_ < 0) {
+        printf ("error in %s: %s\n", what_, zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+int ZMQ_CDECL main (int argc, char *argv[])
+{
+    if (argc != 5 && argc != 6) {
+        printf ("usage: pub_fanout <message-size> <message-count> "
+                "<subscriber-count> <match-percent> [<shards>]\n");
+        return 1;
+    }
+
+    const size_t message_size = atoi (argv[1]);
+    const int message_count = atoi (argv[2]);
+    const int subscriber_count = atoi (argv[3]);
+    const int match_percent = atoi (argv[4]);
+    const int shards = argc == 6 ? atoi (argv[5]) : 1;
+    if (message_size < 1 || message_count < 1 || subscriber_count < 1
+        || match_percent < 0 || match_percent > 100 || shards < 1) {
+        printf ("invalid arguments\n");
+        return 1;
+    }
+    const int matching = subscriber_count * match_percent / 100;
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    check (zmq_ctx_set (ctx, ZMQ_MAX_SOCKETS, subscriber_count + 16),
+           "zmq_ctx_set");
+
+    const int hwm = batch_size;
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    if (!pub) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    const int verbose = 1;
+    check (zmq_setsockopt (pub, ZMQ_XPUB_VERBOSE, &verbose, sizeof verbose),
+           "zmq_setsockopt");
+    check (zmq_setsockopt (pub, ZMQ_SNDHWM, &hwm, sizeof hwm),
+           "zmq_setsockopt");
+#ifdef ZMQ_XPUB_FANOUT_SHARDS
+    check (zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof shards),
+           "zmq_setsockopt");
+#else
+    if (shards != 1) {
+        printf ("sharded fan-out requires a DRAFT build\n");
+        return 1;
+    }
+#endif
+    check (zmq_bind (pub, "inproc://pub_fanout"), "zmq_bind");
+
+    void **subs = (void **) malloc (subscriber_count * sizeof (void *));
+    if (!subs) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+    for (int i = 0; i != subscriber_count; i++) {
+        subs[i] = zmq_socket (ctx, ZMQ_SUB);
+        if (!subs[i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        check (zmq_setsockopt (subs[i], ZMQ_RCVHWM, &hwm, sizeof hwm),
+               "zmq_setsockopt");
+        check (zmq_connect (subs[i], "inproc://pub_fanout"), "zmq_connect");
+        check (zmq_setsockopt (subs[i], ZMQ_SUBSCRIBE, i < matching ? "A" : "B",
+                               1),
+               "zmq_setsockopt");
+    }
+
+    //  Make sure the publisher has seen every subscription before timing.
+    char buf[8];
+    for (int i = 0; i != subscriber_count; i++)
+        check (zmq_recv (pub, buf, sizeof buf, 0), "zmq_recv");
+
+    char *data = (char *) malloc (message_size);
+    if (!data) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+    memset (data, 'A', message_size);
+
+    unsigned long elapsed = 0;
+    for (int sent = 0; sent < message_count; sent += batch_size) {
+        const int batch =
+          message_count - sent < batch_size ? message_count - sent : batch_size;
+
+        void *watch = zmq_stopwatch_start ();
+        for (int i = 0; i != batch; i++)
+            check (zmq_send (pub, data, message_size, 0), "zmq_send");
+        elapsed += zmq_stopwatch_stop (watch);
+
+        for (int i = 0; i != matching; i++)
+            for (int j = 0; j != batch; j++)
+                check (zmq_recv (subs[i], buf, sizeof buf, 0), "zmq_recv");
+    }
+    if (elapsed == 0)
+        elapsed = 1;
+
+    for (int i = 0; i != subscriber_count; i++)
+        check (zmq_close (subs[i]), "zmq_close");
+    check (zmq_close (pub), "zmq_close");
+    check (zmq_ctx_term (ctx), "zmq_ctx_term");
+    free (subs);
+    free (data);
+
+    const double throughput = (double) message_count / elapsed * 1000000;
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("subscribers: %d (%d matching)\n", subscriber_count, matching);
+    printf ("shards: %d\n", shards);
+    printf ("mean throughput: %.0f [msg/s]\n", throughput);
+    printf ("mean fan-out: %.0f [deliveries/s]\n", throughput * matching);
+
+    return 0;
+}
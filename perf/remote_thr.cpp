@@ -10,6 +10,47 @@ const char server_pubkey[] = "DX4nh=yUn{-9ugra0X3Src4SU-4xTgqxcYY.+<SH";
 const char client_pubkey[] = "<n^oA}I:66W+*ds3tAmi1+KJzv-}k&fC2aA5Bj0K";
 const char client_prvkey[] = "9R9bV}[6z6DC-%$!jTVTKvWc=LEL{4i4gzUe$@Zx";
 
+#if defined ZMQ_BUILD_DRAFT_API
+static int
+send_batched (void *s_, int count_, int message_size_, int batch_size_)
+{
+    zmq_msg_t *msgs =
+      static_cast<zmq_msg_t *> (malloc (batch_size_ * sizeof (zmq_msg_t)));
+    if (!msgs) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    for (int i = 0; i < count_;) {
+        const int count = count_ - i < batch_size_ ? count_ - i : batch_size_;
+        for (int j = 0; j != count; j++) {
+            const int rc = zmq_msg_init_size (&msgs[j], message_size_);
+            if (rc != 0) {
+                printf ("error in zmq_msg_init_size: %s\n",
+                        zmq_strerror (errno));
+                return -1;
+            }
+        }
+
+        //  A batch may be sent partially; resubmit the remainder.
+        for (int sent = 0; sent != count;) {
+            const int rc =
+              zmq_msg_send_batch (msgs + sent, count - sent, s_, 0);
+            if (rc < 0) {
+                printf ("error in zmq_msg_send_batch: %s\n",
+                        zmq_strerror (errno));
+                return -1;
+            }
+            sent += rc;
+        }
+        i += count;
+    }
+
+    free (msgs);
+    return 0;
+}
+#endif
+
 int ZMQ_CDECL main (int argc, char *argv[])
 {
     const char *connect_to;
@@ -21,10 +62,11 @@ int ZMQ_CDECL main (int argc, char *argv[])
     int i;
     zmq_msg_t msg;
     int curve = 0;
+    int batch_size = 1;
 
-    if (argc != 4 && argc != 5) {
+    if (argc < 4 || argc > 6) {
         printf ("usage: remote_thr <connect-to> <message-size> "
-                "<message-count> [<enable_curve>]\n");
+                "<message-count> [<enable_curve> [<batch-size>]]\n");
         return 1;
     }
     connect_to = argv[1];
@@ -33,6 +75,14 @@ int ZMQ_CDECL main (int argc, char *argv[])
     if (argc >= 5 && atoi (argv[4])) {
         curve = 1;
     }
+    if (argc >= 6)
+        batch_size = atoi (argv[5]);
+#if !defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        printf ("batching requires the DRAFT API\n");
+        return 1;
+    }
+#endif
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -77,6 +127,12 @@ int ZMQ_CDECL main (int argc, char *argv[])
         return -1;
     }
 
+#if defined ZMQ_BUILD_DRAFT_API
+    if (batch_size > 1) {
+        if (send_batched (s, message_count, message_size, batch_size) != 0)
+            return -1;
+    } else
+#endif
     for (i = 0; i != message_count; i++) {
         rc = zmq_msg_init_size (&msg, message_size);
         if (rc != 0) {
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+//  Measures how ROUTER send and receive throughput scales with the number
+//  of connected peers. Every message is addressed to a different peer, so
+//  the cost of looking peers up by routing id shows in the results.
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+static const int default_peer_counts[] = {1, 10, 100, 1000, 4000};
+
+static void check (int rc_, const char *what_)
+{
+    if (rc_ < 0) {
+        printf ("error in %s: %s\n", what_, zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+static double throughput (int message_count_, unsigned long elapsed_)
+{
+    if (elapsed_ == 0)
+        elapsed_ = 1;
+    return (double) message_count_ * 1000000 / elapsed_;
+}
+
+static void run (int peer_count_, int message_count_)
+{
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    check (zmq_ctx_set (ctx, ZMQ_MAX_SOCKETS, peer_count_ + 16),
+           "zmq_ctx_set");
+
+    int hwm = 0;
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    if (!router) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    check (zmq_setsockopt (router, ZMQ_SNDHWM, &hwm, sizeof hwm),
+           "zmq_setsockopt");
+    check (zmq_setsockopt (router, ZMQ_RCVHWM, &hwm, sizeof hwm),
+           "zmq_setsockopt");
+    check (zmq_bind (router, "inproc://router_thr"), "zmq_bind");
+
+    void **peers = (void **) malloc (peer_count_ * sizeof (void *));
+    char(*routing_ids)[16] = (char(*)[16]) malloc (peer_count_ * 16);
+    if (!peers || !routing_ids) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+
+    for (int i = 0; i != peer_count_; i++) {
+        peers[i] = zmq_socket (ctx, ZMQ_DEALER);
+        if (!peers[i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        snprintf (routing_ids[i], 16, "peer-%d", i);
+        check (zmq_setsockopt (peers[i], ZMQ_ROUTING_ID, routing_ids[i],
+                               strlen (routing_ids[i])),
+               "zmq_setsockopt");
+        check (zmq_setsockopt (peers[i], ZMQ_SNDHWM, &hwm, sizeof hwm),
+               "zmq_setsockopt");
+        check (zmq_setsockopt (peers[i], ZMQ_RCVHWM, &hwm, sizeof hwm),
+               "zmq_setsockopt");
+        check (zmq_connect (peers[i], "inproc://router_thr"), "zmq_connect");
+    }
+
+    //  Make sure the router has attached every peer before timing.
+    char buf[32];
+    for (int i = 0; i != peer_count_; i++)
+        check (zmq_send (peers[i], "", 0, 0), "zmq_send");
+    for (int i = 0; i != peer_count_; i++) {
+        check (zmq_recv (router, buf, sizeof buf, 0), "zmq_recv");
+        check (zmq_recv (router, buf, sizeof buf, 0), "zmq_recv");
+    }
+
+    //  Send to the peers in turn.
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 0; i != message_count_; i++) {
+        const char *routing_id = routing_ids[i % peer_count_];
+        check (zmq_send (router, routing_id, strlen (routing_id), ZMQ_SNDMORE),
+               "zmq_send");
+        check (zmq_send (router, "x", 1, 0), "zmq_send");
+    }
+    const unsigned long send_elapsed = zmq_stopwatch_stop (watch);
+
+    for (int i = 0; i != message_count_; i++)
+        check (zmq_recv (peers[i % peer_count_], buf, sizeof buf, 0),
+               "zmq_recv");
+
+    //  Receive from all the peers at once.
+    for (int i = 0; i != message_count_; i++)
+        check (zmq_send (peers[i % peer_count_], "x", 1, 0), "zmq_send");
+
+    watch = zmq_stopwatch_start ();
+    for (int i = 0; i != message_count_; i++) {
+        check (zmq_recv (router, buf, sizeof buf, 0), "zmq_recv");
+        check (zmq_recv (router, buf, sizeof buf, 0), "zmq_recv");
+    }
+    const unsigned long recv_elapsed = zmq_stopwatch_stop (watch);
+
+    printf ("%8d %16.0f %16.0f\n", peer_count_,
+            throughput (message_count_, send_elapsed),
+            throughput (message_count_, recv_elapsed));
+
+    int linger = 0;
+    for (int i = 0; i != peer_count_; i++) {
+        check (zmq_setsockopt (peers[i], ZMQ_LINGER, &linger, sizeof linger),
+               "zmq_setsockopt");
+        check (zmq_close (peers[i]), "zmq_close");
+    }
+    check (zmq_setsockopt (router, ZMQ_LINGER, &linger, sizeof linger),
+           "zmq_setsockopt");
+    check (zmq_close (router), "zmq_close");
+    check (zmq_ctx_term (ctx), "zmq_ctx_term");
+
+    free (routing_ids);
+    free (peers);
+}
+
+int ZMQ_CDECL main (int argc, char *argv[])
+{
+    if (argc < 2) {
+        printf ("usage: router_thr <message-count> [<peer-count>...]\n");
+        return 1;
+    }
+
+    const int message_count = atoi (argv[1]);
+
+    printf ("message count: %d\n", message_count);
+    printf ("%8s %16s %16s\n", "peers", "send [msg/s]", "recv [msg/s]");
+
+    if (argc > 2)
+        for (int i = 2; i != argc; i++)
+            run (atoi (argv[i]), message_count);
+    else
+        for (size_t i = 0; i != sizeof default_peer_counts
+                                    / sizeof default_peer_counts[0];
+             i++)
+            run (default_peer_counts[i], message_count);
+
+    return 0;
+}
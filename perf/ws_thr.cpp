@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+//  Measures throughput over ws:// next to tcp:// on the loopback
+//  interface. The connecting side masks every payload and the binding
+//  side unmasks it, so the difference shows the cost of WebSocket
+//  framing and masking.
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+static int message_count;
+static size_t message_size;
+static char endpoint[256];
+
+static void check (int rc_, const char *what_)
+{
+    if (rc_ < 0) {
+        printf ("error in %s: %s\n", what_, zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    check (zmq_connect (s, endpoint), "zmq_connect");
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        check (zmq_msg_init_size (&msg, message_size), "zmq_msg_init_size");
+        memset (zmq_msg_data (&msg), i, message_size);
+        check (zmq_sendmsg (s, &msg, 0), "zmq_sendmsg");
+        check (zmq_msg_close (&msg), "zmq_msg_close");
+    }
+
+    check (zmq_close (s), "zmq_close");
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void run (const char *transport_)
+{
+    void *ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    char bind_endpoint[64];
+    snprintf (bind_endpoint, sizeof bind_endpoint, "%s://127.0.0.1:*",
+              transport_);
+    check (zmq_bind (s, bind_endpoint), "zmq_bind");
+    size_t endpoint_len = sizeof endpoint;
+    check (zmq_getsockopt (s, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_len),
+           "zmq_getsockopt");
+
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE thread = (HANDLE) _beginthreadex (NULL, 0, worker, ctx, 0, NULL);
+    if (thread == 0) {
+        printf ("error in _beginthreadex\n");
+        exit (1);
+    }
+#else
+    pthread_t thread;
+    int rc = pthread_create (&thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    zmq_msg_t msg;
+    check (zmq_msg_init (&msg), "zmq_msg_init");
+
+    //  Start timing once the connection is up.
+    check (zmq_recvmsg (s, &msg, 0), "zmq_recvmsg");
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 0; i != message_count - 1; i++) {
+        check (zmq_recvmsg (s, &msg, 0), "zmq_recvmsg");
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    check (zmq_msg_close (&msg), "zmq_msg_close");
+
+#if defined ZMQ_HAVE_WINDOWS
+    WaitForSingleObject (thread, INFINITE);
+    CloseHandle (thread);
+#else
+    pthread_join (thread, NULL);
+#endif
+
+    check (zmq_close (s), "zmq_close");
+    check (zmq_ctx_term (ctx), "zmq_ctx_term");
+
+    const double throughput =
+      (double) (message_count - 1) / elapsed * 1000000;
+    const double megabits = throughput * message_size * 8 / 1000000;
+    printf ("%-4s %16.0f %16.3f\n", transport_, throughput, megabits);
+}
+
+int ZMQ_CDECL main (int argc, char *argv[])
+{
+    if (argc != 3) {
+        printf ("usage: ws_thr <message-size> <message-count>\n");
+        return 1;
+    }
+
+    message_size = atoi (argv[1]);
+    message_count = atoi (argv[2]);
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("%-4s %16s %16s\n", "", "[msg/s]", "[Mb/s]");
+
+    run ("tcp");
+#if defined ZMQ_HAVE_WS
+    run ("ws");
+#else
+    printf ("ws transport not available\n");
+#endif
+
+    return 0;
+}
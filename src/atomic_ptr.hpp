@@ -158,6 +158,21 @@ template <typename T> class atomic_ptr_t
     //  thread is accessing the pointer at the moment.
     void set (T *ptr_) ZMQ_NOEXCEPT { _ptr = ptr_; }
 
+    //  Read the value of the pointer written by another thread.
+    T *load () ZMQ_NOEXCEPT
+    {
+#if defined ZMQ_ATOMIC_PTR_CXX11
+        return _ptr.load (std::memory_order_acquire);
+#else
+        return (T *) atomic_cas ((void **) &_ptr, NULL, NULL
+#if defined ZMQ_ATOMIC_PTR_MUTEX
+                                 ,
+                                 _sync
+#endif
+        );
+#endif
+    }
+
     //  Perform atomic 'exchange pointers' operation. Pointer is set
     //  to the 'val_' value. Old value is returned.
     T *xchg (T *val_) ZMQ_NOEXCEPT
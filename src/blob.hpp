@@ -20,6 +20,7 @@
 #define ZMQ_MAP_INSERT_OR_EMPLACE(k, v) emplace (k, v)
 #define ZMQ_PUSH_OR_EMPLACE_BACK emplace_back
 #define ZMQ_MOVE(x) std::move (x)
+#define ZMQ_HAS_UNORDERED_MAP
 #else
 #if defined __SUNPRO_CC
 template <typename K, typename V>
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_BLOB_MAP_HPP_INCLUDED__
+#define __ZMQ_BLOB_MAP_HPP_INCLUDED__
+
+#include <vector>
+
+#include "blob.hpp"
+#include "err.hpp"
+#include "macros.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+//  Hash table mapping blob_t keys, e.g. routing ids, to values.
+//  Keys are looked up by their bytes, so no blob_t has to be built for
+//  a lookup. Open addressing with linear probing keeps the probed slots
+//  contiguous. Each slot holds the value, the hash of its key and the
+//  position of the key bytes in an arena shared by all the keys, so the
+//  table makes no allocation per key; mismatching keys are skipped, and
+//  the table regrown, without touching the arena. Pointers to values are
+//  invalidated by insertions and removals.
+
+template <typename T> class blob_map_t
+{
+  public:
+    blob_map_t () : _size (0), _garbage (0) {}
+
+    size_t size () const { return _size; }
+
+    bool empty () const { return _size == 0; }
+
+    //  Returns the value of the given key, or NULL if there is none.
+    T *find (const void *key_, size_t size_)
+    {
+        const size_t slot = find_slot (key_, size_, hash (key_, size_));
+        return slot == npos ? NULL : &_slots[slot].value;
+    }
+
+    const T *find (const void *key_, size_t size_) const
+    {
+        const size_t slot = find_slot (key_, size_, hash (key_, size_));
+        return slot == npos ? NULL : &_slots[slot].value;
+    }
+
+    //  Adds the key with the given value. Returns false, leaving the
+    //  table untouched, if the key is present already.
+    bool insert (const blob_t &key_, const T &value_)
+    {
+        const uint32_t key_hash = hash (key_.data (), key_.size ());
+        if (find_slot (key_.data (), key_.size (), key_hash) != npos)
+            return false;
+
+        //  Keep at least half of the slots empty so probe runs stay short.
+        if ((_size + 1) * 2 > _slots.size ())
+            rehash (_slots.empty () ? min_slots : _slots.size () * 2);
+
+        const size_t mask = _slots.size () - 1;
+        size_t slot = key_hash & mask;
+        while (_slots[slot].used)
+            slot = (slot + 1) & mask;
+        _slots[slot].hash = key_hash;
+        _slots[slot].key_size = static_cast<uint32_t> (key_.size ());
+        _slots[slot].key_offset = append_key (key_.data (), key_.size ());
+        _slots[slot].used = true;
+        _slots[slot].value = value_;
+        ++_size;
+        return true;
+    }
+
+    //  Removes the key, storing its value into value_ if not NULL.
+    //  Returns false if the key is not present.
+    bool erase (const void *key_, size_t size_, T *value_ = NULL)
+    {
+        size_t hole = find_slot (key_, size_, hash (key_, size_));
+        if (hole == npos)
+            return false;
+
+        if (value_)
+            *value_ = _slots[hole].value;
+        _slots[hole].used = false;
+        _garbage += _slots[hole].key_size;
+        --_size;
+
+        //  Shift back the entries following the hole that would not be
+        //  reachable from their home slot anymore.
+        const size_t mask = _slots.size () - 1;
+        for (size_t slot = (hole + 1) & mask; _slots[slot].used;
+             slot = (slot + 1) & mask) {
+            const size_t home = _slots[slot].hash & mask;
+            if (((slot - home) & mask) < ((slot - hole) & mask))
+                continue;
+            _slots[hole] = _slots[slot];
+            _slots[slot].used = false;
+            hole = slot;
+        }
+
+        //  Reclaim the bytes of the removed keys once they make up most
+        //  of the arena.
+        if (_garbage > min_garbage && _garbage * 2 > _keys.size ())
+            compact_keys ();
+        return true;
+    }
+
+    //  Calls func_ on the values in no particular order, until it
+    //  returns true. Returns whether it did.
+    template <typename Func> bool any_of (Func func_)
+    {
+        for (typename slots_t::size_type i = 0, n = _slots.size (); i != n;
+             ++i)
+            if (_slots[i].used && func_ (_slots[i].value))
+                return true;
+        return false;
+    }
+
+  private:
+    struct slot_t
+    {
+        slot_t () : hash (0), key_size (0), key_offset (0), used (false) {}
+
+        uint32_t hash;
+        uint32_t key_size;
+        uint32_t key_offset;
+        bool used;
+        T value;
+    };
+
+    typedef std::vector<slot_t> slots_t;
+    typedef std::vector<unsigned char> keys_t;
+
+    static const size_t npos = static_cast<size_t> (-1);
+
+    //  Number of slots allocated by the first insertion; a power of two.
+    static const size_t min_slots = 16;
+
+    //  Bytes of removed keys below which the arena is never compacted.
+    static const size_t min_garbage = 4096;
+
+    //  FNV-1a.
+    static uint32_t hash (const void *key_, size_t size_)
+    {
+        const unsigned char *const data =
+          static_cast<const unsigned char *> (key_);
+        uint32_t res = 2166136261u;
+        for (size_t i = 0; i != size_; ++i) {
+            res ^= data[i];
+            res *= 16777619u;
+        }
+        return res;
+    }
+
+    size_t find_slot (const void *key_, size_t size_, uint32_t hash_) const
+    {
+        if (_slots.empty ())
+            return npos;
+        const size_t mask = _slots.size () - 1;
+        for (size_t slot = hash_ & mask; _slots[slot].used;
+             slot = (slot + 1) & mask) {
+            const slot_t &candidate = _slots[slot];
+            if (candidate.hash == hash_ && candidate.key_size == size_
+                && (size_ == 0
+                    || memcmp (&_keys[candidate.key_offset], key_, size_)
+                         == 0))
+                return slot;
+        }
+        return npos;
+    }
+
+    //  Copies the key to the end of the arena and returns its offset.
+    uint32_t append_key (const unsigned char *key_, size_t size_)
+    {
+        const size_t offset = _keys.size ();
+        zmq_assert (offset + size_ <= UINT32_MAX);
+        _keys.insert (_keys.end (), key_, key_ + size_);
+        return static_cast<uint32_t> (offset);
+    }
+
+    void compact_keys ()
+    {
+        keys_t keys;
+        keys.reserve (_keys.size () - _garbage);
+        for (typename slots_t::size_type i = 0, n = _slots.size (); i != n;
+             ++i) {
+            slot_t &slot = _slots[i];
+            if (!slot.used)
+                continue;
+            const unsigned char *const key = &_keys[0] + slot.key_offset;
+            slot.key_offset = static_cast<uint32_t> (keys.size ());
+            keys.insert (keys.end (), key, key + slot.key_size);
+        }
+        _keys.swap (keys);
+        _garbage = 0;
+    }
+
+    void rehash (size_t count_)
+    {
+        slots_t slots (count_);
+        const size_t mask = count_ - 1;
+        for (typename slots_t::size_type i = 0, n = _slots.size (); i != n;
+             ++i) {
+            if (!_slots[i].used)
+                continue;
+            size_t slot = _slots[i].hash & mask;
+            while (slots[slot].used)
+                slot = (slot + 1) & mask;
+            slots[slot] = _slots[i];
+        }
+        _slots.swap (slots);
+    }
+
+    slots_t _slots;
+    size_t _size;
+
+    //  Bytes of all the keys, including those of removed keys until the
+    //  arena is compacted.
+    keys_t _keys;
+    size_t _garbage;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (blob_map_t)
+};
+}
+
+#endif
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "chunk_pool.hpp"
+#include "err.hpp"
+
+#include <new>
+#include <stdlib.h>
+
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+#include <tbb/scalable_allocator.h>
+#endif
+
+zmq::chunk_pool_t::chunk_pool_t (size_t size_, int max_chunks_) :
+    _size (size_),
+    _max_chunks (max_chunks_),
+    _slots (NULL),
+    _top (0)
+{
+    zmq_assert (max_chunks_ >= 0);
+    if (_max_chunks) {
+        _slots = new (std::nothrow) atomic_ptr_t<void>[_max_chunks];
+        alloc_assert (_slots);
+    }
+}
+
+zmq::chunk_pool_t::~chunk_pool_t ()
+{
+    for (int i = 0; i != _max_chunks; i++)
+        free_chunk (_slots[i].xchg (NULL));
+    delete[] _slots;
+}
+
+void *zmq::chunk_pool_t::allocate ()
+{
+    if (_cached.get ()) {
+        //  Look for an idle chunk below the slot used last.
+        const int top = _top.load ();
+        for (int i = 1; i <= _max_chunks; i++) {
+            const int slot = (top - i + _max_chunks) % _max_chunks;
+            if (!_slots[slot].load ())
+                continue;
+            void *const chunk = _slots[slot].xchg (NULL);
+            if (chunk) {
+                _top.store (slot);
+                _cached.sub (1);
+                _hits.add (1);
+                return chunk;
+            }
+        }
+    }
+
+    _misses.add (1);
+    return allocate_chunk (_size);
+}
+
+void zmq::chunk_pool_t::deallocate (void *chunk_)
+{
+    if (!chunk_)
+        return;
+
+    const atomic_counter_t::integer_t max_chunks = _max_chunks;
+    if (_cached.get () < max_chunks) {
+        //  Look for an empty slot from the slot used last upwards.
+        const int top = _top.load ();
+        for (int i = 0; i != _max_chunks; i++) {
+            const int slot = (top + i) % _max_chunks;
+            if (_slots[slot].load ())
+                continue;
+            if (!_slots[slot].cas (NULL, chunk_)) {
+                _top.store ((slot + 1) % _max_chunks);
+                _cached.add (1);
+                return;
+            }
+        }
+    }
+
+    _drops.add (1);
+    free_chunk (chunk_);
+}
+
+int zmq::chunk_pool_t::cached () const
+{
+    return static_cast<int> (_cached.get ());
+}
+
+int zmq::chunk_pool_t::hits () const
+{
+    return static_cast<int> (_hits.get ());
+}
+
+int zmq::chunk_pool_t::misses () const
+{
+    return static_cast<int> (_misses.get ());
+}
+
+int zmq::chunk_pool_t::drops () const
+{
+    return static_cast<int> (_drops.get ());
+}
+
+void *zmq::chunk_pool_t::allocate_chunk (size_t size_)
+{
+#if defined HAVE_POSIX_MEMALIGN
+    void *pv;
+    if (posix_memalign (&pv, ZMQ_CACHELINE_SIZE, size_) == 0)
+        return pv;
+    return NULL;
+#elif defined ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+    return scalable_aligned_malloc (size_, ZMQ_CACHELINE_SIZE);
+#elif defined _MSC_VER
+    return _aligned_malloc (size_, ZMQ_CACHELINE_SIZE);
+#else
+    return malloc (size_);
+#endif
+}
+
+void zmq::chunk_pool_t::free_chunk (void *chunk_)
+{
+#if defined ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+    scalable_aligned_free (chunk_);
+#elif defined _MSC_VER
+    _aligned_free (chunk_);
+#else
+    free (chunk_);
+#endif
+}
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_CHUNK_POOL_HPP_INCLUDED__
+#define __ZMQ_CHUNK_POOL_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "atomic_counter.hpp"
+#include "atomic_ptr.hpp"
+#include "macros.hpp"
+
+namespace zmq
+{
+//  Cache-aligned memory chunks of a single size, kept for reuse by any
+//  number of queues in any thread once they are done with them. The pool
+//  keeps at most max_chunks_ idle chunks and returns the others to the
+//  heap, so idle queues don't grow the memory footprint without bound.
+//
+//  The idle chunks sit in an array of slots. Chunks are put into empty
+//  slots and taken out of full ones by atomic operations on the slot
+//  alone, starting next to the slot used last, so the pool works like a
+//  stack without a single point of contention.
+
+class chunk_pool_t
+{
+  public:
+    chunk_pool_t (size_t size_, int max_chunks_);
+    ~chunk_pool_t ();
+
+    size_t size () const { return _size; }
+
+    //  Returns a chunk, or NULL if out of memory.
+    void *allocate ();
+
+    void deallocate (void *chunk_);
+
+    //  Number of idle chunks in the pool.
+    int cached () const;
+
+    //  Numbers of chunks handed out from the pool and allocated from the
+    //  heap, and of chunks returned to the heap as the pool was full.
+    int hits () const;
+    int misses () const;
+    int drops () const;
+
+  private:
+    static void *allocate_chunk (size_t size_);
+    static void free_chunk (void *chunk_);
+
+    const size_t _size;
+    const int _max_chunks;
+    atomic_ptr_t<void> *_slots;
+
+    //  Slot next to the last one used.
+    atomic_value_t _top;
+
+    atomic_counter_t _cached;
+    atomic_counter_t _hits;
+    atomic_counter_t _misses;
+    atomic_counter_t _drops;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (chunk_pool_t)
+};
+}
+
+#endif
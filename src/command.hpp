@@ -164,20 +164,24 @@ struct command_t
         {
         } reaped;
 
-        //  Send application-side pipe count and ask to send monitor event
+        //  Send application-side pipe count and memory footprint and ask
+        //  to send monitor event
         struct
         {
             uint64_t queue_count;
+            uint64_t queue_footprint;
             zmq::own_t *socket_base;
             endpoint_uri_pair_t *endpoint_pair;
         } pipe_peer_stats;
 
-        //  Collate application thread and I/O thread pipe counts and endpoints
-        //  and send as event
+        //  Collate application thread and I/O thread pipe counts, memory
+        //  footprints and endpoints and send as event
         struct
         {
             uint64_t outbound_queue_count;
             uint64_t inbound_queue_count;
+            uint64_t outbound_queue_footprint;
+            uint64_t inbound_queue_footprint;
             endpoint_uri_pair_t *endpoint_pair;
         } pipe_stats_publish;
 
@@ -0,0 +1,145 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_COMPACT_MTRIE_HPP_INCLUDED__
+#define __ZMQ_COMPACT_MTRIE_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <vector>
+
+#include "macros.hpp"
+#include "stdint.hpp"
+#include "atomic_counter.hpp"
+#include "topic_batch.hpp"
+
+namespace zmq
+{
+//  Multi-trie with the same interface as generic_mtrie_t, laid out for
+//  large subscription sets. Chains of single-child nodes are collapsed
+//  into one node holding the whole edge label, the first byte of every
+//  child edge sits in a small array scanned with memchr, and the values
+//  of a node are kept in a sorted vector instead of a std::set.
+template <typename T> class compact_mtrie_t
+{
+  public:
+    typedef T value_t;
+    typedef const unsigned char *prefix_t;
+
+    //  Same values as generic_mtrie_t<T>::rm_result.
+    enum rm_result
+    {
+        not_found,
+        last_value_removed,
+        values_remain
+    };
+
+    compact_mtrie_t ();
+    ~compact_mtrie_t ();
+
+    //  Add key to the trie. Returns true iff no entry with the same prefix_
+    //  and size_ existed before.
+    bool add (prefix_t prefix_, size_t size_, value_t *value_);
+
+    //  Adds the topics to the trie one after the other. Calls func_ for
+    //  each topic with whether no entry with the same prefix existed
+    //  before.
+    template <typename Arg>
+    void add_many (const topic_t *topics_,
+                   size_t count_,
+                   value_t *value_,
+                   void (*func_) (const topic_t &topic_, bool added_, Arg arg_),
+                   Arg arg_);
+
+    //  Remove all entries with a specific value from the trie.
+    //  The call_on_uniq_ flag controls if the callback is invoked
+    //  when there are no entries left on a prefix only (true)
+    //  or on every removal (false). The arg_ argument is passed
+    //  through to the callback function.
+    template <typename Arg>
+    void rm (value_t *value_,
+             void (*func_) (const unsigned char *data_, size_t size_, Arg arg_),
+             Arg arg_,
+             bool call_on_uniq_);
+
+    //  Removes a specific entry from the trie.
+    //  Returns the result of the operation.
+    rm_result rm (prefix_t prefix_, size_t size_, value_t *value_);
+
+    //  Calls a callback function for all matching entries, i.e. any node
+    //  corresponding to data_ or a prefix of it. The arg_ argument
+    //  is passed through to the callback function.
+    template <typename Arg>
+    void match (prefix_t data_,
+                size_t size_,
+                void (*func_) (value_t *value_, Arg arg_),
+                Arg arg_);
+
+    //  Retrieve the number of prefixes stored in this trie (added - removed)
+    //  Note this is a multithread safe function.
+    uint32_t num_prefixes () const { return _num_prefixes.get (); }
+
+  private:
+    //  A node is allocated in one block together with its edge label.
+    //  The children array is followed by the first label byte of each
+    //  child, in the same order.
+    struct node_t
+    {
+        value_t **values;
+        node_t **children;
+        uint32_t value_count;
+        uint32_t value_capacity;
+        uint32_t label_size;
+        unsigned short child_count;
+        unsigned short child_capacity;
+
+        unsigned char *label ()
+        {
+            return reinterpret_cast<unsigned char *> (this + 1);
+        }
+        unsigned char *keys ()
+        {
+            return reinterpret_cast<unsigned char *> (children
+                                                      + child_capacity);
+        }
+    };
+
+    //  Position of a node on a path from the root.
+    struct step_t
+    {
+        node_t *parent;
+        unsigned short index;
+    };
+
+    //  Frame of the depth-first traversal done by rm (value_t *, ...).
+    struct frame_t
+    {
+        node_t *node;
+        unsigned short next_child;
+        size_t size;
+    };
+
+    static node_t *alloc_node (const unsigned char *label_, size_t size_);
+    static void free_node (node_t *node_);
+    static int find_child (node_t *node_, unsigned char c_);
+    static void add_child (node_t *node_, node_t *child_);
+    static void remove_child (node_t *node_, unsigned short index_);
+    static bool add_value (node_t *node_, value_t *value_);
+    static bool remove_value (node_t *node_, value_t *value_);
+
+    //  Removes the child at index_ if it holds nothing anymore, or merges
+    //  it with its only child. Returns true if the child was removed.
+    static bool compact_child (node_t *node_, unsigned short index_);
+
+    node_t *_root;
+
+    atomic_counter_t _num_prefixes;
+
+    //  Scratch space kept between calls to avoid reallocations.
+    std::vector<step_t> _path;
+    std::vector<frame_t> _frames;
+    std::vector<unsigned char> _buffer;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (compact_mtrie_t)
+};
+}
+
+#endif
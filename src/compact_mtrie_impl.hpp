@@ -0,0 +1,369 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_COMPACT_MTRIE_IMPL_HPP_INCLUDED__
+#define __ZMQ_COMPACT_MTRIE_IMPL_HPP_INCLUDED__
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "err.hpp"
+#include "macros.hpp"
+#include "compact_mtrie.hpp"
+
+namespace zmq
+{
+template <typename T>
+compact_mtrie_t<T>::compact_mtrie_t () :
+    _root (alloc_node (NULL, 0)), _num_prefixes (0)
+{
+}
+
+template <typename T> compact_mtrie_t<T>::~compact_mtrie_t ()
+{
+    //  Freed without recursion, remote peers control the depth.
+    std::vector<node_t *> nodes (1, _root);
+    while (!nodes.empty ()) {
+        node_t *node = nodes.back ();
+        nodes.pop_back ();
+        nodes.insert (nodes.end (), node->children,
+                      node->children + node->child_count);
+        free_node (node);
+    }
+}
+
+template <typename T>
+typename compact_mtrie_t<T>::node_t *
+compact_mtrie_t<T>::alloc_node (const unsigned char *label_, size_t size_)
+{
+    node_t *node =
+      static_cast<node_t *> (std::malloc (sizeof (node_t) + size_));
+    alloc_assert (node);
+    node->values = NULL;
+    node->children = NULL;
+    node->value_count = 0;
+    node->value_capacity = 0;
+    node->label_size = static_cast<uint32_t> (size_);
+    node->child_count = 0;
+    node->child_capacity = 0;
+    if (size_)
+        memcpy (node->label (), label_, size_);
+    return node;
+}
+
+template <typename T> void compact_mtrie_t<T>::free_node (node_t *node_)
+{
+    std::free (node_->values);
+    std::free (node_->children);
+    std::free (node_);
+}
+
+template <typename T>
+int compact_mtrie_t<T>::find_child (node_t *node_, unsigned char c_)
+{
+    if (!node_->child_count)
+        return -1;
+    const unsigned char *keys = node_->keys ();
+    const void *key = memchr (keys, c_, node_->child_count);
+    return key ? static_cast<int> (static_cast<const unsigned char *> (key)
+                                   - keys)
+               : -1;
+}
+
+template <typename T>
+void compact_mtrie_t<T>::add_child (node_t *node_, node_t *child_)
+{
+    if (node_->child_count == node_->child_capacity) {
+        const unsigned short capacity =
+          node_->child_capacity ? std::min (node_->child_capacity * 2, 256)
+                                : 2;
+        node_t **children = static_cast<node_t **> (
+          std::malloc (capacity * (sizeof (node_t *) + 1)));
+        alloc_assert (children);
+        if (node_->child_count) {
+            memcpy (children, node_->children,
+                    node_->child_count * sizeof (node_t *));
+            memcpy (children + capacity, node_->keys (), node_->child_count);
+        }
+        std::free (node_->children);
+        node_->children = children;
+        node_->child_capacity = capacity;
+    }
+    node_->children[node_->child_count] = child_;
+    node_->keys ()[node_->child_count] = *child_->label ();
+    ++node_->child_count;
+}
+
+template <typename T>
+void compact_mtrie_t<T>::remove_child (node_t *node_, unsigned short index_)
+{
+    //  Children are not ordered, so the last one fills the hole.
+    const unsigned short last = --node_->child_count;
+    node_->children[index_] = node_->children[last];
+    node_->keys ()[index_] = node_->keys ()[last];
+    if (!node_->child_count) {
+        std::free (node_->children);
+        node_->children = NULL;
+        node_->child_capacity = 0;
+    }
+}
+
+template <typename T>
+bool compact_mtrie_t<T>::add_value (node_t *node_, value_t *value_)
+{
+    value_t **end = node_->values + node_->value_count;
+    value_t **it = std::lower_bound (node_->values, end, value_);
+    if (it != end && *it == value_)
+        return false;
+
+    const size_t pos = it - node_->values;
+    if (node_->value_count == node_->value_capacity) {
+        const uint32_t capacity =
+          node_->value_capacity ? node_->value_capacity * 2 : 1;
+        value_t **values = static_cast<value_t **> (
+          std::realloc (node_->values, capacity * sizeof (value_t *)));
+        alloc_assert (values);
+        node_->values = values;
+        node_->value_capacity = capacity;
+    }
+    memmove (node_->values + pos + 1, node_->values + pos,
+             (node_->value_count - pos) * sizeof (value_t *));
+    node_->values[pos] = value_;
+    ++node_->value_count;
+    return true;
+}
+
+template <typename T>
+bool compact_mtrie_t<T>::remove_value (node_t *node_, value_t *value_)
+{
+    value_t **end = node_->values + node_->value_count;
+    value_t **it = std::lower_bound (node_->values, end, value_);
+    if (it == end || *it != value_)
+        return false;
+
+    memmove (it, it + 1, (end - it - 1) * sizeof (value_t *));
+    if (!--node_->value_count) {
+        std::free (node_->values);
+        node_->values = NULL;
+        node_->value_capacity = 0;
+    }
+    return true;
+}
+
+template <typename T>
+bool compact_mtrie_t<T>::compact_child (node_t *node_, unsigned short index_)
+{
+    node_t *child = node_->children[index_];
+    if (child->value_count)
+        return false;
+
+    if (!child->child_count) {
+        free_node (child);
+        remove_child (node_, index_);
+        return true;
+    }
+
+    if (child->child_count == 1) {
+        //  Prepend the label of the child to the label of its only child.
+        //  Nodes have no parent pointers, so the grandchild may move.
+        node_t *grandchild = child->children[0];
+        const size_t size = child->label_size + grandchild->label_size;
+        grandchild = static_cast<node_t *> (
+          std::realloc (grandchild, sizeof (node_t) + size));
+        alloc_assert (grandchild);
+        memmove (grandchild->label () + child->label_size,
+                 grandchild->label (), grandchild->label_size);
+        memcpy (grandchild->label (), child->label (), child->label_size);
+        grandchild->label_size = static_cast<uint32_t> (size);
+        node_->children[index_] = grandchild;
+        free_node (child);
+    }
+    return false;
+}
+
+template <typename T>
+bool compact_mtrie_t<T>::add (prefix_t prefix_, size_t size_, value_t *value_)
+{
+    node_t *node = _root;
+
+    while (size_) {
+        const int index = find_child (node, *prefix_);
+        if (index < 0) {
+            node_t *leaf = alloc_node (prefix_, size_);
+            add_child (node, leaf);
+            node = leaf;
+            break;
+        }
+
+        node_t *child = node->children[index];
+        const unsigned char *label = child->label ();
+        const size_t max = std::min<size_t> (child->label_size, size_);
+        size_t common = 1;
+        while (common < max && label[common] == prefix_[common])
+            ++common;
+
+        if (common < child->label_size) {
+            //  The key ends or diverges inside the edge label, split
+            //  the edge. The child keeps the tail of the label.
+            node_t *split = alloc_node (label, common);
+            child->label_size -= static_cast<uint32_t> (common);
+            memmove (child->label (), label + common, child->label_size);
+            add_child (split, child);
+            node->children[index] = split;
+            child = split;
+        }
+
+        node = child;
+        prefix_ += common;
+        size_ -= common;
+    }
+
+    const bool result = !node->value_count;
+    if (result)
+        _num_prefixes.add (1);
+    add_value (node, value_);
+    return result;
+}
+
+template <typename T>
+template <typename Arg>
+void compact_mtrie_t<T>::add_many (const topic_t *topics_,
+                                   size_t count_,
+                                   value_t *value_,
+                                   void (*func_) (const topic_t &topic_,
+                                                  bool added_,
+                                                  Arg arg_),
+                                   Arg arg_)
+{
+    //  Splitting edges moves nodes around, so every topic walks down
+    //  from the root.
+    for (size_t i = 0; i != count_; ++i)
+        func_ (topics_[i], add (topics_[i].data, topics_[i].size, value_),
+               arg_);
+}
+
+template <typename T>
+template <typename Arg>
+void compact_mtrie_t<T>::rm (value_t *value_,
+                             void (*func_) (prefix_t data_,
+                                            size_t size_,
+                                            Arg arg_),
+                             Arg arg_,
+                             bool call_on_uniq_)
+{
+    //  Depth-first traversal with an explicit stack, remote peers control
+    //  the depth of the trie. Each child is compacted once its subtree
+    //  has been visited.
+    _frames.clear ();
+    _buffer.clear ();
+    node_t *node = _root;
+    size_t size = 0;
+
+    while (true) {
+        //  Remove the value from the node just entered.
+        if (remove_value (node, value_)) {
+            if (!node->value_count) {
+                zmq_assert (_num_prefixes.get () > 0);
+                _num_prefixes.sub (1);
+            }
+            if (!call_on_uniq_ || !node->value_count)
+                func_ (size ? &_buffer[0] : NULL, size, arg_);
+        }
+        const frame_t frame = {node, 0, size};
+        _frames.push_back (frame);
+
+        //  Find the next child to enter, compacting the ones done with.
+        node = NULL;
+        while (!_frames.empty ()) {
+            frame_t &top = _frames.back ();
+            if (top.next_child < top.node->child_count) {
+                node = top.node->children[top.next_child];
+                size = top.size + node->label_size;
+                _buffer.resize (size);
+                memcpy (&_buffer[top.size], node->label (), node->label_size);
+                break;
+            }
+            _frames.pop_back ();
+            if (!_frames.empty ()) {
+                frame_t &parent = _frames.back ();
+                //  A removed child is replaced by the last, unvisited one.
+                if (!compact_child (parent.node, parent.next_child))
+                    ++parent.next_child;
+            }
+        }
+        if (!node)
+            break;
+    }
+}
+
+template <typename T>
+typename compact_mtrie_t<T>::rm_result
+compact_mtrie_t<T>::rm (prefix_t prefix_, size_t size_, value_t *value_)
+{
+    _path.clear ();
+    node_t *node = _root;
+
+    while (size_) {
+        const int index = find_child (node, *prefix_);
+        if (index < 0)
+            return not_found;
+        node_t *child = node->children[index];
+        if (child->label_size > size_
+            || memcmp (child->label (), prefix_, child->label_size) != 0)
+            return not_found;
+
+        const step_t step = {node, static_cast<unsigned short> (index)};
+        _path.push_back (step);
+        node = child;
+        prefix_ += child->label_size;
+        size_ -= child->label_size;
+    }
+
+    if (!remove_value (node, value_))
+        return not_found;
+    if (node->value_count)
+        return values_remain;
+
+    zmq_assert (_num_prefixes.get () > 0);
+    _num_prefixes.sub (1);
+
+    //  Compact upwards for as long as nodes get removed.
+    while (!_path.empty ()
+           && compact_child (_path.back ().parent, _path.back ().index))
+        _path.pop_back ();
+
+    return last_value_removed;
+}
+
+template <typename T>
+template <typename Arg>
+void compact_mtrie_t<T>::match (prefix_t data_,
+                                size_t size_,
+                                void (*func_) (value_t *value_, Arg arg_),
+                                Arg arg_)
+{
+    node_t *node = _root;
+    while (true) {
+        //  Signal the values attached to this node.
+        for (uint32_t i = 0; i != node->value_count; ++i)
+            func_ (node->values[i], arg_);
+
+        //  If we are at the end of the message, there's nothing more to match.
+        if (!size_)
+            break;
+
+        const int index = find_child (node, *data_);
+        if (index < 0)
+            break;
+        node = node->children[index];
+        if (node->label_size > size_
+            || memcmp (node->label (), data_, node->label_size) != 0)
+            break;
+        data_ += node->label_size;
+        size_ -= node->label_size;
+    }
+}
+}
+
+#endif
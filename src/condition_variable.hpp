@@ -23,6 +23,8 @@ class condition_variable_t
         return -1;
     }
 
+    inline void signal () { zmq_assert (false); }
+
     inline void broadcast () { zmq_assert (false); }
 
     ZMQ_NON_COPYABLE_NOR_MOVABLE (condition_variable_t)
@@ -56,6 +58,8 @@ class condition_variable_t
         return -1;
     }
 
+    inline void signal () { WakeConditionVariable (&_cv); }
+
     inline void broadcast () { WakeAllConditionVariable (&_cv); }
 
   private:
@@ -92,6 +96,12 @@ class condition_variable_t
         return res;
     }
 
+    void signal ()
+    {
+        // this assumes that the mutex associated with _cv has been locked by the caller
+        _cv.notify_one ();
+    }
+
     void broadcast ()
     {
         // this assumes that the mutex associated with _cv has been locked by the caller
@@ -172,6 +182,13 @@ class condition_variable_t
         return -1;
     }
 
+    inline void signal ()
+    {
+        scoped_lock_t l (_listenersMutex);
+        if (!_listeners.empty ())
+            semGive (_listeners[0]);
+    }
+
     inline void broadcast ()
     {
         scoped_lock_t l (_listenersMutex);
@@ -268,6 +285,12 @@ class condition_variable_t
         return -1;
     }
 
+    inline void signal ()
+    {
+        int rc = pthread_cond_signal (&_cond);
+        posix_assert (rc);
+    }
+
     inline void broadcast ()
     {
         int rc = pthread_cond_broadcast (&_cond);
@@ -14,6 +14,28 @@ enum
     //  memory allocation by approximately 99.6%
     message_pipe_granularity = 256,
 
+    //  Number of messages the first memory chunk of a message pipe holds.
+    //  Chunks double in size while the pipe is busy, up to
+    //  message_pipe_granularity, and start over from this size once the
+    //  reader has caught up, so idle pipes cost little memory.
+    message_pipe_min_granularity = 8,
+
+    //  Default maximal number of idle message pipe chunks a context keeps
+    //  for reuse, see ZMQ_PIPE_CHUNK_POOL_MAX. A pooled chunk holds
+    //  message_pipe_granularity messages.
+    pipe_chunk_pool_max = 64,
+
+    //  Maximal number of idle decoder buffers an I/O thread keeps for
+    //  reuse, see ZMQ_DECODER_BUFFER_HITS.
+    decoder_buffer_pool_max = 64,
+
+    //  Address space the message pool reserves for each NUMA node, see
+    //  ZMQ_MSG_POOL. Memory is only committed as the pool needs it.
+    msg_pool_arena_size = 512 * 1024 * 1024,
+
+    //  Maximal number of NUMA nodes the message pool keeps memory for.
+    msg_pool_max_nodes = 8,
+
     //  Commands in pipe per allocation event.
     command_pipe_granularity = 16,
 
@@ -36,6 +58,55 @@ enum
     //  latency and fairness.
     proxy_burst_size = 1000,
 
+    //  Maximal time (in milliseconds) the socket of a closed TCP engine is
+    //  kept open for the kernel to release the messages sent with
+    //  MSG_ZEROCOPY. Past that the connection is reset so that the unsent
+    //  data are dropped.
+    zero_copy_linger = 100,
+
+    //  Message bodies of at least this size are written by stream engines
+    //  straight from the message, in a vectored write along with the rest
+    //  of the batch, instead of being copied to the batch buffer. Smaller
+    //  bodies are cheaper to copy than to gather.
+    out_gather_threshold = 256,
+
+    //  Maximal number of buffers gathered in a single vectored write.
+    out_gather_max_chunks = 64,
+
+    //  Maximal value of ZMQ_UDP_BATCH_SIZE. Linux does not accept more
+    //  messages than this in a single recvmmsg/sendmmsg call.
+    max_udp_batch_size = 1024,
+
+    //  Number of times a spinning mailbox checks for commands between
+    //  two readings of the clock.
+    mailbox_spin_checks = 64,
+
+    //  Minimal number of eligible pipes for a sharded distributor to hand
+    //  its messages to the fan-out threads. Below that the sending thread
+    //  writes all the pipes itself.
+    fanout_min_pipes = 64,
+
+    //  Size in bytes past which the subscriptions an XSUB socket resends
+    //  to a new or hiccuped pipe are split into another batch, so that
+    //  the SNDHWM limits what is queued rather than dropping everything.
+    max_subscription_batch_size = 8192,
+
+    //  Jobs in the queue of a fan-out thread per allocation event.
+    fanout_queue_granularity = 256,
+
+    //  Maximal number of shards of a distributor, each but one written by
+    //  a thread of the fan-out pool of the context.
+    fanout_max_shards = 64,
+
+    //  Maximal number of messages an engine has on their way through the
+    //  crypto threads in each direction. Past that the engine stops
+    //  reading from the session (the network) until some are done.
+    crypto_max_in_flight = 64,
+
+    //  Size in bytes past which the scratch buffers a crypto thread used
+    //  to seal or open a message are freed rather than kept for the next.
+    crypto_max_scratch_size = 65536,
+
     //  Maximal delay to process command in API thread (in CPU ticks).
     //  3,000,000 ticks equals to 1 - 2 milliseconds on current CPUs.
     //  Note that delay is only applied when there is continuous stream of
@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "crypto_pool.hpp"
+#include "config.hpp"
+#include "ctx.hpp"
+#include "err.hpp"
+#include "mechanism.hpp"
+
+zmq::crypto_pool_t::crypto_pool_t (const thread_ctx_t &ctx_, int threads_) :
+    _stopping (false)
+{
+    zmq_assert (threads_ > 0);
+    for (int i = 0; i != threads_; i++) {
+        thread_t *thread = new (std::nothrow) thread_t;
+        alloc_assert (thread);
+        _threads.push_back (thread);
+        ctx_.start_thread (*thread, worker_routine, this, "Crypto");
+    }
+}
+
+zmq::crypto_pool_t::~crypto_pool_t ()
+{
+    {
+        scoped_lock_t locker (_sync);
+        //  The channels are destroyed along with their engines, before the
+        //  I/O threads stop.
+        zmq_assert (_jobs.empty ());
+        _stopping = true;
+        _job_posted.broadcast ();
+    }
+    for (std::vector<thread_t *>::iterator it = _threads.begin (),
+                                           end = _threads.end ();
+         it != end; ++it) {
+        (*it)->stop ();
+        LIBZMQ_DELETE (*it);
+    }
+}
+
+void zmq::crypto_pool_t::post (const job_t &job_)
+{
+    //  A single job needs a single thread.
+    _jobs.push_back (job_);
+    _job_posted.signal ();
+}
+
+void zmq::crypto_pool_t::worker_routine (void *arg_)
+{
+    crypto_pool_t *pool = static_cast<crypto_pool_t *> (arg_);
+
+    //  Jobs of the same lane run on several threads at once, so each
+    //  thread has scratch buffers of its own.
+    crypto_scratch_t scratch;
+
+    scoped_lock_t locker (pool->_sync);
+    while (true) {
+        while (!pool->_stopping && pool->_jobs.empty ())
+            pool->_job_posted.wait (&pool->_sync, -1);
+        if (pool->_jobs.empty ())
+            return;
+
+        const job_t job = pool->_jobs.front ();
+        pool->_jobs.pop_front ();
+        crypto_channel_t::item_t *item =
+          static_cast<crypto_channel_t::item_t *> (job.item);
+        job.channel->_running++;
+
+        pool->_sync.unlock ();
+        job.channel->run (job.lane, item, scratch);
+        job.channel->complete (job.lane, item);
+        pool->_sync.lock ();
+
+        //  The channel may be destroyed once no job of it is running.
+        if (--job.channel->_running == 0)
+            pool->_channel_idle.broadcast ();
+    }
+}
+
+zmq::crypto_channel_t::crypto_channel_t (io_thread_t *io_thread_,
+                                         crypto_pool_t *pool_,
+                                         const mechanism_t *mechanism_,
+                                         i_crypto_events *sink_) :
+    io_object_t (io_thread_),
+    _pool (pool_),
+    _mechanism (mechanism_),
+    _sink (sink_),
+    _running (0),
+    _signalled (false),
+    _handle (static_cast<handle_t> (NULL))
+{
+    for (int i = 0; i != lane_count; i++)
+        _oldest[i].store (NULL);
+
+    if (_signaler.valid ()) {
+        _handle = add_fd (_signaler.get_fd ());
+        set_pollin (_handle);
+    }
+}
+
+zmq::crypto_channel_t::~crypto_channel_t ()
+{
+    {
+        //  Jobs not started yet are dropped, running ones waited for.
+        scoped_lock_t locker (_pool->_sync);
+        for (std::deque<crypto_pool_t::job_t>::iterator it =
+               _pool->_jobs.begin ();
+             it != _pool->_jobs.end ();) {
+            if (it->channel == this)
+                it = _pool->_jobs.erase (it);
+            else
+                ++it;
+        }
+        while (_running)
+            _pool->_channel_idle.wait (&_pool->_sync, -1);
+    }
+
+    for (int i = 0; i != lane_count; i++)
+        for (lane_t::iterator it = _lanes[i].begin (), end = _lanes[i].end ();
+             it != end; ++it) {
+            const int rc = it->msg.close ();
+            errno_assert (rc == 0);
+        }
+
+    if (_signaler.valid ())
+        rm_fd (_handle);
+    unplug ();
+}
+
+bool zmq::crypto_channel_t::valid () const
+{
+    return _signaler.valid ();
+}
+
+bool zmq::crypto_channel_t::can_seal () const
+{
+    return _lanes[seal_lane].size () < crypto_max_in_flight;
+}
+
+bool zmq::crypto_channel_t::can_open () const
+{
+    return _lanes[open_lane].size () < crypto_max_in_flight;
+}
+
+void zmq::crypto_channel_t::seal (msg_t *msg_)
+{
+    post (seal_lane, msg_);
+}
+
+void zmq::crypto_channel_t::open (msg_t *msg_)
+{
+    post (open_lane, msg_);
+}
+
+bool zmq::crypto_channel_t::pop_sealed (msg_t *msg_)
+{
+    item_t *item = front (seal_lane);
+    if (!item)
+        return false;
+    const int rc = msg_->move (item->msg);
+    errno_assert (rc == 0);
+    pop (seal_lane);
+    return true;
+}
+
+bool zmq::crypto_channel_t::has_sealed ()
+{
+    return front (seal_lane) != NULL;
+}
+
+zmq::msg_t *zmq::crypto_channel_t::front_opened (int *error_event_code_)
+{
+    item_t *item = front (open_lane);
+    if (!item)
+        return NULL;
+    *error_event_code_ = item->error_event_code;
+    return &item->msg;
+}
+
+void zmq::crypto_channel_t::pop_opened ()
+{
+    pop (open_lane);
+}
+
+void zmq::crypto_channel_t::in_event ()
+{
+    _signaler.recv ();
+    _signalled.store (false);
+
+    //  The sink may destroy the channel.
+    _sink->crypto_done ();
+}
+
+void zmq::crypto_channel_t::post (int lane_, msg_t *msg_)
+{
+    lane_t &lane = _lanes[lane_];
+    lane.emplace_back ();
+    item_t &item = lane.back ();
+    int rc = item.msg.init ();
+    errno_assert (rc == 0);
+    rc = item.msg.move (*msg_);
+    errno_assert (rc == 0);
+    item.error_event_code = 0;
+    item.done.store (false);
+    if (lane.size () == 1)
+        _oldest[lane_].store (&item);
+
+    const crypto_pool_t::job_t job = {this, lane_, &item};
+    scoped_lock_t locker (_pool->_sync);
+    _pool->post (job);
+}
+
+zmq::crypto_channel_t::item_t *zmq::crypto_channel_t::front (int lane_)
+{
+    lane_t &lane = _lanes[lane_];
+    if (lane.empty () || !lane.front ().done.load ())
+        return NULL;
+    return &lane.front ();
+}
+
+void zmq::crypto_channel_t::pop (int lane_)
+{
+    lane_t &lane = _lanes[lane_];
+    lane.pop_front ();
+
+    //  Either the thread completing the new oldest message sees it is the
+    //  oldest, or the next call to front sees it done.
+    _oldest[lane_].store (lane.empty () ? NULL : &lane.front ());
+}
+
+void zmq::crypto_channel_t::run (int lane_,
+                                 item_t *item_,
+                                 crypto_scratch_t &scratch_)
+{
+    if (lane_ == seal_lane)
+        _mechanism->seal (&item_->msg, scratch_);
+    else if (_mechanism->open (&item_->msg, scratch_,
+                               &item_->error_event_code)
+             == -1)
+        zmq_assert (item_->error_event_code != 0);
+}
+
+void zmq::crypto_channel_t::complete (int lane_, item_t *item_)
+{
+    item_->done.store (true);
+
+    //  Messages done ahead of the oldest one are handed out along with it.
+    if (_oldest[lane_].load () == item_ && !_signalled.exchange (true))
+        _signaler.send ();
+}
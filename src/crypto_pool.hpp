@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+#define __ZMQ_CRYPTO_POOL_HPP_INCLUDED__
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "condition_variable.hpp"
+#include "io_object.hpp"
+#include "macros.hpp"
+#include "msg.hpp"
+#include "mutex.hpp"
+#include "signaler.hpp"
+#include "thread.hpp"
+
+namespace zmq
+{
+class thread_ctx_t;
+class io_thread_t;
+class mechanism_t;
+class crypto_channel_t;
+struct crypto_scratch_t;
+
+//  Threads sealing and opening the messages of secure mechanisms on behalf
+//  of the engines, see mechanism_t::enable_offload. The engines talk to
+//  the pool through a crypto_channel_t each.
+class crypto_pool_t
+{
+  public:
+    crypto_pool_t (const thread_ctx_t &ctx_, int threads_);
+    ~crypto_pool_t ();
+
+  private:
+    friend class crypto_channel_t;
+
+    struct job_t
+    {
+        crypto_channel_t *channel;
+        int lane;
+        void *item;
+    };
+
+    void post (const job_t &job_);
+
+    static void worker_routine (void *arg_);
+
+    std::vector<thread_t *> _threads;
+
+    //  Protects the state below and the counts of running jobs of the
+    //  channels. The lanes of the channels are not under this lock.
+    mutex_t _sync;
+
+    //  Signalled when a job is posted or the pool stops.
+    condition_variable_t _job_posted;
+
+    //  Signalled when a channel being destroyed has no more running jobs.
+    condition_variable_t _channel_idle;
+
+    std::deque<job_t> _jobs;
+
+    bool _stopping;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (crypto_pool_t)
+};
+
+//  Interface the owner of a crypto channel implements to learn that some
+//  of its messages are done.
+struct i_crypto_events
+{
+    virtual ~i_crypto_events () ZMQ_DEFAULT;
+
+    //  Called in the I/O thread of the channel when the oldest message of
+    //  a lane may be done.
+    virtual void crypto_done () = 0;
+};
+
+//  Messages of one engine on their way through the crypto threads. Sealed
+//  and opened messages come back in the order they were handed over, each
+//  in its own lane. The channel lives in the I/O thread of the engine and
+//  wakes the engine up there when the oldest message of a lane is done.
+class crypto_channel_t ZMQ_FINAL : public io_object_t
+{
+  public:
+    //  The mechanism must outlive the channel.
+    crypto_channel_t (io_thread_t *io_thread_,
+                      crypto_pool_t *pool_,
+                      const mechanism_t *mechanism_,
+                      i_crypto_events *sink_);
+    ~crypto_channel_t () ZMQ_OVERRIDE;
+
+    //  Returns false if the channel could not be set up, in which case it
+    //  must be destroyed without being used.
+    bool valid () const;
+
+    //  Returns true if the seal (open) lane holds less messages than
+    //  crypto_max_in_flight. The lanes are not bounded otherwise.
+    bool can_seal () const;
+    bool can_open () const;
+
+    //  Hands the message, prepared by the encode (decode) method of the
+    //  mechanism, over to be sealed (opened).
+    void seal (msg_t *msg_);
+    void open (msg_t *msg_);
+
+    //  Moves the oldest sealed message to msg_. Returns false if it is not
+    //  done yet.
+    bool pop_sealed (msg_t *msg_);
+
+    //  Returns true if the oldest sealed message is done.
+    bool has_sealed ();
+
+    //  Returns the oldest opened message, or NULL if it is not done yet.
+    //  On failure to open it, error_event_code_ is set to the code of the
+    //  protocol error, else to 0.
+    msg_t *front_opened (int *error_event_code_);
+
+    //  Drops the oldest opened message, which was moved away.
+    void pop_opened ();
+
+    //  i_poll_events implementation.
+    void in_event () ZMQ_FINAL;
+
+  private:
+    friend class crypto_pool_t;
+
+    enum
+    {
+        seal_lane,
+        open_lane,
+        lane_count
+    };
+
+    struct item_t
+    {
+        msg_t msg;
+        int error_event_code;
+
+        //  Set by the crypto thread once msg and error_event_code are
+        //  final.
+        std::atomic<bool> done;
+    };
+
+    //  Messages in flight, oldest first. Only the I/O thread adds and
+    //  removes messages, at the ends, which leaves the others in place,
+    //  so the threads work on them while the lane changes.
+    typedef std::deque<item_t> lane_t;
+
+    void post (int lane_, msg_t *msg_);
+    item_t *front (int lane_);
+    void pop (int lane_);
+
+    //  Runs the job in a crypto thread, without holding the lock. The
+    //  scratch buffers are those of the thread.
+    void run (int lane_, item_t *item_, crypto_scratch_t &scratch_);
+
+    //  Marks the job done, without holding the lock, and wakes the
+    //  channel up if the job is the oldest of its lane.
+    void complete (int lane_, item_t *item_);
+
+    crypto_pool_t *const _pool;
+    const mechanism_t *const _mechanism;
+    i_crypto_events *const _sink;
+
+    lane_t _lanes[lane_count];
+
+    //  Oldest message of each lane, NULL if the lane is empty. Written by
+    //  the I/O thread, read by the crypto threads.
+    std::atomic<item_t *> _oldest[lane_count];
+
+    //  Number of jobs of the channel the threads are running, under the
+    //  lock of the pool.
+    int _running;
+
+    //  Wakes the channel up in its I/O thread. It is signalled at most
+    //  once until the channel handles it.
+    signaler_t _signaler;
+    std::atomic<bool> _signalled;
+    handle_t _handle;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (crypto_channel_t)
+};
+}
+
+#endif
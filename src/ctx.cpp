@@ -16,6 +16,13 @@
 #include "socket_base.hpp"
 #include "io_thread.hpp"
 #include "reaper.hpp"
+#include "crypto_pool.hpp"
+#include "fanout_pool.hpp"
+#include "chunk_pool.hpp"
+#include "decoder_allocators.hpp"
+#include "msg_pool.hpp"
+#include "yqueue.hpp"
+#include "config.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
@@ -55,12 +62,18 @@ zmq::ctx_t::ctx_t () :
     _starting (true),
     _terminating (false),
     _reaper (NULL),
+    _crypto_pool (NULL),
+    _fanout_pool (NULL),
+    _chunk_pool (NULL),
     _max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
     _max_msgsz (INT_MAX),
     _io_thread_count (ZMQ_IO_THREADS_DFLT),
     _blocky (true),
     _ipv6 (false),
-    _zero_copy (true)
+    _zero_copy (true),
+    _crypto_thread_count (0),
+    _chunk_pool_max (pipe_chunk_pool_max),
+    _msg_pool (false)
 {
 #ifdef _MSC_VER
 #ifndef NDEBUG
@@ -113,9 +126,20 @@ zmq::ctx_t::~ctx_t ()
         LIBZMQ_DELETE (_io_threads[i]);
     }
 
+    //  The engines using the crypto threads are gone along with the I/O
+    //  threads.
+    LIBZMQ_DELETE (_crypto_pool);
+
+    //  The sockets using the fan-out threads are gone.
+    LIBZMQ_DELETE (_fanout_pool);
+
     //  Deallocate the reaper thread object.
     LIBZMQ_DELETE (_reaper);
 
+    //  The pipes taking chunks from the pool are gone along with the
+    //  sockets.
+    LIBZMQ_DELETE (_chunk_pool);
+
     //  The mailboxes in _slots themselves were deallocated with their
     //  corresponding io_thread/socket objects.
 
@@ -297,6 +321,32 @@ int zmq::ctx_t::set (int option_, const void *optval_, size_t optvallen_)
             }
             break;
 
+        case ZMQ_CRYPTO_THREADS:
+            if (is_int && value >= 0) {
+                scoped_lock_t locker (_opt_sync);
+                _crypto_thread_count = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PIPE_CHUNK_POOL_MAX:
+            if (is_int && value >= 0) {
+                scoped_lock_t locker (_opt_sync);
+                _chunk_pool_max = value;
+                return 0;
+            }
+            break;
+
+#ifdef ZMQ_HAVE_MSG_POOL
+        case ZMQ_MSG_POOL:
+            if (is_int && value >= 0) {
+                scoped_lock_t locker (_opt_sync);
+                _msg_pool = (value != 0);
+                return 0;
+            }
+            break;
+#endif
+
         case ZMQ_PREFERRED_MAX_GROUP_NAME_LENGTH:
         case ZMQ_PREFERRED_MAX_SMALL_MESSAGE_SIZE:
             break;
@@ -378,6 +428,81 @@ int zmq::ctx_t::get (int option_, void *optval_, const size_t *optvallen_)
             }
             break;
 
+        case ZMQ_CRYPTO_THREADS:
+            if (is_int) {
+                scoped_lock_t locker (_opt_sync);
+                *value = _crypto_thread_count;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PIPE_CHUNK_POOL_MAX:
+            if (is_int) {
+                scoped_lock_t locker (_opt_sync);
+                *value = _chunk_pool_max;
+                return 0;
+            }
+            break;
+
+#ifdef ZMQ_HAVE_MSG_POOL
+        case ZMQ_MSG_POOL:
+            if (is_int) {
+                scoped_lock_t locker (_opt_sync);
+                *value = _msg_pool;
+                return 0;
+            }
+            break;
+#endif
+
+        case ZMQ_PIPE_CHUNKS_CACHED:
+            if (is_int) {
+                *value = _chunk_pool ? _chunk_pool->cached () : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PIPE_CHUNK_HITS:
+            if (is_int) {
+                *value = _chunk_pool ? _chunk_pool->hits () : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PIPE_CHUNK_MISSES:
+            if (is_int) {
+                *value = _chunk_pool ? _chunk_pool->misses () : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PIPE_CHUNK_DROPS:
+            if (is_int) {
+                *value = _chunk_pool ? _chunk_pool->drops () : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_DECODER_BUFFER_HITS:
+        case ZMQ_DECODER_BUFFER_MISSES:
+        case ZMQ_DECODER_BUFFER_DROPS:
+            if (is_int) {
+                scoped_lock_t locker (_slot_sync);
+                *value = 0;
+                for (io_threads_t::size_type i = 0, size = _io_threads.size ();
+                     i != size; i++) {
+                    const decoder_buffer_pool_t *const pool =
+                      _io_threads[i]->get_decoder_buffer_pool ();
+                    if (option_ == ZMQ_DECODER_BUFFER_HITS)
+                        *value += pool->hits ();
+                    else if (option_ == ZMQ_DECODER_BUFFER_MISSES)
+                        *value += pool->misses ();
+                    else
+                        *value += pool->drops ();
+                }
+                return 0;
+            }
+            break;
+
         case ZMQ_PREFERRED_MAX_GROUP_NAME_LENGTH:
             if (is_int) {
                 *value = sizeof (msg_t::group_t::sgroup.group) - 1;
@@ -421,6 +546,9 @@ bool zmq::ctx_t::start ()
     const int term_and_reaper_threads_count = 2;
     const int mazmq = _max_sockets;
     const int ios = _io_thread_count;
+    const int cryptos = _crypto_thread_count;
+    const int chunk_pool_max = _chunk_pool_max;
+    const bool msg_pool = _msg_pool;
     _opt_sync.unlock ();
     const int slot_count = mazmq + ios + term_and_reaper_threads_count;
     try {
@@ -437,6 +565,24 @@ bool zmq::ctx_t::start ()
     //  Initialise the infrastructure for zmq_ctx_term thread.
     _slots[term_tid] = &_term_mailbox;
 
+#ifdef ZMQ_HAVE_MSG_POOL
+    //  The message pool serves the whole process. It is left out if the
+    //  application set its own message allocator.
+    if (msg_pool)
+        msg_pool_t::install ();
+#else
+    LIBZMQ_UNUSED (msg_pool);
+#endif
+
+    //  Create the pool the message pipes share their memory chunks through.
+    _chunk_pool = new (std::nothrow) chunk_pool_t (
+      yqueue_t<msg_t, message_pipe_granularity>::chunk_size (),
+      chunk_pool_max);
+    if (!_chunk_pool) {
+        errno = ENOMEM;
+        goto fail_cleanup_slots;
+    }
+
     //  Create the reaper thread.
     _reaper = new (std::nothrow) reaper_t (this, reaper_tid);
     if (!_reaper) {
@@ -448,6 +594,22 @@ bool zmq::ctx_t::start ()
     _slots[reaper_tid] = _reaper->get_mailbox ();
     _reaper->start ();
 
+    //  Create the crypto threads, if any.
+    if (cryptos > 0) {
+        _crypto_pool = new (std::nothrow) crypto_pool_t (*this, cryptos);
+        if (!_crypto_pool) {
+            errno = ENOMEM;
+            goto fail_cleanup_reaper;
+        }
+    }
+
+    //  The fan-out threads are started by the sockets using them.
+    _fanout_pool = new (std::nothrow) fanout_pool_t (*this);
+    if (!_fanout_pool) {
+        errno = ENOMEM;
+        goto fail_cleanup_reaper;
+    }
+
     //  Create I/O thread objects and launch them.
     _slots.resize (slot_count, NULL);
 
@@ -482,6 +644,9 @@ fail_cleanup_reaper:
     _reaper = NULL;
 
 fail_cleanup_slots:
+    LIBZMQ_DELETE (_fanout_pool);
+    LIBZMQ_DELETE (_crypto_pool);
+    LIBZMQ_DELETE (_chunk_pool);
     _slots.clear ();
     return false;
 }
@@ -550,6 +715,21 @@ zmq::object_t *zmq::ctx_t::get_reaper () const
     return _reaper;
 }
 
+zmq::crypto_pool_t *zmq::ctx_t::get_crypto_pool () const
+{
+    return _crypto_pool;
+}
+
+zmq::fanout_pool_t *zmq::ctx_t::get_fanout_pool () const
+{
+    return _fanout_pool;
+}
+
+zmq::chunk_pool_t *zmq::ctx_t::get_chunk_pool () const
+{
+    return _chunk_pool;
+}
+
 zmq::thread_ctx_t::thread_ctx_t () :
     _thread_priority (ZMQ_THREAD_PRIORITY_DFLT),
     _thread_sched_policy (ZMQ_THREAD_SCHED_POLICY_DFLT)
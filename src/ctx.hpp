@@ -24,6 +24,9 @@ class io_thread_t;
 class socket_base_t;
 class reaper_t;
 class pipe_t;
+class crypto_pool_t;
+class fanout_pool_t;
+class chunk_pool_t;
 
 //  Information associated with inproc endpoint. Note that endpoint options
 //  are registered as well so that the peer can access them without a need
@@ -107,6 +110,16 @@ class ctx_t ZMQ_FINAL : public thread_ctx_t
     //  Returns reaper thread object.
     zmq::object_t *get_reaper () const;
 
+    //  Returns the threads the engines hand the cryptography of secure
+    //  mechanisms to, or NULL if the engines do it themselves.
+    zmq::crypto_pool_t *get_crypto_pool () const;
+
+    //  Returns the threads writing the shards of large fan-outs.
+    zmq::fanout_pool_t *get_fanout_pool () const;
+
+    //  Returns the pool the message pipes take their memory chunks from.
+    zmq::chunk_pool_t *get_chunk_pool () const;
+
     //  Management of inproc endpoints.
     int register_endpoint (const char *addr_, const endpoint_t &endpoint_);
     int unregister_endpoint (const std::string &addr_,
@@ -186,6 +199,15 @@ class ctx_t ZMQ_FINAL : public thread_ctx_t
     typedef std::vector<zmq::io_thread_t *> io_threads_t;
     io_threads_t _io_threads;
 
+    //  Crypto threads, if any.
+    zmq::crypto_pool_t *_crypto_pool;
+
+    //  Fan-out threads, started as the sockets ask for them.
+    zmq::fanout_pool_t *_fanout_pool;
+
+    //  Idle memory chunks of the message pipes.
+    zmq::chunk_pool_t *_chunk_pool;
+
     //  Array of pointers to mailboxes for both application and I/O threads.
     std::vector<i_mailbox *> _slots;
 
@@ -225,6 +247,15 @@ class ctx_t ZMQ_FINAL : public thread_ctx_t
     // Should we use zero copy message decoding in this context?
     bool _zero_copy;
 
+    //  Number of crypto threads to launch.
+    int _crypto_thread_count;
+
+    //  Maximal number of idle chunks in the chunk pool.
+    int _chunk_pool_max;
+
+    //  Should the message buffers come from the built-in message pool?
+    bool _msg_pool;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (ctx_t)
 
 #ifdef HAVE_FORK
@@ -9,15 +9,6 @@
 
 #ifdef ZMQ_HAVE_CURVE
 
-#ifdef ZMQ_USE_LIBSODIUM
-//  libsodium added crypto_box_easy_afternm and crypto_box_open_easy_afternm with
-//  https: //github.com/jedisct1/libsodium/commit/aaf5fbf2e53a33b18d8ea9bdf2c6f73d7acc8c3e
-#if SODIUM_LIBRARY_VERSION_MAJOR > 7                                           \
-  || (SODIUM_LIBRARY_VERSION_MAJOR == 7 && SODIUM_LIBRARY_VERSION_MINOR >= 4)
-#define ZMQ_HAVE_CRYPTO_BOX_EASY_FNS 1
-#endif
-#endif
-
 zmq::curve_mechanism_base_t::curve_mechanism_base_t (
   session_base_t *session_,
   const options_t &options_,
@@ -25,7 +16,8 @@ zmq::curve_mechanism_base_t::curve_mechanism_base_t (
   const char *decode_nonce_prefix_,
   const bool downgrade_sub_) :
     curve_encoding_t (
-      encode_nonce_prefix_, decode_nonce_prefix_, downgrade_sub_)
+      encode_nonce_prefix_, decode_nonce_prefix_, downgrade_sub_),
+    _offload (false)
 {
     LIBZMQ_UNUSED (session_);
     LIBZMQ_UNUSED (options_);
@@ -33,6 +25,10 @@ zmq::curve_mechanism_base_t::curve_mechanism_base_t (
 
 int zmq::curve_mechanism_base_t::encode (msg_t *msg_)
 {
+    if (_offload) {
+        prepare_encode (msg_);
+        return 0;
+    }
     return curve_encoding_t::encode (msg_);
 }
 
@@ -43,15 +39,40 @@ int zmq::curve_mechanism_base_t::decode (msg_t *msg_)
         return -1;
 
     int error_event_code;
-    rc = curve_encoding_t::decode (msg_, &error_event_code);
-    if (-1 == rc) {
-        session->get_socket ()->event_handshake_failed_protocol (
-          session->get_endpoint (), error_event_code);
-    }
+    if (_offload)
+        rc = check_validity (msg_, &error_event_code);
+    else
+        rc = curve_encoding_t::decode (msg_, &error_event_code);
+    if (-1 == rc)
+        open_failed (error_event_code);
 
     return rc;
 }
 
+void zmq::curve_mechanism_base_t::enable_offload ()
+{
+    _offload = true;
+}
+
+void zmq::curve_mechanism_base_t::seal (msg_t *msg_,
+                                        crypto_scratch_t &scratch_) const
+{
+    box (msg_, scratch_);
+}
+
+int zmq::curve_mechanism_base_t::open (msg_t *msg_,
+                                       crypto_scratch_t &scratch_,
+                                       int *error_event_code_) const
+{
+    return unbox (msg_, scratch_, error_event_code_);
+}
+
+void zmq::curve_mechanism_base_t::open_failed (int error_event_code_)
+{
+    session->get_socket ()->event_handshake_failed_protocol (
+      session->get_endpoint (), error_event_code_);
+}
+
 zmq::curve_encoding_t::curve_encoding_t (const char *encode_nonce_prefix_,
                                          const char *decode_nonce_prefix_,
                                          const bool downgrade_sub_) :
@@ -78,6 +99,20 @@ static const size_t message_header_len =
 static const size_t crypto_box_MACBYTES = 16;
 #endif
 
+#ifndef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
+//  Wipes the plaintext off the scratch buffers, and frees them if a large
+//  message made them grow, so that they don't keep its size from then on.
+static void clear_scratch (zmq::crypto_scratch_t &scratch_, size_t size_)
+{
+    std::fill (scratch_.plaintext.begin (), scratch_.plaintext.begin () + size_,
+               static_cast<uint8_t> (0));
+    if (scratch_.plaintext.capacity () > zmq::crypto_max_scratch_size)
+        std::vector<uint8_t> ().swap (scratch_.plaintext);
+    if (scratch_.box.capacity () > zmq::crypto_max_scratch_size)
+        std::vector<uint8_t> ().swap (scratch_.box);
+}
+#endif
+
 int zmq::curve_encoding_t::check_validity (msg_t *msg_, int *error_event_code_)
 {
     const size_t size = msg_->sizep ();
@@ -111,11 +146,24 @@ int zmq::curve_encoding_t::check_validity (msg_t *msg_, int *error_event_code_)
 
 int zmq::curve_encoding_t::encode (msg_t *msg_)
 {
-    size_t sub_cancel_len = 0;
-    uint8_t message_nonce[crypto_box_NONCEBYTES];
-    memcpy (message_nonce, _encode_nonce_prefix, nonce_prefix_len);
-    put_uint64 (message_nonce + nonce_prefix_len, get_and_inc_nonce ());
+    prepare_encode (msg_);
+    box (msg_, _scratch);
+    return 0;
+}
+
+int zmq::curve_encoding_t::decode (msg_t *msg_, int *error_event_code_)
+{
+    const int rc = check_validity (msg_, error_event_code_);
+    if (0 != rc) {
+        return rc;
+    }
 
+    return unbox (msg_, _scratch, error_event_code_);
+}
+
+void zmq::curve_encoding_t::prepare_encode (msg_t *msg_)
+{
+    size_t sub_cancel_len = 0;
     if (msg_->is_subscribe () || msg_->is_cancel ()) {
         if (_downgrade_sub)
             sub_cancel_len = 1;
@@ -125,20 +173,21 @@ int zmq::curve_encoding_t::encode (msg_t *msg_)
                                : zmq::msg_t::sub_cmd_name_size;
     }
 
-#ifdef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
+    //  The plaintext is laid out in the outgoing message right behind the
+    //  room for the MAC and boxed in place, so the only copy of the data
+    //  is the one into the message. It can't go straight into the
+    //  encoder's buffer: the MAC covers the whole frame, which may be
+    //  larger than the buffer, the encoder writes the frame header from
+    //  the boxed size, and with crypto threads the frame is boxed before
+    //  the encoder sees it.
     const size_t mlen = flags_len + sub_cancel_len + msg_->sizep ();
-    std::vector<uint8_t> message_plaintext (mlen);
-#else
-    const size_t mlen =
-      crypto_box_ZEROBYTES + flags_len + sub_cancel_len + msg_->sizep ();
-    std::vector<uint8_t> message_plaintext_with_zerobytes (mlen);
+    msg_t msg_box;
+    int rc =
+      msg_box.init_size (message_header_len + crypto_box_MACBYTES + mlen);
+    zmq_assert (rc == 0);
+    uint8_t *const message = static_cast<uint8_t *> (msg_box.datap ());
     uint8_t *const message_plaintext =
-      &message_plaintext_with_zerobytes[crypto_box_ZEROBYTES];
-
-    std::fill (message_plaintext_with_zerobytes.begin (),
-               message_plaintext_with_zerobytes.begin () + crypto_box_ZEROBYTES,
-               static_cast<uint8_t> (0));
-#endif
+      message + message_header_len + crypto_box_MACBYTES;
 
     const uint8_t flags = msg_->flagsp () & flag_mask;
     message_plaintext[0] = flags;
@@ -164,54 +213,64 @@ int zmq::curve_encoding_t::encode (msg_t *msg_)
         memcpy (&message_plaintext[flags_len + sub_cancel_len], msg_->datap (),
                 msg_->sizep ());
 
-#ifdef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
-    msg_t msg_box;
-    int rc =
-      msg_box.init_size (message_header_len + mlen + crypto_box_MACBYTES);
-    zmq_assert (rc == 0);
+    memcpy (message, message_command, message_command_len);
+    put_uint64 (message + message_command_len, get_and_inc_nonce ());
 
-    rc = crypto_box_easy_afternm (
-      static_cast<uint8_t *> (msg_box.datap ()) + message_header_len,
-      &message_plaintext[0], mlen, message_nonce, _cn_precom);
+    rc = msg_->move (msg_box);
     zmq_assert (rc == 0);
+}
 
-    msg_->move (msg_box);
-
+void zmq::curve_encoding_t::box (msg_t *msg_, scratch_t &scratch_) const
+{
     uint8_t *const message = static_cast<uint8_t *> (msg_->datap ());
-#else
-    std::vector<uint8_t> message_box (mlen);
+    uint8_t *const message_plaintext =
+      message + message_header_len + crypto_box_MACBYTES;
+    const size_t mlen =
+      msg_->sizep () - message_header_len - crypto_box_MACBYTES;
 
-    int rc =
-      crypto_box_afternm (&message_box[0], &message_plaintext_with_zerobytes[0],
-                          mlen, message_nonce, _cn_precom);
-    zmq_assert (rc == 0);
+    uint8_t message_nonce[crypto_box_NONCEBYTES];
+    memcpy (message_nonce, _encode_nonce_prefix, nonce_prefix_len);
+    memcpy (message_nonce + nonce_prefix_len, message + message_command_len,
+            sizeof (nonce_t));
 
-    rc = msg_->close ();
-    zmq_assert (rc == 0);
+#ifdef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
+    LIBZMQ_UNUSED (scratch_);
 
-    rc = msg_->init_size (16 + mlen - crypto_box_BOXZEROBYTES);
+    //  The box starts with the MAC, so the ciphertext exactly overwrites
+    //  the plaintext, which libsodium supports.
+    const int rc =
+      crypto_box_easy_afternm (message + message_header_len, message_plaintext,
+                               mlen, message_nonce, _cn_precom);
     zmq_assert (rc == 0);
+#else
+    const size_t padded_len = crypto_box_ZEROBYTES + mlen;
+    if (scratch_.plaintext.size () < padded_len)
+        scratch_.plaintext.resize (padded_len);
+    if (scratch_.box.size () < padded_len)
+        scratch_.box.resize (padded_len);
+
+    std::fill (scratch_.plaintext.begin (),
+               scratch_.plaintext.begin () + crypto_box_ZEROBYTES,
+               static_cast<uint8_t> (0));
+    memcpy (&scratch_.plaintext[crypto_box_ZEROBYTES], message_plaintext,
+            mlen);
 
-    uint8_t *const message = static_cast<uint8_t *> (msg_->datap ());
+    const int rc =
+      crypto_box_afternm (&scratch_.box[0], &scratch_.plaintext[0],
+                          padded_len, message_nonce, _cn_precom);
+    zmq_assert (rc == 0);
 
-    memcpy (message + message_header_len, &message_box[crypto_box_BOXZEROBYTES],
-            mlen - crypto_box_BOXZEROBYTES);
+    memcpy (message + message_header_len,
+            &scratch_.box[crypto_box_BOXZEROBYTES],
+            padded_len - crypto_box_BOXZEROBYTES);
+    clear_scratch (scratch_, padded_len);
 #endif
-
-    memcpy (message, message_command, message_command_len);
-    memcpy (message + message_command_len, message_nonce + nonce_prefix_len,
-            sizeof (nonce_t));
-
-    return 0;
 }
 
-int zmq::curve_encoding_t::decode (msg_t *msg_, int *error_event_code_)
+int zmq::curve_encoding_t::unbox (msg_t *msg_,
+                                  scratch_t &scratch_,
+                                  int *error_event_code_) const
 {
-    int rc = check_validity (msg_, error_event_code_);
-    if (0 != rc) {
-        return rc;
-    }
-
     uint8_t *const message = static_cast<uint8_t *> (msg_->datap ());
 
     uint8_t message_nonce[crypto_box_NONCEBYTES];
@@ -220,32 +279,35 @@ int zmq::curve_encoding_t::decode (msg_t *msg_, int *error_event_code_)
             sizeof (nonce_t));
 
 #ifdef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
+    LIBZMQ_UNUSED (scratch_);
+
     const size_t clen = msg_->sizep () - message_header_len;
 
     uint8_t *const message_plaintext = message + message_header_len;
 
-    rc = crypto_box_open_easy_afternm (message_plaintext,
-                                       message + message_header_len, clen,
-                                       message_nonce, _cn_precom);
+    int rc = crypto_box_open_easy_afternm (message_plaintext,
+                                           message + message_header_len, clen,
+                                           message_nonce, _cn_precom);
 #else
     const size_t clen =
       crypto_box_BOXZEROBYTES + msg_->sizep () - message_header_len;
 
-    std::vector<uint8_t> message_plaintext_with_zerobytes (clen);
-    std::vector<uint8_t> message_box (clen);
+    if (scratch_.plaintext.size () < clen)
+        scratch_.plaintext.resize (clen);
+    if (scratch_.box.size () < clen)
+        scratch_.box.resize (clen);
 
-    std::fill (message_box.begin (),
-               message_box.begin () + crypto_box_BOXZEROBYTES,
+    std::fill (scratch_.box.begin (),
+               scratch_.box.begin () + crypto_box_BOXZEROBYTES,
                static_cast<uint8_t> (0));
-    memcpy (&message_box[crypto_box_BOXZEROBYTES], message + message_header_len,
-            msg_->sizep () - message_header_len);
+    memcpy (&scratch_.box[crypto_box_BOXZEROBYTES],
+            message + message_header_len, msg_->sizep () - message_header_len);
 
-    rc = crypto_box_open_afternm (&message_plaintext_with_zerobytes[0],
-                                  &message_box[0], clen, message_nonce,
-                                  _cn_precom);
+    int rc = crypto_box_open_afternm (&scratch_.plaintext[0], &scratch_.box[0],
+                                      clen, message_nonce, _cn_precom);
 
     const uint8_t *const message_plaintext =
-      &message_plaintext_with_zerobytes[crypto_box_ZEROBYTES];
+      &scratch_.plaintext[crypto_box_ZEROBYTES];
 #endif
 
     if (rc == 0) {
@@ -282,6 +344,9 @@ int zmq::curve_encoding_t::decode (msg_t *msg_, int *error_event_code_)
         errno = EPROTO;
     }
 
+#ifndef ZMQ_HAVE_CRYPTO_BOX_EASY_FNS
+    clear_scratch (scratch_, clen);
+#endif
     return rc;
 }
 
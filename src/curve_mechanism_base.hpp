@@ -7,6 +7,13 @@
 
 #if defined(ZMQ_USE_LIBSODIUM)
 #include "sodium.h"
+
+//  libsodium added crypto_box_easy_afternm and crypto_box_open_easy_afternm with
+//  https: //github.com/jedisct1/libsodium/commit/aaf5fbf2e53a33b18d8ea9bdf2c6f73d7acc8c3e
+#if SODIUM_LIBRARY_VERSION_MAJOR > 7                                           \
+  || (SODIUM_LIBRARY_VERSION_MAJOR == 7 && SODIUM_LIBRARY_VERSION_MINOR >= 4)
+#define ZMQ_HAVE_CRYPTO_BOX_EASY_FNS 1
+#endif
 #endif
 
 #if crypto_box_NONCEBYTES != 24 || crypto_box_PUBLICKEYBYTES != 32             \
@@ -20,6 +27,7 @@
 #include "options.hpp"
 
 #include <memory>
+#include <vector>
 
 namespace zmq
 {
@@ -30,9 +38,22 @@ class curve_encoding_t
                       const char *decode_nonce_prefix_,
                       const bool downgrade_sub_);
 
+    //  Zero-padded plaintext and box, for the libraries lacking the easy
+    //  functions.
+    typedef crypto_scratch_t scratch_t;
+
     int encode (msg_t *msg_);
     int decode (msg_t *msg_, int *error_event_code_);
 
+    //  Encoding and decoding in two steps. The first one assigns or checks
+    //  the nonce of the message, so it must run in message order; the
+    //  second one only reads state that is fixed once the handshake is
+    //  done, so it can run in any thread, for several messages at once.
+    void prepare_encode (msg_t *msg_);
+    void box (msg_t *msg_, scratch_t &scratch_) const;
+    int check_validity (msg_t *msg_, int *error_event_code_);
+    int unbox (msg_t *msg_, scratch_t &scratch_, int *error_event_code_) const;
+
     uint8_t *get_writable_precom_buffer () { return _cn_precom; }
     const uint8_t *get_precom_buffer () const { return _cn_precom; }
 
@@ -42,8 +63,6 @@ class curve_encoding_t
     void set_peer_nonce (nonce_t peer_nonce_) { _cn_peer_nonce = peer_nonce_; };
 
   private:
-    int check_validity (msg_t *msg_, int *error_event_code_);
-
     const char *_encode_nonce_prefix;
     const char *_decode_nonce_prefix;
 
@@ -53,6 +72,9 @@ class curve_encoding_t
     //  Intermediary buffer used to speed up boxing and unboxing.
     uint8_t _cn_precom[crypto_box_BEFORENMBYTES]{};
 
+    //  Kept from one message to the next.
+    scratch_t _scratch;
+
     const bool _downgrade_sub;
 
     ZMQ_NON_COPYABLE_NOR_MOVABLE (curve_encoding_t)
@@ -71,6 +93,17 @@ class curve_mechanism_base_t : public virtual mechanism_base_t,
     // mechanism implementation
     int encode (msg_t *msg_) ZMQ_OVERRIDE;
     int decode (msg_t *msg_) ZMQ_OVERRIDE;
+    bool can_offload () const ZMQ_OVERRIDE { return true; }
+    void enable_offload () ZMQ_OVERRIDE;
+    void seal (msg_t *msg_, crypto_scratch_t &scratch_) const ZMQ_OVERRIDE;
+    int open (msg_t *msg_,
+              crypto_scratch_t &scratch_,
+              int *error_event_code_) const ZMQ_OVERRIDE;
+    void open_failed (int error_event_code_) ZMQ_OVERRIDE;
+
+  private:
+    //  True once the cryptography runs on the crypto threads.
+    bool _offload;
 };
 }
 
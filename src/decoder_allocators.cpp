@@ -5,13 +5,151 @@
 
 #include "msg.hpp"
 
+static unsigned char *allocate_buffer (std::size_t size_)
+{
+#ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
+    unsigned char *const buf = static_cast<unsigned char *> (
+      zmq::malloc (size_, ZMQ_MSG_ALLOC_HINT_INCOMING));
+#ifndef NDEBUG
+    zmq::_messages_allocated = true;
+#endif
+#else
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+    unsigned char *const buf =
+      static_cast<unsigned char *> (scalable_malloc (size_));
+#else
+    unsigned char *const buf = static_cast<unsigned char *> (std::malloc (size_));
+#endif
+#endif
+    alloc_assert (buf);
+
+    zmq::shared_buffer_header_t *const header =
+      reinterpret_cast<zmq::shared_buffer_header_t *> (buf);
+    new (&header->refcnt) zmq::atomic_counter_t (1);
+    header->size = size_;
+    return buf;
+}
+
+static void free_buffer (unsigned char *buf_)
+{
+    reinterpret_cast<zmq::shared_buffer_header_t *> (buf_)
+      ->refcnt.~atomic_counter_t ();
+#ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
+    zmq::free (buf_, ZMQ_MSG_ALLOC_HINT_INCOMING);
+#else
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+    scalable_free (buf_);
+#else
+    std::free (buf_);
+#endif
+#endif
+}
+
+zmq::decoder_buffer_pool_t::decoder_buffer_pool_t (int max_buffers_) :
+    _max_buffers (max_buffers_), _idle (NULL), _refs (1)
+{
+}
+
+zmq::decoder_buffer_pool_t::~decoder_buffer_pool_t ()
+{
+    shared_buffer_header_t *header = _returned.xchg (NULL);
+    while (header) {
+        shared_buffer_header_t *const next = header->next;
+        free_buffer (reinterpret_cast<unsigned char *> (header));
+        header = next;
+    }
+    while (_idle) {
+        shared_buffer_header_t *const next = _idle->next;
+        free_buffer (reinterpret_cast<unsigned char *> (_idle));
+        _idle = next;
+    }
+}
+
+unsigned char *zmq::decoder_buffer_pool_t::take (std::size_t size_)
+{
+    while (true) {
+        //  Take over all the buffers given back so far at once.
+        if (!_idle) {
+            _idle = _returned.xchg (NULL);
+            if (!_idle)
+                break;
+        }
+
+        shared_buffer_header_t *const header = _idle;
+        _idle = header->next;
+        _cached.sub (1);
+
+        //  Buffers of decoders with another batch size are of no use.
+        if (header->size != size_) {
+            _drops.add (1);
+            free_buffer (reinterpret_cast<unsigned char *> (header));
+            continue;
+        }
+        _hits.add (1);
+        return reinterpret_cast<unsigned char *> (header);
+    }
+
+    _misses.add (1);
+    return NULL;
+}
+
+void zmq::decoder_buffer_pool_t::give (unsigned char *buf_)
+{
+    const atomic_counter_t::integer_t max_buffers = _max_buffers;
+    if (_cached.add (1) >= max_buffers) {
+        _cached.sub (1);
+        _drops.add (1);
+        free_buffer (buf_);
+        return;
+    }
+
+    //  Only the I/O thread takes buffers out, and it takes them all at
+    //  once, so pushing can't be confused by buffers coming and going.
+    shared_buffer_header_t *const header =
+      reinterpret_cast<shared_buffer_header_t *> (buf_);
+    shared_buffer_header_t *head = _returned.load ();
+    while (true) {
+        header->next = head;
+        shared_buffer_header_t *const prev = _returned.cas (head, header);
+        if (prev == head)
+            break;
+        head = prev;
+    }
+}
+
+void zmq::decoder_buffer_pool_t::add_ref ()
+{
+    _refs.add (1);
+}
+
+bool zmq::decoder_buffer_pool_t::drop_ref ()
+{
+    return !_refs.sub (1);
+}
+
+int zmq::decoder_buffer_pool_t::hits () const
+{
+    return static_cast<int> (_hits.get ());
+}
+
+int zmq::decoder_buffer_pool_t::misses () const
+{
+    return static_cast<int> (_misses.get ());
+}
+
+int zmq::decoder_buffer_pool_t::drops () const
+{
+    return static_cast<int> (_drops.get ());
+}
+
 zmq::shared_message_memory_allocator::shared_message_memory_allocator (
   std::size_t bufsize_) :
     _buf (NULL),
     _buf_size (0),
     _max_size (bufsize_),
     _msg_content (NULL),
-    _max_counters ((_max_size + msg_t::max_vsm_size - 1) / msg_t::max_vsm_size)
+    _max_counters ((_max_size + msg_t::max_vsm_size - 1) / msg_t::max_vsm_size),
+    _pool (NULL)
 {
 }
 
@@ -21,7 +159,8 @@ zmq::shared_message_memory_allocator::shared_message_memory_allocator (
     _buf_size (0),
     _max_size (bufsize_),
     _msg_content (NULL),
-    _max_counters (max_messages_)
+    _max_counters (max_messages_),
+    _pool (NULL)
 {
 }
 
@@ -30,6 +169,20 @@ zmq::shared_message_memory_allocator::~shared_message_memory_allocator ()
     deallocate ();
 }
 
+void zmq::shared_message_memory_allocator::set_pool (
+  decoder_buffer_pool_t *pool_)
+{
+    zmq_assert (!_pool);
+    _pool = pool_;
+
+    //  The buffer allocated so far isn't used by any message yet, so it
+    //  can go to the pool as well.
+    if (_buf && _pool) {
+        reinterpret_cast<shared_buffer_header_t *> (_buf)->pool = _pool;
+        _pool->add_ref ();
+    }
+}
+
 unsigned char *zmq::shared_message_memory_allocator::allocate ()
 {
     if (_buf) {
@@ -51,24 +204,20 @@ unsigned char *zmq::shared_message_memory_allocator::allocate ()
     if (!_buf) {
         // allocate memory for reference counters together with reception buffer
         std::size_t const allocationsize =
-          _max_size + sizeof (zmq::atomic_counter_t)
+          _max_size + sizeof (shared_buffer_header_t)
           + _max_counters * sizeof (zmq::msg_t::content_t);
-#ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
-        _buf = static_cast<unsigned char *> (
-          zmq::malloc (allocationsize, ZMQ_MSG_ALLOC_HINT_INCOMING));
-#ifndef NDEBUG
-        _messages_allocated = true;
-#endif
-#else
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        _buf = static_cast<unsigned char *> (scalable_malloc (allocationsize));
-#else
-        _buf = static_cast<unsigned char *> (std::malloc (allocationsize));
-#endif
-#endif
-        alloc_assert (_buf);
 
-        new (_buf) atomic_counter_t (1);
+        // prefer a buffer the messages are done with to a new one
+        if (_pool)
+            _buf = _pool->take (allocationsize);
+        if (_buf)
+            reinterpret_cast<shared_buffer_header_t *> (_buf)->refcnt.set (1);
+        else
+            _buf = allocate_buffer (allocationsize);
+
+        reinterpret_cast<shared_buffer_header_t *> (_buf)->pool = _pool;
+        if (_pool)
+            _pool->add_ref ();
     } else {
         // release reference count to couple lifetime to messages
         zmq::atomic_counter_t *c =
@@ -78,25 +227,15 @@ unsigned char *zmq::shared_message_memory_allocator::allocate ()
 
     _buf_size = _max_size;
     _msg_content = reinterpret_cast<zmq::msg_t::content_t *> (
-      _buf + sizeof (atomic_counter_t) + _max_size);
-    return _buf + sizeof (zmq::atomic_counter_t);
+      _buf + sizeof (shared_buffer_header_t) + _max_size);
+    return _buf + sizeof (shared_buffer_header_t);
 }
 
 void zmq::shared_message_memory_allocator::deallocate ()
 {
     zmq::atomic_counter_t *c = reinterpret_cast<zmq::atomic_counter_t *> (_buf);
-    if (_buf && !c->sub (1)) {
-        c->~atomic_counter_t ();
-#ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
-        zmq::free (_buf, ZMQ_MSG_ALLOC_HINT_INCOMING);
-#else
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        scalable_free (_buf);
-#else
-        std::free (_buf);
-#endif
-#endif
-    }
+    if (_buf && !c->sub (1))
+        release_buffer (_buf);
     clear ();
 }
 
@@ -114,6 +253,20 @@ void zmq::shared_message_memory_allocator::clear ()
     _msg_content = NULL;
 }
 
+void zmq::shared_message_memory_allocator::release_buffer (unsigned char *buf_)
+{
+    decoder_buffer_pool_t *const pool =
+      reinterpret_cast<shared_buffer_header_t *> (buf_)->pool;
+    if (!pool) {
+        free_buffer (buf_);
+        return;
+    }
+
+    pool->give (buf_);
+    if (pool->drop_ref ())
+        delete pool;
+}
+
 void zmq::shared_message_memory_allocator::inc_ref ()
 {
     (reinterpret_cast<zmq::atomic_counter_t *> (_buf))->add (1);
@@ -126,19 +279,8 @@ void ZMQ_CDECL zmq::shared_message_memory_allocator::call_dec_ref (void *,
     unsigned char *buf = static_cast<unsigned char *> (hint_);
     zmq::atomic_counter_t *c = reinterpret_cast<zmq::atomic_counter_t *> (buf);
 
-    if (!c->sub (1)) {
-        c->~atomic_counter_t ();
-#ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
-        zmq::free (buf, ZMQ_MSG_ALLOC_HINT_INCOMING);
-#else
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        scalable_free (buf);
-#else
-        std::free (buf);
-#endif
-#endif
-        buf = NULL;
-    }
+    if (!c->sub (1))
+        release_buffer (buf);
 }
 
 
@@ -149,5 +291,5 @@ std::size_t zmq::shared_message_memory_allocator::size () const
 
 unsigned char *zmq::shared_message_memory_allocator::data ()
 {
-    return _buf + sizeof (zmq::atomic_counter_t);
+    return _buf + sizeof (shared_buffer_header_t);
 }
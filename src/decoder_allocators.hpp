@@ -7,6 +7,7 @@
 #include <cstdlib>
 
 #include "atomic_counter.hpp"
+#include "atomic_ptr.hpp"
 #include "msg.hpp"
 #include "err.hpp"
 
@@ -83,6 +84,75 @@ class c_single_allocator
     ZMQ_NON_COPYABLE_NOR_MOVABLE (c_single_allocator)
 };
 
+class decoder_buffer_pool_t;
+
+// Header of the buffers of shared_message_memory_allocator, followed by the
+// message data and the content structures of the messages.
+struct shared_buffer_header_t
+{
+    // Number of messages using the buffer, plus one while the decoder does.
+    atomic_counter_t refcnt;
+
+    // Pool the buffer goes back to once nothing uses it, if any.
+    decoder_buffer_pool_t *pool;
+
+    // Size of the whole buffer.
+    std::size_t size;
+
+    // Next idle buffer in the pool.
+    shared_buffer_header_t *next;
+};
+
+// Idle decoder buffers of an I/O thread. The thread closing the last message
+// that uses a buffer gives it back to the pool, without locking, and the
+// decoders of the I/O thread take it from there the next time they need a new
+// buffer. As messages may outlive the I/O thread, the pool is reference
+// counted: the I/O thread holds a reference, and so does each buffer in use.
+class decoder_buffer_pool_t
+{
+  public:
+    explicit decoder_buffer_pool_t (int max_buffers_);
+    ~decoder_buffer_pool_t ();
+
+    // Returns an idle buffer of the given size, or NULL if there's none.
+    // Only the I/O thread may call this.
+    unsigned char *take (std::size_t size_);
+
+    // Keeps a buffer nothing uses any more, or frees it if the pool is full.
+    // Any thread may call this.
+    void give (unsigned char *buf_);
+
+    void add_ref ();
+
+    // Drop reference, returns true if the pool should be deleted.
+    bool drop_ref ();
+
+    // Numbers of buffers taken from the pool and allocated from the heap as
+    // the pool had none, and of buffers freed as the pool was full.
+    int hits () const;
+    int misses () const;
+    int drops () const;
+
+  private:
+    const int _max_buffers;
+
+    // Buffers given back, waiting for the I/O thread to take them over.
+    atomic_ptr_t<shared_buffer_header_t> _returned;
+
+    // Buffers taken over by the I/O thread.
+    shared_buffer_header_t *_idle;
+
+    // Number of buffers in the two lists.
+    atomic_counter_t _cached;
+
+    atomic_counter_t _refs;
+    atomic_counter_t _hits;
+    atomic_counter_t _misses;
+    atomic_counter_t _drops;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (decoder_buffer_pool_t)
+};
+
 // This allocator allocates a reference counted buffer which is used by v2_decoder_t
 // to use zero-copy msg::init_data to create messages with memory from this buffer as
 // data storage.
@@ -92,6 +162,10 @@ class c_single_allocator
 // from zero to one, gets passed to the user application, processed in the user thread and deleted
 // which would then deallocate the buffer. The drawback is that the buffer may be allocated longer
 // than necessary because it is only deleted when allocate is called the next time.
+//
+// With a pool, the buffers the messages were still using when the decoder
+// moved on to a new one are recycled through the pool once the messages are
+// closed, instead of going back to the heap.
 class shared_message_memory_allocator
 {
   public:
@@ -130,6 +204,10 @@ class shared_message_memory_allocator
 
     void resize (std::size_t new_size_) { _buf_size = new_size_; }
 
+    // Recycle the buffers through the pool from now on. The pool must belong
+    // to the thread the decoder runs in.
+    void set_pool (decoder_buffer_pool_t *pool_);
+
     zmq::msg_t::content_t *provide_content () { return _msg_content; }
 
     void advance_content () { _msg_content++; }
@@ -137,11 +215,15 @@ class shared_message_memory_allocator
   private:
     void clear ();
 
+    // Frees the buffer or gives it back to its pool.
+    static void release_buffer (unsigned char *buf_);
+
     unsigned char *_buf;
     std::size_t _buf_size;
     const std::size_t _max_size;
     zmq::msg_t::content_t *_msg_content;
     std::size_t _max_counters;
+    decoder_buffer_pool_t *_pool;
 };
 }
 
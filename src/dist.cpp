@@ -6,29 +6,175 @@
 #include "err.hpp"
 #include "msg.hpp"
 #include "likely.hpp"
+#include "config.hpp"
+#include "fanout_pool.hpp"
+#include "signaler.hpp"
+#include "atomic_counter.hpp"
+
+#include <algorithm>
+
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
+//  Returns the number of set bits in a word.
+static unsigned int count_bits (uint64_t bits_)
+{
+#if defined __GNUC__ || defined __clang__
+    return static_cast<unsigned int> (__builtin_popcountll (bits_));
+#else
+    unsigned int count = 0;
+    for (; bits_; bits_ &= bits_ - 1)
+        ++count;
+    return count;
+#endif
+}
+
+//  Returns the index of the lowest set bit of a non-zero word.
+static unsigned int count_trailing_zeros (uint64_t bits_)
+{
+#if defined __GNUC__ || defined __clang__
+    return static_cast<unsigned int> (__builtin_ctzll (bits_));
+#elif defined _MSC_VER && defined _WIN64
+    unsigned long index;
+    _BitScanForward64 (&index, bits_);
+    return index;
+#else
+    unsigned int index = 0;
+    for (; !(bits_ & 1); bits_ >>= 1)
+        ++index;
+    return index;
+#endif
+}
+
+//  Checks whether any of the bits from begin_ to end_ is set.
+static bool
+any_matching (const uint64_t *matching_, size_t begin_, size_t end_)
+{
+    for (size_t i = begin_ / 64, last = (end_ + 63) / 64; i < last; ++i) {
+        uint64_t bits = matching_[i];
+        if (i == begin_ / 64)
+            bits &= ~uint64_t (0) << (begin_ % 64);
+        if (i == end_ / 64)
+            bits &= (uint64_t (1) << (end_ % 64)) - 1;
+        if (bits)
+            return true;
+    }
+    return false;
+}
+
+//  A message handed to the fan-out threads, with the bitmap of the pipes
+//  to write it to. Each shard drops a reference once done with it.
+struct zmq::dist_t::shard_msg_t
+{
+    msg_t msg;
+    bool flush;
+    size_t pipes;
+    atomic_counter_t refs;
+    std::vector<uint64_t> matching;
+};
 
 zmq::dist_t::dist_t () :
-    _matching (0), _active (0), _eligible (0), _more (false)
+    _pool (NULL),
+    _shard_threads (1, -1),
+    _shard_failed (1),
+    _shard_failures (false),
+    _posted (false),
+    _drained (NULL),
+    _drained_shards (0),
+    _active (0),
+    _eligible (0),
+    _more (false)
 {
 }
 
 zmq::dist_t::~dist_t ()
 {
+    drain ();
     zmq_assert (_pipes.empty ());
+    LIBZMQ_DELETE (_drained);
+}
+
+int zmq::dist_t::set_shards (fanout_pool_t *pool_, int shards_)
+{
+    //  The pipes are about to change hands.
+    drain ();
+
+    std::vector<int> threads (shards_ - 1);
+    if (shards_ > 1) {
+        if (!_drained) {
+            _drained = new (std::nothrow) signaler_t;
+            alloc_assert (_drained);
+            if (!_drained->valid ()) {
+                LIBZMQ_DELETE (_drained);
+                errno = EMFILE;
+                return -1;
+            }
+        }
+        if (pool_->reserve (threads) == -1)
+            return -1;
+    }
+
+    _pool = shards_ > 1 ? pool_ : NULL;
+    _shard_threads.assign (1, -1);
+    _shard_threads.insert (_shard_threads.end (), threads.begin (),
+                           threads.end ());
+    _shard_failed.resize (shards_);
+    return 0;
+}
+
+void zmq::dist_t::drain ()
+{
+    if (_posted) {
+        _posted = false;
+
+        //  Each thread signals once it's done with the messages posted to
+        //  it before.
+        const int shards = static_cast<int> (_shard_threads.size ());
+        for (int i = 1; i != shards; i++) {
+            const fanout_pool_t::job_t job = {shard_job, this, i, NULL};
+            _pool->post (_shard_threads[i], job);
+        }
+        for (int i = 1; i != shards; i++) {
+            while (_drained->wait (-1) == -1)
+                errno_assert (errno == EINTR);
+            _drained->recv ();
+        }
+        const int drained = _drained_shards.exchange (0);
+        zmq_assert (drained == shards - 1);
+    }
+
+    if (!_shard_failures.load (std::memory_order_relaxed))
+        return;
+    _shard_failures.store (false, std::memory_order_relaxed);
+
+    //  A pipe may have failed more than once. It's left the eligible pipes
+    //  the first time it's deactivated.
+    for (size_t i = 0, shards = _shard_failed.size (); i != shards; i++) {
+        for (std::vector<pipe_t *>::iterator it = _shard_failed[i].begin (),
+                                             end = _shard_failed[i].end ();
+             it != end; ++it)
+            if (_pipes.index (*it) < _eligible)
+                deactivate (*it);
+        _shard_failed[i].clear ();
+    }
 }
 
 void zmq::dist_t::attach (pipe_t *pipe_)
 {
+    drain ();
+
     //  If we are in the middle of sending a message, we'll add new pipe
     //  into the list of eligible pipes. Otherwise we add it to the list
     //  of active pipes.
+    _pipes.push_back (pipe_);
+    if (_pipes.size () > _matching.size () * 64)
+        _matching.push_back (0);
     if (_more) {
-        _pipes.push_back (pipe_);
-        _pipes.swap (_eligible, _pipes.size () - 1);
+        swap (_eligible, _pipes.size () - 1);
         _eligible++;
     } else {
-        _pipes.push_back (pipe_);
-        _pipes.swap (_active, _pipes.size () - 1);
+        swap (_active, _pipes.size () - 1);
         _active++;
         _eligible++;
     }
@@ -48,79 +194,74 @@ bool zmq::dist_t::has_pipe (pipe_t *pipe_)
 
 void zmq::dist_t::match (pipe_t *pipe_)
 {
-    //  If pipe is already matching do nothing.
-    if (_pipes.index (pipe_) < _matching)
-        return;
-
-    //  If the pipe isn't eligible, ignore it.
-    if (_pipes.index (pipe_) >= _eligible)
-        return;
-
-    //  Mark the pipe as matching.
-    _pipes.swap (_pipes.index (pipe_), _matching);
-    _matching++;
+    //  If the pipe isn't eligible, ignore it. Matching it again is harmless.
+    const pipes_t::size_type index = _pipes.index (pipe_);
+    if (index < _eligible)
+        set_matching (index);
 }
 
 void zmq::dist_t::reverse_match ()
 {
-    const pipes_t::size_type prev_matching = _matching;
-
-    // Reset matching to 0
-    unmatch ();
-
-    // Mark all matching pipes as not matching and vice-versa.
-    // To do this, push all pipes that are eligible but not
-    // matched - i.e. between "matching" and "eligible" -
-    // to the beginning of the queue.
-    for (pipes_t::size_type i = prev_matching; i < _eligible; ++i) {
-        _pipes.swap (i, _matching++);
-    }
+    //  Mark all matching pipes as not matching and vice-versa, limited to
+    //  the eligible pipes.
+    const size_t full_words = _eligible / 64;
+    for (size_t i = 0; i < full_words; ++i)
+        _matching[i] = ~_matching[i];
+    if (_eligible % 64)
+        _matching[full_words] ^= (uint64_t (1) << (_eligible % 64)) - 1;
 }
 
 void zmq::dist_t::unmatch ()
 {
-    _matching = 0;
+    std::fill (_matching.begin (), _matching.end (), 0);
 }
 
 void zmq::dist_t::pipe_terminated (pipe_t *pipe_)
 {
-    //  Remove the pipe from the list; adjust number of matching, active and/or
+    drain ();
+
+    //  Remove the pipe from the list; adjust number of active and/or
     //  eligible pipes accordingly.
-    if (_pipes.index (pipe_) < _matching) {
-        _pipes.swap (_pipes.index (pipe_), _matching - 1);
-        _matching--;
-    }
+    clear_matching (_pipes.index (pipe_));
     if (_pipes.index (pipe_) < _active) {
-        _pipes.swap (_pipes.index (pipe_), _active - 1);
+        swap (_pipes.index (pipe_), _active - 1);
         _active--;
     }
     if (_pipes.index (pipe_) < _eligible) {
-        _pipes.swap (_pipes.index (pipe_), _eligible - 1);
+        swap (_pipes.index (pipe_), _eligible - 1);
         _eligible--;
     }
 
+    swap (_pipes.index (pipe_), _pipes.size () - 1);
     _pipes.erase (pipe_);
 }
 
 void zmq::dist_t::activated (pipe_t *pipe_)
 {
+    drain ();
+
     //  Move the pipe from passive to eligible state.
     if (_eligible < _pipes.size ()) {
-        _pipes.swap (_pipes.index (pipe_), _eligible);
+        swap (_pipes.index (pipe_), _eligible);
         _eligible++;
     }
 
     //  If there's no message being sent at the moment, move it to
     //  the active state.
     if (!_more && _active < _pipes.size ()) {
-        _pipes.swap (_eligible - 1, _active);
+        swap (_eligible - 1, _active);
         _active++;
     }
 }
 
 int zmq::dist_t::send_to_all (msg_t *msg_)
 {
-    _matching = _active;
+    unmatch ();
+    const size_t full_words = _active / 64;
+    std::fill (_matching.begin (), _matching.begin () + full_words,
+               ~uint64_t (0));
+    if (_active % 64)
+        _matching[full_words] = (uint64_t (1) << (_active % 64)) - 1;
     return send_to_matching (msg_);
 }
 
@@ -143,8 +284,19 @@ int zmq::dist_t::send_to_matching (msg_t *msg_)
 
 void zmq::dist_t::distribute (msg_t *msg_)
 {
+    //  Once a shard failed, deactivate its pipes before they're matched
+    //  again. The fan-out threads are also left to the large fan-outs.
+    if (_pool
+        && (_eligible < fanout_min_pipes
+            || _shard_failures.load (std::memory_order_relaxed)))
+        drain ();
+
+    size_t matching = 0;
+    for (size_t i = 0, words = _matching.size (); i < words; ++i)
+        matching += count_bits (_matching[i]);
+
     //  If there are no matching pipes available, simply drop the message.
-    if (_matching == 0) {
+    if (matching == 0) {
         int rc = msg_->close ();
         errno_assert (rc == 0);
         rc = msg_->init ();
@@ -152,35 +304,34 @@ void zmq::dist_t::distribute (msg_t *msg_)
         return;
     }
 
-    if (msg_->is_vsm ()) {
-        for (pipes_t::size_type i = 0; i < _matching;) {
-            if (!write (_pipes[i], msg_)) {
-                //  Use same index again because entry will have been removed.
-            } else {
-                ++i;
-            }
-        }
-        int rc = msg_->init ();
-        errno_assert (rc == 0);
-        return;
+    //  Encode the frame header once for all the engines sending the
+    //  message, then add references for all matching pipes at once. We
+    //  already hold one reference, that's why -1.
+    const bool vsm = msg_->is_vsm ();
+    if (!vsm) {
+        msg_->encode_frame_header ();
+        msg_->add_refs (static_cast<int> (matching) - 1);
     }
 
-    //  Add matching-1 references to the message. We already hold one reference,
-    //  that's why -1.
-    msg_->add_refs (static_cast<int> (_matching) - 1);
+    const bool flush = !(msg_->flagsp () & msg_t::more);
+    if (_pool && _eligible >= fanout_min_pipes) {
+        distribute_shards (msg_, flush);
+        return;
+    }
 
-    //  Push copy of the message to each matching pipe.
-    int failed = 0;
-    for (pipes_t::size_type i = 0; i < _matching;) {
-        if (!write (_pipes[i], msg_)) {
-            ++failed;
-            //  Use same index again because entry will have been removed.
-        } else {
-            ++i;
-        }
+    //  Push copy of the message to each matching pipe. Pipes that fail are
+    //  deactivated afterwards, deactivating moves pipes around.
+    write_matching (&_matching[0], 0, _eligible, msg_, flush, _failed);
+
+    if (unlikely (!_failed.empty ())) {
+        if (!vsm)
+            msg_->rm_refs (static_cast<int> (_failed.size ()));
+        for (std::vector<pipe_t *>::iterator it = _failed.begin (),
+                                             end = _failed.end ();
+             it != end; ++it)
+            deactivate (*it);
+        _failed.clear ();
     }
-    if (unlikely (failed))
-        msg_->rm_refs (failed);
 
     //  Detach the original message from the data buffer. Note that we don't
     //  close the message. That's because we've already used all the references.
@@ -188,32 +339,139 @@ void zmq::dist_t::distribute (msg_t *msg_)
     errno_assert (rc == 0);
 }
 
-bool zmq::dist_t::has_out ()
+void zmq::dist_t::distribute_shards (msg_t *msg_, bool flush_)
 {
-    return true;
+    //  The shards get a copy of the bitmap, it's reused for the next
+    //  message straight away.
+    shard_msg_t *item = new (std::nothrow) shard_msg_t;
+    alloc_assert (item);
+    int rc = item->msg.init ();
+    errno_assert (rc == 0);
+    rc = item->msg.move (*msg_);
+    errno_assert (rc == 0);
+    item->flush = flush_;
+    item->pipes = _eligible;
+    item->matching.assign (_matching.begin (),
+                           _matching.begin () + (_eligible + 63) / 64);
+
+    //  Post the message to the threads of the shards with matching pipes,
+    //  then write the first shard. The references of the shards not posted
+    //  to are dropped before the first shard is written, so that the
+    //  message outlives the posting.
+    const int shards = static_cast<int> (_shard_threads.size ());
+    item->refs.set (shards);
+    int skipped = 0;
+    for (int i = 1; i != shards; i++) {
+        if (!any_matching (&item->matching[0], shard_begin (i, _eligible),
+                           shard_begin (i + 1, _eligible))) {
+            skipped++;
+            continue;
+        }
+        const fanout_pool_t::job_t job = {shard_job, this, i, item};
+        _pool->post (_shard_threads[i], job);
+        _posted = true;
+    }
+    if (skipped)
+        item->refs.sub (skipped);
+    write_shard (0, item);
 }
 
-bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
+void zmq::dist_t::write_shard (int shard_, shard_msg_t *item_)
 {
-    if (!pipe_->write (msg_)) {
-        _pipes.swap (_pipes.index (pipe_), _matching - 1);
-        _matching--;
-        _pipes.swap (_pipes.index (pipe_), _active - 1);
-        _active--;
-        _pipes.swap (_active, _eligible - 1);
-        _eligible--;
-        return false;
+    //  Once the last reference is dropped, the message may be gone and a
+    //  message with a single reference is closed, so nothing is read from
+    //  it past that point.
+    const bool vsm = item_->msg.is_vsm ();
+    std::vector<pipe_t *> &failed = _shard_failed[shard_];
+    const size_t failed_before = failed.size ();
+    write_matching (&item_->matching[0], shard_begin (shard_, item_->pipes),
+                    shard_begin (shard_ + 1, item_->pipes), &item_->msg,
+                    item_->flush, failed);
+    if (unlikely (failed.size () != failed_before)) {
+        if (!vsm)
+            item_->msg.rm_refs (
+              static_cast<int> (failed.size () - failed_before));
+        _shard_failures.store (true, std::memory_order_relaxed);
     }
-    if (!(msg_->flagsp () & msg_t::more))
-        pipe_->flush ();
+    if (!item_->refs.sub (1))
+        delete item_;
+}
+
+void zmq::dist_t::shard_job (void *arg_, int shard_, void *item_)
+{
+    dist_t *self = static_cast<dist_t *> (arg_);
+    if (item_) {
+        self->write_shard (shard_, static_cast<shard_msg_t *> (item_));
+        return;
+    }
+
+    //  Once signalled, drain may return and the distributor be gone.
+    self->_drained_shards.fetch_add (1, std::memory_order_release);
+    self->_drained->send ();
+}
+
+void zmq::dist_t::write_matching (const uint64_t *matching_,
+                                  size_t begin_,
+                                  size_t end_,
+                                  const msg_t *msg_,
+                                  bool flush_,
+                                  std::vector<pipe_t *> &failed_)
+{
+    for (size_t i = begin_ / 64, last = (end_ + 63) / 64; i < last; ++i) {
+        uint64_t bits = matching_[i];
+        if (i == begin_ / 64)
+            bits &= ~uint64_t (0) << (begin_ % 64);
+        if (i == end_ / 64)
+            bits &= (uint64_t (1) << (end_ % 64)) - 1;
+        for (; bits; bits &= bits - 1) {
+            pipe_t *pipe = _pipes[i * 64 + count_trailing_zeros (bits)];
+            if (unlikely (!pipe->write (msg_)))
+                failed_.push_back (pipe);
+            else if (flush_)
+                pipe->flush ();
+        }
+    }
+}
+
+bool zmq::dist_t::has_out ()
+{
     return true;
 }
 
+void zmq::dist_t::deactivate (pipe_t *pipe_)
+{
+    clear_matching (_pipes.index (pipe_));
+    swap (_pipes.index (pipe_), _active - 1);
+    _active--;
+    swap (_active, _eligible - 1);
+    _eligible--;
+}
+
 bool zmq::dist_t::check_hwm ()
 {
-    for (pipes_t::size_type i = 0; i < _matching; ++i)
-        if (!_pipes[i]->check_hwm ())
-            return false;
+    drain ();
+
+    for (size_t i = 0, words = _matching.size (); i < words; ++i) {
+        for (uint64_t bits = _matching[i]; bits; bits &= bits - 1)
+            if (!_pipes[i * 64 + count_trailing_zeros (bits)]->check_hwm ())
+                return false;
+    }
 
     return true;
 }
+
+void zmq::dist_t::swap (size_t index1_, size_t index2_)
+{
+    if (index1_ == index2_)
+        return;
+    const bool matching1 = is_matching (index1_);
+    if (is_matching (index2_))
+        set_matching (index1_);
+    else
+        clear_matching (index1_);
+    if (matching1)
+        set_matching (index2_);
+    else
+        clear_matching (index2_);
+    _pipes.swap (index1_, index2_);
+}
@@ -3,18 +3,23 @@
 #ifndef __ZMQ_DIST_HPP_INCLUDED__
 #define __ZMQ_DIST_HPP_INCLUDED__
 
+#include <atomic>
 #include <vector>
 
 #include "array.hpp"
 #include "macros.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
 class pipe_t;
 class msg_t;
+class fanout_pool_t;
+class signaler_t;
 
 //  Class manages a set of outbound pipes. It sends each messages to
-//  each of them.
+//  each of them. The pipes to send the next message to are marked in a
+//  bitmap indexed by the position of the pipe in the array.
 class dist_t
 {
   public:
@@ -54,20 +59,99 @@ class dist_t
     // check HWM of all pipes matching
     bool check_hwm ();
 
+    //  Splits the pipes of large fan-outs into shards_ shards. The calling
+    //  thread writes the first one and hands the message to a thread of
+    //  pool_ for each other one, without waiting for them. 1 writes all
+    //  pipes in the calling thread.
+    int set_shards (fanout_pool_t *pool_, int shards_);
+
+    //  Waits for the fan-out threads to be done with the messages handed
+    //  to them and deactivates the pipes they failed to write to. To be
+    //  called before the owner of the pipes acts on them in any other way.
+    void drain ();
+
   private:
-    //  Write the message to the pipe. Make the pipe inactive if writing
-    //  fails. In such a case false is returned.
-    bool write (zmq::pipe_t *pipe_, zmq::msg_t *msg_);
+    //  Make a pipe that could not be written to inactive.
+    void deactivate (zmq::pipe_t *pipe_);
 
     //  Put the message to all active pipes.
     void distribute (zmq::msg_t *msg_);
 
+    //  Hands the message to the fan-out threads, see set_shards.
+    void distribute_shards (zmq::msg_t *msg_, bool flush_);
+
+    //  Writes the message to the pipes from begin_ to end_ marked in the
+    //  bitmap and records the pipes that failed.
+    void write_matching (const uint64_t *matching_,
+                         size_t begin_,
+                         size_t end_,
+                         const zmq::msg_t *msg_,
+                         bool flush_,
+                         std::vector<zmq::pipe_t *> &failed_);
+
+    //  Writes a message handed to the fan-out threads to the pipes of
+    //  the shard.
+    struct shard_msg_t;
+    void write_shard (int shard_, shard_msg_t *item_);
+
+    //  Job run by the fan-out pool, with no item when drain waits for it.
+    static void shard_job (void *arg_, int shard_, void *item_);
+
+    //  First pipe of the shard out of pipes_ eligible pipes.
+    size_t shard_begin (int shard_, size_t pipes_) const
+    {
+        return pipes_ * shard_ / _shard_threads.size ();
+    }
+
+    //  Swaps two pipes together with their matching bits.
+    void swap (size_t index1_, size_t index2_);
+
+    bool is_matching (size_t index_) const
+    {
+        return (_matching[index_ / 64] >> (index_ % 64)) & 1;
+    }
+    void set_matching (size_t index_)
+    {
+        _matching[index_ / 64] |= uint64_t (1) << (index_ % 64);
+    }
+    void clear_matching (size_t index_)
+    {
+        _matching[index_ / 64] &= ~(uint64_t (1) << (index_ % 64));
+    }
+
     //  List of outbound pipes.
     typedef array_t<zmq::pipe_t, 2> pipes_t;
     pipes_t _pipes;
 
-    //  Number of all the pipes to send the next message to.
-    pipes_t::size_type _matching;
+    //  Bitmap of the pipes to send the next message to. Only eligible
+    //  pipes are ever marked.
+    std::vector<uint64_t> _matching;
+
+    //  Pipes distribute failed to write to, deactivated once the message
+    //  has been written to all the others.
+    std::vector<zmq::pipe_t *> _failed;
+
+    //  Threads writing the shards of large fan-outs, if sharding is on.
+    //  The pipes are split into shards by their position and no pipe
+    //  moves until drain, so each pipe is written by a single thread.
+    fanout_pool_t *_pool;
+
+    //  Thread of the pool writing each shard. The first entry stands for
+    //  the calling thread.
+    std::vector<int> _shard_threads;
+
+    //  Pipes each shard failed to write to, owned by the thread writing
+    //  the shard until drain. Set if any shard failed since.
+    std::vector<std::vector<zmq::pipe_t *> > _shard_failed;
+    std::atomic<bool> _shard_failures;
+
+    //  Whether messages were handed to the fan-out threads since drain.
+    bool _posted;
+
+    //  Signalled by each fan-out thread drain waits for, and the number
+    //  of such signals sent since.
+    signaler_t *_drained;
+    std::atomic<int> _drained_shards;
 
     //  Number of active pipes. All the active pipes are located at the
     //  beginning of the pipes array. These are the pipes the messages
@@ -119,6 +119,35 @@ template <typename T> class encoder_base_t : public i_encoder
         return pos;
     }
 
+    size_t pending (unsigned char **data_) ZMQ_FINAL
+    {
+        if (in_progress () == NULL)
+            return 0;
+
+        //  Run the state machine until it produces some data.
+        while (!_to_write) {
+            if (_new_msg_flag) {
+                int rc = _in_progress->close ();
+                errno_assert (rc == 0);
+                rc = _in_progress->init ();
+                errno_assert (rc == 0);
+                _in_progress = NULL;
+                return 0;
+            }
+            (static_cast<T *> (this)->*_next) ();
+        }
+
+        *data_ = _write_pos;
+        return _to_write;
+    }
+
+    void advance (size_t size_) ZMQ_FINAL
+    {
+        zmq_assert (size_ <= _to_write);
+        _write_pos += size_;
+        _to_write -= size_;
+    }
+
     void load_msg (msg_t *msg_) ZMQ_FINAL
     {
         zmq_assert (in_progress () == NULL);
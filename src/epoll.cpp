@@ -1,7 +1,8 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
 #include "precompiled.hpp"
-#if defined ZMQ_IOTHREAD_POLLER_USE_EPOLL
+#if defined ZMQ_IOTHREAD_POLLER_USE_EPOLL                                      \
+  || defined ZMQ_IOTHREAD_POLLER_USE_URING
 #include "epoll.hpp"
 
 #if !defined ZMQ_HAVE_WINDOWS
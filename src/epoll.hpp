@@ -5,7 +5,8 @@
 
 //  poller.hpp decides which polling mechanism to use.
 #include "poller.hpp"
-#if defined ZMQ_IOTHREAD_POLLER_USE_EPOLL
+#if defined ZMQ_IOTHREAD_POLLER_USE_EPOLL                                      \
+  || defined ZMQ_IOTHREAD_POLLER_USE_URING
 
 #include <vector>
 
@@ -79,7 +80,9 @@ class epoll_t ZMQ_FINAL : public worker_poller_base_t
     ZMQ_NON_COPYABLE_NOR_MOVABLE (epoll_t)
 };
 
+#if defined ZMQ_IOTHREAD_POLLER_USE_EPOLL
 typedef epoll_t poller_t;
+#endif
 }
 
 #endif
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "fanout_pool.hpp"
+#include "ctx.hpp"
+#include "err.hpp"
+
+zmq::fanout_pool_t::fanout_pool_t (const thread_ctx_t &ctx_) :
+    _ctx (ctx_),
+    _size (0),
+    _next (0)
+{
+}
+
+zmq::fanout_pool_t::~fanout_pool_t ()
+{
+    //  The distributors are gone, so an empty job is the last in each
+    //  queue.
+    const job_t stop = {NULL, NULL, 0, NULL};
+    for (int i = 0; i != _size; i++) {
+        post (i, stop);
+        _workers[i]->thread.stop ();
+        LIBZMQ_DELETE (_workers[i]);
+    }
+}
+
+int zmq::fanout_pool_t::reserve (std::vector<int> &threads_)
+{
+    const int count = static_cast<int> (threads_.size ());
+    zmq_assert (count <= fanout_max_shards - 1);
+
+    scoped_lock_t locker (_sync);
+    while (_size < count) {
+        worker_t *worker = new (std::nothrow) worker_t;
+        alloc_assert (worker);
+        if (!worker->signaler.valid ()) {
+            delete worker;
+            errno = EMFILE;
+            return -1;
+        }
+        _workers[_size++] = worker;
+        _ctx.start_thread (worker->thread, worker_routine, worker, "Fanout");
+    }
+
+    for (int i = 0; i != count; i++)
+        threads_[i] = (_next + i) % _size;
+    _next = (_next + count) % _size;
+    return 0;
+}
+
+void zmq::fanout_pool_t::post (int thread_, const job_t &job_)
+{
+    worker_t *worker = _workers[thread_];
+    if (!worker->queue.write (job_))
+        worker->signaler.send ();
+}
+
+void zmq::fanout_pool_t::worker_routine (void *arg_)
+{
+    worker_t *worker = static_cast<worker_t *> (arg_);
+
+    job_t job;
+    while (true) {
+        //  If there's no job, the queue is marked asleep and the next post
+        //  signals.
+        if (!worker->queue.read (&job)) {
+            if (worker->signaler.wait (-1) == -1) {
+                errno_assert (errno == EINTR);
+                continue;
+            }
+            worker->signaler.recv ();
+            continue;
+        }
+        if (!job.fn)
+            return;
+        job.fn (job.arg, job.shard, job.item);
+    }
+}
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_FANOUT_POOL_HPP_INCLUDED__
+#define __ZMQ_FANOUT_POOL_HPP_INCLUDED__
+
+#include <vector>
+
+#include "config.hpp"
+#include "macros.hpp"
+#include "mpsc_queue.hpp"
+#include "mutex.hpp"
+#include "signaler.hpp"
+#include "thread.hpp"
+
+namespace zmq
+{
+class thread_ctx_t;
+
+//  Threads of a context writing the shards of large fan-outs on behalf of
+//  the distributors. Each thread has a queue of its own the distributors
+//  append their jobs to without waiting for them. The threads are started
+//  as the distributors ask for them and run until the context ends.
+class fanout_pool_t
+{
+  public:
+    typedef void (job_fn) (void *arg_, int shard_, void *item_);
+
+    struct job_t
+    {
+        job_fn *fn;
+        void *arg;
+        int shard;
+        void *item;
+    };
+
+    explicit fanout_pool_t (const thread_ctx_t &ctx_);
+    ~fanout_pool_t ();
+
+    //  Fills threads_ with the ids of as many distinct threads, starting
+    //  the threads missing. Distributors are spread over the threads.
+    int reserve (std::vector<int> &threads_);
+
+    //  Appends the job to the queue of the thread. Jobs posted to the same
+    //  thread are run in the order they were posted.
+    void post (int thread_, const job_t &job_);
+
+  private:
+    struct worker_t
+    {
+        mpsc_queue_t<job_t, fanout_queue_granularity> queue;
+        signaler_t signaler;
+        thread_t thread;
+    };
+
+    static void worker_routine (void *arg_);
+
+    const thread_ctx_t &_ctx;
+
+    //  Protects the count of threads and the next thread to hand out.
+    //  Threads are never removed, so their slots can be read without it.
+    mutex_t _sync;
+    worker_t *_workers[fanout_max_shards - 1];
+    int _size;
+    int _next;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (fanout_pool_t)
+};
+}
+
+#endif
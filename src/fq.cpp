@@ -93,6 +93,47 @@ int zmq::fq_t::recvpipe (msg_t *msg_, pipe_t **pipe_)
     return -1;
 }
 
+int zmq::fq_t::recv_batch (msg_t *msgs_, size_t count_)
+{
+    size_t received = 0;
+    while (received != count_ && _active > 0) {
+        //  Drain the current pipe rather than moving to the next pipe after
+        //  every message. Fairness is kept at the granularity of a batch.
+        pipe_t *const pipe = _pipes[_current];
+        for (; received != count_; ++received) {
+            msg_t &msg = msgs_[received];
+            int rc = msg.close ();
+            errno_assert (rc == 0);
+            if (!pipe->read (&msg)) {
+                rc = msg.init ();
+                errno_assert (rc == 0);
+                break;
+            }
+            _more = (msg.flagsp () & msg_t::more) != 0;
+        }
+
+        if (received == count_) {
+            if (!_more)
+                _current = (_current + 1) % _active;
+            break;
+        }
+
+        //  The pipe is empty. Check the atomicity of the message and
+        //  deactivate the pipe, see recvpipe ().
+        zmq_assert (!_more);
+        _active--;
+        _pipes.swap (_current, _active);
+        if (_current == _active)
+            _current = 0;
+    }
+
+    if (received == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<int> (received);
+}
+
 bool zmq::fq_t::has_in ()
 {
     //  There are subsequent parts of the partly-read message available.
@@ -27,6 +27,11 @@ class fq_t
 
     int recv (msg_t *msg_);
     int recvpipe (msg_t *msg_, pipe_t **pipe_);
+
+    //  Receives up to count_ message parts, reading all the parts
+    //  available in a pipe before moving on to the next one. Returns the
+    //  number of parts received or -1 with errno set to EAGAIN.
+    int recv_batch (msg_t *msgs_, size_t count_);
     bool has_in ();
 
   private:
@@ -9,6 +9,7 @@
 #include "macros.hpp"
 #include "stdint.hpp"
 #include "atomic_counter.hpp"
+#include "topic_batch.hpp"
 
 namespace zmq
 {
@@ -33,6 +34,17 @@ template <typename T> class generic_mtrie_t
     //  and size_ existed before.
     bool add (prefix_t prefix_, size_t size_, value_t *value_);
 
+    //  Adds the topics to the trie. The walk down the trie for each topic
+    //  starts where it leaves the path of the previous one, so sorted
+    //  topics walk each shared prefix once. Calls func_ for each topic
+    //  with whether no entry with the same prefix existed before.
+    template <typename Arg>
+    void add_many (const topic_t *topics_,
+                   size_t count_,
+                   value_t *value_,
+                   void (*func_) (const topic_t &topic_, bool added_, Arg arg_),
+                   Arg arg_);
+
     //  Remove all entries with a specific value from the trie.
     //  The call_on_uniq_ flag controls if the callback is invoked
     //  when there are no entries left on a prefix only (true)
@@ -62,6 +74,14 @@ template <typename T> class generic_mtrie_t
     uint32_t num_prefixes () const { return _num_prefixes.get (); }
 
   private:
+    //  Returns the child node for c_, extending the table and creating the
+    //  node as needed.
+    generic_mtrie_t *child (unsigned char c_);
+
+    //  Adds the value to node_, a node of this trie. Returns true iff the
+    //  node had no values before.
+    bool add_value (generic_mtrie_t *node_, value_t *value_);
+
     bool is_redundant () const;
 
     typedef std::set<value_t *> pipes_t;
@@ -9,6 +9,7 @@
 #include <new>
 #include <algorithm>
 #include <list>
+#include <vector>
 
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
 #include <tbb/scalable_allocator.h>
@@ -46,111 +47,142 @@ template <typename T> generic_mtrie_t<T>::~generic_mtrie_t ()
 }
 
 template <typename T>
-bool generic_mtrie_t<T>::add (prefix_t prefix_, size_t size_, value_t *pipe_)
+generic_mtrie_t<T> *generic_mtrie_t<T>::child (unsigned char c_)
 {
-    generic_mtrie_t<value_t> *it = this;
-
-    while (size_) {
-        const unsigned char c = *prefix_;
-
-        if (c < it->_min || c >= it->_min + it->_count) {
-            //  The character is out of range of currently handled
-            //  characters. We have to extend the table.
-            if (!it->_count) {
-                it->_min = c;
-                it->_count = 1;
-                it->_next.node = NULL;
-            } else if (it->_count == 1) {
-                const unsigned char oldc = it->_min;
-                generic_mtrie_t *oldp = it->_next.node;
-                it->_count = (it->_min < c ? c - it->_min : it->_min - c) + 1;
-                it->_next.table = static_cast<generic_mtrie_t **> (
+    if (c_ < _min || c_ >= _min + _count) {
+        //  The character is out of range of currently handled
+        //  characters. We have to extend the table.
+        if (!_count) {
+            _min = c_;
+            _count = 1;
+            _next.node = NULL;
+        } else if (_count == 1) {
+            const unsigned char oldc = _min;
+            generic_mtrie_t *oldp = _next.node;
+            _count = (_min < c_ ? c_ - _min : _min - c_) + 1;
+            _next.table = static_cast<generic_mtrie_t **> (
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-                  scalable_malloc (sizeof (generic_mtrie_t *) * it->_count));
+              scalable_malloc (sizeof (generic_mtrie_t *) * _count));
 #else
-                  std::malloc (sizeof (generic_mtrie_t *) * it->_count));
+              std::malloc (sizeof (generic_mtrie_t *) * _count));
 #endif
-                alloc_assert (it->_next.table);
-                for (unsigned short i = 0; i != it->_count; ++i)
-                    it->_next.table[i] = 0;
-                it->_min = std::min (it->_min, c);
-                it->_next.table[oldc - it->_min] = oldp;
-            } else if (it->_min < c) {
-                //  The new character is above the current character range.
-                const unsigned short old_count = it->_count;
-                it->_count = c - it->_min + 1;
+            alloc_assert (_next.table);
+            for (unsigned short i = 0; i != _count; ++i)
+                _next.table[i] = 0;
+            _min = std::min (_min, c_);
+            _next.table[oldc - _min] = oldp;
+        } else if (_min < c_) {
+            //  The new character is above the current character range.
+            const unsigned short old_count = _count;
+            _count = c_ - _min + 1;
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-                it->_next.table =
-                  static_cast<generic_mtrie_t **> (scalable_realloc (
-                    it->_next.table, sizeof (generic_mtrie_t *) * it->_count));
+            _next.table =
+              static_cast<generic_mtrie_t **> (scalable_realloc (
+                _next.table, sizeof (generic_mtrie_t *) * _count));
 #else
-                it->_next.table =
-                  static_cast<generic_mtrie_t **> (std::realloc (
-                    it->_next.table, sizeof (generic_mtrie_t *) * it->_count));
+            _next.table =
+              static_cast<generic_mtrie_t **> (std::realloc (
+                _next.table, sizeof (generic_mtrie_t *) * _count));
 #endif
-                alloc_assert (it->_next.table);
-                for (unsigned short i = old_count; i != it->_count; i++)
-                    it->_next.table[i] = NULL;
-            } else {
-                //  The new character is below the current character range.
-                const unsigned short old_count = it->_count;
-                it->_count = (it->_min + old_count) - c;
+            alloc_assert (_next.table);
+            for (unsigned short i = old_count; i != _count; i++)
+                _next.table[i] = NULL;
+        } else {
+            //  The new character is below the current character range.
+            const unsigned short old_count = _count;
+            _count = (_min + old_count) - c_;
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-                it->_next.table =
-                  static_cast<generic_mtrie_t **> (scalable_realloc (
-                    it->_next.table, sizeof (generic_mtrie_t *) * it->_count));
+            _next.table =
+              static_cast<generic_mtrie_t **> (scalable_realloc (
+                _next.table, sizeof (generic_mtrie_t *) * _count));
 #else
-                it->_next.table =
-                  static_cast<generic_mtrie_t **> (std::realloc (
-                    it->_next.table, sizeof (generic_mtrie_t *) * it->_count));
+            _next.table =
+              static_cast<generic_mtrie_t **> (std::realloc (
+                _next.table, sizeof (generic_mtrie_t *) * _count));
 #endif
-                alloc_assert (it->_next.table);
-                memmove (it->_next.table + it->_min - c, it->_next.table,
-                         old_count * sizeof (generic_mtrie_t *));
-                for (unsigned short i = 0; i != it->_min - c; i++)
-                    it->_next.table[i] = NULL;
-                it->_min = c;
-            }
+            alloc_assert (_next.table);
+            memmove (_next.table + _min - c_, _next.table,
+                     old_count * sizeof (generic_mtrie_t *));
+            for (unsigned short i = 0; i != _min - c_; i++)
+                _next.table[i] = NULL;
+            _min = c_;
         }
+    }
 
-        //  If next node does not exist, create one.
-        if (it->_count == 1) {
-            if (!it->_next.node) {
-                it->_next.node = new (std::nothrow) generic_mtrie_t;
-                alloc_assert (it->_next.node);
-                ++(it->_live_nodes);
-            }
-
-            ++prefix_;
-            --size_;
-            it = it->_next.node;
-        } else {
-            if (!it->_next.table[c - it->_min]) {
-                it->_next.table[c - it->_min] =
-                  new (std::nothrow) generic_mtrie_t;
-                alloc_assert (it->_next.table[c - it->_min]);
-                ++(it->_live_nodes);
-            }
-
-            ++prefix_;
-            --size_;
-            it = it->_next.table[c - it->_min];
-        }
+    //  If next node does not exist, create one.
+    generic_mtrie_t **next =
+      _count == 1 ? &_next.node : &_next.table[c_ - _min];
+    if (!*next) {
+        *next = new (std::nothrow) generic_mtrie_t;
+        alloc_assert (*next);
+        ++_live_nodes;
     }
+    return *next;
+}
 
+template <typename T>
+bool generic_mtrie_t<T>::add_value (generic_mtrie_t *node_, value_t *pipe_)
+{
     //  We are at the node corresponding to the prefix. We are done.
-    const bool result = !it->_pipes;
-    if (!it->_pipes) {
-        it->_pipes = new (std::nothrow) pipes_t;
-        alloc_assert (it->_pipes);
+    const bool result = !node_->_pipes;
+    if (!node_->_pipes) {
+        node_->_pipes = new (std::nothrow) pipes_t;
+        alloc_assert (node_->_pipes);
 
         _num_prefixes.add (1);
     }
-    it->_pipes->insert (pipe_);
+    node_->_pipes->insert (pipe_);
 
     return result;
 }
 
+template <typename T>
+bool generic_mtrie_t<T>::add (prefix_t prefix_, size_t size_, value_t *pipe_)
+{
+    generic_mtrie_t<value_t> *it = this;
+    for (; size_; ++prefix_, --size_)
+        it = it->child (*prefix_);
+
+    return add_value (it, pipe_);
+}
+
+template <typename T>
+template <typename Arg>
+void generic_mtrie_t<T>::add_many (const topic_t *topics_,
+                                   size_t count_,
+                                   value_t *pipe_,
+                                   void (*func_) (const topic_t &topic_,
+                                                  bool added_,
+                                                  Arg arg_),
+                                   Arg arg_)
+{
+    //  Nodes are never removed while adding, so the nodes on the path of
+    //  the previous key stay valid. The node at depth n is path[n].
+    std::vector<generic_mtrie_t *> path (1, this);
+    prefix_t previous = NULL;
+    size_t previous_size = 0;
+
+    for (size_t i = 0; i != count_; ++i) {
+        const prefix_t prefix = topics_[i].data;
+        const size_t size = topics_[i].size;
+        const size_t max = std::min (size, previous_size);
+        size_t common = 0;
+        while (common < max && prefix[common] == previous[common])
+            ++common;
+
+        path.resize (common + 1);
+        generic_mtrie_t *it = path.back ();
+        for (size_t depth = common; depth != size; ++depth) {
+            it = it->child (prefix[depth]);
+            path.push_back (it);
+        }
+
+        func_ (topics_[i], add_value (it, pipe_), arg_);
+        previous = prefix;
+        previous_size = size;
+    }
+}
+
 template <typename T>
 template <typename Arg>
 void generic_mtrie_t<T>::rm (value_t *pipe_,
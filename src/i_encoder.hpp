@@ -23,6 +23,14 @@ struct i_encoder
     //  Function returns 0 when a new message is required.
     virtual size_t encode (unsigned char **data_, size_t size_) = 0;
 
+    //  Returns the encoded data of the current step that were not consumed
+    //  yet, without copying them. The data remain valid until the next call.
+    //  Function returns 0 when a new message is required.
+    virtual size_t pending (unsigned char **data_) = 0;
+
+    //  Consumes the first size_ bytes of the data returned by pending.
+    virtual void advance (size_t size_) = 0;
+
     //  Load a new message into encoder.
     virtual void load_msg (msg_t *msg_) = 0;
 };
@@ -8,6 +8,8 @@
 #include "io_thread.hpp"
 #include "err.hpp"
 #include "ctx.hpp"
+#include "config.hpp"
+#include "decoder_allocators.hpp"
 
 zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_) :
     object_t (ctx_, tid_),
@@ -16,6 +18,10 @@ zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_) :
     _poller = new (std::nothrow) poller_t (*ctx_);
     alloc_assert (_poller);
 
+    _decoder_buffer_pool =
+      new (std::nothrow) decoder_buffer_pool_t (decoder_buffer_pool_max);
+    alloc_assert (_decoder_buffer_pool);
+
     if (_mailbox.get_fd () != retired_fd) {
         _mailbox_handle = _poller->add_fd (_mailbox.get_fd (), this);
         _poller->set_pollin (_mailbox_handle);
@@ -25,6 +31,10 @@ zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_) :
 zmq::io_thread_t::~io_thread_t ()
 {
     LIBZMQ_DELETE (_poller);
+
+    //  Messages still using buffers of the pool keep it alive.
+    if (_decoder_buffer_pool->drop_ref ())
+        LIBZMQ_DELETE (_decoder_buffer_pool);
 }
 
 void zmq::io_thread_t::start ()
@@ -51,6 +61,11 @@ int zmq::io_thread_t::get_load () const
     return _poller->get_load ();
 }
 
+zmq::decoder_buffer_pool_t *zmq::io_thread_t::get_decoder_buffer_pool () const
+{
+    return _decoder_buffer_pool;
+}
+
 void zmq::io_thread_t::in_event ()
 {
     //  TODO: Do we want to limit number of commands I/O thread can
@@ -12,6 +12,7 @@
 namespace zmq
 {
 class ctx_t;
+class decoder_buffer_pool_t;
 
 //  Generic part of the I/O thread. Polling-mechanism-specific features
 //  are implemented in separate "polling objects".
@@ -48,6 +49,10 @@ class io_thread_t ZMQ_FINAL : public object_t, public i_poll_events
     //  Returns load experienced by the I/O thread.
     int get_load () const;
 
+    //  Returns the pool the engines of the thread recycle their decoder
+    //  buffers through.
+    decoder_buffer_pool_t *get_decoder_buffer_pool () const;
+
   private:
     //  I/O thread accesses incoming commands via this mailbox.
     mailbox_t _mailbox;
@@ -58,6 +63,10 @@ class io_thread_t ZMQ_FINAL : public object_t, public i_poll_events
     //  I/O multiplexing is performed using a poller object.
     poller_t *_poller;
 
+    //  Decoder buffers the messages are done with. The pool is shared
+    //  with the buffers handed out and lives as long as any of them.
+    decoder_buffer_pool_t *_decoder_buffer_pool;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (io_thread_t)
 };
 }
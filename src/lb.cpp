@@ -6,7 +6,8 @@
 #include "err.hpp"
 #include "msg.hpp"
 
-zmq::lb_t::lb_t () : _active (0), _current (0), _more (false), _dropping (false)
+zmq::lb_t::lb_t () :
+    _active (0), _current (0), _more (false), _dropping (false), _batching (false)
 {
 }
 
@@ -117,7 +118,12 @@ int zmq::lb_t::sendpipe (msg_t *msg_, pipe_t **pipe_)
     //  continue round-robining (load balance).
     _more = (msg_->flagsp () & msg_t::more) != 0;
     if (!_more) {
-        _pipes[_current]->flush ();
+        if (_batching) {
+            if (_unflushed.empty () || _unflushed.back () != _pipes[_current])
+                _unflushed.push_back (_pipes[_current]);
+        } else {
+            _pipes[_current]->flush ();
+        }
 
         if (++_current >= _active)
             _current = 0;
@@ -130,6 +136,29 @@ int zmq::lb_t::sendpipe (msg_t *msg_, pipe_t **pipe_)
     return 0;
 }
 
+int zmq::lb_t::send_batch (msg_t *msgs_, size_t count_)
+{
+    //  No commands are processed while the batch is being written, so
+    //  the set of pipes and their states cannot change until the
+    //  deferred flushes are performed below.
+    size_t sent = 0;
+    int rc = 0;
+    _batching = true;
+    for (; sent != count_; ++sent) {
+        rc = sendpipe (&msgs_[sent], NULL);
+        if (rc != 0)
+            break;
+    }
+    _batching = false;
+
+    for (std::vector<pipe_t *>::size_type i = 0, size = _unflushed.size ();
+         i != size; ++i)
+        _unflushed[i]->flush ();
+    _unflushed.clear ();
+
+    return sent > 0 ? static_cast<int> (sent) : rc;
+}
+
 bool zmq::lb_t::has_out ()
 {
     //  If one part of the message was already written we can definitely
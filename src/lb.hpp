@@ -3,6 +3,8 @@
 #ifndef __ZMQ_LB_HPP_INCLUDED__
 #define __ZMQ_LB_HPP_INCLUDED__
 
+#include <vector>
+
 #include "array.hpp"
 
 namespace zmq
@@ -31,6 +33,11 @@ class lb_t
     //  being dropped. For the first frame, this will never happen.
     int sendpipe (msg_t *msg_, pipe_t **pipe_);
 
+    //  Sends up to count_ messages. Pipes are flushed once at the end of
+    //  the batch instead of after every message. Returns the number of
+    //  messages sent, or the error code of the first failed send.
+    int send_batch (msg_t *msgs_, size_t count_);
+
     bool has_out ();
 
   private:
@@ -51,6 +58,12 @@ class lb_t
     //  True if we are dropping current message.
     bool _dropping;
 
+    //  True while a batch is being sent. Completed messages are not
+    //  flushed immediately; the pipes are remembered in _unflushed
+    //  and flushed when the batch is done.
+    bool _batching;
+    std::vector<pipe_t *> _unflushed;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (lb_t)
 };
 }
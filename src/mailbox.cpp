@@ -3,8 +3,18 @@
 #include "precompiled.hpp"
 #include "mailbox.hpp"
 #include "err.hpp"
+#include "clock.hpp"
 
-zmq::mailbox_t::mailbox_t ()
+#if defined __SSE2__ || defined _M_X64 || defined _M_IX86
+#include <emmintrin.h>
+#define ZMQ_SPIN_PAUSE() _mm_pause ()
+#elif defined __aarch64__ || (defined __ARM_ARCH && __ARM_ARCH >= 7)
+#define ZMQ_SPIN_PAUSE() __asm__ __volatile__ ("yield")
+#else
+#define ZMQ_SPIN_PAUSE()
+#endif
+
+zmq::mailbox_t::mailbox_t () : _spin_time (0), _spin_hits (0), _spin_misses (0)
 {
     //  Get the pipe into passive state. That way, if the users starts by
     //  polling on the associated file descriptor it will get woken up when
@@ -18,10 +28,11 @@ zmq::mailbox_t::~mailbox_t ()
 {
     //  TODO: Retrieve and deallocate commands inside the _cpipe.
 
-    // Work around problem that other threads might still be in our
-    // send() method, by waiting on the mutex before disappearing.
-    _sync.lock ();
-    _sync.unlock ();
+    //  Work around problem that other threads might still be in our
+    //  send() method, after posting the command that made this thread
+    //  tear the mailbox down, by waiting for them before disappearing.
+    while (_senders.get () != 0)
+        ZMQ_SPIN_PAUSE ();
 }
 
 zmq::fd_t zmq::mailbox_t::get_fd () const
@@ -31,12 +42,11 @@ zmq::fd_t zmq::mailbox_t::get_fd () const
 
 void zmq::mailbox_t::send (const command_t &cmd_)
 {
-    _sync.lock ();
-    _cpipe.write (cmd_, false);
-    const bool ok = _cpipe.flush ();
-    _sync.unlock ();
+    _senders.add (1);
+    const bool ok = _cpipe.write (cmd_);
     if (!ok)
         _signaler.send ();
+    _senders.sub (1);
 }
 
 int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
@@ -50,30 +60,74 @@ int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
         _active = false;
     }
 
-    //  Wait for signal from the command sender.
-    int rc = _signaler.wait (timeout_);
-    if (rc == -1) {
-        errno_assert (errno == EAGAIN || errno == EINTR);
-        return -1;
+    //  Spinning spares the wake-up latency when a command comes soon. Its
+    //  sender signals anyway; the signal is left pending and received the
+    //  next time the mailbox waits.
+    if (_spin_time && timeout_ != 0 && spin (timeout_)) {
+        _active = true;
+        const bool ok = _cpipe.read (cmd_);
+        zmq_assert (ok);
+        return 0;
     }
 
-    //  Receive the signal.
-    rc = _signaler.recv_failable ();
-    if (rc == -1) {
-        errno_assert (errno == EAGAIN);
-        return -1;
-    }
+    while (true) {
+        //  Wait for signal from the command sender.
+        int rc = _signaler.wait (timeout_);
+        if (rc == -1) {
+            errno_assert (errno == EAGAIN || errno == EINTR);
+            return -1;
+        }
 
-    //  Switch into active state.
-    _active = true;
+        //  Receive the signal.
+        rc = _signaler.recv_failable ();
+        if (rc == -1) {
+            errno_assert (errno == EAGAIN);
+            return -1;
+        }
+
+        //  Get a command, switching into active state.
+        if (_cpipe.read (cmd_)) {
+            _active = true;
+            return 0;
+        }
 
-    //  Get a command.
-    const bool ok = _cpipe.read (cmd_);
-    zmq_assert (ok);
-    return 0;
+        //  The signal was left pending by a spin that already got its
+        //  command. Unless waiting forever, report it as a timeout.
+        if (timeout_ >= 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
 }
 
 bool zmq::mailbox_t::valid () const
 {
     return _signaler.valid ();
 }
+
+void zmq::mailbox_t::set_spin_time (int spin_time_)
+{
+    _spin_time = spin_time_;
+}
+
+bool zmq::mailbox_t::spin (int timeout_)
+{
+    //  Do not spin past the timeout.
+    uint64_t spin_time = _spin_time;
+    if (timeout_ > 0 && spin_time > uint64_t (timeout_) * 1000)
+        spin_time = uint64_t (timeout_) * 1000;
+    const uint64_t end = clock_t::now_us () + spin_time;
+
+    do {
+        for (int i = 0; i != mailbox_spin_checks; ++i) {
+            if (_cpipe.probe ()) {
+                ++_spin_hits;
+                return true;
+            }
+            ZMQ_SPIN_PAUSE ();
+        }
+    } while (clock_t::now_us () < end);
+
+    ++_spin_misses;
+    return false;
+}
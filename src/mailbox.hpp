@@ -9,9 +9,10 @@
 #include "fd.hpp"
 #include "config.hpp"
 #include "command.hpp"
-#include "ypipe.hpp"
-#include "mutex.hpp"
+#include "mpsc_queue.hpp"
+#include "atomic_counter.hpp"
 #include "i_mailbox.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
@@ -27,6 +28,14 @@ class mailbox_t ZMQ_FINAL : public i_mailbox
 
     bool valid () const;
 
+    //  Sets how long, in microseconds, recv spins checking for commands
+    //  before it waits for a signal.
+    void set_spin_time (int spin_time_);
+
+    //  Numbers of spins that got a command and that did not.
+    uint64_t get_spin_hits () const { return _spin_hits; }
+    uint64_t get_spin_misses () const { return _spin_misses; }
+
 #ifdef HAVE_FORK
     // close the file descriptors in the signaller. This is used in a forked
     // child process to close the file descriptors so that they do not interfere
@@ -38,23 +47,30 @@ class mailbox_t ZMQ_FINAL : public i_mailbox
 #endif
 
   private:
-    //  The pipe to store actual commands.
-    typedef ypipe_t<command_t, command_pipe_granularity> cpipe_t;
+    //  The queue to store actual commands. There's only one thread
+    //  receiving from the mailbox, but there is arbitrary number of threads
+    //  sending, which the queue lets send at once.
+    typedef mpsc_queue_t<command_t, command_pipe_granularity> cpipe_t;
     cpipe_t _cpipe;
 
     //  Signaler to pass signals from writer thread to reader thread.
     signaler_t _signaler;
 
-    //  There's only one thread receiving from the mailbox, but there
-    //  is arbitrary number of threads sending. Given that ypipe requires
-    //  synchronised access on both of its endpoints, we have to synchronise
-    //  the sending side.
-    mutex_t _sync;
-
     //  True if the underlying pipe is active, ie. when we are allowed to
     //  read commands from it.
     bool _active;
 
+    //  Number of threads in send (). The mailbox is not destroyed until
+    //  they are done with it.
+    atomic_counter_t _senders;
+
+    //  Returns true if a command arrived within the spin time.
+    bool spin (int timeout_);
+
+    int _spin_time;
+    uint64_t _spin_hits;
+    uint64_t _spin_misses;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (mailbox_t)
 };
 }
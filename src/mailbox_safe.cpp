@@ -49,18 +49,18 @@ void zmq::mailbox_safe_t::clear_signalers ()
 
 void zmq::mailbox_safe_t::send (const command_t &cmd_)
 {
-    _sync->lock ();
-    _cpipe.write (cmd_, false);
-    const bool ok = _cpipe.flush ();
+    if (_cpipe.write (cmd_))
+        return;
 
-    if (!ok) {
-        _cond_var.broadcast ();
+    //  A receiver holds the lock from going asleep until it waits on the
+    //  condition variable, so the broadcast can't get lost.
+    _sync->lock ();
+    _cond_var.broadcast ();
 
-        for (std::vector<signaler_t *>::iterator it = _signalers.begin (),
-                                                 end = _signalers.end ();
-             it != end; ++it) {
-            (*it)->send ();
-        }
+    for (std::vector<signaler_t *>::iterator it = _signalers.begin (),
+                                             end = _signalers.end ();
+         it != end; ++it) {
+        (*it)->send ();
     }
 
     _sync->unlock ();
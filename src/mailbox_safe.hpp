@@ -10,7 +10,7 @@
 #include "fd.hpp"
 #include "config.hpp"
 #include "command.hpp"
-#include "ypipe.hpp"
+#include "mpsc_queue.hpp"
 #include "mutex.hpp"
 #include "i_mailbox.hpp"
 #include "condition_variable.hpp"
@@ -42,8 +42,9 @@ class mailbox_safe_t ZMQ_FINAL : public i_mailbox
 #endif
 
   private:
-    //  The pipe to store actual commands.
-    typedef ypipe_t<command_t, command_pipe_granularity> cpipe_t;
+    //  The queue to store actual commands. Senders only take the lock to
+    //  wake the receivers up.
+    typedef mpsc_queue_t<command_t, command_pipe_granularity> cpipe_t;
     cpipe_t _cpipe;
 
     //  Condition variable to pass signals from writer thread to reader thread.
@@ -3,6 +3,8 @@
 #ifndef __ZMQ_MECHANISM_HPP_INCLUDED__
 #define __ZMQ_MECHANISM_HPP_INCLUDED__
 
+#include <vector>
+
 #include "stdint.hpp"
 #include "options.hpp"
 #include "blob.hpp"
@@ -13,6 +15,14 @@ namespace zmq
 class msg_t;
 class session_base_t;
 
+//  Buffers a crypto thread keeps from one message to the next, for the
+//  mechanisms that need room besides the message to seal or open it.
+struct crypto_scratch_t
+{
+    std::vector<uint8_t> plaintext;
+    std::vector<uint8_t> box;
+};
+
 //  Abstract class representing security mechanism.
 //  Different mechanism extends this class.
 
@@ -40,6 +50,36 @@ class mechanism_t
 
     virtual int decode (msg_t *) { return 0; }
 
+    //  Returns true if the mechanism has cryptography that can run on the
+    //  crypto threads, see enable_offload.
+    virtual bool can_offload () const { return false; }
+
+    //  Lets the cryptography of the messages run on the crypto threads.
+    //  From then on encode and decode only do the part that depends on
+    //  the order of the messages, and seal and open finish the job. These
+    //  only use state that doesn't change after the handshake, so they
+    //  can run in any thread, for several messages at once.
+    virtual void enable_offload () {}
+
+    //  The scratch buffers belong to the calling thread.
+    virtual void seal (msg_t *, crypto_scratch_t &) const {}
+
+    //  Returns -1 with the code of the protocol error in
+    //  error_event_code_ if the message can't be opened.
+    virtual int open (msg_t *,
+                      crypto_scratch_t &,
+                      int *error_event_code_) const
+    {
+        LIBZMQ_UNUSED (error_event_code_);
+        return 0;
+    }
+
+    //  Reports a message that could not be opened, in the engine's thread.
+    virtual void open_failed (int error_event_code_)
+    {
+        LIBZMQ_UNUSED (error_event_code_);
+    }
+
     //  Notifies mechanism about availability of ZAP message.
     virtual int zap_msg_available () { return 0; }
 
@@ -0,0 +1,206 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_MPSC_QUEUE_HPP_INCLUDED__
+#define __ZMQ_MPSC_QUEUE_HPP_INCLUDED__
+
+#include <new>
+
+#include "err.hpp"
+#include "atomic_counter.hpp"
+#include "atomic_ptr.hpp"
+#include "macros.hpp"
+
+namespace zmq
+{
+//  Lock-free queue any number of threads can write to at once. Only a
+//  single thread can read from the queue at any specific moment.
+//  T is the type of the object in the queue.
+//  N is granularity of the queue, i.e. how many items are needed to
+//  perform next memory allocation.
+//
+//  Writers append their node by swapping the head of the list, then link
+//  it to the node that was there before. The reader follows the links from
+//  the terminator node it read last. When there's nothing to read, the
+//  reader marks the empty link as asleep, and the writer that fills that
+//  link is the one that has to wake the reader up.
+//
+//  Nodes are allocated N at a time. Writers take turns handing out nodes
+//  from the current chunk, and a chunk is reused once the reader is done
+//  with all of its nodes.
+
+template <typename T, int N> class mpsc_queue_t
+{
+  public:
+    mpsc_queue_t () : _read_chunk (NULL), _read_count (0)
+    {
+        //  Insert terminator node into the queue.
+        node_t *const node = allocate ();
+        node->next.set (NULL);
+        _head.set (node);
+        _tail = node;
+    }
+
+    ~mpsc_queue_t ()
+    {
+        //  Drop the items left and the terminator node.
+        T value;
+        while (read (&value))
+            ;
+        release_read (_tail);
+        release (_read_chunk, _read_count);
+
+        chunk_t *const chunk = _chunk.xchg (NULL);
+        if (chunk)
+            release (chunk, N - chunk->used);
+        delete _spare.xchg (NULL);
+    }
+
+    //  Write an item to the queue. Returns false if the reader is asleep.
+    //  In that case, the caller is obliged to wake the reader up.
+    bool write (const T &value_)
+    {
+        node_t *const node = allocate ();
+        node->value = value_;
+        node->next.set (NULL);
+
+        node_t *const prev = _head.xchg (node);
+        return prev->next.xchg (node) != asleep ();
+    }
+
+    //  Check whether item is available for reading. If not, the reader
+    //  is asleep until the next write.
+    bool check_read ()
+    {
+        node_t *next = _tail->next.load ();
+        if (!next) {
+            next = _tail->next.cas (NULL, asleep ());
+            if (!next)
+                return false;
+        }
+        return next != asleep ();
+    }
+
+    //  Check whether item is available for reading, without putting the
+    //  reader asleep if there is none.
+    bool probe ()
+    {
+        node_t *const next = _tail->next.load ();
+        return next && next != asleep ();
+    }
+
+    //  Reads an item from the queue. Returns false if there is no value
+    //  available, in which case the reader is asleep until the next write.
+    bool read (T *value_)
+    {
+        if (!check_read ())
+            return false;
+
+        node_t *const next = _tail->next.load ();
+        *value_ = next->value;
+        release_read (_tail);
+        _tail = next;
+        return true;
+    }
+
+  private:
+    struct chunk_t;
+
+    struct node_t
+    {
+        T value;
+        atomic_ptr_t<node_t> next;
+        chunk_t *chunk;
+    };
+
+    struct chunk_t
+    {
+        chunk_t () : used (0), refs (N)
+        {
+            for (int i = 0; i != N; i++)
+                nodes[i].chunk = this;
+        }
+
+        node_t nodes[N];
+
+        //  Number of nodes handed out.
+        int used;
+
+        //  Nodes not read yet, including those not handed out yet.
+        atomic_counter_t refs;
+    };
+
+    //  Link value marking the reader as asleep. It points to no node.
+    node_t *asleep () { return reinterpret_cast<node_t *> (&_asleep); }
+
+    node_t *allocate ()
+    {
+        //  Take the current chunk so that no other writer uses it in the
+        //  meantime. Writers finding it taken start another one.
+        chunk_t *chunk = _chunk.xchg (NULL);
+        if (!chunk) {
+            chunk = _spare.xchg (NULL);
+            if (!chunk) {
+                chunk = new (std::nothrow) chunk_t;
+                alloc_assert (chunk);
+            }
+        }
+
+        node_t *const node = &chunk->nodes[chunk->used++];
+        if (chunk->used == N)
+            return node;
+
+        //  Put the chunk back. If another writer put one there meanwhile,
+        //  the rest of that one is left unused.
+        chunk = _chunk.xchg (chunk);
+        if (chunk)
+            release (chunk, N - chunk->used);
+        return node;
+    }
+
+    //  Releases the nodes the reader is done with a chunk at a time, as
+    //  consecutive nodes mostly come from the same chunk.
+    void release_read (node_t *node_)
+    {
+        if (node_->chunk != _read_chunk) {
+            release (_read_chunk, _read_count);
+            _read_chunk = node_->chunk;
+            _read_count = 0;
+        }
+        _read_count++;
+    }
+
+    void release (chunk_t *chunk_, int count_)
+    {
+        if (!count_ || chunk_->refs.sub (count_))
+            return;
+
+        //  There's nobody using the chunk any more. Keep the most recently
+        //  released chunk, as it is most likely to be hot in the cache.
+        chunk_->used = 0;
+        chunk_->refs.set (N);
+        delete _spare.xchg (chunk_);
+    }
+
+    //  Node the writers append to.
+    atomic_ptr_t<node_t> _head;
+
+    //  Terminator node, already read by the reader.
+    node_t *_tail;
+
+    //  Nodes read from the same chunk and not released yet.
+    chunk_t *_read_chunk;
+    int _read_count;
+
+    //  Chunk the nodes are handed out from.
+    atomic_ptr_t<chunk_t> _chunk;
+
+    //  Chunk to hand out nodes from once the current one is used up.
+    atomic_ptr_t<chunk_t> _spare;
+
+    char _asleep;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (mpsc_queue_t)
+};
+}
+
+#endif
@@ -7,12 +7,16 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <new>
 
 #include "stdint.hpp"
 #include "likely.hpp"
 #include "metadata.hpp"
 #include "err.hpp"
+#include "v2_protocol.hpp"
+#include "wire.hpp"
+#include "atomic_ptr.hpp"
 
 //  Check whether the sizes of public representation of the message (zmq_msg_t)
 //  and private representation of the message (zmq::msg_t) match.
@@ -70,8 +74,17 @@ volatile bool _messages_allocated{false};
 static bool _custom_allocator_set{false};
 #endif
 
-static zmq_custom_msg_alloc_fn *_custom_malloc = default_msg_alloc;
-static zmq_custom_msg_free_fn *_custom_free = default_msg_free;
+//  The allocator in use, published as a whole so that no thread ever
+//  pairs the allocation function of one allocator with the free function
+//  of another. NULL stands for the default allocator.
+struct msg_allocator_t
+{
+    zmq_custom_msg_alloc_fn *malloc;
+    zmq_custom_msg_free_fn *free;
+};
+static atomic_ptr_t<const msg_allocator_t> _allocator;
+static msg_allocator_t _custom_allocator;
+static msg_allocator_t _replacement_allocator;
 
 _Check_return_ bool
 set_custom_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
@@ -93,8 +106,9 @@ set_custom_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
 #ifndef NDEBUG
         _custom_allocator_set = true;
 #endif
-        _custom_malloc = malloc_;
-        _custom_free = free_;
+        _custom_allocator.malloc = malloc_;
+        _custom_allocator.free = free_;
+        _allocator.xchg (&_custom_allocator);
         return true;
     }
 
@@ -105,15 +119,39 @@ set_custom_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
     return false;
 }
 
+_Check_return_ bool
+replace_default_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
+                               _In_ zmq_custom_msg_free_fn *free_)
+{
+    const msg_allocator_t *current = _allocator.load ();
+    if (current)
+        return current->malloc == malloc_;
+
+#ifndef NDEBUG
+    _custom_allocator_set = true;
+#endif
+    _replacement_allocator.malloc = malloc_;
+    _replacement_allocator.free = free_;
+    current = _allocator.cas (NULL, &_replacement_allocator);
+    return !current || current->malloc == malloc_;
+}
+
 _Must_inspect_result_
 _Ret_opt_bytecap_ (cb) void *malloc (_In_ size_t cb, ZMQ_MSG_ALLOC_HINT hint)
 {
-    return _custom_malloc (cb, hint);
+    const msg_allocator_t *const allocator = _allocator.load ();
+    if (allocator)
+        return allocator->malloc (cb, hint);
+    return default_msg_alloc (cb, hint);
 }
 
 void free (_Pre_maybenull_ _Post_invalid_ void *ptr, ZMQ_MSG_ALLOC_HINT hint)
 {
-    _custom_free (ptr, hint);
+    const msg_allocator_t *const allocator = _allocator.load ();
+    if (allocator)
+        allocator->free (ptr, hint);
+    else
+        default_msg_free (ptr, hint);
 }
 } // namespace zmq
 #endif
@@ -175,18 +213,19 @@ int zmq::msg_t::init_size (size_t size_)
         _u.lmsg.group.type = group_type_short;
         _u.lmsg.routing_id = 0;
 #ifdef ZMQ_HAVE_CUSTOM_ALLOCATOR
-        _u.lmsg.content = static_cast<content_t *> (zmq::malloc (
-          sizeof (content_t) + size_, ZMQ_MSG_ALLOC_HINT_OUTGOING));
+        _u.lmsg.content = static_cast<content_t *> (
+          zmq::malloc (sizeof (content_t) + frame_headroom + size_,
+                       ZMQ_MSG_ALLOC_HINT_OUTGOING));
 #ifndef NDEBUG
         _messages_allocated = true;
 #endif
 #else
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
         _u.lmsg.content = static_cast<content_t *> (
-          scalable_malloc (sizeof (content_t) + size_));
+          scalable_malloc (sizeof (content_t) + frame_headroom + size_));
 #else
-        _u.lmsg.content =
-          static_cast<content_t *> (std::malloc (sizeof (content_t) + size_));
+        _u.lmsg.content = static_cast<content_t *> (
+          std::malloc (sizeof (content_t) + frame_headroom + size_));
 #endif
 #endif
         if (unlikely (!_u.lmsg.content)) {
@@ -195,10 +234,13 @@ int zmq::msg_t::init_size (size_t size_)
         }
 
 #ifndef NDEBUG
-        memset (_u.lmsg.content, 0, sizeof (content_t) + size_);
+        memset (_u.lmsg.content, 0,
+                sizeof (content_t) + frame_headroom + size_);
 #endif
 
-        _u.lmsg.content->data = _u.lmsg.content + 1;
+        _u.lmsg.content->data =
+          reinterpret_cast<unsigned char *> (_u.lmsg.content + 1)
+          + frame_headroom;
         _u.lmsg.content->size = size_;
         _u.lmsg.content->ffn = NULL;
         _u.lmsg.content->hint = NULL;
@@ -206,6 +248,7 @@ int zmq::msg_t::init_size (size_t size_)
         _u.lmsg.content->custom_allocation_hint = ZMQ_MSG_ALLOC_HINT_OUTGOING;
 #endif
         new (&_u.lmsg.content->refcnt) zmq::atomic_counter_t ();
+        _u.lmsg.content->frame_header_size = 0;
     }
 
     return 0;
@@ -248,6 +291,7 @@ int zmq::msg_t::init_external_storage (_In_ content_t *content_,
     _u.zclmsg.content->ffn = ffn_;
     _u.zclmsg.content->hint = hint_;
     new (&_u.zclmsg.content->refcnt) zmq::atomic_counter_t ();
+    _u.zclmsg.content->frame_header_size = 0;
 
     return 0;
 }
@@ -307,6 +351,7 @@ int zmq::msg_t::init_data (_In_opt_ void *data_,
         _u.lmsg.content->custom_allocation_hint = ZMQ_MSG_ALLOC_HINT_FIXED_SIZE;
 #endif
         new (&_u.lmsg.content->refcnt) zmq::atomic_counter_t ();
+        _u.lmsg.content->frame_header_size = 0;
     }
     return 0;
 }
@@ -380,6 +425,30 @@ int zmq::msg_t::init_cancel (_When_ (topic_ == NULL, _In_range_ (0, 0))
     return rc;
 }
 
+int zmq::msg_t::init_subscribe_batch (const size_t size_,
+                                      _In_reads_bytes_ (size_)
+                                        const unsigned char *batch_)
+{
+    int rc = init_size (size_);
+    if (rc == 0) {
+        set_flags (zmq::msg_t::subscribe_batch);
+        memcpy (datap (), batch_, size_);
+    }
+    return rc;
+}
+
+int zmq::msg_t::init_cancel_batch (const size_t size_,
+                                   _In_reads_bytes_ (size_)
+                                     const unsigned char *batch_)
+{
+    int rc = init_size (size_);
+    if (rc == 0) {
+        set_flags (zmq::msg_t::cancel_batch);
+        memcpy (datap (), batch_, size_);
+    }
+    return rc;
+}
+
 int zmq::msg_t::close ()
 {
     //  Check the validity of the message.
@@ -545,6 +614,7 @@ void zmq::msg_t::shrink (size_t new_size_)
             break;
         case type_lmsg:
             _u.lmsg.content->size = new_size_;
+            _u.lmsg.content->frame_header_size = 0;
             break;
         case type_zclmsg:
             _u.zclmsg.content->size = new_size_;
@@ -557,6 +627,65 @@ void zmq::msg_t::shrink (size_t new_size_)
     }
 }
 
+void zmq::msg_t::encode_frame_header ()
+{
+    if (_u.base.type != type_lmsg
+        || (_u.lmsg.flags & (shared | command | CMD_TYPE_MASK)))
+        return;
+
+    content_t *const content = _u.lmsg.content;
+    unsigned char *header = static_cast<unsigned char *> (content->data);
+    if (header
+        != reinterpret_cast<unsigned char *> (content + 1) + frame_headroom)
+        return;
+
+    //  The same header v2_encoder_t and v3_1_encoder_t write for data
+    //  frames.
+    const unsigned char protocol_flags =
+      _u.lmsg.flags & more ? v2_protocol_t::more_flag : 0;
+    if (content->size > UCHAR_MAX) {
+        header -= 9;
+        header[0] = protocol_flags | v2_protocol_t::large_flag;
+        put_uint64 (header + 1, content->size);
+        content->frame_header_size = 9;
+    } else {
+        header -= 2;
+        header[0] = protocol_flags;
+        header[1] = static_cast<uint8_t> (content->size);
+        content->frame_header_size = 2;
+    }
+}
+
+unsigned char *zmq::msg_t::encoded_frame (size_t *size_)
+{
+    if (_u.base.type != type_lmsg || !_u.lmsg.content->frame_header_size
+        || (_u.lmsg.flags & (command | CMD_TYPE_MASK)))
+        return NULL;
+
+    //  Copies of the message may be sent on with other flags.
+    content_t *const content = _u.lmsg.content;
+    unsigned char *frame =
+      static_cast<unsigned char *> (content->data) - content->frame_header_size;
+    if (!(*frame & v2_protocol_t::more_flag) != !(_u.lmsg.flags & more))
+        return NULL;
+
+    *size_ = content->frame_header_size + content->size;
+    return frame;
+}
+
+bool zmq::msg_t::spans (const void *data_, size_t size_)
+{
+    if (is_vsm ())
+        return false;
+
+    const unsigned char *const body =
+      static_cast<const unsigned char *> (data ());
+    const unsigned char *const begin =
+      is_lmsg () ? body - _u.lmsg.content->frame_header_size : body;
+    const unsigned char *const p = static_cast<const unsigned char *> (data_);
+    return p >= begin && p + size_ <= body + size ();
+}
+
 unsigned char zmq::msg_t::flags () const
 {
     return flagsp ();
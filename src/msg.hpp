@@ -37,6 +37,14 @@ namespace zmq
 _Check_return_ bool
 set_custom_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
                           _In_ zmq_custom_msg_free_fn *free_);
+//  Replaces the default allocator, even once messages were allocated, so
+//  free_ must release the memory of the default allocator as well.
+//  Returns false if a custom allocator other than this one is in use.
+//  The threads calling malloc_ and free_ see whatever was written before
+//  the replacement. Calls are not to overlap.
+_Check_return_ bool
+replace_default_msg_allocator (_In_ zmq_custom_msg_alloc_fn *malloc_,
+                               _In_ zmq_custom_msg_free_fn *free_);
 _Must_inspect_result_
   _Ret_opt_bytecap_ (cb) void *malloc (_In_ size_t cb, ZMQ_MSG_ALLOC_HINT hint);
 void free (_Pre_maybenull_ _Post_invalid_ void *ptr, ZMQ_MSG_ALLOC_HINT hint);
@@ -68,6 +76,9 @@ class msg_t
         ZMQ_MSG_ALLOC_HINT custom_allocation_hint;
 #endif
         zmq::atomic_counter_t refcnt;
+        //  Size of the frame header stored by encode_frame_header right
+        //  in front of the data, 0 if there is none.
+        unsigned char frame_header_size;
     };
 
     //  Message flags.
@@ -82,6 +93,10 @@ class msg_t
         subscribe = 12,
         cancel = 16,
         close_cmd = 20,
+        //  Batches of topics written to the pipes by XSUB sockets, never
+        //  sent over the wire as such.
+        subscribe_batch = 24,
+        cancel_batch = 28,
         credential = 32,
         routing_id = 64,
         shared = 128
@@ -183,6 +198,15 @@ class msg_t
                        const size_t size_,
                      _In_reads_bytes_ (size_) const unsigned char *topic_);
 
+    //  Initialise the message with a batch of topics, as laid out in
+    //  topic_batch.hpp, to subscribe to or to cancel.
+    int init_subscribe_batch (const size_t size_,
+                              _In_reads_bytes_ (size_)
+                                const unsigned char *batch_);
+    int init_cancel_batch (const size_t size_,
+                           _In_reads_bytes_ (size_)
+                             const unsigned char *batch_);
+
     int close ();
     int move (msg_t &src_);
     int copy (msg_t &src_);
@@ -273,6 +297,16 @@ class msg_t
         return (_u.base.flags & CMD_TYPE_MASK) == cancel;
     }
 
+    bool is_subscribe_batch () const
+    {
+        return (_u.base.flags & CMD_TYPE_MASK) == subscribe_batch;
+    }
+
+    bool is_cancel_batch () const
+    {
+        return (_u.base.flags & CMD_TYPE_MASK) == cancel_batch;
+    }
+
     size_t command_body_size () const;
     void *command_body ();
 
@@ -308,6 +342,22 @@ class msg_t
 
     void shrink (size_t new_size_);
 
+    //  Encodes the ZMTP 2.0/3.x header of a data frame right in front of
+    //  the data, so that the engines sending the message to many peers
+    //  share one encoded frame. Only done for messages whose data is held
+    //  along with their content and whose content isn't shared yet.
+    void encode_frame_header ();
+
+    //  Returns the header stored by encode_frame_header followed by the
+    //  data and sets size_ to their total size, or NULL if there is no
+    //  header or the flags of this copy of the message don't match it.
+    unsigned char *encoded_frame (size_t *size_);
+
+    //  Returns whether the size_ bytes at data_ lie within the buffer of
+    //  the message, the header stored by encode_frame_header included, so
+    //  that they can be sent straight from there.
+    bool spans (const void *data_, size_t size_);
+
   public:
     struct long_group_t
     {
@@ -392,6 +442,13 @@ class msg_t
           - (sizeof (metadata_t *) + 3 + sizeof (group_t) + sizeof (uint32_t))
     };
 
+    //  Room left in front of the data of large messages for the frame
+    //  header, keeping the alignment of the data.
+    enum
+    {
+        frame_headroom = 16
+    };
+
     enum
     {
         ping_cmd_name_size = 5,   // 4PING
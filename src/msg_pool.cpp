@@ -0,0 +1,316 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "msg_pool.hpp"
+
+#ifdef ZMQ_HAVE_MSG_POOL
+
+#include <new>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#ifdef ZMQ_HAVE_LINUX
+#include <sched.h>
+#endif
+
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+#include <tbb/scalable_allocator.h>
+#endif
+
+#include "atomic_ptr.hpp"
+#include "config.hpp"
+#include "err.hpp"
+#include "macros.hpp"
+#include "msg.hpp"
+#include "mutex.hpp"
+#include "stdint.hpp"
+
+#if !defined MAP_ANONYMOUS && defined MAP_ANON
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+namespace zmq
+{
+//  Size of the slabs, that of a huge page on most architectures.
+static const size_t slab_size = 2 * 1024 * 1024;
+static const size_t slab_count = msg_pool_arena_size / slab_size;
+
+//  The size classes go from 64B to 128kB.
+static const int min_class_shift = 6;
+static const int class_count = 12;
+
+struct msg_pool_class_t
+{
+    msg_pool_class_t () : free_list (NULL), next (NULL), end (NULL), hits (0)
+    {
+    }
+
+    mutex_t sync;
+
+    //  Freed buffers, each pointing to the next one in its first bytes.
+    void *free_list;
+
+    //  Part of the slab carved last that wasn't handed out yet.
+    char *next;
+    char *end;
+
+    //  Allocations served by the class.
+    uint64_t hits;
+};
+
+struct msg_pool_node_t
+{
+    msg_pool_node_t () : reservation (NULL), arena (NULL), slabs (0) {}
+
+    //  Address space reserved for the node, and the part of it aligned
+    //  to the slab size.
+    void *reservation;
+    char *arena;
+
+    //  Synchronises the carving of new slabs out of the arena.
+    mutex_t sync;
+    size_t slabs;
+    unsigned char slab_classes[slab_count];
+
+    msg_pool_class_t classes[class_count];
+};
+
+static mutex_t install_sync;
+
+//  Published once the pool is set up, so that the node count and the
+//  topology read before are visible to whoever loads the nodes.
+static atomic_ptr_t<msg_pool_node_t> nodes;
+static int node_count = 0;
+
+//  NUMA node of each CPU.
+static std::vector<int> cpu_nodes;
+
+static void *heap_alloc (size_t cb_)
+{
+#if defined(ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR)
+    return scalable_malloc (cb_);
+#else
+    return std::malloc (cb_);
+#endif
+}
+
+static void heap_free (void *ptr_)
+{
+#if defined(ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR)
+    scalable_free (ptr_);
+#else
+    std::free (ptr_);
+#endif
+}
+
+static void read_topology ()
+{
+    node_count = 1;
+    cpu_nodes.clear ();
+#ifdef ZMQ_HAVE_LINUX
+    for (int node = 0; node != msg_pool_max_nodes; node++) {
+        char path[64];
+        snprintf (path, sizeof path, "/sys/devices/system/node/node%d/cpulist",
+                  node);
+        FILE *const file = fopen (path, "r");
+        if (!file)
+            continue;
+        node_count = node + 1;
+
+        //  The list reads like 0-3,8-11.
+        int first;
+        while (fscanf (file, "%d", &first) == 1) {
+            int last = first;
+            int c = fgetc (file);
+            if (c == '-') {
+                if (fscanf (file, "%d", &last) != 1)
+                    break;
+                c = fgetc (file);
+            }
+            if (first >= 0 && last >= first) {
+                if (cpu_nodes.size () <= static_cast<size_t> (last))
+                    cpu_nodes.resize (last + 1, 0);
+                for (int cpu = first; cpu <= last; cpu++)
+                    cpu_nodes[cpu] = node;
+            }
+            if (c != ',')
+                break;
+        }
+        fclose (file);
+    }
+#endif
+}
+
+static int current_node ()
+{
+#ifdef ZMQ_HAVE_LINUX
+    const int cpu = sched_getcpu ();
+    if (cpu >= 0 && static_cast<size_t> (cpu) < cpu_nodes.size ())
+        return cpu_nodes[cpu];
+#endif
+    return 0;
+}
+
+static int size_class (size_t cb_)
+{
+    int size_class = 0;
+    while (size_class != class_count
+           && (static_cast<size_t> (1) << (min_class_shift + size_class)) < cb_)
+        size_class++;
+    return size_class;
+}
+
+static bool reserve_arena (msg_pool_node_t *node_)
+{
+    void *const pv = mmap (NULL, msg_pool_arena_size + slab_size, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pv == MAP_FAILED)
+        return false;
+    node_->reservation = pv;
+
+    //  Align the slabs so that they can be backed by huge pages.
+    const uintptr_t address = reinterpret_cast<uintptr_t> (pv);
+    node_->arena = reinterpret_cast<char *> ((address + slab_size - 1)
+                                             & ~(slab_size - 1));
+    return true;
+}
+
+static void release_arenas (msg_pool_node_t *nodes_)
+{
+    for (int i = 0; i != node_count; i++)
+        if (nodes_[i].reservation)
+            munmap (nodes_[i].reservation, msg_pool_arena_size + slab_size);
+    delete[] nodes_;
+}
+
+//  Returns a new slab for the size class, or NULL if the arena is used up.
+static char *carve_slab (msg_pool_node_t *node_, int size_class_)
+{
+    scoped_lock_t lock (node_->sync);
+    if (node_->slabs == slab_count)
+        return NULL;
+
+    //  Mapping reserved huge pages over the arena is not an option, as a
+    //  failed MAP_FIXED mapping leaves a hole in the reservation that any
+    //  other mapping of the process may take. Transparent huge pages are
+    //  asked for instead.
+    char *const slab = node_->arena + node_->slabs * slab_size;
+    if (mprotect (slab, slab_size, PROT_READ | PROT_WRITE) != 0)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    madvise (slab, slab_size, MADV_HUGEPAGE);
+#endif
+
+    node_->slab_classes[node_->slabs++] =
+      static_cast<unsigned char> (size_class_);
+    return slab;
+}
+
+static void *ZMQ_CDECL pool_alloc (size_t cb_, ZMQ_MSG_ALLOC_HINT hint_)
+{
+    const int class_index = size_class (cb_);
+    if (hint_ == ZMQ_MSG_ALLOC_HINT_NONE || class_index == class_count)
+        return heap_alloc (cb_);
+
+    msg_pool_node_t *const node = &nodes.load ()[current_node ()];
+    msg_pool_class_t &sc = node->classes[class_index];
+    {
+        scoped_lock_t lock (sc.sync);
+        void *const buffer = sc.free_list;
+        if (buffer) {
+            sc.free_list = *static_cast<void **> (buffer);
+            sc.hits++;
+            return buffer;
+        }
+
+        if (sc.next == sc.end) {
+            char *const slab = carve_slab (node, class_index);
+            if (slab) {
+                sc.next = slab;
+                sc.end = slab + slab_size;
+            }
+        }
+        if (sc.next != sc.end) {
+            char *const carved = sc.next;
+            sc.next += static_cast<size_t> (1)
+                       << (min_class_shift + class_index);
+            sc.hits++;
+            return carved;
+        }
+    }
+    return heap_alloc (cb_);
+}
+
+static void ZMQ_CDECL pool_free (void *ptr_, ZMQ_MSG_ALLOC_HINT hint_)
+{
+    LIBZMQ_UNUSED (hint_);
+
+    msg_pool_node_t *const pool_nodes = nodes.load ();
+    const uintptr_t address = reinterpret_cast<uintptr_t> (ptr_);
+    for (int i = 0; i != node_count; i++) {
+        msg_pool_node_t *const node = &pool_nodes[i];
+        const uintptr_t arena = reinterpret_cast<uintptr_t> (node->arena);
+        if (address < arena || address >= arena + msg_pool_arena_size)
+            continue;
+
+        //  The buffer goes back to the node it was carved for.
+        const size_t slab = (address - arena) / slab_size;
+        msg_pool_class_t &sc = node->classes[node->slab_classes[slab]];
+        scoped_lock_t lock (sc.sync);
+        *static_cast<void **> (ptr_) = sc.free_list;
+        sc.free_list = ptr_;
+        return;
+    }
+    heap_free (ptr_);
+}
+}
+
+bool zmq::msg_pool_t::install ()
+{
+    scoped_lock_t lock (install_sync);
+    if (nodes.load ())
+        return true;
+
+    read_topology ();
+    msg_pool_node_t *const pool_nodes =
+      new (std::nothrow) msg_pool_node_t[node_count];
+    if (!pool_nodes)
+        return false;
+    for (int i = 0; i != node_count; i++) {
+        if (!reserve_arena (&pool_nodes[i])) {
+            release_arenas (pool_nodes);
+            return false;
+        }
+    }
+
+    //  The nodes are in place before the allocator can be called.
+    nodes.xchg (pool_nodes);
+    if (!replace_default_msg_allocator (pool_alloc, pool_free)) {
+        nodes.xchg (NULL);
+        release_arenas (pool_nodes);
+        return false;
+    }
+    return true;
+}
+
+uint64_t zmq::msg_pool_t::hits ()
+{
+    msg_pool_node_t *const pool_nodes = nodes.load ();
+    if (!pool_nodes)
+        return 0;
+
+    uint64_t hits = 0;
+    for (int i = 0; i != node_count; i++)
+        for (int j = 0; j != class_count; j++) {
+            msg_pool_class_t &sc = pool_nodes[i].classes[j];
+            scoped_lock_t lock (sc.sync);
+            hits += sc.hits;
+        }
+    return hits;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_MSG_POOL_HPP_INCLUDED__
+#define __ZMQ_MSG_POOL_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+//  The pool plugs into the custom message allocator hook and needs
+//  mmap to reserve its arenas.
+#if defined ZMQ_HAVE_CUSTOM_ALLOCATOR && !defined ZMQ_HAVE_WINDOWS
+#define ZMQ_HAVE_MSG_POOL
+#endif
+
+#ifdef ZMQ_HAVE_MSG_POOL
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+//  Built-in message allocator, see ZMQ_MSG_POOL. Message buffers are
+//  carved out of slabs of 2MB, backed by transparent huge pages where
+//  the system enables them. Each slab holds buffers of a single
+//  power-of-two size class, and freed buffers go back to the free list
+//  of their class.
+//
+//  There's a separate set of slabs for each NUMA node. A thread gets its
+//  buffers from the slabs of the node it runs on, so I/O threads pinned
+//  by ZMQ_THREAD_AFFINITY_CPU_ADD get memory first touched on their own
+//  node. Buffers go back to the node they came from, whichever thread
+//  frees them.
+//
+//  Requests with no allocation hint or larger than the largest size
+//  class, and those made once the node's arena is used up, fall back to
+//  the heap. So does the memory of any message allocated before the
+//  pool was installed.
+
+class msg_pool_t
+{
+  public:
+    //  Makes the pool the message allocator of the process. The pool
+    //  stays in use from then on. Returns false if a custom allocator
+    //  was set already or if the arenas can't be reserved.
+    static bool install ();
+
+    //  Number of allocations served by the pool rather than the heap.
+    static uint64_t hits ();
+};
+}
+
+#endif
+
+#endif
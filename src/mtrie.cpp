@@ -3,8 +3,10 @@
 #include "precompiled.hpp"
 #include "mtrie.hpp"
 #include "generic_mtrie_impl.hpp"
+#include "compact_mtrie_impl.hpp"
 
 namespace zmq
 {
 template class generic_mtrie_t<pipe_t>;
+template class compact_mtrie_t<pipe_t>;
 }
@@ -4,6 +4,7 @@
 #define __ZMQ_MTRIE_HPP_INCLUDED__
 
 #include "generic_mtrie.hpp"
+#include "compact_mtrie.hpp"
 
 #if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER > 1600)
 #define ZMQ_HAS_EXTERN_TEMPLATE 1
@@ -17,6 +18,7 @@ class pipe_t;
 
 #if ZMQ_HAS_EXTERN_TEMPLATE
 extern template class generic_mtrie_t<pipe_t>;
+extern template class compact_mtrie_t<pipe_t>;
 #endif
 
 typedef generic_mtrie_t<pipe_t> mtrie_t;
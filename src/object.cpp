@@ -81,6 +81,7 @@ void zmq::object_t::process_command (const command_t &cmd_)
 
         case command_t::pipe_peer_stats:
             process_pipe_peer_stats (cmd_.args.pipe_peer_stats.queue_count,
+                                     cmd_.args.pipe_peer_stats.queue_footprint,
                                      cmd_.args.pipe_peer_stats.socket_base,
                                      cmd_.args.pipe_peer_stats.endpoint_pair);
             break;
@@ -89,6 +90,8 @@ void zmq::object_t::process_command (const command_t &cmd_)
             process_pipe_stats_publish (
               cmd_.args.pipe_stats_publish.outbound_queue_count,
               cmd_.args.pipe_stats_publish.inbound_queue_count,
+              cmd_.args.pipe_stats_publish.outbound_queue_footprint,
+              cmd_.args.pipe_stats_publish.inbound_queue_footprint,
               cmd_.args.pipe_stats_publish.endpoint_pair);
             break;
 
@@ -284,6 +287,7 @@ void zmq::object_t::send_hiccup (pipe_t *destination_, void *pipe_)
 
 void zmq::object_t::send_pipe_peer_stats (pipe_t *destination_,
                                           uint64_t queue_count_,
+                                          uint64_t queue_footprint_,
                                           own_t *socket_base_,
                                           endpoint_uri_pair_t *endpoint_pair_)
 {
@@ -291,6 +295,7 @@ void zmq::object_t::send_pipe_peer_stats (pipe_t *destination_,
     cmd.destination = destination_;
     cmd.type = command_t::pipe_peer_stats;
     cmd.args.pipe_peer_stats.queue_count = queue_count_;
+    cmd.args.pipe_peer_stats.queue_footprint = queue_footprint_;
     cmd.args.pipe_peer_stats.socket_base = socket_base_;
     cmd.args.pipe_peer_stats.endpoint_pair = endpoint_pair_;
     send_command (cmd);
@@ -300,6 +305,8 @@ void zmq::object_t::send_pipe_stats_publish (
   own_t *destination_,
   uint64_t outbound_queue_count_,
   uint64_t inbound_queue_count_,
+  uint64_t outbound_queue_footprint_,
+  uint64_t inbound_queue_footprint_,
   endpoint_uri_pair_t *endpoint_pair_)
 {
     command_t cmd;
@@ -307,6 +314,10 @@ void zmq::object_t::send_pipe_stats_publish (
     cmd.type = command_t::pipe_stats_publish;
     cmd.args.pipe_stats_publish.outbound_queue_count = outbound_queue_count_;
     cmd.args.pipe_stats_publish.inbound_queue_count = inbound_queue_count_;
+    cmd.args.pipe_stats_publish.outbound_queue_footprint =
+      outbound_queue_footprint_;
+    cmd.args.pipe_stats_publish.inbound_queue_footprint =
+      inbound_queue_footprint_;
     cmd.args.pipe_stats_publish.endpoint_pair = endpoint_pair_;
     send_command (cmd);
 }
@@ -449,6 +460,7 @@ void zmq::object_t::process_hiccup (void *)
 }
 
 void zmq::object_t::process_pipe_peer_stats (uint64_t,
+                                             uint64_t,
                                              own_t *,
                                              endpoint_uri_pair_t *)
 {
@@ -456,6 +468,8 @@ void zmq::object_t::process_pipe_peer_stats (uint64_t,
 }
 
 void zmq::object_t::process_pipe_stats_publish (uint64_t,
+                                                uint64_t,
+                                                uint64_t,
                                                 uint64_t,
                                                 endpoint_uri_pair_t *)
 {
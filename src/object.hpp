@@ -74,11 +74,14 @@ class object_t
     void send_hiccup (zmq::pipe_t *destination_, void *pipe_);
     void send_pipe_peer_stats (zmq::pipe_t *destination_,
                                uint64_t queue_count_,
+                               uint64_t queue_footprint_,
                                zmq::own_t *socket_base,
                                endpoint_uri_pair_t *endpoint_pair_);
     void send_pipe_stats_publish (zmq::own_t *destination_,
                                   uint64_t outbound_queue_count_,
                                   uint64_t inbound_queue_count_,
+                                  uint64_t outbound_queue_footprint_,
+                                  uint64_t inbound_queue_footprint_,
                                   endpoint_uri_pair_t *endpoint_pair_);
     void send_pipe_term (zmq::pipe_t *destination_);
     void send_pipe_term_ack (zmq::pipe_t *destination_);
@@ -104,11 +107,14 @@ class object_t
     virtual void process_activate_write (uint64_t msgs_read_);
     virtual void process_hiccup (void *pipe_);
     virtual void process_pipe_peer_stats (uint64_t queue_count_,
+                                          uint64_t queue_footprint_,
                                           zmq::own_t *socket_base_,
                                           endpoint_uri_pair_t *endpoint_pair_);
     virtual void
     process_pipe_stats_publish (uint64_t outbound_queue_count_,
                                 uint64_t inbound_queue_count_,
+                                uint64_t outbound_queue_footprint_,
+                                uint64_t inbound_queue_footprint_,
                                 endpoint_uri_pair_t *endpoint_pair_);
     virtual void process_pipe_term ();
     virtual void process_pipe_term_ack ();
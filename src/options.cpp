@@ -8,6 +8,7 @@
 #include "options.hpp"
 #include "err.hpp"
 #include "macros.hpp"
+#include "config.hpp"
 
 #ifndef ZMQ_HAVE_WINDOWS
 #include <net/if.h>
@@ -238,11 +239,16 @@ zmq::options_t::options_t () :
     norm_num_parity (4),
     norm_num_autoparity (0),
     norm_push_enable (false),
-    busy_poll (0)
+    busy_poll (0),
+    zero_copy_send_threshold (0),
+    udp_batch_size (1),
+    spin_wait (0),
+    recv_allocator_threshold (0)
 {
     memset (curve_public_key, 0, CURVE_KEYSIZE);
     memset (curve_secret_key, 0, CURVE_KEYSIZE);
     memset (curve_server_key, 0, CURVE_KEYSIZE);
+    memset (&recv_allocator, 0, sizeof recv_allocator);
 #if defined ZMQ_HAVE_VMCI
     vmci_buffer_size = 0;
     vmci_buffer_min_size = 0;
@@ -808,6 +814,45 @@ int zmq::options_t::setsockopt (int option_,
                 return 0;
             }
             break;
+
+        case ZMQ_ZERO_COPY_SEND_THRESHOLD:
+            if (is_int && value >= 0) {
+                zero_copy_send_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_UDP_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_udp_batch_size) {
+                udp_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_SPIN_WAIT:
+            if (is_int && value >= 0) {
+                spin_wait = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_RECV_ALLOCATOR:
+            if (optvallen_ == sizeof (zmq_recv_allocator_t)) {
+                const zmq_recv_allocator_t *const allocator =
+                  static_cast<const zmq_recv_allocator_t *> (optval_);
+                if (allocator->free_fn && !allocator->alloc_fn)
+                    break;
+                recv_allocator = *allocator;
+                return 0;
+            }
+            break;
+
+        case ZMQ_RECV_ALLOCATOR_THRESHOLD:
+            if (is_int && value >= 0) {
+                recv_allocator_threshold = value;
+                return 0;
+            }
+            break;
 #ifdef ZMQ_HAVE_WSS
         case ZMQ_WSS_KEY_PEM:
             // TODO: check if valid certificate
@@ -1373,6 +1418,41 @@ int zmq::options_t::getsockopt (int option_,
             }
             break;
 
+        case ZMQ_ZERO_COPY_SEND_THRESHOLD:
+            if (is_int) {
+                *value = zero_copy_send_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_UDP_BATCH_SIZE:
+            if (is_int) {
+                *value = udp_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_SPIN_WAIT:
+            if (is_int) {
+                *value = spin_wait;
+                return 0;
+            }
+            break;
+
+        case ZMQ_RECV_ALLOCATOR:
+            if (*optvallen_ == sizeof (zmq_recv_allocator_t)) {
+                memcpy (optval_, &recv_allocator, sizeof recv_allocator);
+                return 0;
+            }
+            break;
+
+        case ZMQ_RECV_ALLOCATOR_THRESHOLD:
+            if (is_int) {
+                *value = recv_allocator_threshold;
+                return 0;
+            }
+            break;
+
 #ifdef ZMQ_HAVE_NORM
         case ZMQ_NORM_MODE:
             if (is_int) {
@@ -307,6 +307,23 @@ struct options_t
 
     //  This option removes several delays caused by scheduling, interrupts and context switching.
     int busy_poll;
+
+    //  Messages of at least this size are sent over TCP with MSG_ZEROCOPY,
+    //  straight from their content. 0 disables zero-copy sends.
+    int zero_copy_send_threshold;
+
+    //  Maximal number of datagrams the UDP engine receives or sends per
+    //  I/O event, with a single system call where supported.
+    int udp_batch_size;
+
+    //  Time in microseconds a blocking call spins, checking for commands,
+    //  before it goes to sleep. 0 disables spinning.
+    int spin_wait;
+
+    //  Application allocator messages of at least recv_allocator_threshold
+    //  bytes are received into, if any.
+    zmq_recv_allocator_t recv_allocator;
+    int recv_allocator_threshold;
 };
 
 inline bool get_effective_conflate_option (const options_t &options)
@@ -7,6 +7,7 @@
 #include "macros.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
+#include "ctx.hpp"
 
 #include "ypipe.hpp"
 #include "ypipe_conflate.hpp"
@@ -19,21 +20,25 @@ int zmq::pipepair (object_t *parents_[2],
     //   Creates two pipe objects. These objects are connected by two ypipes,
     //   each to pass messages in one direction.
 
-    typedef ypipe_t<msg_t, message_pipe_granularity> upipe_normal_t;
+    typedef ypipe_t<msg_t, message_pipe_granularity,
+                    message_pipe_min_granularity>
+      upipe_normal_t;
     typedef ypipe_conflate_t<msg_t> upipe_conflate_t;
 
+    chunk_pool_t *const pool = parents_[0]->get_ctx ()->get_chunk_pool ();
+
     pipe_t::upipe_t *upipe1;
     if (conflate_[0])
         upipe1 = new (std::nothrow) upipe_conflate_t ();
     else
-        upipe1 = new (std::nothrow) upipe_normal_t ();
+        upipe1 = new (std::nothrow) upipe_normal_t (pool);
     alloc_assert (upipe1);
 
     pipe_t::upipe_t *upipe2;
     if (conflate_[1])
         upipe2 = new (std::nothrow) upipe_conflate_t ();
     else
-        upipe2 = new (std::nothrow) upipe_normal_t ();
+        upipe2 = new (std::nothrow) upipe_normal_t (pool);
     alloc_assert (upipe2);
 
     pipes_[0] = new (std::nothrow)
@@ -499,7 +504,9 @@ void zmq::pipe_t::hiccup ()
     _in_pipe =
       _conflate
         ? static_cast<upipe_t *> (new (std::nothrow) ypipe_conflate_t<msg_t> ())
-        : new (std::nothrow) ypipe_t<msg_t, message_pipe_granularity> ();
+        : new (std::nothrow) ypipe_t<msg_t, message_pipe_granularity,
+                                     message_pipe_min_granularity> (
+          get_ctx ()->get_chunk_pool ());
 
     alloc_assert (_in_pipe);
     _in_active = true;
@@ -559,16 +566,20 @@ void zmq::pipe_t::send_stats_to_peer (own_t *socket_base_)
         endpoint_uri_pair_t *ep =
           new (std::nothrow) endpoint_uri_pair_t (_endpoint_pair);
         send_pipe_peer_stats (_peer, _msgs_written - _peers_msgs_read,
+                              _out_pipe ? _out_pipe->footprint () : 0,
                               socket_base_, ep);
     }
 }
 
 void zmq::pipe_t::process_pipe_peer_stats (uint64_t queue_count_,
+                                           uint64_t queue_footprint_,
                                            own_t *socket_base_,
                                            endpoint_uri_pair_t *endpoint_pair_)
 {
-    send_pipe_stats_publish (socket_base_, queue_count_,
-                             _msgs_written - _peers_msgs_read, endpoint_pair_);
+    send_pipe_stats_publish (
+      socket_base_, queue_count_, _msgs_written - _peers_msgs_read,
+      queue_footprint_, _out_pipe ? _out_pipe->footprint () : 0,
+      endpoint_pair_);
 }
 
 void zmq::pipe_t::send_disconnect_msg ()
@@ -135,6 +135,7 @@ class pipe_t ZMQ_FINAL : public object_t,
     void process_hiccup (void *pipe_) ZMQ_OVERRIDE;
     void
     process_pipe_peer_stats (uint64_t queue_count_,
+                             uint64_t queue_footprint_,
                              own_t *socket_base_,
                              endpoint_uri_pair_t *endpoint_pair_) ZMQ_OVERRIDE;
     void process_pipe_term () ZMQ_OVERRIDE;
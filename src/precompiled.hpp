@@ -116,6 +116,10 @@
 
 // TODO: find a better home for these. Must be included here.
 
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 namespace zmq
 {
 template <class T,
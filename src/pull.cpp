@@ -43,6 +43,11 @@ int zmq::pull_t::xrecv (msg_t *msg_)
     return _fq.recv (msg_);
 }
 
+int zmq::pull_t::xrecv_batch (msg_t *msgs_, size_t count_)
+{
+    return _fq.recv_batch (msgs_, count_);
+}
+
 bool zmq::pull_t::xhas_in ()
 {
     return _fq.has_in ();
@@ -47,6 +47,11 @@ int zmq::push_t::xsend (msg_t *msg_)
     return _lb.send (msg_);
 }
 
+int zmq::push_t::xsend_batch (msg_t *msgs_, size_t count_)
+{
+    return _lb.send_batch (msgs_, count_);
+}
+
 bool zmq::push_t::xhas_out ()
 {
     return _lb.has_out ();
@@ -26,6 +26,7 @@ class push_t ZMQ_FINAL : public socket_base_t
                        bool subscribe_to_all_,
                        bool locally_initiated_);
     int xsend (zmq::msg_t *msg_);
+    int xsend_batch (zmq::msg_t *msgs_, size_t count_);
     bool xhas_out ();
     void xwrite_activated (zmq::pipe_t *pipe_);
     void xpipe_terminated (zmq::pipe_t *pipe_);
@@ -7,9 +7,22 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <iterator>
 #include <vector>
 
+#if defined __SSE2__ || defined _M_X64                                         \
+  || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define ZMQ_RADIX_TREE_SSE2
+#include <emmintrin.h>
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define ZMQ_RADIX_TREE_NEON
+#include <arm_neon.h>
+#endif
+
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
 #include <tbb/scalable_allocator.h>
 #endif
@@ -130,63 +143,243 @@ bool node_t::operator!= (node_t other_) const
     return !(*this == other_);
 }
 
-void node_t::resize (size_t prefix_length_, size_t edgecount_)
+static size_t node_size (size_t prefix_length_, size_t edgecount_)
 {
-    const size_t node_size = 3 * sizeof (uint32_t) + prefix_length_
-                             + edgecount_ * (1 + sizeof (void *));
-    unsigned char *new_data =
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-      static_cast<unsigned char *> (scalable_realloc (_data, node_size));
-#else
-      static_cast<unsigned char *> (std::realloc (_data, node_size));
-#endif
-    zmq_assert (new_data);
-    _data = new_data;
+    return 3 * sizeof (uint32_t) + prefix_length_
+           + edgecount_ * (1 + sizeof (void *));
+}
+
+size_t node_t::size ()
+{
+    return node_size (prefix_length (), edgecount ());
+}
+
+void node_t::resize (node_arena_t &arena_,
+                     size_t prefix_length_,
+                     size_t edgecount_)
+{
+    _data = arena_.reallocate (_data, size (),
+                               node_size (prefix_length_, edgecount_));
     set_prefix_length (static_cast<uint32_t> (prefix_length_));
     set_edgecount (static_cast<uint32_t> (edgecount_));
 }
 
-node_t make_node (size_t refcount_, size_t prefix_length_, size_t edgecount_)
+node_t make_node (node_arena_t &arena_,
+                  size_t refcount_,
+                  size_t prefix_length_,
+                  size_t edgecount_)
 {
-    const size_t node_size = 3 * sizeof (uint32_t) + prefix_length_
-                             + edgecount_ * (1 + sizeof (void *));
+    node_t node (arena_.allocate (node_size (prefix_length_, edgecount_)));
+    node.set_refcount (static_cast<uint32_t> (refcount_));
+    node.set_prefix_length (static_cast<uint32_t> (prefix_length_));
+    node.set_edgecount (static_cast<uint32_t> (edgecount_));
+    return node;
+}
+
+// ----------------------------------------------------------------------
 
+static unsigned char *allocate_memory (size_t size_)
+{
     unsigned char *data =
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-      static_cast<unsigned char *> (scalable_malloc (node_size));
+      static_cast<unsigned char *> (scalable_malloc (size_));
 #else
-      static_cast<unsigned char *> (std::malloc (node_size));
+      static_cast<unsigned char *> (std::malloc (size_));
 #endif
     zmq_assert (data);
+    return data;
+}
 
-    node_t node (data);
-    node.set_refcount (static_cast<uint32_t> (refcount_));
-    node.set_prefix_length (static_cast<uint32_t> (prefix_length_));
-    node.set_edgecount (static_cast<uint32_t> (edgecount_));
-    return node;
+static void free_memory (unsigned char *data_)
+{
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+    scalable_free (data_);
+#else
+    std::free (data_);
+#endif
 }
 
-// ----------------------------------------------------------------------
+node_arena_t::node_arena_t () :
+    _block_pos (NULL), _block_left (0), _live (0), _changes (0)
+{
+    for (size_t i = 0; i < classes; ++i)
+        _free_lists[i] = NULL;
+}
 
-zmq::radix_tree_t::radix_tree_t () : _root (make_node (0, 0, 0)), _size (0)
+node_arena_t::~node_arena_t ()
 {
+    for (std::vector<unsigned char *>::iterator it = _blocks.begin (),
+                                                end = _blocks.end ();
+         it != end; ++it)
+        free_memory (*it);
 }
 
-static void free_nodes (node_t node_)
+unsigned char *node_arena_t::allocate (size_t size_)
 {
-    for (size_t i = 0, count = node_.edgecount (); i < count; ++i)
-        free_nodes (node_.node_at (i));
+    ++_live;
+    ++_changes;
 
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-    scalable_free (node_._data);
+    const size_t size_class = (size_ - 1) / granularity;
+    if (size_class >= classes)
+        return allocate_memory (size_);
+
+    unsigned char *data = _free_lists[size_class];
+    if (data) {
+        memcpy (&_free_lists[size_class], data, sizeof (data));
+        return data;
+    }
+
+    //  The rest of a block too small for the node is wasted.
+    const size_t rounded_size = (size_class + 1) * granularity;
+    if (_block_left < rounded_size) {
+        _block_pos = allocate_memory (block_size);
+        _blocks.push_back (_block_pos);
+        _block_left = block_size;
+    }
+    data = _block_pos;
+    _block_pos += rounded_size;
+    _block_left -= rounded_size;
+    return data;
+}
+
+unsigned char *node_arena_t::reallocate (unsigned char *data_,
+                                         size_t old_size_,
+                                         size_t new_size_)
+{
+    const size_t old_class = (old_size_ - 1) / granularity;
+    const size_t new_class = (new_size_ - 1) / granularity;
+    if (old_class == new_class && old_class < classes)
+        return data_;
+
+    unsigned char *data = allocate (new_size_);
+    memcpy (data, data_, std::min (old_size_, new_size_));
+    deallocate (data_, old_size_);
+    return data;
+}
+
+void node_arena_t::deallocate (unsigned char *data_, size_t size_)
+{
+    --_live;
+    ++_changes;
+
+    const size_t size_class = (size_ - 1) / granularity;
+    if (size_class >= classes) {
+        free_memory (data_);
+        return;
+    }
+    memcpy (data_, &_free_lists[size_class], sizeof (data_));
+    _free_lists[size_class] = data_;
+}
+
+void node_arena_t::swap (node_arena_t &other_)
+{
+    for (size_t i = 0; i < classes; ++i)
+        std::swap (_free_lists[i], other_._free_lists[i]);
+    _blocks.swap (other_._blocks);
+    std::swap (_block_pos, other_._block_pos);
+    std::swap (_block_left, other_._block_left);
+    std::swap (_live, other_._live);
+    std::swap (_changes, other_._changes);
+}
+
+// ----------------------------------------------------------------------
+
+#if defined ZMQ_RADIX_TREE_SSE2
+//  Returns the index of the lowest set bit of a non-zero 16-bit mask.
+static size_t lowest_bit (unsigned int mask_)
+{
+#if defined _MSC_VER
+    unsigned long index;
+    _BitScanForward (&index, mask_);
+    return index;
 #else
-    std::free (node_._data);
+    return static_cast<size_t> (__builtin_ctz (mask_));
+#endif
+}
+#endif
+
+//  Returns the number of leading bytes a_ and b_ have in common, comparing
+//  at most size_ bytes. Topics tend to share long prefixes, so whole
+//  blocks are compared at once.
+static size_t common_prefix_length (const unsigned char *a_,
+                                    const unsigned char *b_,
+                                    size_t size_)
+{
+    size_t i = 0;
+#if defined ZMQ_RADIX_TREE_SSE2
+    for (; i + 16 <= size_; i += 16) {
+        const __m128i a =
+          _mm_loadu_si128 (reinterpret_cast<const __m128i *> (a_ + i));
+        const __m128i b =
+          _mm_loadu_si128 (reinterpret_cast<const __m128i *> (b_ + i));
+        const unsigned int mismatch =
+          ~static_cast<unsigned int> (
+            _mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)))
+          & 0xffff;
+        if (mismatch)
+            return i + lowest_bit (mismatch);
+    }
+#elif defined ZMQ_RADIX_TREE_NEON
+    for (; i + 16 <= size_; i += 16) {
+        const uint8x16_t equal =
+          vceqq_u8 (vld1q_u8 (a_ + i), vld1q_u8 (b_ + i));
+        const uint64x2_t halves = vreinterpretq_u64_u8 (equal);
+        if ((vgetq_lane_u64 (halves, 0) & vgetq_lane_u64 (halves, 1))
+            != ~static_cast<uint64_t> (0))
+            break;
+    }
+#endif
+    while (i < size_ && a_[i] == b_[i])
+        ++i;
+    return i;
+}
+
+//  Returns the index of byte_ among the size_ first bytes of the edges of
+//  a node, or size_ if no edge starts with it.
+static size_t find_edge (const unsigned char *first_bytes_,
+                         size_t size_,
+                         unsigned char byte_)
+{
+    size_t i = 0;
+#if defined ZMQ_RADIX_TREE_SSE2
+    const __m128i needle = _mm_set1_epi8 (static_cast<char> (byte_));
+    for (; i + 16 <= size_; i += 16) {
+        const __m128i bytes = _mm_loadu_si128 (
+          reinterpret_cast<const __m128i *> (first_bytes_ + i));
+        const unsigned int found = static_cast<unsigned int> (
+          _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, needle)));
+        if (found)
+            return i + lowest_bit (found);
+    }
+#elif defined ZMQ_RADIX_TREE_NEON
+    const uint8x16_t needle = vdupq_n_u8 (byte_);
+    for (; i + 16 <= size_; i += 16) {
+        const uint64x2_t found = vreinterpretq_u64_u8 (
+          vceqq_u8 (vld1q_u8 (first_bytes_ + i), needle));
+        if (vgetq_lane_u64 (found, 0) | vgetq_lane_u64 (found, 1))
+            break;
+    }
 #endif
+    while (i < size_ && first_bytes_[i] != byte_)
+        ++i;
+    return i;
+}
+
+zmq::radix_tree_t::radix_tree_t () :
+    _root (make_node (_arena, 0, 0, 0)), _size (0)
+{
+}
+
+static void free_nodes (node_arena_t &arena_, node_t node_)
+{
+    for (size_t i = 0, count = node_.edgecount (); i < count; ++i)
+        free_nodes (arena_, node_.node_at (i));
+    arena_.deallocate (node_._data, node_.size ());
 }
 
 zmq::radix_tree_t::~radix_tree_t ()
 {
-    free_nodes (_root);
+    free_nodes (_arena, _root);
 }
 
 match_result_t::match_result_t (size_t key_bytes_matched_,
@@ -229,12 +422,10 @@ match_result_t zmq::radix_tree_t::match (const unsigned char *key_,
         const unsigned char *const prefix = current_node.prefix ();
         const size_t prefix_length = current_node.prefix_length ();
 
-        for (prefix_byte_index = 0;
-             prefix_byte_index < prefix_length && key_byte_index < key_size_;
-             ++prefix_byte_index, ++key_byte_index) {
-            if (prefix[prefix_byte_index] != key_[key_byte_index])
-                break;
-        }
+        prefix_byte_index = common_prefix_length (
+          prefix, key_ + key_byte_index,
+          std::min (prefix_length, key_size_ - key_byte_index));
+        key_byte_index += prefix_byte_index;
 
         // Even if a prefix of the key matches and we're doing a
         // lookup, this means we've found a matching subscription.
@@ -251,19 +442,14 @@ match_result_t zmq::radix_tree_t::match (const unsigned char *key_,
 
         // We need to match the rest of the key. Check if there's an
         // outgoing edge from this node.
-        node_t next_node = current_node;
-        for (size_t i = 0, edgecount = current_node.edgecount (); i < edgecount;
-             ++i) {
-            if (current_node.first_byte_at (i) == key_[key_byte_index]) {
-                parent_edge_index = edge_index;
-                edge_index = i;
-                next_node = current_node.node_at (i);
-                break;
-            }
-        }
-
-        if (next_node == current_node)
+        const size_t edgecount = current_node.edgecount ();
+        const size_t next_edge_index = find_edge (
+          current_node.first_bytes (), edgecount, key_[key_byte_index]);
+        if (next_edge_index == edgecount)
             break; // No outgoing edge.
+        parent_edge_index = edge_index;
+        edge_index = next_edge_index;
+        const node_t next_node = current_node.node_at (edge_index);
         grandparent_node = parent_node;
         parent_node = current_node;
         current_node = next_node;
@@ -289,11 +475,12 @@ bool zmq::radix_tree_t::add (const unsigned char *key_, size_t key_size_)
             // The mismatch is at one of the outgoing edges, so we
             // create an edge from the current node to a new leaf node
             // that has the rest of the key as the prefix.
-            node_t key_node = make_node (1, key_size_ - key_bytes_matched, 0);
+            node_t key_node =
+              make_node (_arena, 1, key_size_ - key_bytes_matched, 0);
             key_node.set_prefix (key_ + key_bytes_matched);
 
             // Reallocate for one more edge.
-            current_node.resize (current_node.prefix_length (),
+            current_node.resize (_arena, current_node.prefix_length (),
                                  current_node.edgecount () + (size_t) 1);
 
             // Make room for the new edge. We need to shift the chunk
@@ -327,9 +514,10 @@ bool zmq::radix_tree_t::add (const unsigned char *key_, size_t key_size_)
         // One node will have the rest of the characters from the key,
         // and the other node will have the rest of the characters
         // from the current node's prefix.
-        node_t key_node = make_node (1, key_size_ - key_bytes_matched, 0);
+        node_t key_node =
+          make_node (_arena, 1, key_size_ - key_bytes_matched, 0);
         node_t split_node =
-          make_node (current_node.refcount (),
+          make_node (_arena, current_node.refcount (),
                      current_node.prefix_length () - prefix_bytes_matched,
                      current_node.edgecount ());
 
@@ -345,7 +533,7 @@ bool zmq::radix_tree_t::add (const unsigned char *key_, size_t key_size_)
         // the matched characters and 2 outgoing edges to the above
         // nodes. Set the refcount to 0 since this node doesn't hold a
         // key.
-        current_node.resize (prefix_bytes_matched, 2);
+        current_node.resize (_arena, prefix_bytes_matched, 2);
         current_node.set_refcount (0);
 
         // Add links to the new nodes. We don't need to copy the
@@ -367,7 +555,7 @@ bool zmq::radix_tree_t::add (const unsigned char *key_, size_t key_size_)
         // the current node's prefix and the outgoing edges from the
         // current node.
         node_t split_node =
-          make_node (current_node.refcount (),
+          make_node (_arena, current_node.refcount (),
                      current_node.prefix_length () - prefix_bytes_matched,
                      current_node.edgecount ());
         split_node.set_prefix (current_node.prefix () + prefix_bytes_matched);
@@ -376,7 +564,7 @@ bool zmq::radix_tree_t::add (const unsigned char *key_, size_t key_size_)
 
         // Resize the current node to hold only the matched characters
         // from its prefix and one edge to the new node.
-        current_node.resize (prefix_bytes_matched, 1);
+        current_node.resize (_arena, prefix_bytes_matched, 1);
 
         // Add an edge to the split node and set the refcount to 1
         // since this key wasn't inserted earlier. We don't need to
@@ -437,9 +625,9 @@ bool zmq::radix_tree_t::rm (const unsigned char *key_, size_t key_size_)
         // keep the old prefix length since resize() will overwrite
         // it.
         const uint32_t old_prefix_length = current_node.prefix_length ();
-        current_node.resize (old_prefix_length
-                               + (size_t) child.prefix_length (),
-                             child.edgecount ());
+        current_node.resize (
+          _arena, old_prefix_length + (size_t) child.prefix_length (),
+          child.edgecount ());
 
         // Append the child node's prefix to the current node.
         memcpy (current_node.prefix () + old_prefix_length, child.prefix (),
@@ -450,11 +638,7 @@ bool zmq::radix_tree_t::rm (const unsigned char *key_, size_t key_size_)
         current_node.set_node_pointers (child.node_pointers ());
         current_node.set_refcount (child.refcount ());
 
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        scalable_free (child._data);
-#else
-        std::free (child._data);
-#endif
+        _arena.deallocate (child._data, child.size ());
         parent_node.set_node_at (edge_index, current_node);
         return true;
     }
@@ -471,9 +655,9 @@ bool zmq::radix_tree_t::rm (const unsigned char *key_, size_t key_size_)
         // keep the old prefix length since resize() will overwrite
         // it.
         const uint32_t old_prefix_length = parent_node.prefix_length ();
-        parent_node.resize (old_prefix_length
-                              + (size_t) other_child.prefix_length (),
-                            other_child.edgecount ());
+        parent_node.resize (
+          _arena, old_prefix_length + (size_t) other_child.prefix_length (),
+          other_child.edgecount ());
 
         // Append the child node's prefix to the current node.
         memcpy (parent_node.prefix () + old_prefix_length,
@@ -484,13 +668,8 @@ bool zmq::radix_tree_t::rm (const unsigned char *key_, size_t key_size_)
         parent_node.set_node_pointers (other_child.node_pointers ());
         parent_node.set_refcount (other_child.refcount ());
 
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        scalable_free (current_node._data);
-        scalable_free (other_child._data);
-#else
-        std::free (current_node._data);
-        std::free (other_child._data);
-#endif
+        _arena.deallocate (current_node._data, current_node.size ());
+        _arena.deallocate (other_child._data, other_child.size ());
         grandparent_node.set_node_at (parent_edge_index, parent_node);
         return true;
     }
@@ -516,15 +695,11 @@ bool zmq::radix_tree_t::rm (const unsigned char *key_, size_t key_size_)
 
     // Shrink the parent node to the new size, which "deletes" the
     // last pointer in the chunk of node pointers.
-    parent_node.resize (parent_node.prefix_length (),
+    parent_node.resize (_arena, parent_node.prefix_length (),
                         parent_node.edgecount () - 1);
 
     // Nothing points to this node now, so we can reclaim it.
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-    scalable_free (current_node._data);
-#else
-    std::free (current_node._data);
-#endif
+    _arena.deallocate (current_node._data, current_node.size ());
 
     if (parent_node.prefix_length () == 0)
         _root._data = parent_node._data;
@@ -582,3 +757,43 @@ size_t zmq::radix_tree_t::size () const
 {
     return _size.get ();
 }
+
+static node_t copy_node (node_arena_t &arena_, node_t node_)
+{
+    const size_t size = node_.size ();
+    node_t copy (arena_.allocate (size));
+    memcpy (copy._data, node_._data, size);
+    return copy;
+}
+
+void zmq::radix_tree_t::compact ()
+{
+    //  Copy the nodes level by level, each copy still pointing to the
+    //  original children until their turn comes.
+    node_arena_t arena;
+    std::vector<node_t> nodes (1, copy_node (arena, _root));
+    _arena.deallocate (_root._data, _root.size ());
+    for (size_t i = 0; i < nodes.size (); ++i) {
+        node_t node = nodes[i];
+        for (size_t j = 0, count = node.edgecount (); j < count; ++j) {
+            node_t child = node.node_at (j);
+            const node_t copy = copy_node (arena, child);
+            _arena.deallocate (child._data, child.size ());
+            node.set_node_at (j, copy);
+            nodes.push_back (copy);
+        }
+    }
+    _root = nodes[0];
+
+    //  The blocks of the old layout go with the local arena.
+    _arena.swap (arena);
+    _arena.clear_changes ();
+    zmq_assert (arena.live () == 0);
+}
+
+void zmq::radix_tree_t::compact_if_fragmented ()
+{
+    const size_t changes = _arena.changes ();
+    if (changes >= compaction_min_changes && changes >= _arena.live ())
+        compact ();
+}
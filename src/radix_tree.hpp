@@ -4,9 +4,65 @@
 #define RADIX_TREE_HPP
 
 #include <stddef.h>
+#include <vector>
 
 #include "stdint.hpp"
 #include "atomic_counter.hpp"
+#include "macros.hpp"
+
+// Allocator for the nodes of a radix tree.
+//
+// Node sizes are rounded up to size classes. Nodes are carved out of
+// large blocks one after the other, and freed nodes are kept in a list
+// per size class for reuse, so that subscription churn doesn't fragment
+// the heap. Nodes larger than the largest size class are allocated on
+// their own.
+class node_arena_t
+{
+  public:
+    node_arena_t ();
+    ~node_arena_t ();
+
+    unsigned char *allocate (size_t size_);
+
+    // Same as realloc. The node stays in place if both sizes are of the
+    // same class.
+    unsigned char *
+    reallocate (unsigned char *data_, size_t old_size_, size_t new_size_);
+
+    void deallocate (unsigned char *data_, size_t size_);
+
+    // Number of nodes allocated and not freed.
+    size_t live () const { return _live; }
+
+    // Number of nodes allocated or freed since the arena was created or
+    // clear_changes was called.
+    size_t changes () const { return _changes; }
+    void clear_changes () { _changes = 0; }
+
+    void swap (node_arena_t &other_);
+
+  private:
+    enum
+    {
+        granularity = 16,
+        classes = 32,
+        block_size = 65536
+    };
+
+    // Lists of freed nodes, linked through their first bytes.
+    unsigned char *_free_lists[classes];
+
+    // Blocks nodes are carved from, and what's left of the last one.
+    std::vector<unsigned char *> _blocks;
+    unsigned char *_block_pos;
+    size_t _block_left;
+
+    size_t _live;
+    size_t _changes;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (node_arena_t)
+};
 
 // Wrapper type for a node's data layout.
 //
@@ -58,12 +114,17 @@ struct node_t
     void set_node_pointers (const unsigned char *pointers_);
     void set_node_at (size_t index_, node_t node_);
     void set_edge_at (size_t index_, unsigned char first_byte_, node_t node_);
-    void resize (size_t prefix_length_, size_t edgecount_);
+    void
+    resize (node_arena_t &arena_, size_t prefix_length_, size_t edgecount_);
+    size_t size ();
 
     unsigned char *_data;
 };
 
-node_t make_node (size_t refcount_, size_t prefix_length_, size_t edgecount_);
+node_t make_node (node_arena_t &arena_,
+                  size_t refcount_,
+                  size_t prefix_length_,
+                  size_t edgecount_);
 
 struct match_result_t
 {
@@ -110,10 +171,25 @@ class radix_tree_t
     //  Retrieve size of the radix tree. Note this is a multithread safe function.
     size_t size () const;
 
+    //  Lays the nodes out again in breadth-first order in fresh memory,
+    //  so that lookups walk through contiguous memory.
+    void compact ();
+
+    //  Compacts the tree if at least as many nodes were allocated or freed
+    //  since the last compaction as the tree has, e.g. after a bulk load of
+    //  subscriptions. Small trees are left alone.
+    void compact_if_fragmented ();
+
   private:
+    enum
+    {
+        compaction_min_changes = 1024
+    };
+
     match_result_t
     match (const unsigned char *key_, size_t key_size_, bool is_lookup_) const;
 
+    node_arena_t _arena;
     node_t _root;
     atomic_counter_t _size;
 };
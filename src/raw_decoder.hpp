@@ -15,7 +15,8 @@ namespace zmq
 class raw_decoder_t ZMQ_FINAL : public i_decoder
 {
   public:
-    raw_decoder_t (size_t bufsize_);
+    //  If a pool is given, the buffers are recycled through it.
+    raw_decoder_t (size_t bufsize_, decoder_buffer_pool_t *pool_ = NULL);
     ~raw_decoder_t ();
 
     //  i_decoder interface.
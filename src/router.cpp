@@ -176,9 +176,8 @@ int zmq::router_t::xsend (msg_t *msg_)
             //  Find the pipe associated with the routing id stored in the prefix.
             //  If there's no such pipe just silently ignore the message, unless
             //  router_mandatory is set.
-            out_pipe_t *out_pipe = lookup_out_pipe (
-              blob_t (static_cast<unsigned char *> (msg_->datap ()),
-                      msg_->sizep (), zmq::reference_tag_t ()));
+            out_pipe_t *out_pipe =
+              lookup_out_pipe (msg_->datap (), msg_->sizep ());
 
             if (out_pipe) {
                 _current_out = out_pipe->pipe;
@@ -408,11 +407,8 @@ int zmq::router_t::get_peer_state (const void *routing_id_,
 {
     int res = 0;
 
-    // TODO remove the const_cast, see comment in lookup_out_pipe
-    const blob_t routing_id_blob (
-      static_cast<unsigned char *> (const_cast<void *> (routing_id_)),
-      routing_id_size_, reference_tag_t ());
-    const out_pipe_t *out_pipe = lookup_out_pipe (routing_id_blob);
+    const out_pipe_t *out_pipe =
+      lookup_out_pipe (routing_id_, routing_id_size_);
     if (!out_pipe) {
         errno = EHOSTUNREACH;
         return -1;
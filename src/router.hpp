@@ -17,7 +17,6 @@ namespace zmq
 class ctx_t;
 class pipe_t;
 
-//  TODO: This class uses O(n) scheduling. Rewrite it to use O(1) algorithm.
 class router_t : public routing_socket_base_t
 {
   public:
@@ -62,13 +62,10 @@ void zmq::server_t::xread_activated (pipe_t *pipe_)
 
 void zmq::server_t::xwrite_activated (pipe_t *pipe_)
 {
-    const out_pipes_t::iterator end = _out_pipes.end ();
-    out_pipes_t::iterator it;
-    for (it = _out_pipes.begin (); it != end; ++it)
-        if (it->second.pipe == pipe_)
-            break;
-
+    const out_pipes_t::iterator it =
+      _out_pipes.find (pipe_->get_server_socket_routing_id ());
     zmq_assert (it != _out_pipes.end ());
+    zmq_assert (it->second.pipe == pipe_);
     zmq_assert (!it->second.active);
     it->second.active = true;
 }
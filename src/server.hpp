@@ -11,13 +11,16 @@
 #include "blob.hpp"
 #include "fq.hpp"
 
+#ifdef ZMQ_HAS_UNORDERED_MAP
+#include <unordered_map>
+#endif
+
 namespace zmq
 {
 class ctx_t;
 class msg_t;
 class pipe_t;
 
-//  TODO: This class uses O(n) scheduling. Rewrite it to use O(1) algorithm.
 class server_t : public socket_base_t
 {
   public:
@@ -47,7 +50,11 @@ class server_t : public socket_base_t
     };
 
     //  Outbound pipes indexed by the peer IDs.
+#ifdef ZMQ_HAS_UNORDERED_MAP
+    typedef std::unordered_map<uint32_t, outpipe_t> out_pipes_t;
+#else
     typedef std::map<uint32_t, outpipe_t> out_pipes_t;
+#endif
     out_pipes_t _out_pipes;
 
     //  Routing IDs are generated. It's a simple increment and wrap-over
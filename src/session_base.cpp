@@ -7,6 +7,7 @@
 #include "err.hpp"
 #include "pipe.hpp"
 #include "likely.hpp"
+#include "topic_batch.hpp"
 #include "tcp_connecter.hpp"
 #include "ws_connecter.hpp"
 #include "ipc_connecter.hpp"
@@ -106,6 +107,7 @@ zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
     _pipe (NULL),
     _zap_pipe (NULL),
     _incomplete_in (false),
+    _batch_offset (0),
     _pending (false),
     _engine (NULL),
     _socket (socket_),
@@ -117,6 +119,8 @@ zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
     _wss_hostname (options_.wss_hostname)
 #endif
 {
+    const int rc = _batch.init ();
+    errno_assert (rc == 0);
 }
 
 const zmq::endpoint_uri_pair_t &zmq::session_base_t::get_endpoint () const
@@ -139,6 +143,9 @@ zmq::session_base_t::~session_base_t ()
     if (_engine)
         _engine->terminate ();
 
+    const int rc = _batch.close ();
+    errno_assert (rc == 0);
+
     LIBZMQ_DELETE (_addr);
 }
 
@@ -153,12 +160,36 @@ void zmq::session_base_t::attach_pipe (pipe_t *pipe_)
 
 int zmq::session_base_t::pull_msg (msg_t *msg_)
 {
-    if (!_pipe || !_pipe->read (msg_)) {
-        errno = EAGAIN;
-        return -1;
+    if (!_batch.sizep ()) {
+        if (!_pipe || !_pipe->read (msg_)) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        _incomplete_in = (msg_->flagsp () & msg_t::more) != 0;
+
+        if (likely (!msg_->is_subscribe_batch () && !msg_->is_cancel_batch ()))
+            return 0;
+
+        //  There is no batched subscription in ZMTP, so the topics of the
+        //  batch are handed to the engine as separate subscriptions.
+        const int rc = _batch.move (*msg_);
+        errno_assert (rc == 0);
+        _batch_offset = 0;
     }
 
-    _incomplete_in = (msg_->flagsp () & msg_t::more) != 0;
+    const unsigned char *batch = static_cast<unsigned char *> (_batch.datap ());
+    const topic_t topic = read_topic (batch, _batch_offset);
+    int rc = _batch.is_subscribe_batch ()
+               ? msg_->init_subscribe (topic.size, topic.data)
+               : msg_->init_cancel (topic.size, topic.data);
+    errno_assert (rc == 0);
+    if (_batch_offset == _batch.sizep ()) {
+        rc = _batch.close ();
+        errno_assert (rc == 0);
+        rc = _batch.init ();
+        errno_assert (rc == 0);
+    }
 
     return 0;
 }
@@ -244,6 +275,13 @@ void zmq::session_base_t::clean_pipes ()
         rc = msg.close ();
         errno_assert (rc == 0);
     }
+
+    //  Drop the rest of a batch of subscriptions, the socket sends all of
+    //  its subscriptions again once the engine is reattached.
+    int rc = _batch.close ();
+    errno_assert (rc == 0);
+    rc = _batch.init ();
+    errno_assert (rc == 0);
 }
 
 void zmq::session_base_t::pipe_terminated (pipe_t *pipe_)
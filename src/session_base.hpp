@@ -112,6 +112,11 @@ class session_base_t : public own_t, public io_object_t, public i_pipe_events
     //  is still in the in pipe.
     bool _incomplete_in;
 
+    //  Batch of subscriptions read from the in pipe and handed to the
+    //  engine one topic at a time, and the offset of the next topic.
+    msg_t _batch;
+    size_t _batch_offset;
+
     //  True if termination have been suspended to push the pending
     //  messages to the network.
     bool _pending;
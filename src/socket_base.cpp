@@ -5,6 +5,7 @@
 #include <string>
 #include <algorithm>
 #include <limits>
+#include <climits>
 
 #include "macros.hpp"
 
@@ -430,6 +431,11 @@ int zmq::socket_base_t::setsockopt (int option_,
     //  the generic option parser.
     rc = options.setsockopt (option_, optval_, optvallen_);
     update_pipe_options (option_);
+#ifdef ZMQ_BUILD_DRAFT_API
+    //  Thread-safe sockets wait on a condition variable and do not spin.
+    if (rc == 0 && option_ == ZMQ_SPIN_WAIT && !_thread_safe)
+        static_cast<mailbox_t *> (_mailbox)->set_spin_time (options.spin_wait);
+#endif
 
     return rc;
 }
@@ -467,6 +473,18 @@ int zmq::socket_base_t::getsockopt (int option_,
           (static_cast<mailbox_t *> (_mailbox))->get_fd ());
     }
 
+#ifdef ZMQ_BUILD_DRAFT_API
+    if (option_ == ZMQ_SPIN_WAIT_HITS || option_ == ZMQ_SPIN_WAIT_MISSES) {
+        uint64_t count = 0;
+        if (!_thread_safe) {
+            const mailbox_t *mailbox = static_cast<mailbox_t *> (_mailbox);
+            count = option_ == ZMQ_SPIN_WAIT_HITS ? mailbox->get_spin_hits ()
+                                                  : mailbox->get_spin_misses ();
+        }
+        return do_getsockopt<uint64_t> (optval_, optvallen_, count);
+    }
+#endif
+
     if (option_ == ZMQ_EVENTS) {
         rc = process_commands (0, false);
         if (rc != 0 && (errno == EINTR || errno == ETERM)) {
@@ -1240,6 +1258,7 @@ int zmq::socket_base_t::term_endpoint (const char *endpoint_uri_)
     if (unlikely (rc != 0)) {
         return -1;
     }
+    xdrain ();
 
     //  Parse endpoint_uri_ string.
     std::string uri_protocol;
@@ -1470,6 +1489,178 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
     return 0;
 }
 
+int zmq::socket_base_t::send_batch (msg_t *msgs_, size_t count_, int flags_)
+{
+    scoped_optional_lock_t sync_lock (_thread_safe ? &_sync : NULL);
+
+    //  Check whether the context hasn't been shut down yet.
+    if (unlikely (_ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (unlikely (!msgs_ || count_ == 0 || count_ > INT_MAX)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Check whether messages passed to the function are valid.
+    for (size_t i = 0; i != count_; ++i) {
+        if (unlikely (!msgs_[i].check ())) {
+            errno = EFAULT;
+            return -1;
+        }
+    }
+
+    //  Process pending commands, if any. This is done once for the whole
+    //  batch rather than once per message.
+    int rc = process_commands (0, true);
+    if (unlikely (rc != 0)) {
+        return -1;
+    }
+
+    //  Impose the flags on the messages. With ZMQ_SNDMORE the batch is
+    //  a single multi-part message, the last part being the final one.
+    //  Otherwise every message in the batch stands on its own.
+    for (size_t i = 0; i != count_; ++i) {
+        msgs_[i].reset_flags (msg_t::more);
+        if ((flags_ & ZMQ_SNDMORE) && i != count_ - 1)
+            msgs_[i].set_flags (msg_t::more);
+        msgs_[i].reset_metadata ();
+    }
+
+    //  Try to send the messages using method in each socket class.
+    rc = xsend_batch (msgs_, count_);
+    if (rc > 0) {
+        return rc;
+    }
+    //  Special case for ZMQ_PUSH, see send ().
+    if (unlikely (rc == -2)) {
+        if (!((flags_ & ZMQ_DONTWAIT) || options.sndtimeo == 0)) {
+            rc = msgs_[0].close ();
+            errno_assert (rc == 0);
+            rc = msgs_[0].init ();
+            errno_assert (rc == 0);
+            return 1;
+        }
+    }
+    if (unlikely (errno != EAGAIN)) {
+        return -1;
+    }
+
+    //  In case of non-blocking send we'll simply propagate
+    //  the error - including EAGAIN - up the stack.
+    if ((flags_ & ZMQ_DONTWAIT) || options.sndtimeo == 0) {
+        return -1;
+    }
+
+    //  Compute the time when the timeout should occur.
+    //  If the timeout is infinite, don't care.
+    int timeout = options.sndtimeo;
+    const uint64_t end = timeout < 0 ? 0 : (_clock.now_ms () + timeout);
+
+    //  Wait until at least one message of the batch can be sent.
+    while (true) {
+        if (unlikely (process_commands (timeout, false) != 0)) {
+            return -1;
+        }
+        rc = xsend_batch (msgs_, count_);
+        if (rc > 0)
+            break;
+        if (unlikely (errno != EAGAIN)) {
+            return -1;
+        }
+        if (timeout > 0) {
+            timeout = static_cast<int> (end - _clock.now_ms ());
+            if (timeout <= 0) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+
+    return rc;
+}
+
+int zmq::socket_base_t::recv_batch (msg_t *msgs_, size_t count_, int flags_)
+{
+    scoped_optional_lock_t sync_lock (_thread_safe ? &_sync : NULL);
+
+    //  Check whether the context hasn't been shut down yet.
+    if (unlikely (_ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (unlikely (!msgs_ || count_ == 0 || count_ > INT_MAX)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Check whether messages passed to the function are valid.
+    for (size_t i = 0; i != count_; ++i) {
+        if (unlikely (!msgs_[i].check ())) {
+            errno = EFAULT;
+            return -1;
+        }
+    }
+
+    //  Process pending commands once for the whole batch, so that the
+    //  pipes activated since the last call are drained by this one.
+    if (unlikely (process_commands (0, false) != 0)) {
+        return -1;
+    }
+    _ticks = 0;
+
+    //  Get the messages.
+    int rc = xrecv_batch (msgs_, count_);
+    if (unlikely (rc < 0 && errno != EAGAIN)) {
+        return -1;
+    }
+
+    //  If we have messages, return immediately.
+    if (rc > 0) {
+        for (int i = 0; i != rc; ++i)
+            extract_flags (&msgs_[i]);
+        return rc;
+    }
+
+    //  Non-blocking case, see recv ().
+    if ((flags_ & ZMQ_DONTWAIT) || options.rcvtimeo == 0) {
+        return -1;
+    }
+
+    //  Compute the time when the timeout should occur.
+    //  If the timeout is infinite, don't care.
+    int timeout = options.rcvtimeo;
+    const uint64_t end = timeout < 0 ? 0 : (_clock.now_ms () + timeout);
+
+    //  In blocking scenario, commands are processed over and over again until
+    //  we are able to fetch at least one message.
+    while (true) {
+        if (unlikely (process_commands (timeout, false) != 0)) {
+            return -1;
+        }
+        rc = xrecv_batch (msgs_, count_);
+        if (rc > 0)
+            break;
+        if (unlikely (errno != EAGAIN)) {
+            return -1;
+        }
+        if (timeout > 0) {
+            timeout = static_cast<int> (end - _clock.now_ms ());
+            if (timeout <= 0) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+
+    for (int i = 0; i != rc; ++i)
+        extract_flags (&msgs_[i]);
+    return rc;
+}
+
 int zmq::socket_base_t::close ()
 {
     scoped_optional_lock_t sync_lock (_thread_safe ? &_sync : NULL);
@@ -1566,6 +1757,8 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
         return -1;
 
     //  Process all available commands.
+    if (rc == 0)
+        xdrain ();
     while (rc == 0 || errno == EINTR) {
         if (rc == 0) {
             cmd.destination->process_command (cmd);
@@ -1628,10 +1821,13 @@ void zmq::socket_base_t::process_term_endpoint (std::string *endpoint_)
 void zmq::socket_base_t::process_pipe_stats_publish (
   uint64_t outbound_queue_count_,
   uint64_t inbound_queue_count_,
+  uint64_t outbound_queue_footprint_,
+  uint64_t inbound_queue_footprint_,
   endpoint_uri_pair_t *endpoint_pair_)
 {
-    uint64_t values[2] = {outbound_queue_count_, inbound_queue_count_};
-    event (*endpoint_pair_, values, 2, ZMQ_EVENT_PIPES_STATS);
+    uint64_t values[4] = {outbound_queue_count_, inbound_queue_count_,
+                          outbound_queue_footprint_, inbound_queue_footprint_};
+    event (*endpoint_pair_, values, 4, ZMQ_EVENT_PIPES_STATS);
     delete endpoint_pair_;
 }
 
@@ -1639,7 +1835,8 @@ void zmq::socket_base_t::process_pipe_stats_publish (
  * There are 2 pipes per connection, and the inbound one _must_ be queried from
  * the I/O thread. So ask the outbound pipe, in the application thread, to send
  * a message (pipe_peer_stats) to its peer. The message will carry the outbound
- * pipe stats and endpoint, and the reference to the socket object.
+ * pipe stats (message count and memory footprint) and endpoint, and the
+ * reference to the socket object.
  * The inbound pipe on the I/O thread will then add its own stats and endpoint,
  * and write back a message to the socket object (pipe_stats_publish) which
  * will raise an event with the data.
@@ -1735,6 +1932,30 @@ int zmq::socket_base_t::xrecv (msg_t *)
     return -1;
 }
 
+int zmq::socket_base_t::xsend_batch (msg_t *msgs_, size_t count_)
+{
+    size_t sent = 0;
+    int rc = 0;
+    for (; sent != count_; ++sent) {
+        rc = xsend (&msgs_[sent]);
+        if (rc != 0)
+            break;
+    }
+    return sent > 0 ? static_cast<int> (sent) : rc;
+}
+
+int zmq::socket_base_t::xrecv_batch (msg_t *msgs_, size_t count_)
+{
+    size_t received = 0;
+    int rc = 0;
+    for (; received != count_; ++received) {
+        rc = xrecv (&msgs_[received]);
+        if (rc != 0)
+            break;
+    }
+    return received > 0 ? static_cast<int> (received) : rc;
+}
+
 void zmq::socket_base_t::xread_activated (pipe_t *)
 {
     zmq_assert (false);
@@ -1749,6 +1970,10 @@ void zmq::socket_base_t::xhiccuped (pipe_t *)
     zmq_assert (false);
 }
 
+void zmq::socket_base_t::xdrain ()
+{
+}
+
 void zmq::socket_base_t::in_event ()
 {
     //  This function is invoked only once the socket is running in the context
@@ -2200,15 +2425,13 @@ int zmq::routing_socket_base_t::xsetsockopt (
 
 void zmq::routing_socket_base_t::xwrite_activated (pipe_t *pipe_)
 {
-    const out_pipes_t::iterator end = _out_pipes.end ();
-    out_pipes_t::iterator it;
-    for (it = _out_pipes.begin (); it != end; ++it)
-        if (it->second.pipe == pipe_)
-            break;
-
-    zmq_assert (it != end);
-    zmq_assert (!it->second.active);
-    it->second.active = true;
+    const blob_t &routing_id = pipe_->get_routing_id ();
+    out_pipe_t *const out_pipe =
+      _out_pipes.find (routing_id.data (), routing_id.size ());
+    zmq_assert (out_pipe);
+    zmq_assert (out_pipe->pipe == pipe_);
+    zmq_assert (!out_pipe->active);
+    out_pipe->active = true;
 }
 
 std::string zmq::routing_socket_base_t::extract_connect_routing_id ()
@@ -2228,47 +2451,53 @@ void zmq::routing_socket_base_t::add_out_pipe (blob_t routing_id_,
 {
     //  Add the record into output pipes lookup table
     const out_pipe_t outpipe = {pipe_, true};
-    const bool ok =
-      _out_pipes.ZMQ_MAP_INSERT_OR_EMPLACE (ZMQ_MOVE (routing_id_), outpipe)
-        .second;
+    const bool ok = _out_pipes.insert (ZMQ_MOVE (routing_id_), outpipe);
     zmq_assert (ok);
 }
 
 bool zmq::routing_socket_base_t::has_out_pipe (const blob_t &routing_id_) const
 {
-    return 0 != _out_pipes.count (routing_id_);
+    return lookup_out_pipe (routing_id_) != NULL;
 }
 
 zmq::routing_socket_base_t::out_pipe_t *
 zmq::routing_socket_base_t::lookup_out_pipe (const blob_t &routing_id_)
 {
-    // TODO we could probably avoid constructor a temporary blob_t to call this function
-    out_pipes_t::iterator it = _out_pipes.find (routing_id_);
-    return it == _out_pipes.end () ? NULL : &it->second;
+    return _out_pipes.find (routing_id_.data (), routing_id_.size ());
 }
 
 const zmq::routing_socket_base_t::out_pipe_t *
 zmq::routing_socket_base_t::lookup_out_pipe (const blob_t &routing_id_) const
 {
-    // TODO we could probably avoid constructor a temporary blob_t to call this function
-    const out_pipes_t::const_iterator it = _out_pipes.find (routing_id_);
-    return it == _out_pipes.end () ? NULL : &it->second;
+    return _out_pipes.find (routing_id_.data (), routing_id_.size ());
+}
+
+zmq::routing_socket_base_t::out_pipe_t *
+zmq::routing_socket_base_t::lookup_out_pipe (const void *routing_id_,
+                                             size_t size_)
+{
+    return _out_pipes.find (routing_id_, size_);
+}
+
+const zmq::routing_socket_base_t::out_pipe_t *
+zmq::routing_socket_base_t::lookup_out_pipe (const void *routing_id_,
+                                             size_t size_) const
+{
+    return _out_pipes.find (routing_id_, size_);
 }
 
 void zmq::routing_socket_base_t::erase_out_pipe (const pipe_t *pipe_)
 {
-    const size_t erased = _out_pipes.erase (pipe_->get_routing_id ());
+    const blob_t &routing_id = pipe_->get_routing_id ();
+    const bool erased =
+      _out_pipes.erase (routing_id.data (), routing_id.size ());
     zmq_assert (erased);
 }
 
 zmq::routing_socket_base_t::out_pipe_t
 zmq::routing_socket_base_t::try_erase_out_pipe (const blob_t &routing_id_)
 {
-    const out_pipes_t::iterator it = _out_pipes.find (routing_id_);
     out_pipe_t res = {NULL, false};
-    if (it != _out_pipes.end ()) {
-        res = it->second;
-        _out_pipes.erase (it);
-    }
+    _out_pipes.erase (routing_id_.data (), routing_id_.size (), &res);
     return res;
 }
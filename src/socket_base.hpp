@@ -10,6 +10,7 @@
 #include "own.hpp"
 #include "array.hpp"
 #include "blob.hpp"
+#include "blob_map.hpp"
 #include "stdint.hpp"
 #include "poller.hpp"
 #include "i_poll_events.hpp"
@@ -61,6 +62,8 @@ class socket_base_t : public own_t,
     int term_endpoint (const char *endpoint_uri_);
     int send (zmq::msg_t *msg_, int flags_);
     int recv (zmq::msg_t *msg_, int flags_);
+    int send_batch (zmq::msg_t *msgs_, size_t count_, int flags_);
+    int recv_batch (zmq::msg_t *msgs_, size_t count_, int flags_);
     void add_signaler (signaler_t *s_);
     void remove_signaler (signaler_t *s_);
     int close ();
@@ -175,12 +178,24 @@ class socket_base_t : public own_t,
     virtual bool xhas_in ();
     virtual int xrecv (zmq::msg_t *msg_);
 
+    //  Batched variants of xsend and xrecv. They return the number of
+    //  messages processed, or -1 if none could be. The default
+    //  implementation simply loops over xsend/xrecv; socket types that
+    //  can fill or drain their pipes more cheaply override them.
+    virtual int xsend_batch (zmq::msg_t *msgs_, size_t count_);
+    virtual int xrecv_batch (zmq::msg_t *msgs_, size_t count_);
+
     //  i_pipe_events will be forwarded to these functions.
     virtual void xread_activated (pipe_t *pipe_);
     virtual void xwrite_activated (pipe_t *pipe_);
     virtual void xhiccuped (pipe_t *pipe_);
     virtual void xpipe_terminated (pipe_t *pipe_) = 0;
 
+    //  Called before the socket acts on its pipes outside of the x- methods,
+    //  e.g. to process commands. Socket types handing messages to other
+    //  threads wait for them to be done with the pipes.
+    virtual void xdrain ();
+
     //  the default implementation assumes that joub and leave are not supported.
     virtual int xjoin (const char *group_);
     virtual int xleave (const char *group_);
@@ -277,6 +292,8 @@ class socket_base_t : public own_t,
     void
     process_pipe_stats_publish (uint64_t outbound_queue_count_,
                                 uint64_t inbound_queue_count_,
+                                uint64_t outbound_queue_footprint_,
+                                uint64_t inbound_queue_footprint_,
                                 endpoint_uri_pair_t *endpoint_pair_) ZMQ_FINAL;
     void process_term (int linger_) ZMQ_FINAL;
     void process_term_endpoint (std::string *endpoint_) ZMQ_FINAL;
@@ -360,23 +377,31 @@ class routing_socket_base_t : public socket_base_t
     bool has_out_pipe (const blob_t &routing_id_) const;
     out_pipe_t *lookup_out_pipe (const blob_t &routing_id_);
     const out_pipe_t *lookup_out_pipe (const blob_t &routing_id_) const;
+    //  Variants looking the routing id up in place, e.g. in a message.
+    out_pipe_t *lookup_out_pipe (const void *routing_id_, size_t size_);
+    const out_pipe_t *lookup_out_pipe (const void *routing_id_,
+                                       size_t size_) const;
     void erase_out_pipe (const pipe_t *pipe_);
     out_pipe_t try_erase_out_pipe (const blob_t &routing_id_);
     template <typename Func> bool any_of_out_pipes (Func func_)
     {
-        bool res = false;
-        for (out_pipes_t::iterator it = _out_pipes.begin (),
-                                   end = _out_pipes.end ();
-             it != end && !res; ++it) {
-            res |= func_ (*it->second.pipe);
-        }
-
-        return res;
+        return _out_pipes.any_of (out_pipe_predicate_t<Func> (func_));
     }
 
   private:
+    //  Adapts predicates on pipes to the out_pipe_t values of _out_pipes.
+    template <typename Func> struct out_pipe_predicate_t
+    {
+        explicit out_pipe_predicate_t (Func func_) : func (func_) {}
+        bool operator() (const out_pipe_t &out_pipe_)
+        {
+            return func (*out_pipe_.pipe);
+        }
+        Func func;
+    };
+
     //  Outbound pipes indexed by the peer IDs.
-    typedef std::map<blob_t, out_pipe_t> out_pipes_t;
+    typedef blob_map_t<out_pipe_t> out_pipes_t;
     out_pipes_t _out_pipes;
 
     // Next assigned name on a zmq_connect() call used by ROUTER and STREAM socket types
@@ -71,9 +71,8 @@ int zmq::stream_t::xsend (msg_t *msg_)
             //  Find the pipe associated with the routing id stored in the prefix.
             //  If there's no such pipe return an error
 
-            out_pipe_t *out_pipe = lookup_out_pipe (
-              blob_t (static_cast<unsigned char *> (msg_->datap ()),
-                      msg_->sizep (), reference_tag_t ()));
+            out_pipe_t *out_pipe =
+              lookup_out_pipe (msg_->datap (), msg_->sizep ());
 
             if (out_pipe) {
                 _current_out = out_pipe->pipe;
@@ -10,12 +10,14 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <new>
 #include <sstream>
 
 #include "stream_engine_base.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
+#include "ctx.hpp"
 #include "v1_encoder.hpp"
 #include "v1_decoder.hpp"
 #include "v2_encoder.hpp"
@@ -32,6 +34,7 @@
 #include "curve_server.hpp"
 #endif
 #include "raw_decoder.hpp"
+#include "decoder_allocators.hpp"
 #include "raw_encoder.hpp"
 #include "config.hpp"
 #include "err.hpp"
@@ -108,7 +111,20 @@ zmq::stream_engine_base_t::stream_engine_base_t (
     _session (NULL),
     _socket (NULL),
     _has_handshake_stage (has_handshake_stage_),
-    _out_batch_size (0)
+    _out_batch_size (0),
+    _io_thread (NULL),
+    _crypto (NULL),
+    _input_paused (false),
+    _opened_stalled (false)
+#if !defined ZMQ_HAVE_WINDOWS
+    ,
+    _gather (false),
+    _out_iov_pos (0)
+#endif
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    ,
+    _zero_copy_threshold (0)
+#endif
 {
     const int rc = _tx_msg.init ();
     errno_assert (rc == 0);
@@ -121,6 +137,21 @@ zmq::stream_engine_base_t::~stream_engine_base_t ()
 {
     zmq_assert (!_plugged);
 
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Closing the socket doesn't stop the kernel from transmitting the
+    //  data still queued, which may be the content of messages sent
+    //  zero-copy. The socket is closed once the kernel is done with them,
+    //  without holding up the I/O thread meanwhile.
+    if (!_zero_copy_sends.empty () && _s != retired_fd) {
+        _zero_copy_sends.reap (_s);
+        if (!_zero_copy_sends.empty ()) {
+            zmq_assert (_io_thread);
+            zero_copy_linger_t::start (_io_thread, _s, _zero_copy_sends);
+            _s = retired_fd;
+        }
+    }
+#endif
+
     if (_s != retired_fd) {
 #ifdef ZMQ_HAVE_WINDOWS
         const int rc = closesocket (_s);
@@ -138,6 +169,10 @@ zmq::stream_engine_base_t::~stream_engine_base_t ()
         _s = retired_fd;
     }
 
+#if !defined ZMQ_HAVE_WINDOWS
+    release_gathered ();
+#endif
+
     const int rc = _tx_msg.close ();
     errno_assert (rc == 0);
 
@@ -162,6 +197,25 @@ void zmq::stream_engine_base_t::plug (io_thread_t *io_thread_,
 
     _out_batch_size = _options.out_batch_size;
 
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Zero-copy sends are only possible on TCP sockets.
+    if (_options.zero_copy_send_threshold > 0 && raw_socket_write ()
+        && tune_tcp_zero_copy (_s) == 0)
+        _zero_copy_threshold =
+          static_cast<size_t> (_options.zero_copy_send_threshold);
+#endif
+
+#if !defined ZMQ_HAVE_WINDOWS
+    //  Large bodies are not copied by zero-copy sends either, and those
+    //  need the output to be a single chunk of a message.
+    _gather = raw_socket_write ();
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    _gather = _gather && !_zero_copy_threshold;
+#endif
+    if (_gather)
+        _out_gather_buf.resize (_out_batch_size);
+#endif
+
     //  Connect to session object.
     zmq_assert (!_session);
     zmq_assert (session_);
@@ -169,6 +223,7 @@ void zmq::stream_engine_base_t::plug (io_thread_t *io_thread_,
     _socket = _session->get_socket ();
 
     //  Connect to I/O threads poller object.
+    _io_thread = io_thread_;
     io_object_t::plug (io_thread_);
     _handle = add_fd (_s);
     _io_error = false;
@@ -201,6 +256,11 @@ void zmq::stream_engine_base_t::unplug ()
         cancel_timer (heartbeat_ivl_timer_id);
         _has_heartbeat_timer = false;
     }
+
+    //  The crypto threads may still be working on messages of the engine,
+    //  this waits for them.
+    LIBZMQ_DELETE (_crypto);
+
     //  Cancel all fd subscriptions.
     if (!_io_error)
         rm_fd (_handle);
@@ -219,6 +279,15 @@ void zmq::stream_engine_base_t::terminate ()
 
 void zmq::stream_engine_base_t::in_event ()
 {
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Zero-copy notifications raise POLLERR, which the pollers report as
+    //  an input event. While input is stopped, that must not be mistaken
+    //  for an I/O error; actual errors are reported again by the poller.
+    if (!_zero_copy_sends.empty () && _zero_copy_sends.reap (_s)
+        && _input_stopped)
+        return;
+#endif
+
     // ignore errors
     const bool res = in_event_internal ();
     LIBZMQ_UNUSED (res);
@@ -259,6 +328,13 @@ bool zmq::stream_engine_base_t::in_event_internal ()
 
     //  If there's no data to process in the buffer...
     if (!_insize) {
+        //  Don't read more while the crypto threads are behind.
+        if (unlikely (_crypto != NULL) && !_crypto->can_open ()) {
+            _input_paused = true;
+            reset_pollin (_handle);
+            return true;
+        }
+
         //  Retrieve the buffer and read as much data as possible.
         //  Note that buffer can be arbitrarily large. However, we assume
         //  the underlying TCP layer has fixed buffer size and thus the
@@ -336,26 +412,34 @@ void zmq::stream_engine_base_t::out_event ()
     check_for_more:
 #endif
 
-        _outpos = NULL;
-        _outsize = _encoder->encode (&_outpos, 0);
-
-        while (_outsize < static_cast<size_t> (_out_batch_size)) {
-            if ((this->*_next_msg) (&_tx_msg) == -1) {
-                //  ws_engine can cause an engine error and delete it, so
-                //  bail out immediately to avoid use-after-free
-                if (errno == ECONNRESET)
-                    return;
-                else
-                    break;
+#if !defined ZMQ_HAVE_WINDOWS
+        if (_gather) {
+            if (!gather_output ())
+                return;
+        } else
+#endif
+        {
+            _outpos = NULL;
+            _outsize = _encoder->encode (&_outpos, 0);
+
+            while (_outsize < static_cast<size_t> (_out_batch_size)) {
+                if (next_output_msg (&_tx_msg) == -1) {
+                    //  ws_engine can cause an engine error and delete it, so
+                    //  bail out immediately to avoid use-after-free
+                    if (errno == ECONNRESET)
+                        return;
+                    else
+                        break;
+                }
+                _encoder->load_msg (&_tx_msg);
+                unsigned char *bufptr = _outpos + _outsize;
+                const size_t n =
+                  _encoder->encode (&bufptr, _out_batch_size - _outsize);
+                zmq_assert (n > 0);
+                if (_outpos == NULL)
+                    _outpos = bufptr;
+                _outsize += n;
             }
-            _encoder->load_msg (&_tx_msg);
-            unsigned char *bufptr = _outpos + _outsize;
-            const size_t n =
-              _encoder->encode (&bufptr, _out_batch_size - _outsize);
-            zmq_assert (n > 0);
-            if (_outpos == NULL)
-                _outpos = bufptr;
-            _outsize += n;
         }
 
         //  If there is no data to send, stop polling for output.
@@ -371,7 +455,21 @@ void zmq::stream_engine_base_t::out_event ()
     //  arbitrarily large. However, we assume that underlying TCP layer has
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
-    const int nbytes = write (_outpos, _outsize);
+    int nbytes;
+#if !defined ZMQ_HAVE_WINDOWS
+    if (_out_iov_pos < _out_iov.size ())
+        nbytes = write_gathered ();
+    else
+#endif
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Large chunks pointing straight into the content of the message being
+    //  sent (see encoder_base_t::encode) can be sent without any copy.
+    if (_zero_copy_threshold && _outsize >= _zero_copy_threshold
+        && _tx_msg.spans (_outpos, _outsize))
+        nbytes = write_zero_copy ();
+    else
+#endif
+        nbytes = write (_outpos, _outsize);
 
     //  IO error has occurred. We stop waiting for output events.
     //  The engine is not terminated until we detect input error;
@@ -381,7 +479,9 @@ void zmq::stream_engine_base_t::out_event ()
         return;
     }
 
-    _outpos += nbytes;
+    //  Gathered output has no single position; write_gathered tracks it.
+    if (_outpos)
+        _outpos += nbytes;
     _outsize -= nbytes;
 
     //  If we are still handshaking and there are no data
@@ -422,7 +522,13 @@ bool zmq::stream_engine_base_t::restart_input ()
     zmq_assert (_session != NULL);
     zmq_assert (_decoder != NULL);
 
-    int rc = (this->*_process_msg) (_decoder->msg ());
+    //  If the oldest opened message is what stopped the input, the decoder
+    //  has no message pending.
+    int rc;
+    if (_opened_stalled)
+        rc = push_opened ();
+    else
+        rc = (this->*_process_msg) (_decoder->msg ());
     if (rc == -1) {
         if (errno == EAGAIN)
             _session->flush ();
@@ -458,6 +564,7 @@ bool zmq::stream_engine_base_t::restart_input ()
 
     else {
         _input_stopped = false;
+        _input_paused = false;
         set_pollin ();
         _session->flush ();
 
@@ -475,7 +582,7 @@ int zmq::stream_engine_base_t::next_handshake_command (msg_t *msg_)
 
     if (_mechanism->status () == mechanism_t::ready) {
         mechanism_ready ();
-        return pull_and_encode (msg_);
+        return next_output_msg (msg_);
     }
     if (_mechanism->status () == mechanism_t::error) {
         errno = EPROTO;
@@ -574,6 +681,20 @@ void zmq::stream_engine_base_t::mechanism_ready ()
     _next_msg = &stream_engine_base_t::pull_and_encode;
     _process_msg = &stream_engine_base_t::write_credential;
 
+    //  Hand the cryptography of the messages over to the crypto threads,
+    //  if the context has any.
+    crypto_pool_t *crypto_pool = _socket->get_ctx ()->get_crypto_pool ();
+    if (crypto_pool && can_offload_crypto () && _mechanism->can_offload ()
+        && !_crypto) {
+        _crypto = new (std::nothrow)
+          crypto_channel_t (_io_thread, crypto_pool, _mechanism, this);
+        alloc_assert (_crypto);
+        if (_crypto->valid ())
+            _mechanism->enable_offload ();
+        else
+            LIBZMQ_DELETE (_crypto);
+    }
+
     //  Compile metadata.
     properties_t properties;
     init_properties (properties);
@@ -641,6 +762,24 @@ int zmq::stream_engine_base_t::decode_and_push (msg_t *msg_)
     if (_mechanism->decode (msg_) == -1)
         return -1;
 
+    //  The crypto threads open the message, push_opened takes it from
+    //  there.
+    if (_crypto) {
+        _crypto->open (msg_);
+        return 0;
+    }
+
+    process_decoded (msg_);
+    if (_session->push_msg (msg_) == -1) {
+        if (errno == EAGAIN)
+            _process_msg = &stream_engine_base_t::push_one_then_decode_and_push;
+        return -1;
+    }
+    return 0;
+}
+
+void zmq::stream_engine_base_t::process_decoded (msg_t *msg_)
+{
     if (_has_timeout_timer) {
         _has_timeout_timer = false;
         cancel_timer (heartbeat_timeout_timer_id);
@@ -657,14 +796,91 @@ int zmq::stream_engine_base_t::decode_and_push (msg_t *msg_)
 
     if (_metadata)
         msg_->set_metadata (_metadata);
-    if (_session->push_msg (msg_) == -1) {
-        if (errno == EAGAIN)
-            _process_msg = &stream_engine_base_t::push_one_then_decode_and_push;
+}
+
+int zmq::stream_engine_base_t::next_output_msg (msg_t *msg_)
+{
+    if (likely (_crypto == NULL))
+        return (this->*_next_msg) (msg_);
+    return pull_sealed (msg_);
+}
+
+int zmq::stream_engine_base_t::pull_sealed (msg_t *msg_)
+{
+    //  Keep the crypto threads busy with the messages to come.
+    while (_crypto->can_seal ()) {
+        msg_t msg;
+        int rc = msg.init ();
+        errno_assert (rc == 0);
+        if ((this->*_next_msg) (&msg) == -1) {
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            break;
+        }
+        _crypto->seal (&msg);
+    }
+
+    if (!_crypto->pop_sealed (msg_)) {
+        errno = EAGAIN;
         return -1;
     }
     return 0;
 }
 
+int zmq::stream_engine_base_t::push_opened ()
+{
+    while (true) {
+        int error_event_code;
+        msg_t *msg = _crypto->front_opened (&error_event_code);
+        if (!msg)
+            return 0;
+
+        //  A message stalled on the session went through this already.
+        if (!_opened_stalled) {
+            if (error_event_code) {
+                _mechanism->open_failed (error_event_code);
+                errno = EPROTO;
+                return -1;
+            }
+            process_decoded (msg);
+        }
+
+        if (_session->push_msg (msg) == -1) {
+            _opened_stalled = errno == EAGAIN;
+            return -1;
+        }
+        _opened_stalled = false;
+        _crypto->pop_opened ();
+    }
+}
+
+void zmq::stream_engine_base_t::crypto_done ()
+{
+    //  While stalled, the opened messages wait for restart_input.
+    if (!_opened_stalled) {
+        if (push_opened () == -1) {
+            if (errno != EAGAIN) {
+                error (protocol_error);
+                return;
+            }
+            //  Stop reading until the session makes room again.
+            if (!_input_stopped) {
+                _input_stopped = true;
+                reset_pollin (_handle);
+            }
+        }
+        _session->flush ();
+    }
+
+    if (_input_paused && !_input_stopped && _crypto->can_open ()) {
+        _input_paused = false;
+        set_pollin ();
+    }
+
+    if (_output_stopped && _crypto->has_sealed ())
+        restart_output ();
+}
+
 int zmq::stream_engine_base_t::push_one_then_decode_and_push (msg_t *msg_)
 {
     const int rc = _session->push_msg (msg_);
@@ -789,3 +1005,130 @@ int zmq::stream_engine_base_t::write (const void *data_, size_t size_)
 {
     return zmq::tcp_write (_s, data_, size_);
 }
+
+#if !defined ZMQ_HAVE_WINDOWS
+bool zmq::stream_engine_base_t::gather_output ()
+{
+    release_gathered ();
+
+    _outpos = NULL;
+    _outsize = 0;
+    size_t copied = 0;
+    while (_outsize < _out_batch_size) {
+        unsigned char *data;
+        const size_t n = _encoder->pending (&data);
+        if (n == 0) {
+            if (next_output_msg (&_tx_msg) == -1) {
+                //  ws_engine can cause an engine error and delete it, so
+                //  bail out immediately to avoid use-after-free
+                if (errno == ECONNRESET)
+                    return false;
+                break;
+            }
+            _encoder->load_msg (&_tx_msg);
+            continue;
+        }
+
+        //  Large bodies, along with the header when the frame was encoded
+        //  once for all peers, are written straight from the message, which
+        //  is referenced until then. Anything else (protocol headers, small
+        //  or masked bodies) is copied.
+        if (n >= out_gather_threshold && _tx_msg.spans (data, n)) {
+            if (_out_iov.size () == out_gather_max_chunks)
+                break;
+            _out_iov_msgs.push_back (msg_t ());
+            int rc = _out_iov_msgs.back ().init ();
+            errno_assert (rc == 0);
+            rc = _out_iov_msgs.back ().copy (_tx_msg);
+            errno_assert (rc == 0);
+            const iovec iov = {data, n};
+            _out_iov.push_back (iov);
+            _encoder->advance (n);
+            _outsize += n;
+            continue;
+        }
+
+        //  Copy into the batch buffer, appending to its last chunk if it
+        //  was the last one gathered. The buffer cannot overflow as the
+        //  copied data are part of the batch.
+        const size_t to_copy = std::min (n, _out_batch_size - _outsize);
+        unsigned char *dest = &_out_gather_buf[copied];
+        if (!_out_iov.empty ()
+            && static_cast<unsigned char *> (_out_iov.back ().iov_base)
+                   + _out_iov.back ().iov_len
+                 == dest)
+            _out_iov.back ().iov_len += to_copy;
+        else {
+            if (_out_iov.size () == out_gather_max_chunks)
+                break;
+            const iovec iov = {dest, to_copy};
+            _out_iov.push_back (iov);
+        }
+        memcpy (dest, data, to_copy);
+        _encoder->advance (to_copy);
+        copied += to_copy;
+        _outsize += to_copy;
+    }
+    return true;
+}
+
+int zmq::stream_engine_base_t::write_gathered ()
+{
+    const int nbytes =
+      tcp_writev (_s, &_out_iov[_out_iov_pos],
+                  static_cast<int> (_out_iov.size () - _out_iov_pos));
+    if (nbytes == -1)
+        return -1;
+
+    //  Skip the buffers written entirely and trim the one written partially.
+    size_t written = static_cast<size_t> (nbytes);
+    while (written > 0) {
+        iovec &iov = _out_iov[_out_iov_pos];
+        if (written < iov.iov_len) {
+            iov.iov_base =
+              static_cast<unsigned char *> (iov.iov_base) + written;
+            iov.iov_len -= written;
+            break;
+        }
+        written -= iov.iov_len;
+        _out_iov_pos++;
+    }
+
+    //  Release the messages as soon as their bodies are sent.
+    if (_out_iov_pos == _out_iov.size ())
+        release_gathered ();
+    return nbytes;
+}
+
+void zmq::stream_engine_base_t::release_gathered ()
+{
+    for (std::vector<msg_t>::iterator it = _out_iov_msgs.begin (),
+                                      end = _out_iov_msgs.end ();
+         it != end; ++it) {
+        const int rc = it->close ();
+        errno_assert (rc == 0);
+    }
+    _out_iov_msgs.clear ();
+    _out_iov.clear ();
+    _out_iov_pos = 0;
+}
+#endif
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+int zmq::stream_engine_base_t::write_zero_copy ()
+{
+    bool zero_copy;
+    const int nbytes = tcp_write_zero_copy (_s, _outpos, _outsize, &zero_copy);
+    if (!zero_copy)
+        return nbytes;
+
+    _zero_copy_sends.add (_tx_msg);
+    return nbytes;
+}
+#endif
+
+zmq::decoder_buffer_pool_t *
+zmq::stream_engine_base_t::decoder_buffer_pool () const
+{
+    return _io_thread ? _io_thread->get_decoder_buffer_pool () : NULL;
+}
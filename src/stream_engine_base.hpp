@@ -4,8 +4,14 @@
 #define __ZMQ_STREAM_ENGINE_BASE_HPP_INCLUDED__
 
 #include <stddef.h>
+#include <deque>
+#include <vector>
+#if !defined ZMQ_HAVE_WINDOWS
+#include <sys/uio.h>
+#endif
 
 #include "fd.hpp"
+#include "crypto_pool.hpp"
 #include "i_engine.hpp"
 #include "io_object.hpp"
 #include "i_encoder.hpp"
@@ -15,17 +21,21 @@
 #include "metadata.hpp"
 #include "msg.hpp"
 #include "tcp.hpp"
+#include "zero_copy_sends.hpp"
 
 namespace zmq
 {
 class io_thread_t;
+class decoder_buffer_pool_t;
 class session_base_t;
 class mechanism_t;
 
 //  This engine handles any socket with SOCK_STREAM semantics,
 //  e.g. TCP socket or an UNIX domain socket.
 
-class stream_engine_base_t : public io_object_t, public i_engine
+class stream_engine_base_t : public io_object_t,
+                             public i_engine,
+                             public i_crypto_events
 {
   public:
     stream_engine_base_t (fd_t fd_,
@@ -49,6 +59,9 @@ class stream_engine_base_t : public io_object_t, public i_engine
     void out_event () ZMQ_OVERRIDE;
     void timer_event (int id_) ZMQ_FINAL;
 
+    //  i_crypto_events interface implementation.
+    void crypto_done () ZMQ_FINAL;
+
   protected:
     typedef metadata_t::dict_t properties_t;
     bool init_properties (properties_t &properties_);
@@ -64,6 +77,10 @@ class stream_engine_base_t : public io_object_t, public i_engine
 
     int pull_and_encode (msg_t *msg_);
     virtual int decode_and_push (msg_t *msg_);
+
+    //  Handles the engine's side of a decoded message before it is pushed
+    //  to the session.
+    void process_decoded (msg_t *msg_);
     int push_one_then_decode_and_push (msg_t *msg_);
 
     void set_handshake_timer ();
@@ -71,6 +88,11 @@ class stream_engine_base_t : public io_object_t, public i_engine
     virtual bool handshake () { return true; };
     virtual void plug_internal (){};
 
+    //  Returns true if the messages go through the encode and decode
+    //  methods of the mechanism only, so that their cryptography can run
+    //  on the crypto threads.
+    virtual bool can_offload_crypto () const { return true; }
+
     virtual int process_command_message (msg_t *msg_)
     {
         LIBZMQ_UNUSED (msg_);
@@ -95,12 +117,20 @@ class stream_engine_base_t : public io_object_t, public i_engine
     virtual int read (void *data, size_t size_);
     virtual int write (const void *data_, size_t size_);
 
+    //  Returns true if write () passes the data to the socket unchanged,
+    //  which is required to send them with MSG_ZEROCOPY or gathered from
+    //  several buffers.
+    virtual bool raw_socket_write () const { return true; }
+
     void reset_pollout () { io_object_t::reset_pollout (_handle); }
     void set_pollout () { io_object_t::set_pollout (_handle); }
     void set_pollin () { io_object_t::set_pollin (_handle); }
     session_base_t *session () { return _session; }
     socket_base_t *socket () { return _socket; }
 
+    //  Pool recycling the decoder buffers of the I/O thread.
+    decoder_buffer_pool_t *decoder_buffer_pool () const;
+
     const options_t _options;
 
     unsigned char *_inpos;
@@ -161,6 +191,18 @@ class stream_engine_base_t : public io_object_t, public i_engine
 
     void mechanism_ready ();
 
+    //  Gets the next message to send, from the crypto threads if they seal
+    //  the messages.
+    int next_output_msg (msg_t *msg_);
+
+    //  Hands the messages to send over to the crypto threads and gets back
+    //  the oldest one once sealed.
+    int pull_sealed (msg_t *msg_);
+
+    //  Pushes the messages the crypto threads have opened to the session,
+    //  in order.
+    int push_opened ();
+
     //  Underlying socket.
     fd_t _s;
 
@@ -189,6 +231,63 @@ class stream_engine_base_t : public io_object_t, public i_engine
 
     size_t _out_batch_size;
 
+    //  I/O thread the engine runs in.
+    io_thread_t *_io_thread;
+
+    //  Messages on their way through the crypto threads, if any.
+    crypto_channel_t *_crypto;
+
+    //  True if reading is paused until the crypto threads open some of
+    //  the messages already read.
+    bool _input_paused;
+
+    //  True if input is stopped because the oldest opened message could
+    //  not be pushed to the session. The decoder has no message pending
+    //  then.
+    bool _opened_stalled;
+
+#if !defined ZMQ_HAVE_WINDOWS
+    //  Fills the output from the encoder like the regular path does, but
+    //  message bodies of at least out_gather_threshold bytes are referenced
+    //  rather than copied to the batch buffer. Returns false if the engine
+    //  was destroyed meanwhile.
+    bool gather_output ();
+
+    //  Writes the gathered output with a single vectored write.
+    int write_gathered ();
+
+    //  Drops the references to the messages of the gathered output.
+    void release_gathered ();
+
+    //  True if the output is gathered rather than copied.
+    bool _gather;
+
+    //  Buffers of the gathered output, of which the first _out_iov_pos
+    //  ones were written already.
+    std::vector<iovec> _out_iov;
+    size_t _out_iov_pos;
+
+    //  Messages whose bodies are referenced by _out_iov.
+    std::vector<msg_t> _out_iov_msgs;
+
+    //  Buffer the small pieces of the gathered output are copied to.
+    std::vector<unsigned char> _out_gather_buf;
+#endif
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Sends the pending output, which points into the content of _tx_msg,
+    //  with MSG_ZEROCOPY. A reference to the message is kept until the
+    //  kernel notifies it does not use its content anymore.
+    int write_zero_copy ();
+
+    //  Messages the kernel may still read for the sends made so far.
+    zero_copy_sends_t _zero_copy_sends;
+
+    //  Output chunks of at least this size are sent with MSG_ZEROCOPY.
+    //  0 if zero-copy sends are disabled.
+    size_t _zero_copy_threshold;
+#endif
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (stream_engine_base_t)
 };
 }
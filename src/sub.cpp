@@ -24,6 +24,10 @@ int zmq::sub_t::xsetsockopt (int option_,
                              _When_ (optval_ == NULL, _In_range_ (0, 0))
                                const size_t optvallen_)
 {
+#ifdef ZMQ_BUILD_DRAFT_API
+    if (option_ == ZMQ_SUBSCRIBE_MANY || option_ == ZMQ_UNSUBSCRIBE_MANY)
+        return xsub_t::xsetsockopt (option_, optval_, optvallen_);
+#endif
     if (option_ != ZMQ_SUBSCRIBE && option_ != ZMQ_UNSUBSCRIBE) {
         errno = EINVAL;
         return -1;
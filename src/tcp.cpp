@@ -11,6 +11,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
@@ -19,6 +20,11 @@
 #endif
 #endif
 
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+#include <string.h>
+#include <linux/errqueue.h>
+#endif
+
 #if defined ZMQ_HAVE_OPENVMS
 #include <ioctl.h>
 #endif
@@ -242,6 +248,38 @@ int zmq::tcp_write (fd_t s_, const void *data_, size_t size_)
 #endif
 }
 
+#if !defined ZMQ_HAVE_WINDOWS
+int zmq::tcp_writev (fd_t s_, const iovec *iov_, int count_)
+{
+    const ssize_t nbytes = writev (s_, iov_, count_);
+
+    //  Same as tcp_write: these errors mean that nothing could be written.
+    if (nbytes == -1
+        && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+
+    //  Signalise peer failure.
+    if (nbytes == -1) {
+#if !defined(TARGET_OS_IPHONE) || !TARGET_OS_IPHONE
+        errno_assert (errno != EACCES && errno != EBADF && errno != EDESTADDRREQ
+                      && errno != EFAULT && errno != EINVAL
+                      && errno != EISCONN && errno != EMSGSIZE
+                      && errno != ENOMEM && errno != ENOTSOCK
+                      && errno != EOPNOTSUPP);
+#else
+        errno_assert (errno != EACCES && errno != EDESTADDRREQ
+                      && errno != EFAULT && errno != EINVAL
+                      && errno != EISCONN && errno != EMSGSIZE
+                      && errno != ENOMEM && errno != ENOTSOCK
+                      && errno != EOPNOTSUPP);
+#endif
+        return -1;
+    }
+
+    return static_cast<int> (nbytes);
+}
+#endif
+
 int zmq::tcp_read (fd_t s_, void *data_, size_t size_)
 {
 #ifdef ZMQ_HAVE_WINDOWS
@@ -329,6 +367,99 @@ void zmq::tune_tcp_busy_poll (fd_t socket_, int busy_poll_)
 #endif
 }
 
+int zmq::tune_tcp_zero_copy (fd_t s_)
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    int flag = 1;
+    return setsockopt (s_, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof (int));
+#else
+    LIBZMQ_UNUSED (s_);
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+int zmq::tcp_write_zero_copy (fd_t s_,
+                              const void *data_,
+                              size_t size_,
+                              bool *zero_copy_)
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    const ssize_t nbytes = send (s_, data_, size_, MSG_ZEROCOPY);
+
+    //  ENOBUFS means that the pages of the buffer cannot be pinned (e.g. the
+    //  socket exceeded its optmem limit); fall back to a regular send.
+    if (nbytes == -1 && errno == ENOBUFS) {
+        *zero_copy_ = false;
+        return tcp_write (s_, data_, size_);
+    }
+
+    if (nbytes == -1
+        && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        *zero_copy_ = false;
+        return 0;
+    }
+
+    //  Signalise peer failure.
+    if (nbytes == -1) {
+        errno_assert (errno != EACCES && errno != EBADF && errno != EDESTADDRREQ
+                      && errno != EFAULT && errno != EISCONN
+                      && errno != EMSGSIZE && errno != ENOMEM
+                      && errno != ENOTSOCK && errno != EOPNOTSUPP);
+        *zero_copy_ = false;
+        return -1;
+    }
+
+    *zero_copy_ = true;
+    return static_cast<int> (nbytes);
+#else
+    *zero_copy_ = false;
+    return tcp_write (s_, data_, size_);
+#endif
+}
+
+int zmq::tcp_read_zero_copy_completion (fd_t s_,
+                                        uint32_t *first_id_,
+                                        uint32_t *last_id_)
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    char control[CMSG_SPACE (sizeof (sock_extended_err))];
+    msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+
+    const ssize_t rc = recvmsg (s_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+    if (rc == -1) {
+        errno_assert (errno != EBADF && errno != EFAULT && errno != ENOTSOCK);
+        if (errno == EWOULDBLOCK || errno == EINTR)
+            errno = EAGAIN;
+        return -1;
+    }
+
+    for (cmsghdr *cm = CMSG_FIRSTHDR (&msg); cm; cm = CMSG_NXTHDR (&msg, cm)) {
+        if ((cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+            && (cm->cmsg_level != SOL_IPV6 || cm->cmsg_type != IPV6_RECVERR))
+            continue;
+        const sock_extended_err *serr =
+          reinterpret_cast<const sock_extended_err *> (CMSG_DATA (cm));
+        if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            continue;
+
+        *first_id_ = serr->ee_info;
+        *last_id_ = serr->ee_data;
+        return 1;
+    }
+    return 0;
+#else
+    LIBZMQ_UNUSED (s_);
+    LIBZMQ_UNUSED (first_id_);
+    LIBZMQ_UNUSED (last_id_);
+    errno = EAGAIN;
+    return -1;
+#endif
+}
+
 zmq::fd_t zmq::tcp_open_socket (const char *address_,
                                 const zmq::options_t &options_,
                                 bool local_,
@@ -4,6 +4,11 @@
 #define __ZMQ_TCP_HPP_INCLUDED__
 
 #include "fd.hpp"
+#include "stdint.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS
+struct iovec;
+#endif
 
 namespace zmq
 {
@@ -34,6 +39,11 @@ int tune_tcp_maxrt (fd_t sockfd_, int timeout_);
 //  of error or orderly shutdown by the other peer -1 is returned.
 int tcp_write (fd_t s_, const void *data_, size_t size_);
 
+#if !defined ZMQ_HAVE_WINDOWS
+//  Same as tcp_write, but gathers the data from count_ buffers.
+int tcp_writev (fd_t s_, const iovec *iov_, int count_);
+#endif
+
 //  Reads data from the socket (up to 'size' bytes).
 //  Returns the number of bytes actually read or -1 on error.
 //  Zero indicates the peer has closed the connection.
@@ -43,6 +53,27 @@ void tcp_tune_loopback_fast_path (fd_t socket_);
 
 void tune_tcp_busy_poll (fd_t socket_, int busy_poll_);
 
+//  Enables MSG_ZEROCOPY sends on the socket. Returns -1 if the platform or
+//  the socket does not support them.
+int tune_tcp_zero_copy (fd_t s_);
+
+//  Same as tcp_write, but the data are sent with MSG_ZEROCOPY, i.e. the
+//  kernel references the pages of the buffer until it notifies their release
+//  on the error queue. zero_copy_ is set to false if the data had to be
+//  copied instead, in which case no notification is queued for this call.
+int tcp_write_zero_copy (fd_t s_,
+                         const void *data_,
+                         size_t size_,
+                         bool *zero_copy_);
+
+//  Reads one notification from the error queue of the socket. Returns 1 and
+//  sets the range of ids of the zero-copy sends it releases, 0 if the
+//  notification was of another kind, or -1 with errno set to EAGAIN if the
+//  error queue is empty.
+int tcp_read_zero_copy_completion (fd_t s_,
+                                   uint32_t *first_id_,
+                                   uint32_t *last_id_);
+
 //  Resolves the given address_ string, opens a socket and sets socket options
 //  according to the passed options_. On success, returns the socket
 //  descriptor and assigns the resolved address to out_tcp_addr_. In case of
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include <string.h>
+
+#include <algorithm>
+
+#include "topic_batch.hpp"
+#include "err.hpp"
+#include "wire.hpp"
+
+bool zmq::parse_topic_batch (const unsigned char *batch_,
+                             size_t size_,
+                             std::vector<topic_t> &topics_)
+{
+    topics_.clear ();
+    size_t offset = 0;
+    while (offset < size_) {
+        if (size_ - offset < 4)
+            return false;
+        const size_t topic_size = get_uint32 (batch_ + offset);
+        if (size_ - offset - 4 < topic_size)
+            return false;
+        const topic_t topic = {batch_ + offset + 4, topic_size};
+        topics_.push_back (topic);
+        offset += 4 + topic_size;
+    }
+    return true;
+}
+
+zmq::topic_t zmq::read_topic (const unsigned char *batch_, size_t &offset_)
+{
+    const topic_t topic = {batch_ + offset_ + 4,
+                           get_uint32 (batch_ + offset_)};
+    offset_ += 4 + topic.size;
+    return topic;
+}
+
+static bool topic_less (const zmq::topic_t &lhs_, const zmq::topic_t &rhs_)
+{
+    const int rc =
+      memcmp (lhs_.data, rhs_.data, std::min (lhs_.size, rhs_.size));
+    return rc < 0 || (rc == 0 && lhs_.size < rhs_.size);
+}
+
+void zmq::sort_topics (std::vector<topic_t> &topics_)
+{
+    std::sort (topics_.begin (), topics_.end (), topic_less);
+}
+
+void zmq::append_topic (std::vector<unsigned char> &batch_,
+                        const unsigned char *data_,
+                        size_t size_)
+{
+    zmq_assert (size_ <= 0xffffffffU);
+    const size_t offset = batch_.size ();
+    batch_.resize (offset + 4 + size_);
+    put_uint32 (&batch_[offset], static_cast<uint32_t> (size_));
+    if (size_)
+        memcpy (&batch_[offset + 4], data_, size_);
+}
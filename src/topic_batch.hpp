@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_TOPIC_BATCH_HPP_INCLUDED__
+#define __ZMQ_TOPIC_BATCH_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <vector>
+
+namespace zmq
+{
+//  Batches of topics, as passed to ZMQ_SUBSCRIBE_MANY and
+//  ZMQ_UNSUBSCRIBE_MANY and written to the pipes as a single message,
+//  hold each topic preceded by its size as a 4-byte integer in network
+//  byte order.
+
+//  A topic pointing into a batch.
+struct topic_t
+{
+    const unsigned char *data;
+    size_t size;
+};
+
+//  Splits the batch into its topics. Returns false if the batch is
+//  malformed.
+bool parse_topic_batch (const unsigned char *batch_,
+                        size_t size_,
+                        std::vector<topic_t> &topics_);
+
+//  Reads the topic at offset_ of a well-formed batch and moves offset_
+//  past it.
+topic_t read_topic (const unsigned char *batch_, size_t &offset_);
+
+//  Sorts the topics in lexicographical order, bringing the topics that
+//  share a prefix next to each other.
+void sort_topics (std::vector<topic_t> &topics_);
+
+//  Appends a topic to the batch.
+void append_topic (std::vector<unsigned char> &batch_,
+                   const unsigned char *data_,
+                   size_t size_);
+}
+
+#endif
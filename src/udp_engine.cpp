@@ -35,6 +35,11 @@ zmq::udp_engine_t::udp_engine_t (const options_t &options_) :
     _handle (static_cast<handle_t> (NULL)),
     _address (NULL),
     _options (options_),
+    _batch_size (options_.udp_batch_size),
+    _out_count (0),
+    _out_next (0),
+    _in_count (0),
+    _in_next (0),
     _send_enabled (false),
     _recv_enabled (false)
 {
@@ -71,6 +76,41 @@ int zmq::udp_engine_t::init (address_t *address_, bool send_, bool recv_)
 
     unblock_socket (_fd);
 
+    if (send_) {
+        _out_buffers.resize (_batch_size * MAX_UDP_MSG);
+        _out_sizes.resize (_batch_size);
+        if (_options.raw_socket)
+            _out_raw_addresses.resize (_batch_size);
+#if defined ZMQ_HAVE_MMSG
+        _out_iov.resize (_batch_size);
+        _out_msgs.resize (_batch_size);
+        for (int i = 0; i < _batch_size; i++) {
+            _out_iov[i].iov_base = &_out_buffers[i * MAX_UDP_MSG];
+            memset (&_out_msgs[i], 0, sizeof (mmsghdr));
+            _out_msgs[i].msg_hdr.msg_iov = &_out_iov[i];
+            _out_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+
+    if (recv_) {
+        _in_buffers.resize (_batch_size * MAX_UDP_MSG);
+        _in_sizes.resize (_batch_size);
+        _in_addresses.resize (_batch_size);
+#if defined ZMQ_HAVE_MMSG
+        _in_iov.resize (_batch_size);
+        _in_msgs.resize (_batch_size);
+        for (int i = 0; i < _batch_size; i++) {
+            _in_iov[i].iov_base = &_in_buffers[i * MAX_UDP_MSG];
+            _in_iov[i].iov_len = MAX_UDP_MSG;
+            memset (&_in_msgs[i], 0, sizeof (mmsghdr));
+            _in_msgs[i].msg_hdr.msg_iov = &_in_iov[i];
+            _in_msgs[i].msg_hdr.msg_iovlen = 1;
+            _in_msgs[i].msg_hdr.msg_name = &_in_addresses[i];
+        }
+#endif
+    }
+
     return 0;
 }
 
@@ -128,8 +168,7 @@ void zmq::udp_engine_t::plug (io_thread_t *io_thread_, session_base_t *session_)
                 rc = rc | set_udp_multicast_iface (_fd, is_ipv6, udp_addr);
             }
         } else {
-            /// XXX fixme ?
-            _out_address = reinterpret_cast<sockaddr *> (&_raw_address);
+            //  The destination of each datagram is in _out_raw_addresses.
             _out_address_len =
               static_cast<zmq_socklen_t> (sizeof (sockaddr_in));
         }
@@ -382,9 +421,11 @@ void zmq::udp_engine_t::sockaddr_to_msg (zmq::msg_t *msg_,
     *address = 0;
 }
 
-int zmq::udp_engine_t::resolve_raw_address (const char *name_, size_t length_)
+int zmq::udp_engine_t::resolve_raw_address (sockaddr_in *raw_address_,
+                                            const char *name_,
+                                            size_t length_)
 {
-    memset (&_raw_address, 0, sizeof _raw_address);
+    memset (raw_address_, 0, sizeof *raw_address_);
 
     const char *delimiter = NULL;
 
@@ -415,11 +456,11 @@ int zmq::udp_engine_t::resolve_raw_address (const char *name_, size_t length_)
         return -1;
     }
 
-    _raw_address.sin_family = AF_INET;
-    _raw_address.sin_port = htons (port);
-    _raw_address.sin_addr.s_addr = inet_addr (addr_str.c_str ());
+    raw_address_->sin_family = AF_INET;
+    raw_address_->sin_port = htons (port);
+    raw_address_->sin_addr.s_addr = inet_addr (addr_str.c_str ());
 
-    if (_raw_address.sin_addr.s_addr == INADDR_NONE) {
+    if (raw_address_->sin_addr.s_addr == INADDR_NONE) {
         errno = EINVAL;
         return -1;
     }
@@ -428,78 +469,130 @@ int zmq::udp_engine_t::resolve_raw_address (const char *name_, size_t length_)
 }
 
 void zmq::udp_engine_t::out_event ()
+{
+    //  Datagrams the socket could not take last time are sent first.
+    if (_out_next == _out_count) {
+        _out_count = 0;
+        _out_next = 0;
+        int rc;
+        while (_out_count < _batch_size
+               && (rc = pull_datagram (_out_count)) != -1)
+            if (rc == 0)
+                _out_count++;
+
+        if (_out_count == 0) {
+            reset_pollout (_handle);
+            return;
+        }
+    }
+
+    send_datagrams ();
+}
+
+int zmq::udp_engine_t::pull_datagram (int slot_)
 {
     msg_t group_msg;
     int rc = _session->pull_msg (&group_msg);
     errno_assert (rc == 0 || (rc == -1 && errno == EAGAIN));
+    if (rc != 0)
+        return -1;
 
-    if (rc == 0) {
-        msg_t body_msg;
-        rc = _session->pull_msg (&body_msg);
-        //  If there's a group, there should also be a body
-        errno_assert (rc == 0);
-
-        const size_t group_size = group_msg.sizep ();
-        const size_t body_size = body_msg.sizep ();
-        size_t size;
-
-        if (_options.raw_socket) {
-            rc = resolve_raw_address (static_cast<char *> (group_msg.datap ()),
-                                      group_size);
-
-            //  We discard the message if address is not valid
-            if (rc != 0) {
-                rc = group_msg.close ();
-                errno_assert (rc == 0);
-
-                rc = body_msg.close ();
-                errno_assert (rc == 0);
+    msg_t body_msg;
+    rc = _session->pull_msg (&body_msg);
+    //  If there's a group, there should also be a body
+    errno_assert (rc == 0);
 
-                return;
-            }
+    const size_t group_size = group_msg.sizep ();
+    const size_t body_size = body_msg.sizep ();
+    char *const buffer = &_out_buffers[slot_ * MAX_UDP_MSG];
+    size_t size;
+    int result = 0;
 
-            size = body_size;
+    if (_options.raw_socket) {
+        rc = resolve_raw_address (&_out_raw_addresses[slot_],
+                                  static_cast<char *> (group_msg.datap ()),
+                                  group_size);
+
+        //  We discard the message if address is not valid
+        size = body_size;
+        if (rc != 0 || size > MAX_UDP_MSG)
+            result = 1;
+        else
+            memcpy (buffer, body_msg.datap (), body_size);
+    } else {
+        //  We discard the message if it does not fit in a datagram
+        size = group_size + body_size + 1;
+        if (size > MAX_UDP_MSG)
+            result = 1;
+        else {
+            buffer[0] = static_cast<unsigned char> (group_size);
+            memcpy (buffer + 1, group_msg.datap (), group_size);
+            memcpy (buffer + 1 + group_size, body_msg.datap (), body_size);
+        }
+    }
+    _out_sizes[slot_] = size;
 
-            memcpy (_out_buffer, body_msg.datap (), body_size);
-        } else {
-            size = group_size + body_size + 1;
+    rc = group_msg.close ();
+    errno_assert (rc == 0);
 
-            // TODO: check if larger than maximum size
-            _out_buffer[0] = static_cast<unsigned char> (group_size);
-            memcpy (_out_buffer + 1, group_msg.datap (), group_size);
-            memcpy (_out_buffer + 1 + group_size, body_msg.datap (), body_size);
-        }
+    rc = body_msg.close ();
+    errno_assert (rc == 0);
 
-        rc = group_msg.close ();
-        errno_assert (rc == 0);
+    return result;
+}
 
-        body_msg.close ();
-        errno_assert (rc == 0);
+const sockaddr *zmq::udp_engine_t::out_address (int slot_) const
+{
+    if (_options.raw_socket)
+        return reinterpret_cast<const sockaddr *> (&_out_raw_addresses[slot_]);
+    return _out_address;
+}
 
+void zmq::udp_engine_t::send_datagrams ()
+{
+#if defined ZMQ_HAVE_MMSG
+    for (int i = _out_next; i < _out_count; i++) {
+        _out_iov[i].iov_len = _out_sizes[i];
+        _out_msgs[i].msg_hdr.msg_name = const_cast<sockaddr *> (out_address (i));
+        _out_msgs[i].msg_hdr.msg_namelen = _out_address_len;
+    }
+    const int rc = sendmmsg (_fd, &_out_msgs[_out_next],
+                             static_cast<unsigned int> (_out_count - _out_next),
+                             0);
+    if (rc >= 0) {
+        _out_next += rc;
+        return;
+    }
+#else
+    int rc = 0;
+    for (; _out_next < _out_count; _out_next++) {
+        char *const buffer = &_out_buffers[_out_next * MAX_UDP_MSG];
+        const size_t size = _out_sizes[_out_next];
 #ifdef ZMQ_HAVE_WINDOWS
-        rc = sendto (_fd, _out_buffer, static_cast<int> (size), 0, _out_address,
-                     _out_address_len);
+        rc = sendto (_fd, buffer, static_cast<int> (size), 0,
+                     out_address (_out_next), _out_address_len);
 #elif defined ZMQ_HAVE_VXWORKS
-        rc = sendto (_fd, reinterpret_cast<caddr_t> (_out_buffer), size, 0,
-                     (sockaddr *) _out_address, _out_address_len);
+        rc = sendto (_fd, reinterpret_cast<caddr_t> (buffer), size, 0,
+                     (sockaddr *) out_address (_out_next), _out_address_len);
 #else
-        rc = sendto (_fd, _out_buffer, size, 0, _out_address, _out_address_len);
+        rc = sendto (_fd, buffer, size, 0, out_address (_out_next),
+                     _out_address_len);
 #endif
-        if (rc < 0) {
+        if (rc < 0)
+            break;
+    }
+    if (rc >= 0)
+        return;
+#endif
+
+    //  The datagrams not sent yet are kept until the socket is writable.
 #ifdef ZMQ_HAVE_WINDOWS
-            if (WSAGetLastError () != WSAEWOULDBLOCK) {
-                assert_success_or_recoverable (_fd, rc);
-                error (connection_error);
-            }
+    if (WSAGetLastError () != WSAEWOULDBLOCK) {
 #else
-            if (rc != EWOULDBLOCK) {
-                assert_success_or_recoverable (_fd, rc);
-                error (connection_error);
-            }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
 #endif
-        }
-    } else {
-        reset_pollout (_handle);
+        assert_success_or_recoverable (_fd, rc);
+        error (connection_error);
     }
 }
 
@@ -523,55 +616,100 @@ void zmq::udp_engine_t::restart_output ()
 
 void zmq::udp_engine_t::in_event ()
 {
-    sockaddr_storage in_address;
-    zmq_socklen_t in_addrlen =
-      static_cast<zmq_socklen_t> (sizeof (sockaddr_storage));
+    //  Datagrams that did not fit in the pipe last time are pushed first.
+    if (_in_next == _in_count) {
+        const int count = receive_datagrams ();
+        if (count <= 0)
+            return;
+        _in_count = count;
+        _in_next = 0;
+    }
+
+    for (; _in_next < _in_count; _in_next++)
+        if (push_datagram (_in_next) == -1) {
+            reset_pollin (_handle);
+            break;
+        }
 
-    const int nbytes =
-      recvfrom (_fd, _in_buffer, MAX_UDP_MSG, 0,
-                reinterpret_cast<sockaddr *> (&in_address), &in_addrlen);
+    _session->flush ();
+}
+
+int zmq::udp_engine_t::receive_datagrams ()
+{
+#if defined ZMQ_HAVE_MMSG
+    for (int i = 0; i < _batch_size; i++)
+        _in_msgs[i].msg_hdr.msg_namelen =
+          static_cast<zmq_socklen_t> (sizeof (sockaddr_storage));
+
+    const int rc = recvmmsg (_fd, &_in_msgs[0],
+                             static_cast<unsigned int> (_batch_size), 0, NULL);
+    if (rc >= 0) {
+        for (int i = 0; i < rc; i++)
+            _in_sizes[i] = _in_msgs[i].msg_len;
+        return rc;
+    }
+#else
+    int count = 0;
+    int rc = 0;
+    while (count < _batch_size) {
+        zmq_socklen_t in_addrlen =
+          static_cast<zmq_socklen_t> (sizeof (sockaddr_storage));
+        rc = recvfrom (_fd, &_in_buffers[count * MAX_UDP_MSG], MAX_UDP_MSG, 0,
+                       reinterpret_cast<sockaddr *> (&_in_addresses[count]),
+                       &in_addrlen);
+        if (rc < 0)
+            break;
+        _in_sizes[count++] = static_cast<size_t> (rc);
+    }
+    if (count > 0)
+        return count;
+#endif
 
-    if (nbytes < 0) {
 #ifdef ZMQ_HAVE_WINDOWS
-        if (WSAGetLastError () != WSAEWOULDBLOCK) {
-            assert_success_or_recoverable (_fd, nbytes);
-            error (connection_error);
-        }
+    if (WSAGetLastError () != WSAEWOULDBLOCK) {
 #else
-        if (nbytes != EWOULDBLOCK) {
-            assert_success_or_recoverable (_fd, nbytes);
-            error (connection_error);
-        }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
 #endif
-        return;
+        assert_success_or_recoverable (_fd, rc);
+        error (connection_error);
+        return -1;
     }
+    return 0;
+}
+
+int zmq::udp_engine_t::push_datagram (int slot_)
+{
+    const char *const buffer = &_in_buffers[slot_ * MAX_UDP_MSG];
+    const size_t nbytes = _in_sizes[slot_];
 
     int rc;
-    int body_size;
-    int body_offset;
+    size_t body_size;
+    size_t body_offset;
     msg_t msg;
 
     if (_options.raw_socket) {
-        zmq_assert (in_address.ss_family == AF_INET);
-        sockaddr_to_msg (&msg, reinterpret_cast<sockaddr_in *> (&in_address));
+        zmq_assert (_in_addresses[slot_].ss_family == AF_INET);
+        sockaddr_to_msg (
+          &msg, reinterpret_cast<const sockaddr_in *> (&_in_addresses[slot_]));
 
         body_size = nbytes;
         body_offset = 0;
     } else {
         // TODO in out_event, the group size is an *unsigned* char. what is
         // the maximum value?
-        const char *group_buffer = _in_buffer + 1;
-        const int group_size = _in_buffer[0];
+        const char *group_buffer = buffer + 1;
+        const size_t group_size =
+          nbytes ? static_cast<unsigned char> (buffer[0]) : 0;
+
+        //  This doesn't fit, just ignore
+        if (nbytes < 1 + group_size)
+            return 0;
 
         rc = msg.init_size (group_size);
         errno_assert (rc == 0);
         msg.set_flags (msg_t::more);
         memcpy (msg.datap (), group_buffer, group_size);
 
-        //  This doesn't fit, just ignore
-        if (nbytes - 1 < group_size)
-            return;
-
         body_size = nbytes - 1 - group_size;
         body_offset = 1 + group_size;
     }
@@ -579,36 +717,35 @@ void zmq::udp_engine_t::in_event ()
     rc = _session->push_msg (&msg);
     errno_assert (rc == 0 || (rc == -1 && errno == EAGAIN));
 
-    //  Group description message doesn't fit in the pipe, drop
+    //  Group description message doesn't fit in the pipe, retry later
     if (rc != 0) {
         rc = msg.close ();
         errno_assert (rc == 0);
-
-        reset_pollin (_handle);
-        return;
+        return -1;
     }
 
     rc = msg.close ();
     errno_assert (rc == 0);
     rc = msg.init_size (body_size);
     errno_assert (rc == 0);
-    memcpy (msg.datap (), _in_buffer + body_offset, body_size);
+    memcpy (msg.datap (), buffer + body_offset, body_size);
 
     // Push message body to session
     rc = _session->push_msg (&msg);
-    // Message body doesn't fit in the pipe, drop and reset session state
+    // Message body doesn't fit in the pipe, drop the group description and
+    // reset session state so that the whole datagram can be retried later
     if (rc != 0) {
         rc = msg.close ();
         errno_assert (rc == 0);
 
+        _session->rollback ();
         _session->reset ();
-        reset_pollin (_handle);
-        return;
+        return -1;
     }
 
     rc = msg.close ();
     errno_assert (rc == 0);
-    _session->flush ();
+    return 0;
 }
 
 bool zmq::udp_engine_t::restart_input ()
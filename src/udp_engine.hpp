@@ -7,6 +7,12 @@
 #include "address.hpp"
 #include "msg.hpp"
 
+#include <vector>
+#if defined ZMQ_HAVE_MMSG
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
 #define MAX_UDP_MSG 8192
 
 namespace zmq
@@ -48,7 +54,28 @@ class udp_engine_t ZMQ_FINAL : public io_object_t, public i_engine
     const endpoint_uri_pair_t &get_endpoint () const;
 
   private:
-    int resolve_raw_address (const char *name_, size_t length_);
+    //  Receives up to _batch_size datagrams into the input ring. Returns the
+    //  number of datagrams received, or -1 if the engine was terminated.
+    int receive_datagrams ();
+
+    //  Pushes the datagram in the given slot of the input ring to the
+    //  session. Returns -1 if it does not fit in the pipe.
+    int push_datagram (int slot_);
+
+    //  Pulls a message from the session and encodes it into the given slot
+    //  of the output ring. Returns 0 on success, 1 if the message was
+    //  discarded or -1 if there is no message to send.
+    int pull_datagram (int slot_);
+
+    //  Sends the datagrams of the output ring not sent yet.
+    void send_datagrams ();
+
+    //  Returns the destination of the datagram in the given slot.
+    const sockaddr *out_address (int slot_) const;
+
+    static int resolve_raw_address (sockaddr_in *raw_address_,
+                                    const char *name_,
+                                    size_t length_);
     static void sockaddr_to_msg (zmq::msg_t *msg_, const sockaddr_in *addr_);
 
     static int set_udp_reuse_address (fd_t s_, bool on_);
@@ -78,12 +105,35 @@ class udp_engine_t ZMQ_FINAL : public io_object_t, public i_engine
 
     options_t _options;
 
-    sockaddr_in _raw_address{};
     const struct sockaddr *_out_address{};
     zmq_socklen_t _out_address_len{};
 
-    char _out_buffer[MAX_UDP_MSG]{};
-    char _in_buffer[MAX_UDP_MSG]{};
+    //  Maximal number of datagrams received or sent per I/O event.
+    const int _batch_size;
+
+    //  Datagrams to send, MAX_UDP_MSG bytes apart, with the destination of
+    //  each for raw sockets. Those before _out_next were sent already.
+    std::vector<char> _out_buffers;
+    std::vector<size_t> _out_sizes;
+    std::vector<sockaddr_in> _out_raw_addresses;
+    int _out_count;
+    int _out_next;
+
+    //  Datagrams received, MAX_UDP_MSG bytes apart, with their source.
+    //  Those from _in_next on were not pushed to the session yet.
+    std::vector<char> _in_buffers;
+    std::vector<size_t> _in_sizes;
+    std::vector<sockaddr_storage> _in_addresses;
+    int _in_count;
+    int _in_next;
+
+#if defined ZMQ_HAVE_MMSG
+    std::vector<iovec> _out_iov;
+    std::vector<mmsghdr> _out_msgs;
+    std::vector<iovec> _in_iov;
+    std::vector<mmsghdr> _in_msgs;
+#endif
+
     bool _send_enabled;
     bool _recv_enabled;
 };
@@ -0,0 +1,544 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#if defined ZMQ_IOTHREAD_POLLER_USE_URING
+#include "uring.hpp"
+#include "epoll.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <endian.h>
+#include <poll.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "macros.hpp"
+#include "err.hpp"
+#include "config.hpp"
+#include "i_poll_events.hpp"
+
+//  The generation of a poll request lives in the low bits of its user data,
+//  next to the (suitably aligned) address of the poll entry.
+static const uint64_t gen_mask = 7;
+
+//  User data of requests whose completions are to be ignored.
+static const uint64_t ignored_user_data = 0;
+
+static int sys_io_uring_setup (unsigned entries_, io_uring_params *params_)
+{
+    return static_cast<int> (syscall (__NR_io_uring_setup, entries_, params_));
+}
+
+static int sys_io_uring_enter (int fd_,
+                               unsigned to_submit_,
+                               unsigned min_complete_,
+                               unsigned flags_,
+                               const void *arg_,
+                               size_t argsz_)
+{
+    return static_cast<int> (syscall (__NR_io_uring_enter, fd_, to_submit_,
+                                      min_complete_, flags_, arg_, argsz_));
+}
+
+zmq::uring_t::uring_t (const zmq::thread_ctx_t &ctx_) :
+    worker_poller_base_t (ctx_),
+    _ring_fd (retired_fd),
+    _sq_ptr (MAP_FAILED),
+    _sq_size (0),
+    _cq_ptr (MAP_FAILED),
+    _cq_size (0),
+    _sqes (static_cast<io_uring_sqe *> (MAP_FAILED)),
+    _sqes_size (0),
+    _sq_head (NULL),
+    _sq_tail (NULL),
+    _sq_mask (0),
+    _sq_entries (0),
+    _sq_array (NULL),
+    _cq_head (NULL),
+    _cq_tail (NULL),
+    _cq_mask (0),
+    _cqes (NULL),
+    _to_submit (0),
+    _epoll (NULL)
+{
+    if (!setup_ring ()) {
+        //  The kernel lacks io_uring support (or it is disabled, e.g. by
+        //  a seccomp policy); use epoll instead.
+        _epoll = new (std::nothrow) epoll_t (ctx_);
+        alloc_assert (_epoll);
+    }
+}
+
+zmq::uring_t::~uring_t ()
+{
+    //  Wait till the worker thread exits.
+    stop_worker ();
+    LIBZMQ_DELETE (_epoll);
+
+    if (_ring_fd != retired_fd) {
+        munmap (_sqes, _sqes_size);
+        if (_cq_ptr != _sq_ptr)
+            munmap (_cq_ptr, _cq_size);
+        munmap (_sq_ptr, _sq_size);
+
+        //  Closing the ring cancels all the polls still in flight.
+        close (_ring_fd);
+    }
+
+    for (retired_t::iterator it = _retired.begin (), end = _retired.end ();
+         it != end; ++it) {
+        LIBZMQ_DELETE (*it);
+    }
+}
+
+bool zmq::uring_t::setup_ring ()
+{
+    io_uring_params params;
+    memset (&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = max_io_events * 16;
+
+    const int fd = sys_io_uring_setup (max_io_events, &params);
+    if (fd == -1)
+        return false;
+
+    //  Completions must never be dropped, or a poll entry would stay
+    //  disarmed forever; waiting with a timeout needs the extended
+    //  argument of io_uring_enter.
+    if (!(params.features & IORING_FEAT_NODROP)
+        || !(params.features & IORING_FEAT_EXT_ARG)) {
+        close (fd);
+        return false;
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        _sq_size = _cq_size = std::max (_sq_size, _cq_size);
+
+    _sq_ptr = mmap (NULL, _sq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (_sq_ptr == MAP_FAILED) {
+        close (fd);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        _cq_ptr = _sq_ptr;
+    else {
+        _cq_ptr = mmap (NULL, _cq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (_cq_ptr == MAP_FAILED) {
+            munmap (_sq_ptr, _sq_size);
+            close (fd);
+            return false;
+        }
+    }
+    _sqes_size = params.sq_entries * sizeof (io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe *> (
+      mmap (NULL, _sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (_sqes == MAP_FAILED) {
+        if (_cq_ptr != _sq_ptr)
+            munmap (_cq_ptr, _cq_size);
+        munmap (_sq_ptr, _sq_size);
+        close (fd);
+        return false;
+    }
+
+    char *const sq = static_cast<char *> (_sq_ptr);
+    _sq_head = reinterpret_cast<unsigned *> (sq + params.sq_off.head);
+    _sq_tail = reinterpret_cast<unsigned *> (sq + params.sq_off.tail);
+    _sq_mask = *reinterpret_cast<unsigned *> (sq + params.sq_off.ring_mask);
+    _sq_entries =
+      *reinterpret_cast<unsigned *> (sq + params.sq_off.ring_entries);
+    _sq_array = reinterpret_cast<unsigned *> (sq + params.sq_off.array);
+
+    char *const cq = static_cast<char *> (_cq_ptr);
+    _cq_head = reinterpret_cast<unsigned *> (cq + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned *> (cq + params.cq_off.tail);
+    _cq_mask = *reinterpret_cast<unsigned *> (cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe *> (cq + params.cq_off.cqes);
+
+    _ring_fd = fd;
+    return true;
+}
+
+bool zmq::uring_t::uring_enabled () const
+{
+    return _epoll == NULL;
+}
+
+zmq::uring_t::handle_t zmq::uring_t::add_fd (fd_t fd_, i_poll_events *events_)
+{
+    if (_epoll)
+        return _epoll->add_fd (fd_, events_);
+
+    check_thread ();
+    poll_entry_t *pe = new (std::nothrow) poll_entry_t;
+    alloc_assert (pe);
+    zmq_assert ((reinterpret_cast<uintptr_t> (pe) & gen_mask) == 0);
+
+    pe->fd = fd_;
+    pe->events = events_;
+    pe->mask = 0;
+    pe->armed = 0;
+    pe->gen = 0;
+    pe->inflight = false;
+    pe->cancelling = false;
+    pe->pending = false;
+
+    //  Even with an empty mask a poll is kept armed, so that errors and
+    //  hang-ups are reported the same way epoll does.
+    pe->pending = true;
+    _pending.push_back (pe);
+
+    //  Increase the load metric of the thread.
+    adjust_load (1);
+
+    return pe;
+}
+
+void zmq::uring_t::rm_fd (handle_t handle_)
+{
+    if (_epoll) {
+        _epoll->rm_fd (handle_);
+        return;
+    }
+
+    check_thread ();
+    poll_entry_t *pe = static_cast<poll_entry_t *> (handle_);
+    if (pe->inflight) {
+        //  The entry is kept alive until the cancelled poll completes.
+        if (!pe->cancelling) {
+            io_uring_sqe *sqe = get_sqe ();
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uintptr_t> (pe) | pe->gen;
+            sqe->user_data = ignored_user_data;
+            pe->cancelling = true;
+        }
+
+        //  An in-flight poll holds a reference to the file, so the removal
+        //  is submitted right away: the caller is about to close the socket
+        //  and expects it to be released (e.g. its port freed) immediately.
+        int rc;
+        do {
+            rc = enter (false, 0);
+        } while (rc == -1 && errno == EINTR);
+        errno_assert (rc != -1 || errno == EBUSY || errno == EAGAIN);
+    }
+    pe->fd = retired_fd;
+    _retired.push_back (pe);
+
+    //  Decrease the load metric of the thread.
+    adjust_load (-1);
+}
+
+void zmq::uring_t::set_pollin (handle_t handle_)
+{
+    if (_epoll) {
+        _epoll->set_pollin (handle_);
+        return;
+    }
+
+    check_thread ();
+    poll_entry_t *pe = static_cast<poll_entry_t *> (handle_);
+    update (pe, pe->mask | POLLIN);
+}
+
+void zmq::uring_t::reset_pollin (handle_t handle_)
+{
+    if (_epoll) {
+        _epoll->reset_pollin (handle_);
+        return;
+    }
+
+    check_thread ();
+    poll_entry_t *pe = static_cast<poll_entry_t *> (handle_);
+    update (pe, pe->mask & ~(static_cast<uint32_t> (POLLIN)));
+}
+
+void zmq::uring_t::set_pollout (handle_t handle_)
+{
+    if (_epoll) {
+        _epoll->set_pollout (handle_);
+        return;
+    }
+
+    check_thread ();
+    poll_entry_t *pe = static_cast<poll_entry_t *> (handle_);
+    update (pe, pe->mask | POLLOUT);
+}
+
+void zmq::uring_t::reset_pollout (handle_t handle_)
+{
+    if (_epoll) {
+        _epoll->reset_pollout (handle_);
+        return;
+    }
+
+    check_thread ();
+    poll_entry_t *pe = static_cast<poll_entry_t *> (handle_);
+    update (pe, pe->mask & ~(static_cast<uint32_t> (POLLOUT)));
+}
+
+void zmq::uring_t::start (const char *name_)
+{
+    if (_epoll)
+        _epoll->start (name_);
+    else
+        worker_poller_base_t::start (name_);
+}
+
+void zmq::uring_t::stop ()
+{
+    if (_epoll) {
+        _epoll->stop ();
+        return;
+    }
+
+    check_thread ();
+}
+
+int zmq::uring_t::get_load () const
+{
+    return _epoll ? _epoll->get_load () : poller_base_t::get_load ();
+}
+
+void zmq::uring_t::add_timer (int timeout_, i_poll_events *sink_, int id_)
+{
+    if (_epoll)
+        _epoll->add_timer (timeout_, sink_, id_);
+    else
+        poller_base_t::add_timer (timeout_, sink_, id_);
+}
+
+void zmq::uring_t::cancel_timer (i_poll_events *sink_, int id_)
+{
+    if (_epoll)
+        _epoll->cancel_timer (sink_, id_);
+    else
+        poller_base_t::cancel_timer (sink_, id_);
+}
+
+int zmq::uring_t::max_fds ()
+{
+    return -1;
+}
+
+void zmq::uring_t::update (poll_entry_t *pe_, uint32_t mask_)
+{
+    pe_->mask = mask_;
+
+    //  A poll for a superset of the events is as good as the exact one:
+    //  unwanted events are filtered out when the completion arrives.
+    //  Requests are coalesced until the next wait.
+    if (!pe_->pending && (!pe_->inflight || (mask_ & ~pe_->armed))) {
+        pe_->pending = true;
+        _pending.push_back (pe_);
+    }
+}
+
+void zmq::uring_t::flush_pending ()
+{
+    for (pending_t::size_type i = 0; i != _pending.size (); ++i) {
+        poll_entry_t *const pe = _pending[i];
+        pe->pending = false;
+        if (pe->fd == retired_fd)
+            continue;
+
+        if (pe->inflight) {
+            //  Remove the current poll; it is re-armed with the new mask
+            //  once its completion arrives.
+            if (!pe->cancelling && (pe->mask & ~pe->armed)) {
+                io_uring_sqe *sqe = get_sqe ();
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<uintptr_t> (pe) | pe->gen;
+                sqe->user_data = ignored_user_data;
+                pe->cancelling = true;
+            }
+            continue;
+        }
+
+        io_uring_sqe *sqe = get_sqe ();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = pe->fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+        sqe->poll32_events = (pe->mask << 16) | (pe->mask >> 16);
+#else
+        sqe->poll32_events = pe->mask;
+#endif
+        pe->gen = (pe->gen + 1) & gen_mask;
+        sqe->user_data = reinterpret_cast<uintptr_t> (pe) | pe->gen;
+        pe->armed = pe->mask;
+        pe->inflight = true;
+    }
+    _pending.clear ();
+}
+
+io_uring_sqe *zmq::uring_t::get_sqe ()
+{
+    //  No SQPOLL thread is used, so the kernel only reads the submission
+    //  queue from within io_uring_enter, called by this thread.
+    const unsigned tail = *_sq_tail;
+    if (tail - __atomic_load_n (_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+        int rc;
+        do {
+            rc = enter (false, 0);
+        } while (rc == -1 && errno == EINTR);
+        errno_assert (rc != -1);
+        zmq_assert (tail - __atomic_load_n (_sq_head, __ATOMIC_ACQUIRE)
+                    < _sq_entries);
+    }
+
+    const unsigned index = tail & _sq_mask;
+    io_uring_sqe *sqe = &_sqes[index];
+    memset (sqe, 0, sizeof (io_uring_sqe));
+    _sq_array[index] = index;
+    __atomic_store_n (_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    _to_submit++;
+    return sqe;
+}
+
+int zmq::uring_t::enter (bool wait_, uint64_t timeout_)
+{
+    unsigned flags = 0;
+    unsigned min_complete = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    const void *argp = NULL;
+    size_t argsz = 0;
+
+    if (wait_) {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        min_complete = 1;
+        memset (&arg, 0, sizeof arg);
+        if (timeout_) {
+            ts.tv_sec = static_cast<long long> (timeout_ / 1000);
+            ts.tv_nsec = static_cast<long long> (timeout_ % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uintptr_t> (&ts);
+        }
+        argp = &arg;
+        argsz = sizeof arg;
+    }
+
+    const int rc = sys_io_uring_enter (_ring_fd, _to_submit, min_complete,
+                                       flags, argp, argsz);
+    if (rc > 0)
+        _to_submit -= std::min (static_cast<unsigned> (rc), _to_submit);
+    return rc;
+}
+
+void zmq::uring_t::process_cqe (uint64_t user_data_, int res_)
+{
+    if (user_data_ == ignored_user_data)
+        return;
+
+    poll_entry_t *const pe =
+      reinterpret_cast<poll_entry_t *> (user_data_ & ~gen_mask);
+    if ((user_data_ & gen_mask) != pe->gen)
+        return;
+    pe->inflight = false;
+    pe->cancelling = false;
+
+    if (pe->fd == retired_fd)
+        return;
+
+    uint32_t revents = 0;
+    if (res_ >= 0)
+        revents = static_cast<uint32_t> (res_);
+    else if (res_ != -ECANCELED)
+        revents = POLLERR;
+
+    if (revents & (POLLERR | POLLHUP))
+        pe->events->in_event ();
+    if (pe->fd == retired_fd)
+        return;
+    if ((revents & POLLOUT) && (pe->mask & POLLOUT))
+        pe->events->out_event ();
+    if (pe->fd == retired_fd)
+        return;
+    if ((revents & POLLIN) && (pe->mask & POLLIN))
+        pe->events->in_event ();
+    if (pe->fd == retired_fd)
+        return;
+
+    //  Re-arm the poll, unless one of the handlers already did.
+    if (!pe->pending && !pe->inflight) {
+        pe->pending = true;
+        _pending.push_back (pe);
+    }
+}
+
+void zmq::uring_t::loop ()
+{
+    while (true) {
+        //  Execute any due timers.
+        const int timeout = static_cast<int> (execute_timers ());
+
+        if (get_load () == 0) {
+            if (timeout == 0)
+                break;
+
+            // TODO sleep for timeout
+            continue;
+        }
+
+        //  Submit the poll changes and wait for events in a single call.
+        //  Polls that fired while the previous batch was being dispatched
+        //  are already in the completion queue.
+        flush_pending ();
+        const unsigned fired = __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE);
+        const int rc = enter (true, timeout);
+        if (rc == -1) {
+            errno_assert (errno == EINTR || errno == ETIME || errno == EBUSY
+                          || errno == EAGAIN);
+        }
+
+        //  Dispatch the polls just re-armed on ready sockets before the
+        //  ones that fired earlier. This is the order epoll reports
+        //  level-triggered events in, and connections keep being served
+        //  in the order they were established.
+        const unsigned head = *_cq_head;
+        const unsigned tail = __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE);
+        _completions.clear ();
+        for (unsigned i = fired; i != tail; ++i) {
+            const completion_t completion = {_cqes[i & _cq_mask].user_data,
+                                             _cqes[i & _cq_mask].res};
+            _completions.push_back (completion);
+        }
+        for (unsigned i = head; i != fired; ++i) {
+            const completion_t completion = {_cqes[i & _cq_mask].user_data,
+                                             _cqes[i & _cq_mask].res};
+            _completions.push_back (completion);
+        }
+        __atomic_store_n (_cq_head, tail, __ATOMIC_RELEASE);
+
+        for (completions_t::size_type i = 0, size = _completions.size ();
+             i != size; ++i)
+            process_cqe (_completions[i].user_data, _completions[i].res);
+
+        //  Queue the re-arms before any entry can be destroyed, so that
+        //  the pending list never refers to a deleted entry.
+        flush_pending ();
+
+        //  Destroy retired event sources, except those whose poll is still
+        //  in flight; they are destroyed once the completion arrives.
+        retired_t::iterator kept = _retired.begin ();
+        for (retired_t::iterator it = _retired.begin (), end = _retired.end ();
+             it != end; ++it) {
+            if ((*it)->inflight)
+                *kept++ = *it;
+            else
+                LIBZMQ_DELETE (*it);
+        }
+        _retired.erase (kept, _retired.end ());
+    }
+}
+
+#endif
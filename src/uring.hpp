@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_URING_HPP_INCLUDED__
+#define __ZMQ_URING_HPP_INCLUDED__
+
+//  poller.hpp decides which polling mechanism to use.
+#include "poller.hpp"
+#if defined ZMQ_IOTHREAD_POLLER_USE_URING
+
+#include <vector>
+
+#include <linux/io_uring.h>
+
+#include "ctx.hpp"
+#include "fd.hpp"
+#include "thread.hpp"
+#include "poller_base.hpp"
+
+namespace zmq
+{
+struct i_poll_events;
+class epoll_t;
+
+//  This class implements socket polling mechanism using the Linux-specific
+//  io_uring interface. Readiness is requested with one-shot POLL_ADD
+//  operations that are re-armed after each completion, which preserves the
+//  level-triggered semantics the engines rely on. All the poll requests
+//  queued during one iteration of the event loop are submitted by the same
+//  io_uring_enter call that waits for completions, replacing the separate
+//  epoll_ctl and epoll_wait system calls.
+//
+//  If the kernel does not support io_uring, or lacks the features needed
+//  here, the poller hands the whole poller concept over to an epoll_t at
+//  construction time.
+
+class uring_t ZMQ_FINAL : public worker_poller_base_t
+{
+  public:
+    typedef void *handle_t;
+
+    uring_t (const thread_ctx_t &ctx_);
+    ~uring_t () ZMQ_OVERRIDE;
+
+    //  "poller" concept.
+    handle_t add_fd (fd_t fd_, zmq::i_poll_events *events_);
+    void rm_fd (handle_t handle_);
+    void set_pollin (handle_t handle_);
+    void reset_pollin (handle_t handle_);
+    void set_pollout (handle_t handle_);
+    void reset_pollout (handle_t handle_);
+    void start (const char *name_ = NULL);
+    void stop ();
+
+    //  Methods of the poller concept implemented by poller_base_t, which
+    //  have to go to the epoll poller in fallback mode.
+    int get_load () const;
+    void add_timer (int timeout_, zmq::i_poll_events *sink_, int id_);
+    void cancel_timer (zmq::i_poll_events *sink_, int id_);
+
+    static int max_fds ();
+
+    //  Returns true if io_uring is in use, false if the poller fell back
+    //  to epoll.
+    bool uring_enabled () const;
+
+  private:
+    struct poll_entry_t
+    {
+        fd_t fd;
+        zmq::i_poll_events *events;
+
+        //  Events the owner is interested in.
+        uint32_t mask;
+
+        //  Events requested by the in-flight poll, if any.
+        uint32_t armed;
+
+        //  Generation of the in-flight poll, stored in the low bits of
+        //  the user data so that stale completions can be told apart.
+        uint32_t gen;
+
+        //  True while a poll request is queued or in the kernel.
+        bool inflight;
+
+        //  True if a removal of the in-flight poll was requested.
+        bool cancelling;
+
+        //  True if the entry is queued in _pending.
+        bool pending;
+    };
+
+    //  Main event loop.
+    void loop () ZMQ_OVERRIDE;
+
+    //  Sets up the ring. Returns false if io_uring is not usable.
+    bool setup_ring ();
+
+    //  Returns the next free submission queue entry, submitting the
+    //  pending ones if the queue is full.
+    io_uring_sqe *get_sqe ();
+
+    //  Submits pending entries and, if wait_ is true, waits for at least
+    //  one completion or until timeout_ (in ms, 0 = forever) expires.
+    int enter (bool wait_, uint64_t timeout_);
+
+    //  Updates the mask of the entry. In io_uring mode the change is
+    //  applied by flush_pending before the next wait.
+    void update (poll_entry_t *pe_, uint32_t mask_);
+
+    //  Queues poll requests for entries that have no poll in flight, and
+    //  removals for in-flight polls that do not cover the requested mask.
+    void flush_pending ();
+
+    //  Dispatches a single completion.
+    void process_cqe (uint64_t user_data_, int res_);
+
+    //  Io_uring file descriptor and mapped rings; _ring_fd is retired_fd
+    //  if the poller fell back to epoll.
+    fd_t _ring_fd;
+    void *_sq_ptr;
+    size_t _sq_size;
+    void *_cq_ptr;
+    size_t _cq_size;
+    io_uring_sqe *_sqes;
+    size_t _sqes_size;
+
+    unsigned *_sq_head;
+    unsigned *_sq_tail;
+    unsigned _sq_mask;
+    unsigned _sq_entries;
+    unsigned *_sq_array;
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    unsigned _cq_mask;
+    io_uring_cqe *_cqes;
+
+    //  Number of entries queued but not yet submitted.
+    unsigned _to_submit;
+
+    //  Entries whose poll request needs to be (re-)armed.
+    typedef std::vector<poll_entry_t *> pending_t;
+    pending_t _pending;
+
+    //  Completions harvested in one iteration of the event loop, in the
+    //  order they are dispatched.
+    struct completion_t
+    {
+        uint64_t user_data;
+        int res;
+    };
+    typedef std::vector<completion_t> completions_t;
+    completions_t _completions;
+
+    //  Poller doing all the work in fallback mode, NULL otherwise.
+    epoll_t *_epoll;
+
+    //  List of retired event sources.
+    typedef std::vector<poll_entry_t *> retired_t;
+    retired_t _retired;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (uring_t)
+};
+
+typedef uring_t poller_t;
+}
+
+#endif
+
+#endif
@@ -13,12 +13,18 @@
 
 zmq::v2_decoder_t::v2_decoder_t (size_t bufsize_,
                                  int64_t maxmsgsize_,
-                                 bool zero_copy_) :
+                                 bool zero_copy_,
+                                 decoder_buffer_pool_t *pool_) :
     decoder_base_t<v2_decoder_t, shared_message_memory_allocator> (bufsize_),
     _msg_flags (0),
     _zero_copy (zero_copy_),
-    _max_msg_size (maxmsgsize_)
+    _max_msg_size (maxmsgsize_),
+    _recv_allocator_threshold (0)
 {
+    memset (&_recv_allocator, 0, sizeof _recv_allocator);
+    if (pool_)
+        get_allocator ().set_pool (pool_);
+
     int rc = _in_progress.init ();
     errno_assert (rc == 0);
 
@@ -32,6 +38,13 @@ zmq::v2_decoder_t::~v2_decoder_t ()
     errno_assert (rc == 0);
 }
 
+void zmq::v2_decoder_t::set_recv_allocator (
+  const zmq_recv_allocator_t &allocator_, size_t threshold_)
+{
+    _recv_allocator = allocator_;
+    _recv_allocator_threshold = threshold_;
+}
+
 int zmq::v2_decoder_t::flags_ready (unsigned char const *)
 {
     _msg_flags = 0;
@@ -86,10 +99,29 @@ int zmq::v2_decoder_t::size_ready (uint64_t msg_size_,
     // the current message can exceed the current buffer. We have to copy the buffer
     // data into a new message and complete it in the next receive.
 
+    //  Large messages may go to memory of the application. Messages small
+    //  enough to be stored in msg_t are not worth it, and commands are
+    //  never handed to the application.
+    void *app_data = NULL;
+    if (unlikely (_recv_allocator.alloc_fn && !(_msg_flags & msg_t::command)
+                  && msg_size_ >= _recv_allocator_threshold
+                  && msg_size_ > msg_t::max_vsm_size))
+        app_data = _recv_allocator.alloc_fn (static_cast<size_t> (msg_size_),
+                                             _recv_allocator.hint);
+
     shared_message_memory_allocator &allocator = get_allocator ();
-    if (unlikely (!_zero_copy
-                  || msg_size_ > static_cast<size_t> (
-                       allocator.data () + allocator.size () - read_pos_))) {
+    if (app_data) {
+        //  The payload is read straight into the application's memory,
+        //  which the message hands back to it once closed.
+        rc = _in_progress.init_data (app_data, static_cast<size_t> (msg_size_),
+                                     _recv_allocator.free_fn,
+                                     _recv_allocator.hint);
+        if (unlikely (rc) && _recv_allocator.free_fn)
+            _recv_allocator.free_fn (app_data, _recv_allocator.hint);
+    } else if (unlikely (!_zero_copy
+                         || msg_size_ > static_cast<size_t> (
+                              allocator.data () + allocator.size ()
+                              - read_pos_))) {
         // a new message has started, but the size would exceed the pre-allocated arena
         // this happens every time when a message does not fit completely into the buffer
         rc = _in_progress.init_size (static_cast<size_t> (msg_size_));
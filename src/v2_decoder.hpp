@@ -15,12 +15,21 @@ class v2_decoder_t ZMQ_FINAL
     : public decoder_base_t<v2_decoder_t, shared_message_memory_allocator>
 {
   public:
-    v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_, bool zero_copy_);
+    //  If a pool is given, the buffers are recycled through it.
+    v2_decoder_t (size_t bufsize_,
+                  int64_t maxmsgsize_,
+                  bool zero_copy_,
+                  decoder_buffer_pool_t *pool_ = NULL);
     ~v2_decoder_t ();
 
     //  i_decoder interface.
     msg_t *msg () { return &_in_progress; }
 
+    //  Messages of at least threshold_ bytes are read straight into memory
+    //  from the application's allocator, see ZMQ_RECV_ALLOCATOR.
+    void set_recv_allocator (const zmq_recv_allocator_t &allocator_,
+                             size_t threshold_);
+
   private:
     int flags_ready (unsigned char const *);
     int one_byte_size_ready (unsigned char const *);
@@ -36,6 +45,9 @@ class v2_decoder_t ZMQ_FINAL
     const bool _zero_copy;
     const int64_t _max_msg_size;
 
+    zmq_recv_allocator_t _recv_allocator;
+    size_t _recv_allocator_threshold;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (v2_decoder_t)
 };
 }
@@ -22,6 +22,15 @@ zmq::v3_1_encoder_t::~v3_1_encoder_t ()
 
 void zmq::v3_1_encoder_t::message_ready ()
 {
+    //  Data frames fanned out to many peers come with their header
+    //  encoded, send header and data in one go.
+    size_t frame_size;
+    unsigned char *frame = in_progress ()->encoded_frame (&frame_size);
+    if (frame) {
+        next_step (frame, frame_size, &v3_1_encoder_t::message_ready, true);
+        return;
+    }
+
     //  Encode flags.
     size_t size = in_progress ()->sizep ();
     size_t header_size = 2; // flags byte + size byte
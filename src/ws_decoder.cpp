@@ -7,6 +7,7 @@
 
 #include "ws_protocol.hpp"
 #include "ws_decoder.hpp"
+#include "ws_mask.hpp"
 #include "likely.hpp"
 #include "wire.hpp"
 #include "err.hpp"
@@ -14,7 +15,8 @@
 zmq::ws_decoder_t::ws_decoder_t (size_t bufsize_,
                                  int64_t maxmsgsize_,
                                  bool zero_copy_,
-                                 bool must_mask_) :
+                                 bool must_mask_,
+                                 decoder_buffer_pool_t *pool_) :
     decoder_base_t<ws_decoder_t, shared_message_memory_allocator> (bufsize_),
     _msg_flags (0),
     _zero_copy (zero_copy_),
@@ -22,6 +24,9 @@ zmq::ws_decoder_t::ws_decoder_t (size_t bufsize_,
     _must_mask (must_mask_),
     _size (0)
 {
+    if (pool_)
+        get_allocator ().set_pool (pool_);
+
     memset (_tmpbuf, 0, sizeof (_tmpbuf));
     int rc = _in_progress.init ();
     errno_assert (rc == 0);
@@ -232,12 +237,12 @@ int zmq::ws_decoder_t::size_ready (unsigned char const *read_pos_)
 int zmq::ws_decoder_t::message_ready (unsigned char const *)
 {
     if (_must_mask) {
-        int mask_index = _opcode == ws_protocol_t::opcode_binary ? 1 : 0;
+        const size_t mask_index =
+          _opcode == ws_protocol_t::opcode_binary ? 1 : 0;
 
         unsigned char *data =
           static_cast<unsigned char *> (_in_progress.datap ());
-        for (size_t i = 0; i < _size; ++i, mask_index++)
-            data[i] = data[i] ^ _mask[mask_index % 4];
+        ws_mask (data, data, _size, _mask, mask_index);
     }
 
     //  Message is completely read. Signal this to the caller
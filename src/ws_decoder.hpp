@@ -16,10 +16,12 @@ class ws_decoder_t ZMQ_FINAL
     : public decoder_base_t<ws_decoder_t, shared_message_memory_allocator>
 {
   public:
+    //  If a pool is given, the buffers are recycled through it.
     ws_decoder_t (size_t bufsize_,
                   int64_t maxmsgsize_,
                   bool zero_copy_,
-                  bool must_mask_);
+                  bool must_mask_,
+                  decoder_buffer_pool_t *pool_ = NULL);
     ~ws_decoder_t ();
 
     //  i_decoder interface.
@@ -7,6 +7,7 @@
 #include "likely.hpp"
 #include "wire.hpp"
 #include "random.hpp"
+#include "ws_mask.hpp"
 
 #include <limits.h>
 
@@ -109,14 +110,13 @@ void zmq::ws_encoder_t::size_ready ()
             dest = static_cast<unsigned char *> (_masked_msg.datap ());
         }
 
-        int mask_index = 0;
+        size_t mask_index = 0;
         if (_is_binary)
             ++mask_index;
         //  TODO: remove once there is an opcode for subscribe/cancel
         if (in_progress ()->is_subscribe () || in_progress ()->is_cancel ())
             ++mask_index;
-        for (size_t i = 0; i < size; ++i, mask_index++)
-            dest[i] = src[i] ^ _mask[mask_index % 4];
+        ws_mask (dest, src, size, _mask, mask_index);
 
         next_step (dest, size, &ws_encoder_t::message_ready, true);
     } else {
@@ -116,6 +116,9 @@ class ws_engine_t : public stream_engine_base_t
     void plug_internal ();
     void start_ws_handshake ();
 
+    //  WebSocket control frames bypass the mechanism.
+    bool can_offload_crypto () const { return false; }
+
   private:
     int routing_id_msg (msg_t *msg_);
     int process_routing_id_msg (msg_t *msg_);
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "ws_mask.hpp"
+#include "stdint.hpp"
+
+#include <string.h>
+
+#if defined __SSE2__ || defined _M_X64                                         \
+  || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define ZMQ_WS_MASK_SSE2
+#include <emmintrin.h>
+//  AVX2 is compiled in separately and only used if the CPU supports it.
+#if defined __GNUC__ && (defined __clang__ || __GNUC__ >= 5)
+#define ZMQ_WS_MASK_AVX2
+#include <immintrin.h>
+#endif
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define ZMQ_WS_MASK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace zmq
+{
+//  Masks the longest prefix of src_ the kernel handles, with pattern_
+//  holding the key bytes for the first 32 bytes. Returns the length of
+//  the prefix, a multiple of 4 so that the key phase stays the same.
+typedef size_t (*ws_mask_fn_t) (unsigned char *dest_,
+                                const unsigned char *src_,
+                                size_t size_,
+                                const unsigned char *pattern_);
+
+static size_t mask_scalar (unsigned char *dest_,
+                           const unsigned char *src_,
+                           size_t size_,
+                           const unsigned char *pattern_)
+{
+    uint64_t pattern;
+    memcpy (&pattern, pattern_, sizeof pattern);
+    size_t i = 0;
+    for (; i + 8 <= size_; i += 8) {
+        uint64_t chunk;
+        memcpy (&chunk, src_ + i, sizeof chunk);
+        chunk ^= pattern;
+        memcpy (dest_ + i, &chunk, sizeof chunk);
+    }
+    return i;
+}
+
+#if defined ZMQ_WS_MASK_SSE2
+static size_t mask_sse2 (unsigned char *dest_,
+                         const unsigned char *src_,
+                         size_t size_,
+                         const unsigned char *pattern_)
+{
+    const __m128i pattern =
+      _mm_loadu_si128 (reinterpret_cast<const __m128i *> (pattern_));
+    size_t i = 0;
+    for (; i + 64 <= size_; i += 64) {
+        const __m128i *src = reinterpret_cast<const __m128i *> (src_ + i);
+        __m128i *dest = reinterpret_cast<__m128i *> (dest_ + i);
+        const __m128i a = _mm_loadu_si128 (src);
+        const __m128i b = _mm_loadu_si128 (src + 1);
+        const __m128i c = _mm_loadu_si128 (src + 2);
+        const __m128i d = _mm_loadu_si128 (src + 3);
+        _mm_storeu_si128 (dest, _mm_xor_si128 (a, pattern));
+        _mm_storeu_si128 (dest + 1, _mm_xor_si128 (b, pattern));
+        _mm_storeu_si128 (dest + 2, _mm_xor_si128 (c, pattern));
+        _mm_storeu_si128 (dest + 3, _mm_xor_si128 (d, pattern));
+    }
+    for (; i + 16 <= size_; i += 16) {
+        const __m128i chunk =
+          _mm_loadu_si128 (reinterpret_cast<const __m128i *> (src_ + i));
+        _mm_storeu_si128 (reinterpret_cast<__m128i *> (dest_ + i),
+                          _mm_xor_si128 (chunk, pattern));
+    }
+    return i;
+}
+#endif
+
+#if defined ZMQ_WS_MASK_AVX2
+__attribute__ ((target ("avx2"))) static size_t
+mask_avx2 (unsigned char *dest_,
+           const unsigned char *src_,
+           size_t size_,
+           const unsigned char *pattern_)
+{
+    const __m256i pattern =
+      _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (pattern_));
+    size_t i = 0;
+    for (; i + 64 <= size_; i += 64) {
+        const __m256i *src = reinterpret_cast<const __m256i *> (src_ + i);
+        __m256i *dest = reinterpret_cast<__m256i *> (dest_ + i);
+        const __m256i a = _mm256_loadu_si256 (src);
+        const __m256i b = _mm256_loadu_si256 (src + 1);
+        _mm256_storeu_si256 (dest, _mm256_xor_si256 (a, pattern));
+        _mm256_storeu_si256 (dest + 1, _mm256_xor_si256 (b, pattern));
+    }
+    for (; i + 32 <= size_; i += 32) {
+        const __m256i chunk =
+          _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (src_ + i));
+        _mm256_storeu_si256 (reinterpret_cast<__m256i *> (dest_ + i),
+                             _mm256_xor_si256 (chunk, pattern));
+    }
+    return i;
+}
+#endif
+
+#if defined ZMQ_WS_MASK_NEON
+static size_t mask_neon (unsigned char *dest_,
+                         const unsigned char *src_,
+                         size_t size_,
+                         const unsigned char *pattern_)
+{
+    const uint8x16_t pattern = vld1q_u8 (pattern_);
+    size_t i = 0;
+    for (; i + 64 <= size_; i += 64) {
+        const uint8x16_t a = vld1q_u8 (src_ + i);
+        const uint8x16_t b = vld1q_u8 (src_ + i + 16);
+        const uint8x16_t c = vld1q_u8 (src_ + i + 32);
+        const uint8x16_t d = vld1q_u8 (src_ + i + 48);
+        vst1q_u8 (dest_ + i, veorq_u8 (a, pattern));
+        vst1q_u8 (dest_ + i + 16, veorq_u8 (b, pattern));
+        vst1q_u8 (dest_ + i + 32, veorq_u8 (c, pattern));
+        vst1q_u8 (dest_ + i + 48, veorq_u8 (d, pattern));
+    }
+    for (; i + 16 <= size_; i += 16)
+        vst1q_u8 (dest_ + i, veorq_u8 (vld1q_u8 (src_ + i), pattern));
+    return i;
+}
+#endif
+
+static ws_mask_fn_t select_mask_fn ()
+{
+#if defined ZMQ_WS_MASK_AVX2
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return mask_avx2;
+#endif
+#if defined ZMQ_WS_MASK_SSE2
+    return mask_sse2;
+#elif defined ZMQ_WS_MASK_NEON
+    return mask_neon;
+#else
+    return mask_scalar;
+#endif
+}
+
+static const ws_mask_fn_t mask_fn = select_mask_fn ();
+}
+
+void zmq::ws_mask (unsigned char *dest_,
+                   const unsigned char *src_,
+                   size_t size_,
+                   const unsigned char mask_[4],
+                   size_t offset_)
+{
+    unsigned char pattern[32];
+    for (size_t i = 0; i != sizeof pattern; ++i)
+        pattern[i] = mask_[(offset_ + i) % 4];
+
+    //  Vector kernels are not worth the call for short payloads.
+    size_t done = size_ >= 16 ? mask_fn (dest_, src_, size_, pattern) : 0;
+    done += mask_scalar (dest_ + done, src_ + done, size_ - done, pattern);
+    for (; done != size_; ++done)
+        dest_[done] = src_[done] ^ pattern[done % 4];
+}
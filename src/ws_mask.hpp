@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_WS_MASK_HPP_INCLUDED__
+#define __ZMQ_WS_MASK_HPP_INCLUDED__
+
+#include <stddef.h>
+
+namespace zmq
+{
+//  XORs size_ bytes of src_ with the WebSocket masking key into dest_,
+//  which may be src_ itself. The first byte is masked with
+//  mask_[offset_ % 4], so payloads can continue a masked frame header.
+//  Uses the widest vector instructions the CPU supports.
+void ws_mask (unsigned char *dest_,
+              const unsigned char *src_,
+              size_t size_,
+              const unsigned char mask_[4],
+              size_t offset_);
+}
+
+#endif
@@ -42,6 +42,7 @@ class wss_engine_t : public ws_engine_t
     int read (void *data, size_t size_);
     int write (const void *data_, size_t size_);
 #endif
+    bool raw_socket_write () const { return false; }
 
   private:
     bool do_handshake ();
@@ -8,7 +8,9 @@
 #include "err.hpp"
 #include "msg.hpp"
 #include "macros.hpp"
+#include "ctx.hpp"
 #include "generic_mtrie_impl.hpp"
+#include "compact_mtrie_impl.hpp"
 
 zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     socket_base_t (parent_, tid_, sid_),
@@ -21,6 +23,7 @@ zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     _lossy (true),
     _manual (false),
     _send_last_pipe (false),
+    _fanout_shards (1),
     _pending_pipes (),
     _welcome_msg ()
 {
@@ -80,7 +83,7 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
         size_t size = 0;
         bool subscribe = false;
         bool is_subscribe_or_cancel = false;
-        bool notify = false;
+        bool is_batch = false;
 
         const bool first_part = !_more_recv;
         _more_recv = (msg.flagsp () & msg_t::more) != 0;
@@ -92,6 +95,13 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
                 size = msg.command_body_size ();
                 subscribe = msg.is_subscribe ();
                 is_subscribe_or_cancel = true;
+            } else if (msg.is_subscribe_batch () || msg.is_cancel_batch ()) {
+                //  Batches only come from XSUB sockets over inproc.
+                data = msg_data;
+                size = msg.sizep ();
+                subscribe = msg.is_subscribe_batch ();
+                is_subscribe_or_cancel = true;
+                is_batch = true;
             } else if (msg.sizep () > 0 && (*msg_data == 0 || *msg_data == 1)) {
                 data = msg_data + 1;
                 size = msg.sizep () - 1;
@@ -104,57 +114,11 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
             _process_subscribe =
               !_only_first_subscribe || is_subscribe_or_cancel;
 
-        if (is_subscribe_or_cancel) {
-            if (_manual) {
-                // Store manual subscription to use on termination
-                if (!subscribe)
-                    _manual_subscriptions.rm (data, size, pipe_);
-                else
-                    _manual_subscriptions.add (data, size, pipe_);
-
-                _pending_pipes.push_back (pipe_);
-            } else {
-                if (!subscribe) {
-                    const mtrie_t::rm_result rm_result =
-                      _subscriptions.rm (data, size, pipe_);
-                    //  TODO reconsider what to do if rm_result == mtrie_t::not_found
-                    notify =
-                      rm_result != mtrie_t::values_remain || _verbose_unsubs;
-                } else {
-                    const bool first_added =
-                      _subscriptions.add (data, size, pipe_);
-                    notify = first_added || _verbose_subs;
-                }
-            }
-
-            //  If the request was a new subscription, or the subscription
-            //  was removed, or verbose mode or manual mode are enabled, store it
-            //  so that it can be passed to the user on next recv call.
-            if (_manual || (options.type == ZMQ_XPUB && notify)) {
-                //  ZMTP 3.1 hack: we need to support sub/cancel commands, but
-                //  we can't give them back to userspace as it would be an API
-                //  breakage since the payload of the message is completely
-                //  different. Manually craft an old-style message instead.
-                //  Although with other transports it would be possible to simply
-                //  reuse the same buffer and prefix a 0/1 byte to the topic, with
-                //  inproc the subscribe/cancel command string is not present in
-                //  the message, so this optimization is not possible.
-                //  The pushback makes a copy of the data array anyway, so the
-                //  number of buffer copies does not change.
-                blob_t notification (size + 1);
-                if (subscribe)
-                    *notification.data () = 1;
-                else
-                    *notification.data () = 0;
-                memcpy (notification.data () + 1, data, size);
-
-                _pending_data.push_back (ZMQ_MOVE (notification));
-                if (metadata)
-                    metadata->add_ref ();
-                _pending_metadata.push_back (metadata);
-                _pending_flags.push_back (0);
-            }
-        } else if (options.type != ZMQ_PUB) {
+        if (is_batch)
+            apply_batch (pipe_, metadata, data, size, subscribe);
+        else if (is_subscribe_or_cancel)
+            apply_subscription (pipe_, metadata, data, size, subscribe);
+        else if (options.type != ZMQ_PUB) {
             //  Process user message coming upstream from xsub socket,
             //  but not if the type is PUB, which never processes user
             //  messages
@@ -169,11 +133,114 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
     }
 }
 
+void zmq::xpub_t::apply_subscription (pipe_t *pipe_,
+                                      metadata_t *metadata_,
+                                      const unsigned char *data_,
+                                      size_t size_,
+                                      bool subscribe_)
+{
+    bool notify = false;
+    if (_manual) {
+        // Store manual subscription to use on termination
+        if (!subscribe_)
+            _manual_subscriptions.rm (data_, size_, pipe_);
+        else
+            _manual_subscriptions.add (data_, size_, pipe_);
+
+        _pending_pipes.push_back (pipe_);
+    } else {
+        if (!subscribe_) {
+            const mtrie_t::rm_result rm_result =
+              _subscriptions.rm (data_, size_, pipe_);
+            //  TODO reconsider what to do if rm_result == mtrie_t::not_found
+            notify = rm_result != mtrie_t::values_remain || _verbose_unsubs;
+        } else {
+            const bool first_added = _subscriptions.add (data_, size_, pipe_);
+            notify = first_added || _verbose_subs;
+        }
+    }
+
+    //  If the request was a new subscription, or the subscription
+    //  was removed, or verbose mode or manual mode are enabled, store it
+    //  so that it can be passed to the user on next recv call.
+    if (_manual || (options.type == ZMQ_XPUB && notify))
+        queue_notification (metadata_, data_, size_, subscribe_);
+}
+
+void zmq::xpub_t::apply_batch (pipe_t *pipe_,
+                               metadata_t *metadata_,
+                               const unsigned char *batch_,
+                               size_t size_,
+                               bool subscribe_)
+{
+    std::vector<topic_t> topics;
+    const bool ok = parse_topic_batch (batch_, size_, topics);
+    zmq_assert (ok);
+
+    if (subscribe_ && !_manual) {
+        //  The trie adds the topics in one go, walking the prefixes they
+        //  share only once.
+        batch_t batch = {this, metadata_};
+        _subscriptions.add_many (&topics[0], topics.size (), pipe_,
+                                 notify_added, &batch);
+        return;
+    }
+
+    for (std::vector<topic_t>::const_iterator it = topics.begin (),
+                                              end = topics.end ();
+         it != end; ++it)
+        apply_subscription (pipe_, metadata_, it->data, it->size, subscribe_);
+}
+
+void zmq::xpub_t::notify_added (const topic_t &topic_,
+                                bool added_,
+                                batch_t *batch_)
+{
+    xpub_t *self = batch_->self;
+    if (self->options.type == ZMQ_XPUB && (added_ || self->_verbose_subs))
+        self->queue_notification (batch_->metadata, topic_.data, topic_.size,
+                                  true);
+}
+
+void zmq::xpub_t::queue_notification (metadata_t *metadata_,
+                                      const unsigned char *data_,
+                                      size_t size_,
+                                      bool subscribe_)
+{
+    //  ZMTP 3.1 hack: we need to support sub/cancel commands, but
+    //  we can't give them back to userspace as it would be an API
+    //  breakage since the payload of the message is completely
+    //  different. Manually craft an old-style message instead.
+    //  Although with other transports it would be possible to simply
+    //  reuse the same buffer and prefix a 0/1 byte to the topic, with
+    //  inproc the subscribe/cancel command string is not present in
+    //  the message, so this optimization is not possible.
+    //  The pushback makes a copy of the data array anyway, so the
+    //  number of buffer copies does not change.
+    blob_t notification (size_ + 1);
+    if (subscribe_)
+        *notification.data () = 1;
+    else
+        *notification.data () = 0;
+    memcpy (notification.data () + 1, data_, size_);
+
+    _pending_data.push_back (ZMQ_MOVE (notification));
+    if (metadata_)
+        metadata_->add_ref ();
+    _pending_metadata.push_back (metadata_);
+    _pending_flags.push_back (0);
+}
+
 void zmq::xpub_t::xwrite_activated (pipe_t *pipe_)
 {
     _dist.activated (pipe_);
 }
 
+void zmq::xpub_t::xdrain ()
+{
+    _dist.drain ();
+}
+
 int zmq::xpub_t::xsetsockopt (int option_,
                               _In_reads_bytes_opt_ (optvallen_)
                                 const void *optval_,
@@ -182,7 +249,9 @@ int zmq::xpub_t::xsetsockopt (int option_,
 {
     if (option_ == ZMQ_XPUB_VERBOSE || option_ == ZMQ_XPUB_VERBOSER
         || option_ == ZMQ_XPUB_MANUAL_LAST_VALUE || option_ == ZMQ_XPUB_NODROP
-        || option_ == ZMQ_XPUB_MANUAL || option_ == ZMQ_ONLY_FIRST_SUBSCRIBE) {
+        || option_ == ZMQ_XPUB_MANUAL || option_ == ZMQ_ONLY_FIRST_SUBSCRIBE
+        || option_ == ZMQ_XPUB_COMPACT_TRIE
+        || option_ == ZMQ_XPUB_FANOUT_SHARDS) {
         if (optvallen_ != sizeof (int)
             || *static_cast<const int *> (optval_) < 0) {
             errno = EINVAL;
@@ -203,6 +272,29 @@ int zmq::xpub_t::xsetsockopt (int option_,
             _manual = (*static_cast<const int *> (optval_) != 0);
         else if (option_ == ZMQ_ONLY_FIRST_SUBSCRIBE)
             _only_first_subscribe = (*static_cast<const int *> (optval_) != 0);
+        else if (option_ == ZMQ_XPUB_COMPACT_TRIE) {
+            //  The layout can only be chosen while the tries are empty.
+            if (_subscriptions.num_prefixes ()
+                || _manual_subscriptions.num_prefixes ()) {
+                errno = EINVAL;
+                return -1;
+            }
+            const bool compact = *static_cast<const int *> (optval_) != 0;
+            _subscriptions.set_compact (compact);
+            _manual_subscriptions.set_compact (compact);
+        } else if (option_ == ZMQ_XPUB_FANOUT_SHARDS) {
+            const int shards = *static_cast<const int *> (optval_);
+            if (shards < 1 || shards > fanout_max_shards) {
+                errno = EINVAL;
+                return -1;
+            }
+            if (shards != _fanout_shards) {
+                if (_dist.set_shards (get_ctx ()->get_fanout_pool (), shards)
+                    == -1)
+                    return -1;
+                _fanout_shards = shards;
+            }
+        }
     } else if (option_ == ZMQ_SUBSCRIBE && _manual) {
         if (_last_pipe != NULL)
             _subscriptions.add ((unsigned char *) optval_, optvallen_,
@@ -238,6 +330,11 @@ int zmq::xpub_t::xgetsockopt (int option_, void *optval_, size_t *optvallen_)
         return do_getsockopt<int> (optval_, optvallen_,
                                    (int) _subscriptions.num_prefixes ());
     }
+    if (option_ == ZMQ_XPUB_COMPACT_TRIE)
+        return do_getsockopt<int> (optval_, optvallen_,
+                                   _subscriptions.compact () ? 1 : 0);
+    if (option_ == ZMQ_XPUB_FANOUT_SHARDS)
+        return do_getsockopt<int> (optval_, optvallen_, _fanout_shards);
 
     // room for future options here
 
@@ -17,6 +17,81 @@ class msg_t;
 class pipe_t;
 class io_thread_t;
 
+//  Subscription trie of an XPUB socket, either mtrie_t or, once
+//  ZMQ_XPUB_COMPACT_TRIE is set, the path-compressed compact_mtrie_t.
+class xpub_trie_t
+{
+  public:
+    xpub_trie_t () : _compact (false) {}
+
+    bool compact () const { return _compact; }
+    void set_compact (bool compact_) { _compact = compact_; }
+
+    bool add (mtrie_t::prefix_t prefix_, size_t size_, pipe_t *pipe_)
+    {
+        return _compact ? _compact_mtrie.add (prefix_, size_, pipe_)
+                        : _mtrie.add (prefix_, size_, pipe_);
+    }
+
+    template <typename Arg>
+    void add_many (const topic_t *topics_,
+                   size_t count_,
+                   pipe_t *pipe_,
+                   void (*func_) (const topic_t &topic_, bool added_, Arg arg_),
+                   Arg arg_)
+    {
+        if (_compact)
+            _compact_mtrie.add_many (topics_, count_, pipe_, func_, arg_);
+        else
+            _mtrie.add_many (topics_, count_, pipe_, func_, arg_);
+    }
+
+    template <typename Arg>
+    void rm (pipe_t *pipe_,
+             void (*func_) (mtrie_t::prefix_t data_, size_t size_, Arg arg_),
+             Arg arg_,
+             bool call_on_uniq_)
+    {
+        if (_compact)
+            _compact_mtrie.rm (pipe_, func_, arg_, call_on_uniq_);
+        else
+            _mtrie.rm (pipe_, func_, arg_, call_on_uniq_);
+    }
+
+    mtrie_t::rm_result
+    rm (mtrie_t::prefix_t prefix_, size_t size_, pipe_t *pipe_)
+    {
+        return _compact ? static_cast<mtrie_t::rm_result> (
+                 _compact_mtrie.rm (prefix_, size_, pipe_))
+                        : _mtrie.rm (prefix_, size_, pipe_);
+    }
+
+    template <typename Arg>
+    void match (mtrie_t::prefix_t data_,
+                size_t size_,
+                void (*func_) (pipe_t *pipe_, Arg arg_),
+                Arg arg_)
+    {
+        if (_compact)
+            _compact_mtrie.match (data_, size_, func_, arg_);
+        else
+            _mtrie.match (data_, size_, func_, arg_);
+    }
+
+    uint32_t num_prefixes () const
+    {
+        return _compact ? _compact_mtrie.num_prefixes ()
+                        : _mtrie.num_prefixes ();
+    }
+
+  private:
+    bool _compact;
+    mtrie_t _mtrie;
+    compact_mtrie_t<pipe_t> _compact_mtrie;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (xpub_trie_t)
+};
+
 class xpub_t : public socket_base_t
 {
   public:
@@ -39,8 +114,39 @@ class xpub_t : public socket_base_t
                        const size_t optvallen_) ZMQ_FINAL;
     int xgetsockopt (int option_, void *optval_, size_t *optvallen_) ZMQ_FINAL;
     void xpipe_terminated (zmq::pipe_t *pipe_) ZMQ_FINAL;
+    void xdrain () ZMQ_FINAL;
 
   private:
+    //  Applies a subscription or cancel read from pipe_ and queues the
+    //  notification for the user, if any.
+    void apply_subscription (zmq::pipe_t *pipe_,
+                             zmq::metadata_t *metadata_,
+                             const unsigned char *data_,
+                             size_t size_,
+                             bool subscribe_);
+
+    //  Applies a batch of subscriptions or cancels read from pipe_.
+    void apply_batch (zmq::pipe_t *pipe_,
+                      zmq::metadata_t *metadata_,
+                      const unsigned char *batch_,
+                      size_t size_,
+                      bool subscribe_);
+
+    //  Queues a subscription or cancel to be received by the user.
+    void queue_notification (zmq::metadata_t *metadata_,
+                             const unsigned char *data_,
+                             size_t size_,
+                             bool subscribe_);
+
+    //  Function to be applied to the topics of a batch added to the trie.
+    struct batch_t
+    {
+        xpub_t *self;
+        zmq::metadata_t *metadata;
+    };
+    static void
+    notify_added (const topic_t &topic_, bool added_, batch_t *batch_);
+
     //  Function to be applied to the trie to send all the subscriptions
     //  upstream.
     static void send_unsubscription (zmq::mtrie_t::prefix_t data_,
@@ -51,10 +157,10 @@ class xpub_t : public socket_base_t
     static void mark_as_matching (zmq::pipe_t *pipe_, xpub_t *self_);
 
     //  List of all subscriptions mapped to corresponding pipes.
-    mtrie_t _subscriptions;
+    xpub_trie_t _subscriptions;
 
     //  List of manual subscriptions mapped to corresponding pipes.
-    mtrie_t _manual_subscriptions;
+    xpub_trie_t _manual_subscriptions;
 
     //  Distributor of messages holding the list of outbound pipes.
     dist_t _dist;
@@ -91,6 +197,10 @@ class xpub_t : public socket_base_t
     //  Send message to the last pipe, only used if xpub is on manual and after calling set option with ZMQ_SUBSCRIBE
     bool _send_last_pipe;
 
+    //  Number of shards the distributor splits large fan-outs into, set
+    //  with ZMQ_XPUB_FANOUT_SHARDS.
+    int _fanout_shards;
+
     //  Function to be applied to match the last pipe.
     static void mark_last_pipe_as_matching (zmq::pipe_t *pipe_, xpub_t *self_);
 
@@ -6,6 +6,8 @@
 #include "macros.hpp"
 #include "xsub.hpp"
 #include "err.hpp"
+#include "config.hpp"
+#include "topic_batch.hpp"
 
 zmq::xsub_t::xsub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     socket_base_t (parent_, tid_, sid_),
@@ -44,8 +46,7 @@ void zmq::xsub_t::xattach_pipe (pipe_t *pipe_,
     _dist.attach (pipe_);
 
     //  Send all the cached subscriptions to the new upstream peer.
-    _subscriptions.apply (send_subscription, pipe_);
-    pipe_->flush ();
+    send_subscriptions (pipe_);
 }
 
 void zmq::xsub_t::xread_activated (pipe_t *pipe_)
@@ -67,8 +68,7 @@ void zmq::xsub_t::xpipe_terminated (pipe_t *pipe_)
 void zmq::xsub_t::xhiccuped (pipe_t *pipe_)
 {
     //  Send all the cached subscriptions to the hiccuped pipe.
-    _subscriptions.apply (send_subscription, pipe_);
-    pipe_->flush ();
+    send_subscriptions (pipe_);
 }
 
 int zmq::xsub_t::xsetsockopt (int option_,
@@ -90,6 +90,10 @@ int zmq::xsub_t::xsetsockopt (int option_,
     else if (option_ == ZMQ_XSUB_VERBOSE_UNSUBSCRIBE) {
         _verbose_unsubs = (*static_cast<const int *> (optval_) != 0);
         return 0;
+    } else if (option_ == ZMQ_SUBSCRIBE_MANY
+               || option_ == ZMQ_UNSUBSCRIBE_MANY) {
+        return send_batch (static_cast<const unsigned char *> (optval_),
+                           optvallen_, option_ == ZMQ_SUBSCRIBE_MANY);
     }
 #endif
     errno = EINVAL;
@@ -168,6 +172,48 @@ int zmq::xsub_t::xsend (msg_t *msg_)
     return 0;
 }
 
+int zmq::xsub_t::send_batch (const unsigned char *batch_,
+                             size_t size_,
+                             bool subscribe_)
+{
+    //  The batch can't be slipped into a multipart message being sent.
+    if (_more_send) {
+        errno = EFSM;
+        return -1;
+    }
+
+    std::vector<topic_t> topics;
+    if (!parse_topic_batch (batch_, size_, topics)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Sorted, the topics sharing a prefix follow each other, which
+    //  saves the upstream tries walking that prefix again.
+    sort_topics (topics);
+    std::vector<unsigned char> batch;
+    batch.reserve (size_);
+    for (std::vector<topic_t>::const_iterator it = topics.begin (),
+                                              end = topics.end ();
+         it != end; ++it) {
+        unsigned char *data = const_cast<unsigned char *> (it->data);
+        if (subscribe_)
+            _subscriptions.add (data, it->size);
+        else if (!_subscriptions.rm (data, it->size) && !_verbose_unsubs)
+            continue;
+        append_topic (batch, it->data, it->size);
+    }
+    if (batch.empty ())
+        return 0;
+
+    msg_t msg;
+    int rc = subscribe_ ? msg.init_subscribe_batch (batch.size (), &batch[0])
+                        : msg.init_cancel_batch (batch.size (), &batch[0]);
+    errno_assert (rc == 0);
+    rc = _dist.send_to_all (&msg);
+    return close_and_return (&msg, rc);
+}
+
 bool zmq::xsub_t::xhas_out ()
 {
     //  Subscription can be added/removed anytime.
@@ -255,30 +301,55 @@ bool zmq::xsub_t::xhas_in ()
 
 bool zmq::xsub_t::match (msg_t *msg_)
 {
+#ifdef ZMQ_USE_RADIX_TREE
+    //  Relay the tree out after bulk (un)subscriptions, before matching.
+    _subscriptions.compact_if_fragmented ();
+#endif
     const bool matching = _subscriptions.check (
       static_cast<unsigned char *> (msg_->datap ()), msg_->sizep ());
 
     return matching ^ options.invert_matching;
 }
 
-void zmq::xsub_t::send_subscription (
-  _In_reads_bytes_opt_ (size_) unsigned char *data_,
-  _When_ (data_ == NULL, _In_range_ (0, 0)) size_t size_,
-  _In_ void *arg_)
+void zmq::xsub_t::send_subscriptions (pipe_t *pipe_)
 {
-    pipe_t *pipe = static_cast<pipe_t *> (arg_);
+    subscription_batch_t batch;
+    batch.pipe = pipe_;
+    batch.dropped = false;
+    _subscriptions.apply (append_subscription, &batch);
+    write_subscriptions (batch);
+    pipe_->flush ();
+}
 
-    //  Create the subscription message.
-    msg_t msg;
-    const int rc = msg.init_subscribe (size_, data_);
-    errno_assert (rc == 0);
+void zmq::xsub_t::write_subscriptions (subscription_batch_t &batch_)
+{
+    if (batch_.topics.empty ())
+        return;
 
-    //  Send it to the pipe.
-    const bool sent = pipe->write (&msg);
-    //  If we reached the SNDHWM, and thus cannot send the subscription, drop
-    //  the subscription message instead. This matches the behaviour of
+    //  If we reached the SNDHWM, and thus cannot send the batch, drop it
+    //  along with the subscriptions left. This matches the behaviour of
     //  zmq_setsockopt(ZMQ_SUBSCRIBE, ...), which also drops subscriptions
     //  when the SNDHWM is reached.
-    if (!sent)
+    msg_t msg;
+    const int rc =
+      msg.init_subscribe_batch (batch_.topics.size (), &batch_.topics[0]);
+    errno_assert (rc == 0);
+    if (!batch_.pipe->write (&msg)) {
         msg.close ();
+        batch_.dropped = true;
+    }
+    batch_.topics.clear ();
+}
+
+void zmq::xsub_t::append_subscription (
+  _In_reads_bytes_opt_ (size_) unsigned char *data_,
+  _When_ (data_ == NULL, _In_range_ (0, 0)) size_t size_,
+  _In_ void *arg_)
+{
+    subscription_batch_t &batch = *static_cast<subscription_batch_t *> (arg_);
+    if (batch.dropped)
+        return;
+    append_topic (batch.topics, data_, size_);
+    if (batch.topics.size () >= max_subscription_batch_size)
+        write_subscriptions (batch);
 }
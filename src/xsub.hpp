@@ -3,6 +3,8 @@
 #ifndef __ZMQ_XSUB_HPP_INCLUDED__
 #define __ZMQ_XSUB_HPP_INCLUDED__
 
+#include <vector>
+
 #include "socket_base.hpp"
 #include "session_base.hpp"
 #include "dist.hpp"
@@ -48,12 +50,35 @@ class xsub_t : public socket_base_t
     //  Check whether the message matches at least one subscription.
     bool match (zmq::msg_t *msg_);
 
-    //  Function to be applied to the trie to send all the subsciptions
-    //  upstream.
+    //  Applies a ZMQ_SUBSCRIBE_MANY or ZMQ_UNSUBSCRIBE_MANY batch and
+    //  sends the topics that change the subscriptions upstream in one
+    //  message.
+    int send_batch (const unsigned char *batch_, size_t size_, bool subscribe_);
+
+    //  Sends all the subscriptions to the pipe, in batches of at most
+    //  max_subscription_batch_size bytes.
+    void send_subscriptions (zmq::pipe_t *pipe_);
+
+    //  Subscriptions on their way to a pipe.
+    struct subscription_batch_t
+    {
+        pipe_t *pipe;
+        std::vector<unsigned char> topics;
+
+        //  Set once a batch hit the SNDHWM.
+        bool dropped;
+    };
+
+    //  Writes the topics collected to the pipe.
+    static void write_subscriptions (subscription_batch_t &batch_);
+
+    //  Function to be applied to the trie to collect all the subscriptions
+    //  in batches.
     static void
-    send_subscription (_In_reads_bytes_opt_ (size_) unsigned char *data_,
-                       _When_ (data_ == NULL, _In_range_ (0, 0)) size_t size_,
-                       _In_ void *arg_);
+    append_subscription (_In_reads_bytes_opt_ (size_) unsigned char *data_,
+                         _When_ (data_ == NULL, _In_range_ (0, 0))
+                           size_t size_,
+                         _In_ void *arg_);
 
     //  Fair queueing object for inbound pipes.
     fq_t _fq;
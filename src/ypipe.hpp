@@ -15,12 +15,16 @@ namespace zmq
 //  T is the type of the object in the queue.
 //  N is granularity of the pipe, i.e. how many items are needed to
 //  perform next memory allocation.
+//  M is the granularity the pipe starts with and goes back to once the
+//  reader has caught up with the writer.
 
-template <typename T, int N> class ypipe_t ZMQ_FINAL : public ypipe_base_t<T>
+template <typename T, int N, int M = N>
+class ypipe_t ZMQ_FINAL : public ypipe_base_t<T>
 {
   public:
-    //  Initialises the pipe.
-    ypipe_t ()
+    //  Initialises the pipe. The memory chunks of the pipe are taken from
+    //  the pool, if any.
+    ypipe_t (chunk_pool_t *pool_ = NULL) : _queue (pool_)
     {
         //  Insert terminator element into the queue.
         _queue.push ();
@@ -88,6 +92,10 @@ template <typename T, int N> class ypipe_t ZMQ_FINAL : public ypipe_base_t<T>
             //  that reader is sleeping.
             _c.set (_f);
             _w = _f;
+
+            //  The reader has consumed everything flushed so far, so the
+            //  pipe is not under load any more.
+            _queue.shrink ();
             return false;
         }
 
@@ -147,12 +155,14 @@ template <typename T, int N> class ypipe_t ZMQ_FINAL : public ypipe_base_t<T>
         return (*fn_) (_queue.front ());
     }
 
+    size_t footprint () const { return _queue.footprint (); }
+
   protected:
     //  Allocation-efficient queue to store pipe items.
     //  Front of the queue points to the first prefetched item, back of
     //  the pipe points to last un-flushed item. Front is used only by
     //  reader thread, while back is used only by writer thread.
-    yqueue_t<T, N> _queue;
+    yqueue_t<T, N, M> _queue;
 
     //  Points to the first un-flushed item. This variable is used
     //  exclusively by writer thread.
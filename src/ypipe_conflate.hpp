@@ -84,6 +84,9 @@ template <typename T> class ypipe_conflate_t ZMQ_FINAL : public ypipe_base_t<T>
         return dbuffer.probe (fn_);
     }
 
+    //  The double buffer holds two items at most.
+    size_t footprint () const { return 2 * sizeof (T); }
+
   protected:
     dbuffer_t<T> dbuffer;
     bool reader_awake;
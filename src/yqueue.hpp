@@ -7,7 +7,9 @@
 #include <stddef.h>
 
 #include "err.hpp"
+#include "atomic_counter.hpp"
 #include "atomic_ptr.hpp"
+#include "chunk_pool.hpp"
 #include "platform.hpp"
 
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
@@ -18,7 +20,7 @@ namespace zmq
 {
 //  yqueue is an efficient queue implementation. The main goal is
 //  to minimise number of allocations/deallocations needed. Thus yqueue
-//  allocates/deallocates elements in batches of N.
+//  allocates/deallocates elements in batches of up to N.
 //
 //  yqueue allows one thread to use push/back function and another one
 //  to use pop/front functions. However, user must ensure that there's no
@@ -28,6 +30,10 @@ namespace zmq
 //  T is the type of the object in the queue.
 //  N is granularity of the queue (how many pushes have to be done till
 //  actual memory allocation is required).
+//  M is the granularity the queue starts with. Each chunk allocated while
+//  the queue is busy is twice the size of the previous one, up to N, and
+//  the chunks go back to M elements once the queue gets idle (see shrink),
+//  so that idle queues hold little memory.
 #if defined HAVE_POSIX_MEMALIGN
 // ALIGN is the memory alignment size to use in the case where we have
 // posix_memalign available. Default value is 64, this alignment will
@@ -35,17 +41,23 @@ namespace zmq
 // architectures where cache lines are <= 64 bytes (e.g. most things
 // except POWER). It is detected at build time to try to account for other
 // platforms like POWER and s390x.
-template <typename T, int N, size_t ALIGN = ZMQ_CACHELINE_SIZE> class yqueue_t
+template <typename T,
+          int N,
+          int M = N,
+          size_t ALIGN = ZMQ_CACHELINE_SIZE>
+class yqueue_t
 #else
-template <typename T, int N> class yqueue_t
+template <typename T, int N, int M = N> class yqueue_t
 #endif
 {
   public:
-    //  Create the queue.
-    inline yqueue_t ()
+    //  Create the queue. If a pool is given, the chunks of N elements are
+    //  taken from it and returned to it. The pool must outlive the queue.
+    inline yqueue_t (chunk_pool_t *pool_ = NULL) :
+        _next_size (M), _pool (pool_)
     {
-        _begin_chunk = allocate_chunk ();
-        alloc_assert (_begin_chunk);
+        zmq_assert (!_pool || _pool->size () >= chunk_size ());
+        _begin_chunk = allocate_chunk (next_size ());
         _begin_pos = 0;
         _back_chunk = NULL;
         _back_pos = 0;
@@ -58,49 +70,34 @@ template <typename T, int N> class yqueue_t
     {
         while (true) {
             if (_begin_chunk == _end_chunk) {
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-                scalable_aligned_free (_begin_chunk);
-#else
-#if _MSC_VER
-                _aligned_free (_begin_chunk);
-#else
-                std::free (_begin_chunk);
-#endif
-#endif
+                free_chunk (_begin_chunk);
                 break;
             }
             chunk_t *o = _begin_chunk;
             _begin_chunk = _begin_chunk->next;
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-            scalable_aligned_free (o);
-#else
-#if _MSC_VER
-            _aligned_free (o);
-#else
-            std::free (o);
-#endif
-#endif
+            free_chunk (o);
         }
 
-        chunk_t *sc = _spare_chunk.xchg (NULL);
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        scalable_aligned_free (sc);
-#else
-#if _MSC_VER
-        _aligned_free (sc);
-#else
-        std::free (sc);
-#endif
-#endif
+        free_chunk (_spare_chunk.xchg (NULL));
+    }
+
+    //  Size of the largest memory chunks the queue allocates.
+    static size_t chunk_size () { return chunk_size (N); }
+
+    //  Memory held by the queue, in bytes. Can be called from both the
+    //  reader and the writer thread.
+    size_t footprint () const
+    {
+        return _chunks.get () * header_size + _elements.get () * sizeof (T);
     }
 
     //  Returns reference to the front element of the queue.
     //  If the queue is empty, behaviour is undefined.
-    inline T &front () { return _begin_chunk->values[_begin_pos]; }
+    inline T &front () { return values (_begin_chunk)[_begin_pos]; }
 
     //  Returns reference to the back element of the queue.
     //  If the queue is empty, behaviour is undefined.
-    inline T &back () { return _back_chunk->values[_back_pos]; }
+    inline T &back () { return values (_back_chunk)[_back_pos]; }
 
     //  Adds an element to the back end of the queue.
     inline void push ()
@@ -108,19 +105,21 @@ template <typename T, int N> class yqueue_t
         _back_chunk = _end_chunk;
         _back_pos = _end_pos;
 
-        if (++_end_pos != N)
+        if (++_end_pos != _end_chunk->size)
             return;
 
+        //  The spare chunk is only used if it is of the size needed now.
+        const int size = next_size ();
         chunk_t *sc = _spare_chunk.xchg (NULL);
-        if (sc) {
-            _end_chunk->next = sc;
-            sc->prev = _end_chunk;
-        } else {
-            _end_chunk->next = allocate_chunk ();
-            alloc_assert (_end_chunk->next);
-            _end_chunk->next->prev = _end_chunk;
+        if (sc && sc->size != size) {
+            free_chunk (sc);
+            sc = NULL;
         }
-        _end_chunk = _end_chunk->next;
+        if (!sc)
+            sc = allocate_chunk (size);
+        _end_chunk->next = sc;
+        sc->prev = _end_chunk;
+        _end_chunk = sc;
         _end_pos = 0;
     }
 
@@ -137,8 +136,8 @@ template <typename T, int N> class yqueue_t
         if (_back_pos)
             --_back_pos;
         else {
-            _back_pos = N - 1;
             _back_chunk = _back_chunk->prev;
+            _back_pos = _back_chunk->size - 1;
         }
 
         //  Now, move 'end' position backwards. Note that obsolete end chunk
@@ -148,17 +147,9 @@ template <typename T, int N> class yqueue_t
         if (_end_pos)
             --_end_pos;
         else {
-            _end_pos = N - 1;
             _end_chunk = _end_chunk->prev;
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-            scalable_aligned_free (_end_chunk->next);
-#else
-#if _MSC_VER
-            _aligned_free (_end_chunk->next);
-#else
-            std::free (_end_chunk->next);
-#endif
-#endif
+            _end_pos = _end_chunk->size - 1;
+            free_chunk (_end_chunk->next);
             _end_chunk->next = NULL;
         }
     }
@@ -166,7 +157,7 @@ template <typename T, int N> class yqueue_t
     //  Removes an element from the front end of the queue.
     inline void pop ()
     {
-        if (++_begin_pos == N) {
+        if (++_begin_pos == _begin_chunk->size) {
             chunk_t *o = _begin_chunk;
             _begin_chunk = _begin_chunk->next;
             _begin_chunk->prev = NULL;
@@ -176,46 +167,113 @@ template <typename T, int N> class yqueue_t
             //  so for cache reasons we'll get rid of the spare and
             //  use 'o' as the spare.
             chunk_t *cs = _spare_chunk.xchg (o);
-#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-            scalable_aligned_free (cs);
-#else
-#if _MSC_VER
-            _aligned_free (cs);
-#else
-            std::free (cs);
-#endif
-#endif
+            free_chunk (cs);
         }
     }
 
+    //  The writer calls this when it finds the reader has consumed all of
+    //  the queue. The chunks allocated from now on start over from M
+    //  elements, and the spare chunk is dropped unless it is that small.
+    inline void shrink ()
+    {
+        if (_next_size == M)
+            return;
+        _next_size = M;
+
+        chunk_t *sc = _spare_chunk.xchg (NULL);
+        if (sc && sc->size != M) {
+            free_chunk (sc);
+            sc = NULL;
+        }
+        if (sc)
+            free_chunk (_spare_chunk.xchg (sc));
+    }
+
   private:
-    //  Individual memory chunk to hold N elements.
+    //  Individual memory chunk. The header is followed by the elements,
+    //  starting at the next cache line.
     struct chunk_t
     {
-        T values[N];
         chunk_t *prev;
         chunk_t *next;
+        int size;
     };
 
-    static inline chunk_t *allocate_chunk ()
+    static const size_t header_size =
+      (sizeof (chunk_t) + ZMQ_CACHELINE_SIZE - 1) / ZMQ_CACHELINE_SIZE
+      * ZMQ_CACHELINE_SIZE;
+
+    static size_t chunk_size (int size_)
+    {
+        return header_size + size_ * sizeof (T);
+    }
+
+    static T *values (chunk_t *chunk_)
+    {
+        return reinterpret_cast<T *> (reinterpret_cast<char *> (chunk_)
+                                      + header_size);
+    }
+
+    //  Size of the chunk to allocate now. The one after it is twice as
+    //  large, up to N.
+    inline int next_size ()
+    {
+        const int size = _next_size;
+        if (_next_size < N)
+            _next_size = _next_size * 2 < N ? _next_size * 2 : N;
+        return size;
+    }
+
+    inline chunk_t *allocate_chunk (int size_)
     {
+        chunk_t *chunk;
+        if (_pool && size_ == N)
+            chunk = static_cast<chunk_t *> (_pool->allocate ());
+        else {
 #if defined HAVE_POSIX_MEMALIGN
-        void *pv;
-        if (posix_memalign (&pv, ALIGN, sizeof (chunk_t)) == 0)
-            return (chunk_t *) pv;
-        return NULL;
+            void *pv;
+            chunk = posix_memalign (&pv, ALIGN, chunk_size (size_)) == 0
+                      ? static_cast<chunk_t *> (pv)
+                      : NULL;
 #else
 #ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
-        return static_cast<chunk_t *> (
-          scalable_aligned_malloc (sizeof (chunk_t), ZMQ_CACHELINE_SIZE));
+            chunk = static_cast<chunk_t *> (scalable_aligned_malloc (
+              chunk_size (size_), ZMQ_CACHELINE_SIZE));
 #else
 #if _MSC_VER
-        return static_cast<chunk_t *> (
-          _aligned_malloc (sizeof (chunk_t), ZMQ_CACHELINE_SIZE));
+            chunk = static_cast<chunk_t *> (
+              _aligned_malloc (chunk_size (size_), ZMQ_CACHELINE_SIZE));
 #else
-        return static_cast<chunk_t *> (std::malloc (sizeof (chunk_t)));
+            chunk = static_cast<chunk_t *> (std::malloc (chunk_size (size_)));
 #endif
 #endif
+#endif
+        }
+        alloc_assert (chunk);
+        chunk->size = size_;
+        _chunks.add (1);
+        _elements.add (size_);
+        return chunk;
+    }
+
+    inline void free_chunk (chunk_t *chunk_)
+    {
+        if (!chunk_)
+            return;
+        _chunks.sub (1);
+        _elements.sub (chunk_->size);
+        if (_pool && chunk_->size == N) {
+            _pool->deallocate (chunk_);
+            return;
+        }
+#ifdef ZMQ_HAVE_TBB_SCALABLE_ALLOCATOR
+        scalable_aligned_free (chunk_);
+#else
+#if _MSC_VER
+        _aligned_free (chunk_);
+#else
+        std::free (chunk_);
+#endif
 #endif
     }
 
@@ -235,6 +293,16 @@ template <typename T, int N> class yqueue_t
     //  us from having to call malloc/free.
     atomic_ptr_t<chunk_t> _spare_chunk;
 
+    //  Size of the next chunk to allocate, accessed by the writer only.
+    int _next_size;
+
+    //  Numbers of chunks and of elements in them the queue holds.
+    atomic_counter_t _chunks;
+    atomic_counter_t _elements;
+
+    //  Pool the chunks are taken from, if any.
+    chunk_pool_t *const _pool;
+
     ZMQ_NON_COPYABLE_NOR_MOVABLE (yqueue_t)
 };
 }
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "precompiled.hpp"
+#include "zero_copy_sends.hpp"
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+
+#include <algorithm>
+#include <new>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "config.hpp"
+#include "err.hpp"
+#include "tcp.hpp"
+
+zmq::zero_copy_sends_t::zero_copy_sends_t () : _next_id (0)
+{
+}
+
+zmq::zero_copy_sends_t::~zero_copy_sends_t ()
+{
+    for (std::deque<send_t>::iterator it = _sends.begin (),
+                                      end = _sends.end ();
+         it != end; ++it) {
+        const int rc = it->msg.close ();
+        errno_assert (rc == 0);
+    }
+}
+
+void zmq::zero_copy_sends_t::add (msg_t &msg_)
+{
+    const uint32_t id = _next_id++;
+    if (!_sends.empty () && _sends.back ().last_id + 1 == id
+        && _sends.back ().msg.data () == msg_.data ()) {
+        _sends.back ().last_id = id;
+        _sends.back ().remaining++;
+        return;
+    }
+
+    _sends.push_back (send_t ());
+    send_t &send = _sends.back ();
+    send.first_id = id;
+    send.last_id = id;
+    send.remaining = 1;
+    int rc = send.msg.init ();
+    errno_assert (rc == 0);
+    rc = send.msg.copy (msg_);
+    errno_assert (rc == 0);
+}
+
+bool zmq::zero_copy_sends_t::reap (fd_t s_)
+{
+    bool reaped = false;
+    uint32_t first_id;
+    uint32_t last_id;
+    int rc;
+    while ((rc = tcp_read_zero_copy_completion (s_, &first_id, &last_id))
+           != -1) {
+        reaped = true;
+        if (rc == 0)
+            continue;
+
+        //  Ranges are usually notified in order, but the kernel does not
+        //  guarantee it, so the ids of each message are accounted for.
+        for (std::deque<send_t>::iterator it = _sends.begin (),
+                                          end = _sends.end ();
+             it != end; ++it) {
+            const int32_t from = static_cast<int32_t> (first_id - it->first_id);
+            const int32_t to = static_cast<int32_t> (last_id - it->first_id);
+            const int32_t count =
+              static_cast<int32_t> (it->last_id - it->first_id);
+            const int32_t overlap =
+              std::min (to, count) - std::max (from, 0) + 1;
+            if (overlap <= 0)
+                continue;
+            zmq_assert (static_cast<uint32_t> (overlap) <= it->remaining);
+            it->remaining -= overlap;
+        }
+        while (!_sends.empty () && _sends.front ().remaining == 0) {
+            rc = _sends.front ().msg.close ();
+            errno_assert (rc == 0);
+            _sends.pop_front ();
+        }
+    }
+    return reaped;
+}
+
+void zmq::zero_copy_sends_t::swap (zero_copy_sends_t &other_)
+{
+    _sends.swap (other_._sends);
+    std::swap (_next_id, other_._next_id);
+}
+
+void zmq::zero_copy_linger_t::start (io_thread_t *io_thread_,
+                                     fd_t s_,
+                                     zero_copy_sends_t &sends_)
+{
+    zero_copy_linger_t *const object =
+      new (std::nothrow) zero_copy_linger_t (io_thread_, s_);
+    alloc_assert (object);
+    object->_sends.swap (sends_);
+
+    //  Notifications raise POLLERR, which the pollers report as an input
+    //  event whatever the events polled for.
+    object->_handle = object->add_fd (s_);
+    object->add_timer (zero_copy_linger, linger_timer_id);
+    object->_has_timer = true;
+}
+
+zmq::zero_copy_linger_t::zero_copy_linger_t (io_thread_t *io_thread_,
+                                             fd_t s_) :
+    io_object_t (io_thread_),
+    _s (s_),
+    _handle (static_cast<handle_t> (NULL)),
+    _has_timer (false)
+{
+}
+
+zmq::zero_copy_linger_t::~zero_copy_linger_t ()
+{
+    zmq_assert (_s == retired_fd);
+}
+
+void zmq::zero_copy_linger_t::in_event ()
+{
+    //  Nothing on the error queue means the socket is in error or hung
+    //  up, and would keep being reported. No more completions are to be
+    //  expected then.
+    if (_sends.reap (_s) && !_sends.empty ())
+        return;
+    finish ();
+}
+
+void zmq::zero_copy_linger_t::timer_event (int id_)
+{
+    zmq_assert (id_ == linger_timer_id);
+    _has_timer = false;
+    finish ();
+}
+
+void zmq::zero_copy_linger_t::finish ()
+{
+    if (_has_timer) {
+        cancel_timer (linger_timer_id);
+        _has_timer = false;
+    }
+    rm_fd (_handle);
+
+    //  Reset the connection, so that the kernel drops the unsent data
+    //  rather than reading the content of messages released below.
+    if (!_sends.empty ()) {
+        const linger lng = {1, 0};
+        const int rc =
+          setsockopt (_s, SOL_SOCKET, SO_LINGER, &lng, sizeof lng);
+        errno_assert (rc == 0);
+    }
+    const int rc = close (_s);
+    errno_assert (rc == 0 || errno == ECONNRESET);
+    _s = retired_fd;
+
+    unplug ();
+    delete this;
+}
+
+#endif
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#ifndef __ZMQ_ZERO_COPY_SENDS_HPP_INCLUDED__
+#define __ZMQ_ZERO_COPY_SENDS_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+
+#include <deque>
+
+#include "fd.hpp"
+#include "io_object.hpp"
+#include "msg.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+class io_thread_t;
+
+//  Messages whose content the kernel may still read, as they were sent
+//  with MSG_ZEROCOPY on a TCP socket. Each is referenced until the kernel
+//  notifies on the error queue of the socket that it is done with it.
+
+class zero_copy_sends_t
+{
+  public:
+    zero_copy_sends_t ();
+    ~zero_copy_sends_t ();
+
+    bool empty () const { return _sends.empty (); }
+
+    //  Keeps a reference to msg_, whose content was just sent with
+    //  MSG_ZEROCOPY. A message sent by several partial sends is
+    //  referenced once.
+    void add (msg_t &msg_);
+
+    //  Releases the messages the kernel is done with. Returns true if any
+    //  notification was read from the error queue of s_.
+    bool reap (fd_t s_);
+
+    void swap (zero_copy_sends_t &other_);
+
+  private:
+    //  Message referenced by the zero-copy sends with ids in
+    //  [first_id, last_id], of which remaining are still outstanding.
+    struct send_t
+    {
+        uint32_t first_id;
+        uint32_t last_id;
+        uint32_t remaining;
+        msg_t msg;
+    };
+    std::deque<send_t> _sends;
+
+    //  Id the kernel assigns to the next successful zero-copy send.
+    uint32_t _next_id;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (zero_copy_sends_t)
+};
+
+//  Holds on to the socket of a closed engine until the kernel is done with
+//  the messages the engine sent with MSG_ZEROCOPY, as closing the socket
+//  doesn't stop the transmission of the data still queued. The completions
+//  are read as the I/O thread polls the socket, so that closing an engine
+//  doesn't hold up the others. If they are not all in after
+//  zero_copy_linger ms, the connection is reset, which drops the data.
+
+class zero_copy_linger_t ZMQ_FINAL : public io_object_t
+{
+  public:
+    //  Takes over s_ and the messages of sends_. The object deletes
+    //  itself once the socket is closed.
+    static void start (io_thread_t *io_thread_,
+                       fd_t s_,
+                       zero_copy_sends_t &sends_);
+
+  private:
+    zero_copy_linger_t (io_thread_t *io_thread_, fd_t s_);
+    ~zero_copy_linger_t ();
+
+    //  i_poll_events interface implementation.
+    void in_event ();
+    void timer_event (int id_);
+
+    //  Closes the socket, resetting the connection first if the kernel
+    //  may still read the messages, and deletes the object.
+    void finish ();
+
+    enum
+    {
+        linger_timer_id = 0x50
+    };
+
+    fd_t _s;
+    handle_t _handle;
+    bool _has_timer;
+    zero_copy_sends_t _sends;
+
+    ZMQ_NON_COPYABLE_NOR_MOVABLE (zero_copy_linger_t)
+};
+}
+
+#endif
+
+#endif
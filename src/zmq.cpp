@@ -696,6 +696,32 @@ zmq_msg_recv (_Inout_ zmq_msg_t *msg_, _In_ void *s_, int flags_)
     return s_recvmsg (s, msg_, flags_);
 }
 
+ZMQ_EXPORT_IMPL (int)
+zmq_msg_send_batch (_Inout_updates_ (count_) zmq_msg_t *msgs_,
+                    size_t count_,
+                    _In_ void *s_,
+                    int flags_)
+{
+    zmq::socket_base_t *s = as_socket_base_t (s_);
+    if (!s)
+        return -1;
+    return s->send_batch (reinterpret_cast<zmq::msg_t *> (msgs_), count_,
+                          flags_);
+}
+
+ZMQ_EXPORT_IMPL (int)
+zmq_msg_recv_batch (_Inout_updates_ (count_) zmq_msg_t *msgs_,
+                    size_t count_,
+                    _In_ void *s_,
+                    int flags_)
+{
+    zmq::socket_base_t *s = as_socket_base_t (s_);
+    if (!s)
+        return -1;
+    return s->recv_batch (reinterpret_cast<zmq::msg_t *> (msgs_), count_,
+                          flags_);
+}
+
 ZMQ_EXPORT_IMPL (int) zmq_msg_close (_Inout_ zmq_msg_t *msg_)
 {
     return (reinterpret_cast<zmq::msg_t *> (msg_))->close ();
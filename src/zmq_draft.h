@@ -54,6 +54,29 @@
 #define ZMQ_NORM_NUM_PARITY 122
 #define ZMQ_NORM_NUM_AUTOPARITY 123
 #define ZMQ_NORM_PUSH 124
+#define ZMQ_ZERO_COPY_SEND_THRESHOLD 125
+#define ZMQ_UDP_BATCH_SIZE 126
+#define ZMQ_SPIN_WAIT 127
+#define ZMQ_SPIN_WAIT_HITS 128
+#define ZMQ_SPIN_WAIT_MISSES 129
+#define ZMQ_XPUB_COMPACT_TRIE 130
+#define ZMQ_XPUB_FANOUT_SHARDS 131
+#define ZMQ_SUBSCRIBE_MANY 132
+#define ZMQ_UNSUBSCRIBE_MANY 133
+#define ZMQ_RECV_ALLOCATOR 134
+#define ZMQ_RECV_ALLOCATOR_THRESHOLD 135
+
+/*  DRAFT ZMQ_RECV_ALLOCATOR option value. An I/O thread writes the           */
+/*  messages into the memory alloc_fn returns, so the application must not    */
+/*  reuse it until free_fn is called for it, or with a NULL free_fn, until    */
+/*  the message received into it and all its copies are closed.               */
+typedef void *(ZMQ_CDECL zmq_recv_alloc_fn) (size_t size_, void *hint_);
+typedef struct zmq_recv_allocator_t
+{
+    zmq_recv_alloc_fn *alloc_fn;
+    zmq_free_fn *free_fn;
+    void *hint;
+} zmq_recv_allocator_t;
 
 /*  DRAFT ZMQ_NORM_MODE options                                               */
 #define ZMQ_NORM_FIXED 0
@@ -69,6 +92,16 @@
 
 /*  DRAFT Context options                                                     */
 #define ZMQ_ZERO_COPY_RECV 10
+#define ZMQ_CRYPTO_THREADS 13
+#define ZMQ_PIPE_CHUNK_POOL_MAX 14
+#define ZMQ_PIPE_CHUNKS_CACHED 15
+#define ZMQ_PIPE_CHUNK_HITS 16
+#define ZMQ_PIPE_CHUNK_MISSES 17
+#define ZMQ_PIPE_CHUNK_DROPS 18
+#define ZMQ_MSG_POOL 19
+#define ZMQ_DECODER_BUFFER_HITS 20
+#define ZMQ_DECODER_BUFFER_MISSES 21
+#define ZMQ_DECODER_BUFFER_DROPS 22
 
 /*  DRAFT Context methods.                                                    */
 int zmq_ctx_set_ext (void *context_,
@@ -90,6 +123,14 @@ uint32_t zmq_msg_routing_id (zmq_msg_t *msg_);
 int zmq_msg_set_group (zmq_msg_t *msg_, const char *group_);
 const char *zmq_msg_group (zmq_msg_t *msg_);
 int zmq_msg_init_buffer (zmq_msg_t *msg_, const void *buf_, size_t size_);
+int zmq_msg_send_batch (zmq_msg_t *msgs_,
+                        size_t count_,
+                        void *s_,
+                        int flags_);
+int zmq_msg_recv_batch (zmq_msg_t *msgs_,
+                        size_t count_,
+                        void *s_,
+                        int flags_);
 
 /*  DRAFT Msg property names.                                                 */
 #define ZMQ_MSG_PROPERTY_ROUTING_ID "Routing-Id"
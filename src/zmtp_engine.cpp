@@ -301,6 +301,22 @@ bool zmq::zmtp_engine_t::handshake_v1_0 ()
     return true;
 }
 
+void zmq::zmtp_engine_t::create_v2_decoder ()
+{
+    v2_decoder_t *const decoder = new (std::nothrow)
+      v2_decoder_t (_options.in_batch_size, _options.maxmsgsize,
+                    _options.zero_copy, decoder_buffer_pool ());
+    alloc_assert (decoder);
+
+    //  The frames of the mechanisms with encryption are not the messages
+    //  the application receives, which are decrypted out of them.
+    if (_options.recv_allocator.alloc_fn
+        && (_options.mechanism == ZMQ_NULL || _options.mechanism == ZMQ_PLAIN))
+        decoder->set_recv_allocator (_options.recv_allocator,
+                                     _options.recv_allocator_threshold);
+    _decoder = decoder;
+}
+
 bool zmq::zmtp_engine_t::handshake_v2_0 ()
 {
     if (session ()->zap_enabled ()) {
@@ -312,9 +328,7 @@ bool zmq::zmtp_engine_t::handshake_v2_0 ()
     _encoder = new (std::nothrow) v2_encoder_t (_options.out_batch_size);
     alloc_assert (_encoder);
 
-    _decoder = new (std::nothrow) v2_decoder_t (
-      _options.in_batch_size, _options.maxmsgsize, _options.zero_copy);
-    alloc_assert (_decoder);
+    create_v2_decoder ();
 
     return true;
 }
@@ -389,9 +403,7 @@ bool zmq::zmtp_engine_t::handshake_v3_0 ()
     _encoder = new (std::nothrow) v2_encoder_t (_options.out_batch_size);
     alloc_assert (_encoder);
 
-    _decoder = new (std::nothrow) v2_decoder_t (
-      _options.in_batch_size, _options.maxmsgsize, _options.zero_copy);
-    alloc_assert (_decoder);
+    create_v2_decoder ();
 
     return zmq::zmtp_engine_t::handshake_v3_x (true);
 }
@@ -401,9 +413,7 @@ bool zmq::zmtp_engine_t::handshake_v3_1 ()
     _encoder = new (std::nothrow) v3_1_encoder_t (_options.out_batch_size);
     alloc_assert (_encoder);
 
-    _decoder = new (std::nothrow) v2_decoder_t (
-      _options.in_batch_size, _options.maxmsgsize, _options.zero_copy);
-    alloc_assert (_decoder);
+    create_v2_decoder ();
 
     return zmq::zmtp_engine_t::handshake_v3_x (false);
 }
@@ -62,6 +62,9 @@ class zmtp_engine_t ZMQ_FINAL : public stream_engine_base_t
                                                  unsigned char revision,
                                                  unsigned char minor);
 
+    //  Creates the decoder of ZMTP 2.0 and later.
+    void create_v2_decoder ();
+
     bool handshake_v1_0_unversioned ();
     bool handshake_v1_0 ();
     bool handshake_v2_0 ();
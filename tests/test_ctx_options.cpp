@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: MPL-2.0 */
 
+#include <string.h>
 #include <limits>
 #include "testutil.hpp"
 #include "testutil_unity.hpp"
@@ -178,6 +179,228 @@ void test_ctx_zero_copy ()
 #endif
 }
 
+void test_ctx_crypto_threads ()
+{
+#ifdef ZMQ_CRYPTO_THREADS
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS));
+    TEST_ASSERT_FAILURE_ERRNO (EINVAL,
+                               zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, -1));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, 2));
+    TEST_ASSERT_EQUAL_INT (2, zmq_ctx_get (ctx, ZMQ_CRYPTO_THREADS));
+
+    //  Mechanisms without cryptography don't use the crypto threads.
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    TEST_ASSERT_NOT_NULL (pull);
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pull, endpoint, sizeof endpoint);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    TEST_ASSERT_NOT_NULL (push);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, endpoint));
+    send_string_expect_success (push, "clear", 0);
+    recv_string_expect_success (pull, "clear", 0);
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (push));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (pull));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#endif
+}
+
+void test_ctx_crypto_threads_curve ()
+{
+#ifdef ZMQ_CRYPTO_THREADS
+    if (!zmq_has ("curve"))
+        TEST_IGNORE_MESSAGE ("libzmq without CURVE, ignoring test.");
+
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_CRYPTO_THREADS, 3));
+
+    char server_public[41], server_secret[41];
+    char client_public[41], client_secret[41];
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_curve_keypair (server_public, server_secret));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_curve_keypair (client_public, client_secret));
+
+    void *server = zmq_socket (ctx, ZMQ_PAIR);
+    TEST_ASSERT_NOT_NULL (server);
+    const int as_server = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      server, ZMQ_CURVE_SERVER, &as_server, sizeof as_server));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 41));
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (server, endpoint, sizeof endpoint);
+
+    void *client = zmq_socket (ctx, ZMQ_PAIR);
+    TEST_ASSERT_NOT_NULL (client);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (client, endpoint));
+
+    //  Both sides send before receiving, so that each engine seals and
+    //  opens messages at the same time, on several threads.
+    const int count = 500;
+    char buffer[4096];
+    void *const sockets[] = {client, server};
+    for (int i = 0; i < count; ++i)
+        for (int s = 0; s < 2; ++s) {
+            const int size = (i * 97 + s) % static_cast<int> (sizeof buffer);
+            memset (buffer, (i + s) & 0xff, size);
+            TEST_ASSERT_EQUAL_INT (size, TEST_ASSERT_SUCCESS_ERRNO (zmq_send (
+                                           sockets[s], buffer, size, 0)));
+        }
+    for (int i = 0; i < count; ++i)
+        for (int s = 0; s < 2; ++s) {
+            const int size = (i * 97 + s) % static_cast<int> (sizeof buffer);
+            TEST_ASSERT_EQUAL_INT (
+              size, TEST_ASSERT_SUCCESS_ERRNO (
+                      zmq_recv (sockets[1 - s], buffer, sizeof buffer, 0)));
+            for (int j = 0; j < size; ++j)
+                TEST_ASSERT_EQUAL_INT ((i + s) & 0xff, buffer[j] & 0xff);
+        }
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (client));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (server));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#endif
+}
+
+#ifdef ZMQ_PIPE_CHUNK_POOL_MAX
+//  Passes enough messages through a pipe for it to go through a few
+//  memory chunks.
+static void pass_messages (void *ctx_)
+{
+    void *pair[2];
+    for (int i = 0; i < 2; ++i) {
+        pair[i] = zmq_socket (ctx_, ZMQ_PAIR);
+        TEST_ASSERT_NOT_NULL (pair[i]);
+    }
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pair[0], "inproc://chunks"));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (pair[1], "inproc://chunks"));
+
+    const int count = 1500;
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < count; ++i)
+            send_string_expect_success (pair[1], "chunk", 0);
+        for (int i = 0; i < count; ++i)
+            recv_string_expect_success (pair[0], "chunk", 0);
+    }
+
+    for (int i = 0; i < 2; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_close (pair[i]));
+}
+#endif
+
+void test_ctx_pipe_chunk_pool ()
+{
+#ifdef ZMQ_PIPE_CHUNK_POOL_MAX
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_EQUAL_INT (64, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_POOL_MAX));
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNKS_CACHED));
+    TEST_ASSERT_FAILURE_ERRNO (EINVAL,
+                               zmq_ctx_set (ctx, ZMQ_PIPE_CHUNK_POOL_MAX, -1));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_PIPE_CHUNK_POOL_MAX, 8));
+    TEST_ASSERT_EQUAL_INT (8, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_POOL_MAX));
+
+    //  The chunks the pipe is done with are kept for the next ones.
+    pass_messages (ctx);
+    TEST_ASSERT_GREATER_THAN_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_MISSES));
+    TEST_ASSERT_GREATER_THAN_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_HITS));
+    TEST_ASSERT_GREATER_THAN_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNKS_CACHED));
+    TEST_ASSERT_LESS_OR_EQUAL_INT (8,
+                                   zmq_ctx_get (ctx, ZMQ_PIPE_CHUNKS_CACHED));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+
+    //  Without a pool, all the chunks go back to the heap.
+    ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_PIPE_CHUNK_POOL_MAX, 0));
+    pass_messages (ctx);
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_HITS));
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNKS_CACHED));
+    TEST_ASSERT_GREATER_THAN_INT (0, zmq_ctx_get (ctx, ZMQ_PIPE_CHUNK_DROPS));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#endif
+}
+
+//  Starting a context with the pool installs it in the whole process, so
+//  that is left to unittest_msg_pool.
+void test_ctx_msg_pool ()
+{
+#ifdef ZMQ_MSG_POOL
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    if (zmq_ctx_set (ctx, ZMQ_MSG_POOL, 1) == -1) {
+        TEST_ASSERT_EQUAL_INT (EINVAL, errno);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+        TEST_IGNORE_MESSAGE ("libzmq without message pool, ignoring test.");
+    }
+    TEST_ASSERT_EQUAL_INT (1, zmq_ctx_get (ctx, ZMQ_MSG_POOL));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_MSG_POOL, 0));
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_MSG_POOL));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#endif
+}
+
+void test_ctx_decoder_buffer_pool ()
+{
+#ifdef ZMQ_DECODER_BUFFER_HITS
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_EQUAL_INT (0, zmq_ctx_get (ctx, ZMQ_DECODER_BUFFER_HITS));
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    TEST_ASSERT_NOT_NULL (pull);
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pull, endpoint, sizeof endpoint);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    TEST_ASSERT_NOT_NULL (push);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, endpoint));
+
+    //  The messages are kept until the decoder has gone through several
+    //  buffers, which go back to the pool once the messages are closed.
+    const int count = 1000;
+    const size_t size = 100;
+    char data[size];
+    memset (data, 'd', size);
+    zmq_msg_t *msgs =
+      static_cast<zmq_msg_t *> (malloc (count * sizeof (zmq_msg_t)));
+    TEST_ASSERT_NOT_NULL (msgs);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < count; ++i)
+            TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                                   zmq_send (push, data, size, 0));
+        for (int i = 0; i < count; ++i) {
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msgs[i]));
+            TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                                   TEST_ASSERT_SUCCESS_ERRNO (
+                                     zmq_msg_recv (&msgs[i], pull, 0)));
+            TEST_ASSERT_EQUAL_MEMORY (data, zmq_msg_data (&msgs[i]), size);
+        }
+        for (int i = 0; i < count; ++i)
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msgs[i]));
+    }
+    free (msgs);
+
+    TEST_ASSERT_GREATER_THAN_INT (
+      0, zmq_ctx_get (ctx, ZMQ_DECODER_BUFFER_MISSES));
+    TEST_ASSERT_GREATER_THAN_INT (0,
+                                  zmq_ctx_get (ctx, ZMQ_DECODER_BUFFER_HITS));
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (push));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (pull));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#endif
+}
+
 void test_ctx_option_max_sockets ()
 {
     TEST_ASSERT_EQUAL_INT (ZMQ_MAX_SOCKETS_DFLT,
@@ -308,6 +531,11 @@ int ZMQ_CDECL main (void)
     RUN_TEST (test_ctx_option_ipv6_set);
     RUN_TEST (test_ctx_thread_opts);
     RUN_TEST (test_ctx_zero_copy);
+    RUN_TEST (test_ctx_crypto_threads);
+    RUN_TEST (test_ctx_crypto_threads_curve);
+    RUN_TEST (test_ctx_pipe_chunk_pool);
+    RUN_TEST (test_ctx_msg_pool);
+    RUN_TEST (test_ctx_decoder_buffer_pool);
     RUN_TEST (test_ctx_option_blocky);
     RUN_TEST (test_ctx_option_preferred_sizes);
     RUN_TEST (test_ctx_option_invalid);
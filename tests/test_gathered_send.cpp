@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+//  Body sizes around the size from which stream engines write bodies
+//  straight from the messages rather than copying them.
+static const size_t body_sizes[] = {0,    1,    33,   255,   256,
+                                    257,  1000, 8192, 100000};
+static const int body_count = sizeof body_sizes / sizeof body_sizes[0];
+static const int rounds = 20;
+
+static unsigned char pattern (int round_, size_t pos_)
+{
+    return static_cast<unsigned char> (round_ * 7 + pos_ * 13);
+}
+
+static void free_fn (void *data_, void *hint_)
+{
+    LIBZMQ_UNUSED (hint_);
+    free (data_);
+}
+
+static void send_triplet (void *socket_, int round_, size_t body_size_)
+{
+    //  Envelope and header are small and get copied.
+    send_string_expect_success (socket_, "envelope", ZMQ_SNDMORE);
+    char header[100];
+    memset (header, 'h', sizeof header);
+    TEST_ASSERT_EQUAL_INT (
+      static_cast<int> (sizeof header),
+      TEST_ASSERT_SUCCESS_ERRNO (
+        zmq_send (socket_, header, sizeof header, ZMQ_SNDMORE)));
+
+    //  Alternate bodies owned by the library and by the application.
+    zmq_msg_t msg;
+    if (round_ % 2) {
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init_size (&msg, body_size_));
+        unsigned char *data =
+          static_cast<unsigned char *> (zmq_msg_data (&msg));
+        for (size_t i = 0; i < body_size_; ++i)
+            data[i] = pattern (round_, i);
+    } else {
+        unsigned char *data =
+          static_cast<unsigned char *> (malloc (body_size_ ? body_size_ : 1));
+        TEST_ASSERT_NOT_NULL (data);
+        for (size_t i = 0; i < body_size_; ++i)
+            data[i] = pattern (round_, i);
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_msg_init_data (&msg, data, body_size_, free_fn, NULL));
+    }
+    TEST_ASSERT_EQUAL_INT (static_cast<int> (body_size_),
+                           zmq_msg_send (&msg, socket_, 0));
+}
+
+static void recv_triplet (void *socket_, int round_, size_t body_size_)
+{
+    recv_string_expect_success (socket_, "envelope", 0);
+
+    zmq_msg_t msg;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+    TEST_ASSERT_EQUAL_INT (100, zmq_msg_recv (&msg, socket_, 0));
+    TEST_ASSERT_TRUE (zmq_msg_more (&msg));
+
+    TEST_ASSERT_EQUAL_INT (static_cast<int> (body_size_),
+                           zmq_msg_recv (&msg, socket_, 0));
+    TEST_ASSERT_FALSE (zmq_msg_more (&msg));
+    const unsigned char *data =
+      static_cast<const unsigned char *> (zmq_msg_data (&msg));
+    for (size_t i = 0; i < body_size_; ++i)
+        if (data[i] != pattern (round_, i))
+            TEST_FAIL_MESSAGE ("corrupted body");
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+}
+
+static void test_send (void *pull_, const char *endpoint_, int out_batch_size_)
+{
+    void *push = test_context_socket (ZMQ_PUSH);
+    if (out_batch_size_)
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (push, ZMQ_OUT_BATCH_SIZE, &out_batch_size_,
+                          sizeof out_batch_size_));
+    //  A small send buffer makes writes partial.
+    const int sndbuf = 4096;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_SNDBUF, &sndbuf, sizeof sndbuf));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, endpoint_));
+
+    for (int round = 0; round < rounds; ++round)
+        for (int i = 0; i < body_count; ++i)
+            send_triplet (push, round, body_sizes[i]);
+
+    for (int round = 0; round < rounds; ++round)
+        for (int i = 0; i < body_count; ++i)
+            recv_triplet (pull_, round, body_sizes[i]);
+
+    test_context_socket_close (push);
+}
+
+static void test_transport (const char *transport_)
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+    char my_endpoint[MAX_SOCKET_STRING];
+    if (strcmp (transport_, "tcp") == 0)
+        bind_loopback_ipv4 (pull, my_endpoint, sizeof my_endpoint);
+    else
+        bind_loopback_ipc (pull, my_endpoint, sizeof my_endpoint);
+
+    test_send (pull, my_endpoint, 0);
+    test_send (pull, my_endpoint, 300);
+    test_send (pull, my_endpoint, 65536);
+
+    test_context_socket_close (pull);
+}
+
+void test_send_tcp ()
+{
+    test_transport ("tcp");
+}
+
+void test_send_ipc ()
+{
+#if defined(ZMQ_HAVE_IPC)
+    test_transport ("ipc");
+#else
+    TEST_IGNORE_MESSAGE ("ipc is not available");
+#endif
+}
+
+int ZMQ_CDECL main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_send_tcp);
+    RUN_TEST (test_send_ipc);
+    return UNITY_END ();
+}
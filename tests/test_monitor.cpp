@@ -379,6 +379,14 @@ void test_monitor_versioned_stats (bind_function_t bind_function_,
         TEST_ASSERT_NOT_NULL (queue_stat);
         TEST_ASSERT_EQUAL_INT (i == 0 ? 0 : send_hwm, queue_stat[0]);
         TEST_ASSERT_EQUAL_INT (0, queue_stat[1]);
+        //  The full queues hold at least the memory of the messages in them,
+        //  and the empty ones still hold a chunk.
+        if (i != 0)
+            TEST_ASSERT_GREATER_OR_EQUAL (send_hwm * sizeof (zmq_msg_t),
+                                          queue_stat[2]);
+        else
+            TEST_ASSERT_GREATER_THAN (0, queue_stat[2]);
+        TEST_ASSERT_GREATER_THAN (0, queue_stat[3]);
         free (push_local_address);
         free (push_remote_address);
         free (queue_stat);
@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+static const size_t batch_size = 16;
+
+static void init_batch (zmq_msg_t *msgs_, size_t count_)
+{
+    for (size_t i = 0; i < count_; ++i) {
+        char buf[16];
+        const int len = snprintf (buf, sizeof buf, "msg%d", (int) i);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init_buffer (&msgs_[i], buf, len));
+    }
+}
+
+static void close_batch (zmq_msg_t *msgs_, size_t count_)
+{
+    for (size_t i = 0; i < count_; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msgs_[i]));
+}
+
+static void expect_batch (zmq_msg_t *msgs_, size_t count_, bool multipart_)
+{
+    for (size_t i = 0; i < count_; ++i) {
+        char buf[16];
+        const int len = snprintf (buf, sizeof buf, "msg%d", (int) i);
+        TEST_ASSERT_EQUAL_INT (len, zmq_msg_size (&msgs_[i]));
+        TEST_ASSERT_EQUAL_STRING_LEN (buf, zmq_msg_data (&msgs_[i]), len);
+        TEST_ASSERT_EQUAL_INT (multipart_ && i != count_ - 1,
+                               zmq_msg_more (&msgs_[i]));
+    }
+}
+
+static void test_batch (const char *endpoint_, int flags_)
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+    char my_endpoint[MAX_SOCKET_STRING];
+    if (strcmp (endpoint_, "tcp") == 0)
+        bind_loopback_ipv4 (pull, my_endpoint, sizeof my_endpoint);
+    else {
+        strcpy (my_endpoint, endpoint_);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pull, my_endpoint));
+    }
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, my_endpoint));
+
+    zmq_msg_t msgs[batch_size];
+    init_batch (msgs, batch_size);
+    TEST_ASSERT_EQUAL_INT (
+      batch_size,
+      TEST_ASSERT_SUCCESS_ERRNO (
+        zmq_msg_send_batch (msgs, batch_size, push, flags_)));
+    close_batch (msgs, batch_size);
+
+    //  The receiver may get the batch in several chunks.
+    for (size_t i = 0; i < batch_size; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msgs[i]));
+    size_t received = 0;
+    while (received < batch_size) {
+        received += TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_recv_batch (
+          msgs + received, batch_size - received, pull, 0));
+    }
+    expect_batch (msgs, batch_size, (flags_ & ZMQ_SNDMORE) != 0);
+
+    int rcvmore;
+    size_t size = sizeof rcvmore;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pull, ZMQ_RCVMORE, &rcvmore, &size));
+    TEST_ASSERT_EQUAL_INT (0, rcvmore);
+    close_batch (msgs, batch_size);
+
+    test_context_socket_close_zero_linger (push);
+    test_context_socket_close_zero_linger (pull);
+}
+
+void test_batch_inproc ()
+{
+    test_batch ("inproc://batch", 0);
+}
+
+void test_batch_inproc_multipart ()
+{
+    test_batch ("inproc://batch", ZMQ_SNDMORE);
+}
+
+void test_batch_tcp ()
+{
+    test_batch ("tcp", 0);
+}
+
+void test_batch_hwm ()
+{
+    const int hwm = 4;
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pull, "inproc://batch_hwm"));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, "inproc://batch_hwm"));
+
+    //  Only as many messages as the combined HWMs allow are accepted.
+    zmq_msg_t msgs[batch_size];
+    init_batch (msgs, batch_size);
+    const int sent = TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_msg_send_batch (msgs, batch_size, push, ZMQ_DONTWAIT));
+    TEST_ASSERT_EQUAL_INT (2 * hwm, sent);
+    TEST_ASSERT_FAILURE_ERRNO (
+      EAGAIN,
+      zmq_msg_send_batch (msgs + sent, batch_size - sent, push, ZMQ_DONTWAIT));
+    close_batch (msgs, batch_size);
+
+    //  Nothing left to receive after draining.
+    for (size_t i = 0; i < batch_size; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msgs[i]));
+    int received = 0;
+    while (received < sent)
+        received += TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_msg_recv_batch (msgs, batch_size, pull, 0));
+    TEST_ASSERT_EQUAL_INT (sent, received);
+    TEST_ASSERT_FAILURE_ERRNO (
+      EAGAIN, zmq_msg_recv_batch (msgs, batch_size, pull, ZMQ_DONTWAIT));
+    close_batch (msgs, batch_size);
+
+    test_context_socket_close_zero_linger (push);
+    test_context_socket_close_zero_linger (pull);
+}
+
+//  A blocking batch send returns as soon as part of the batch is queued
+//  and only fails once nothing at all could be queued.
+void test_batch_partial_send ()
+{
+    const int hwm = 4;
+    const int timeout = 100;
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_SNDTIMEO, &timeout, sizeof timeout));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pull, "inproc://batch_partial"));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, "inproc://batch_partial"));
+
+    zmq_msg_t msgs[batch_size];
+    init_batch (msgs, batch_size);
+    const int sent = TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_msg_send_batch (msgs, batch_size, push, 0));
+    TEST_ASSERT_EQUAL_INT (2 * hwm, sent);
+
+    //  The messages that were not queued are left intact.
+    for (size_t i = 0; i < batch_size; ++i)
+        TEST_ASSERT_EQUAL_INT (i < (size_t) sent ? 0 : 4 + (i >= 10),
+                               zmq_msg_size (&msgs[i]));
+    TEST_ASSERT_FAILURE_ERRNO (
+      EAGAIN, zmq_msg_send_batch (msgs + sent, batch_size - sent, push, 0));
+    TEST_ASSERT_EQUAL_INT (4, zmq_msg_size (&msgs[sent]));
+
+    //  Once the receiver makes room the rest of the batch goes through.
+    zmq_msg_t received[batch_size];
+    for (size_t i = 0; i < batch_size; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&received[i]));
+    int count = 0;
+    int queued = sent;
+    while (count < (int) batch_size) {
+        count += TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_recv_batch (
+          received + count, batch_size - count, pull, 0));
+        if (queued < (int) batch_size)
+            queued += TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_send_batch (
+              msgs + queued, batch_size - queued, push, 0));
+    }
+    expect_batch (received, batch_size, false);
+    close_batch (received, batch_size);
+    close_batch (msgs, batch_size);
+
+    test_context_socket_close_zero_linger (push);
+    test_context_socket_close_zero_linger (pull);
+}
+
+//  Messages from several peers are all received, multi-part messages are
+//  not interleaved.
+void test_batch_recv_many_pipes ()
+{
+    const int peers = 4;
+    void *pull = test_context_socket (ZMQ_PULL);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pull, "inproc://batch_many"));
+    void *push[peers];
+    zmq_msg_t msgs[batch_size];
+    for (int i = 0; i < peers; ++i) {
+        push[i] = test_context_socket (ZMQ_PUSH);
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_connect (push[i], "inproc://batch_many"));
+        init_batch (msgs, batch_size);
+        TEST_ASSERT_EQUAL_INT (batch_size,
+                               TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_send_batch (
+                                 msgs, batch_size, push[i], ZMQ_SNDMORE)));
+        close_batch (msgs, batch_size);
+    }
+
+    //  Receive in batches that don't line up with the messages.
+    for (size_t i = 0; i < batch_size; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msgs[i]));
+    const size_t chunk = 5;
+    size_t part = 0;
+    for (int total = 0; total < peers * (int) batch_size;) {
+        const int rc = TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_msg_recv_batch (msgs, chunk, pull, 0));
+        for (int i = 0; i < rc; ++i) {
+            char buf[16];
+            const int len = snprintf (buf, sizeof buf, "msg%d", (int) part);
+            TEST_ASSERT_EQUAL_STRING_LEN (buf, zmq_msg_data (&msgs[i]), len);
+            TEST_ASSERT_EQUAL_INT (part != batch_size - 1,
+                                   zmq_msg_more (&msgs[i]));
+            part = (part + 1) % batch_size;
+        }
+        total += rc;
+    }
+    TEST_ASSERT_EQUAL_INT (0, part);
+    TEST_ASSERT_FAILURE_ERRNO (
+      EAGAIN, zmq_msg_recv_batch (msgs, chunk, pull, ZMQ_DONTWAIT));
+    close_batch (msgs, batch_size);
+
+    for (int i = 0; i < peers; ++i)
+        test_context_socket_close_zero_linger (push[i]);
+    test_context_socket_close_zero_linger (pull);
+}
+
+void test_batch_invalid ()
+{
+    void *push = test_context_socket (ZMQ_PUSH);
+    zmq_msg_t msg;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+    TEST_ASSERT_FAILURE_ERRNO (EINVAL, zmq_msg_send_batch (&msg, 0, push, 0));
+    TEST_ASSERT_FAILURE_ERRNO (EINVAL, zmq_msg_recv_batch (NULL, 1, push, 0));
+    TEST_ASSERT_FAILURE_ERRNO (ENOTSUP, zmq_msg_recv_batch (&msg, 1, push, 0));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+    test_context_socket_close (push);
+}
+
+int ZMQ_CDECL main (void)
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_batch_inproc);
+    RUN_TEST (test_batch_inproc_multipart);
+    RUN_TEST (test_batch_tcp);
+    RUN_TEST (test_batch_hwm);
+    RUN_TEST (test_batch_partial_send);
+    RUN_TEST (test_batch_recv_many_pipes);
+    RUN_TEST (test_batch_invalid);
+    return UNITY_END ();
+}
@@ -3,6 +3,8 @@
 #include "testutil.hpp"
 #include "testutil_unity.hpp"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 SETUP_TEARDOWN_TESTCONTEXT
@@ -83,11 +85,213 @@ void test ()
     test_context_socket_close (sub2);
 }
 
+static void many_subscribers (int shards_)
+{
+    //  Enough subscribers for the matching pipes to span more than one word
+    //  of the distributor's bitmap.
+    const int subscriber_count = 100;
+    void *subs[subscriber_count];
+
+    void *pub = test_context_socket (ZMQ_XPUB);
+    int verbose = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose)));
+#ifdef ZMQ_XPUB_FANOUT_SHARDS
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards_, sizeof (shards_)));
+#else
+    TEST_ASSERT_EQUAL_INT (1, shards_);
+#endif
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pub, "inproc://many"));
+
+    for (int i = 0; i < subscriber_count; ++i) {
+        subs[i] = test_context_socket (ZMQ_SUB);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (subs[i], "inproc://many"));
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (subs[i], ZMQ_SUBSCRIBE, i % 3 ? "A" : "B", 1));
+    }
+    char buffer[8];
+    for (int i = 0; i < subscriber_count; ++i)
+        TEST_ASSERT_EQUAL_INT (
+          2, TEST_ASSERT_SUCCESS_ERRNO (zmq_recv (pub, buffer, 8, 0)));
+
+    send_string_expect_success (pub, "A", 0);
+    for (int i = 0; i < subscriber_count; ++i) {
+        if (i % 3) {
+            recv_string_expect_success (subs[i], "A", 0);
+        } else {
+            TEST_ASSERT_FAILURE_ERRNO (
+              EAGAIN, zmq_recv (subs[i], NULL, 0, ZMQ_DONTWAIT));
+        }
+    }
+
+    //  Now invert the matching on both sides.
+    int invert = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_INVERT_MATCHING, &invert, sizeof (invert)));
+    for (int i = 0; i < subscriber_count; ++i)
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+          subs[i], ZMQ_INVERT_MATCHING, &invert, sizeof (invert)));
+
+    send_string_expect_success (pub, "A", 0);
+    for (int i = 0; i < subscriber_count; ++i) {
+        if (i % 3) {
+            TEST_ASSERT_FAILURE_ERRNO (
+              EAGAIN, zmq_recv (subs[i], NULL, 0, ZMQ_DONTWAIT));
+        } else {
+            recv_string_expect_success (subs[i], "A", 0);
+        }
+    }
+
+    //  Clean up.
+    test_context_socket_close (pub);
+    for (int i = 0; i < subscriber_count; ++i)
+        test_context_socket_close (subs[i]);
+}
+
+void test_many_subscribers ()
+{
+    many_subscribers (1);
+}
+
+#ifdef ZMQ_XPUB_FANOUT_SHARDS
+void test_many_subscribers_sharded ()
+{
+    //  There are enough subscribers for the fan-out threads to write
+    //  the shards, whichever third or two thirds of them match.
+    many_subscribers (4);
+}
+
+void test_sharded_order ()
+{
+    //  Two publishers share the fan-out threads of the context. Each
+    //  subscriber still gets the messages of each publisher in order,
+    //  multi-part messages whole.
+    const int subscriber_count = 70;
+    const int message_count = 200;
+    void *pubs[2];
+    void *subs[subscriber_count];
+    char endpoint[32];
+
+    for (int p = 0; p < 2; ++p) {
+        pubs[p] = test_context_socket (ZMQ_XPUB);
+        int shards = 3 + p;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+          pubs[p], ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+        int verbose = 1;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+          pubs[p], ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose)));
+        int hwm = 0;
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (pubs[p], ZMQ_SNDHWM, &hwm, sizeof (hwm)));
+        snprintf (endpoint, sizeof endpoint, "inproc://order%d", p);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pubs[p], endpoint));
+    }
+    for (int i = 0; i < subscriber_count; ++i) {
+        subs[i] = test_context_socket (ZMQ_SUB);
+        int hwm = 0;
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (subs[i], ZMQ_RCVHWM, &hwm, sizeof (hwm)));
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (subs[i], ZMQ_SUBSCRIBE, "", 0));
+        for (int p = 0; p < 2; ++p) {
+            snprintf (endpoint, sizeof endpoint, "inproc://order%d", p);
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (subs[i], endpoint));
+        }
+    }
+    char buffer[16];
+    for (int p = 0; p < 2; ++p)
+        for (int i = 0; i < subscriber_count; ++i)
+            TEST_ASSERT_EQUAL_INT (1, TEST_ASSERT_SUCCESS_ERRNO (
+                                        zmq_recv (pubs[p], buffer, 16, 0)));
+
+    for (int n = 0; n < message_count; ++n)
+        for (int p = 0; p < 2; ++p) {
+            snprintf (buffer, sizeof buffer, "%d", n);
+            send_string_expect_success (pubs[p], buffer, ZMQ_SNDMORE);
+            send_string_expect_success (pubs[p], p ? "B" : "A", 0);
+        }
+
+    for (int i = 0; i < subscriber_count; ++i) {
+        int next[2] = {0, 0};
+        for (int n = 0; n < 2 * message_count; ++n) {
+            const int size = TEST_ASSERT_SUCCESS_ERRNO (
+              zmq_recv (subs[i], buffer, sizeof buffer - 1, 0));
+            buffer[size] = 0;
+            const int seq = atoi (buffer);
+            int more;
+            size_t more_size = sizeof (more);
+            TEST_ASSERT_SUCCESS_ERRNO (
+              zmq_getsockopt (subs[i], ZMQ_RCVMORE, &more, &more_size));
+            TEST_ASSERT_TRUE (more);
+            TEST_ASSERT_EQUAL_INT (1, TEST_ASSERT_SUCCESS_ERRNO (
+                                        zmq_recv (subs[i], buffer, 16, 0)));
+            const int p = buffer[0] == 'B';
+            TEST_ASSERT_EQUAL_INT (next[p], seq);
+            next[p]++;
+        }
+    }
+
+    for (int p = 0; p < 2; ++p)
+        test_context_socket_close (pubs[p]);
+    for (int i = 0; i < subscriber_count; ++i)
+        test_context_socket_close (subs[i]);
+}
+
+void test_fanout_shards_option ()
+{
+    void *pub = test_context_socket (ZMQ_PUB);
+    int shards;
+    size_t size = sizeof (shards);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, &size));
+    TEST_ASSERT_EQUAL_INT (1, shards);
+
+    shards = 0;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL,
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+
+    //  Each shard but one takes a thread of the context, so there's a cap.
+    shards = 65;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL,
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+    shards = 64;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, &size));
+    TEST_ASSERT_EQUAL_INT (64, shards);
+
+    shards = 3;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+    shards = 0;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, &size));
+    TEST_ASSERT_EQUAL_INT (3, shards);
+
+    //  Going back to a single shard writes all pipes in the calling thread.
+    shards = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pub, ZMQ_XPUB_FANOUT_SHARDS, &shards, sizeof (shards)));
+
+    test_context_socket_close (pub);
+}
+#endif
+
 int ZMQ_CDECL main ()
 {
     setup_test_environment ();
 
     UNITY_BEGIN ();
     RUN_TEST (test);
+    RUN_TEST (test_many_subscribers);
+#ifdef ZMQ_XPUB_FANOUT_SHARDS
+    RUN_TEST (test_many_subscribers_sharded);
+    RUN_TEST (test_sharded_order);
+    RUN_TEST (test_fanout_shards_option);
+#endif
     return UNITY_END ();
 }
@@ -377,6 +377,97 @@ void test_tcp ()
     test ("tcp://localhost:6213");
 }
 
+static void send_filled (void *socket_, size_t size_, int fill_, int flags_)
+{
+    zmq_msg_t msg;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init_size (&msg, size_));
+    memset (zmq_msg_data (&msg), fill_, size_);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_send (&msg, socket_, flags_));
+}
+
+static void recv_filled (void *socket_, size_t size_, int fill_, bool more_)
+{
+    zmq_msg_t msg;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_recv (&msg, socket_, 0));
+    TEST_ASSERT_EQUAL_UINT (size_, zmq_msg_size (&msg));
+    const unsigned char *data =
+      static_cast<const unsigned char *> (zmq_msg_data (&msg));
+    for (size_t i = 0; i < size_; i++)
+        TEST_ASSERT_EQUAL_UINT8 (fill_, data[i]);
+    TEST_ASSERT_EQUAL_INT (more_, zmq_msg_more (&msg));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+}
+
+void test_tcp_shared_frames ()
+{
+    //  Large messages are sent to all the subscribers with one frame header
+    //  encoded by the publisher. Messages forwarded with other flags than
+    //  they were first sent with must not go out with the old header.
+    const int subscriber_count = 4;
+    const size_t sizes[] = {100, 300, 20000};
+    const int size_count = sizeof (sizes) / sizeof (sizes[0]);
+
+    char my_endpoint[MAX_SOCKET_STRING];
+    void *publisher = test_context_socket (ZMQ_PUB);
+    bind_loopback_ipv4 (publisher, my_endpoint, sizeof (my_endpoint));
+
+    void *subscribers[subscriber_count];
+    for (int i = 0; i < subscriber_count; i++) {
+        subscribers[i] = test_context_socket (ZMQ_SUB);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (subscribers[i], my_endpoint));
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (subscribers[i], ZMQ_SUBSCRIBE, "", 0));
+    }
+
+    //  An inproc subscriber receiving the messages as they were sent.
+    void *inproc_publisher = test_context_socket (ZMQ_PUB);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (inproc_publisher, "inproc://frames"));
+    void *forwarder = test_context_socket (ZMQ_SUB);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (forwarder, "inproc://frames"));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (forwarder, ZMQ_SUBSCRIBE, "", 0));
+    msleep (SETTLE_TIME);
+
+    //  Multipart messages, the last part flagged differently.
+    for (int i = 0; i < size_count; i++) {
+        send_filled (publisher, sizes[i], i + 1, ZMQ_SNDMORE);
+        send_filled (publisher, sizes[i], i + 11, 0);
+        send_filled (inproc_publisher, sizes[i], i + 21, ZMQ_SNDMORE);
+        send_filled (inproc_publisher, sizes[i], i + 31, 0);
+    }
+
+    //  Forward the parts received over inproc with their flags swapped.
+    for (int i = 0; i < size_count; i++) {
+        zmq_msg_t first;
+        zmq_msg_t second;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&first));
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&second));
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_recv (&first, forwarder, 0));
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_recv (&second, forwarder, 0));
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_msg_send (&second, publisher, ZMQ_SNDMORE));
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_send (&first, publisher, 0));
+    }
+
+    for (int s = 0; s < subscriber_count; s++) {
+        for (int i = 0; i < size_count; i++) {
+            recv_filled (subscribers[s], sizes[i], i + 1, true);
+            recv_filled (subscribers[s], sizes[i], i + 11, false);
+        }
+        for (int i = 0; i < size_count; i++) {
+            recv_filled (subscribers[s], sizes[i], i + 31, true);
+            recv_filled (subscribers[s], sizes[i], i + 21, false);
+        }
+    }
+
+    test_context_socket_close (inproc_publisher);
+    test_context_socket_close (forwarder);
+    for (int i = 0; i < subscriber_count; i++)
+        test_context_socket_close (subscribers[i]);
+    test_context_socket_close (publisher);
+}
+
 void test_ipc ()
 {
 #if defined ZMQ_HAVE_IPC
@@ -493,6 +584,7 @@ int ZMQ_CDECL main ()
 
     RUN_TEST (test_inproc);
     RUN_TEST (test_tcp);
+    RUN_TEST (test_tcp_shared_frames);
 
     RUN_TEST (test_ipc);
 
@@ -255,6 +255,82 @@ void test_radio_dish_udp (int ipv6_)
 }
 MAKE_TEST_V4V6 (test_radio_dish_udp)
 
+void test_udp_batch_size_option ()
+{
+    void *dish = test_context_socket (ZMQ_DISH);
+
+    int value;
+    size_t size = sizeof value;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (dish, ZMQ_UDP_BATCH_SIZE, &value, &size));
+    TEST_ASSERT_EQUAL_INT (1, value);
+
+    value = 0;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (dish, ZMQ_UDP_BATCH_SIZE, &value, sizeof value));
+    value = 1025;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (dish, ZMQ_UDP_BATCH_SIZE, &value, sizeof value));
+
+    value = 16;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (dish, ZMQ_UDP_BATCH_SIZE, &value, sizeof value));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (dish, ZMQ_UDP_BATCH_SIZE, &value, &size));
+    TEST_ASSERT_EQUAL_INT (16, value);
+
+    test_context_socket_close (dish);
+}
+
+void test_radio_dish_udp_batch (int ipv6_)
+{
+    void *radio = test_context_socket (ZMQ_RADIO);
+    void *dish = test_context_socket (ZMQ_DISH);
+
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (radio, ZMQ_IPV6, &ipv6_, sizeof (int)));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (dish, ZMQ_IPV6, &ipv6_, sizeof (int)));
+
+    const int batch_size = 16;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (radio, ZMQ_UDP_BATCH_SIZE,
+                                               &batch_size, sizeof (int)));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (dish, ZMQ_UDP_BATCH_SIZE, &batch_size, sizeof (int)));
+
+    //  A pipe smaller than a batch makes the engine hold datagrams back.
+    const int hwm = 5;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (dish, ZMQ_RCVHWM, &hwm, sizeof (int)));
+
+    const char *radio_url = ipv6_ ? "udp://[::1]:5556" : "udp://127.0.0.1:5556";
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (dish, "udp://*:5556"));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (radio, radio_url));
+
+    msleep (SETTLE_TIME);
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_join (dish, "TV"));
+
+    const int count = 100;
+    char body[16];
+    for (int i = 0; i < count; i++) {
+        snprintf (body, sizeof body, "Episode %d", i);
+        msg_send_expect_success (radio, "TV", body);
+    }
+
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i < count; i++) {
+        snprintf (body, sizeof body, "Episode %d", i);
+        msg_recv_cmp (dish, "TV", body);
+    }
+
+    test_context_socket_close (dish);
+    test_context_socket_close (radio);
+}
+MAKE_TEST_V4V6 (test_radio_dish_udp_batch)
+
 //
 // Use "private experiment" multicast addresses
 //
@@ -531,6 +607,9 @@ int ZMQ_CDECL main (void)
     RUN_TEST (test_radio_dish_tcp_poll_ipv6);
     RUN_TEST (test_radio_dish_udp_ipv4);
     RUN_TEST (test_radio_dish_udp_ipv6);
+    RUN_TEST (test_udp_batch_size_option);
+    RUN_TEST (test_radio_dish_udp_batch_ipv4);
+    RUN_TEST (test_radio_dish_udp_batch_ipv6);
 
     RUN_TEST (test_radio_dish_mcast_ipv4);
     RUN_TEST (test_radio_dish_no_loop_ipv4);
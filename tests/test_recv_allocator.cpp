@@ -0,0 +1,282 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+static const int threshold = 64 * 1024;
+static const size_t large_size = 1024 * 1024;
+static const int message_count = 8;
+
+//  The allocator runs in the I/O thread, the free function in the thread
+//  closing the message. The counters are only read once both are done.
+static int allocated;
+static int freed;
+static void *allocations[message_count];
+
+static void *alloc_fn (size_t size_, void *hint_)
+{
+    //  Declining makes the checks of the test fail.
+    if (hint_ != &allocated)
+        return NULL;
+    void *const data = malloc (size_);
+    allocations[allocated++] = data;
+    return data;
+}
+
+static void free_fn (void *data_, void *hint_)
+{
+    TEST_ASSERT_EQUAL_PTR (&allocated, hint_);
+    free (data_);
+    ++freed;
+}
+
+static unsigned char registered[large_size];
+
+static void *registered_fn (size_t size_, void *hint_)
+{
+    LIBZMQ_UNUSED (hint_);
+    return size_ <= sizeof registered ? registered : NULL;
+}
+
+void test_option ()
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+
+    zmq_recv_allocator_t allocator;
+    memset (&allocator, 1, sizeof allocator);
+    size_t size = sizeof allocator;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, &size));
+    TEST_ASSERT_NULL (allocator.alloc_fn);
+    TEST_ASSERT_NULL (allocator.free_fn);
+
+    allocator.alloc_fn = alloc_fn;
+    allocator.free_fn = free_fn;
+    allocator.hint = &allocated;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, sizeof allocator));
+    memset (&allocator, 0, sizeof allocator);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, &size));
+    TEST_ASSERT_EQUAL_PTR (alloc_fn, allocator.alloc_fn);
+    TEST_ASSERT_EQUAL_PTR (free_fn, allocator.free_fn);
+    TEST_ASSERT_EQUAL_PTR (&allocated, allocator.hint);
+
+    //  A free function alone makes no sense.
+    allocator.alloc_fn = NULL;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL,
+      zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, sizeof allocator));
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, 1));
+
+    int value = -1;
+    size = sizeof value;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &value, &size));
+    TEST_ASSERT_EQUAL_INT (0, value);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &threshold, sizeof threshold));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &value, &size));
+    TEST_ASSERT_EQUAL_INT (threshold, value);
+    value = -1;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &value,
+                              sizeof value));
+
+    test_context_socket_close (pull);
+}
+
+static void bind_and_connect (void *pull_, void *push_)
+{
+    char my_endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pull_, my_endpoint, sizeof my_endpoint);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push_, my_endpoint));
+}
+
+void test_recv_into_allocator ()
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+
+    zmq_recv_allocator_t allocator = {alloc_fn, free_fn, &allocated};
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, sizeof allocator));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &threshold, sizeof threshold));
+    bind_and_connect (pull, push);
+
+    //  Alternate messages above and below the threshold.
+    unsigned char *data = static_cast<unsigned char *> (malloc (large_size));
+    TEST_ASSERT_NOT_NULL (data);
+    allocated = 0;
+    freed = 0;
+    for (int i = 0; i < message_count; ++i) {
+        const size_t size = i % 2 ? 1000 : large_size;
+        memset (data, 'a' + i, size);
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                               zmq_send (push, data, size, 0));
+    }
+
+    for (int i = 0; i < message_count; ++i) {
+        const size_t size = i % 2 ? 1000 : large_size;
+        zmq_msg_t msg;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                               zmq_msg_recv (&msg, pull, 0));
+        memset (data, 'a' + i, size);
+        TEST_ASSERT_EQUAL_MEMORY (data, zmq_msg_data (&msg), size);
+        if (size == large_size)
+            TEST_ASSERT_EQUAL_PTR (allocations[i / 2], zmq_msg_data (&msg));
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+    }
+    free (data);
+
+    TEST_ASSERT_EQUAL_INT (message_count / 2, allocated);
+    TEST_ASSERT_EQUAL_INT (message_count / 2, freed);
+
+    test_context_socket_close (push);
+    test_context_socket_close (pull);
+}
+
+void test_recv_into_registered_buffer ()
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+
+    //  Without a free function the memory stays the application's.
+    zmq_recv_allocator_t allocator = {registered_fn, NULL, NULL};
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_RECV_ALLOCATOR, &allocator, sizeof allocator));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      pull, ZMQ_RECV_ALLOCATOR_THRESHOLD, &threshold, sizeof threshold));
+    bind_and_connect (pull, push);
+
+    //  The allocator declines the second message, which is too large.
+    const size_t sizes[] = {large_size, 2 * large_size};
+    unsigned char *data = static_cast<unsigned char *> (malloc (sizes[1]));
+    TEST_ASSERT_NOT_NULL (data);
+    for (int i = 0; i < 2; ++i) {
+        memset (data, 'r' + i, sizes[i]);
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (sizes[i]),
+                               zmq_send (push, data, sizes[i], 0));
+
+        zmq_msg_t msg;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (sizes[i]),
+                               zmq_msg_recv (&msg, pull, 0));
+        if (i == 0)
+            TEST_ASSERT_EQUAL_PTR (registered, zmq_msg_data (&msg));
+        else
+            TEST_ASSERT_TRUE (zmq_msg_data (&msg) != registered);
+        TEST_ASSERT_EQUAL_MEMORY (data, zmq_msg_data (&msg), sizes[i]);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+    }
+    free (data);
+
+    test_context_socket_close (push);
+    test_context_socket_close (pull);
+}
+
+static void set_allocator (void *socket_, int threshold_)
+{
+    zmq_recv_allocator_t allocator = {alloc_fn, free_fn, &allocated};
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      socket_, ZMQ_RECV_ALLOCATOR, &allocator, sizeof allocator));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      socket_, ZMQ_RECV_ALLOCATOR_THRESHOLD, &threshold_, sizeof threshold_));
+}
+
+void test_commands_not_allocated ()
+{
+    void *xpub = test_context_socket (ZMQ_XPUB);
+    void *sub = test_context_socket (ZMQ_SUB);
+    set_allocator (xpub, 0);
+    char my_endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (xpub, my_endpoint, sizeof my_endpoint);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sub, my_endpoint));
+
+    //  Subscriptions travel as commands, large enough for the allocator.
+    allocated = 0;
+    char topic[100];
+    memset (topic, 't', sizeof topic);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (sub, ZMQ_SUBSCRIBE, topic, sizeof topic));
+    char subscription[1 + sizeof topic];
+    TEST_ASSERT_EQUAL_INT (
+      static_cast<int> (sizeof subscription),
+      zmq_recv (xpub, subscription, sizeof subscription, 0));
+    TEST_ASSERT_EQUAL_INT (1, subscription[0]);
+    TEST_ASSERT_EQUAL_MEMORY (topic, subscription + 1, sizeof topic);
+    TEST_ASSERT_EQUAL_INT (0, allocated);
+
+    test_context_socket_close (sub);
+    test_context_socket_close (xpub);
+}
+
+void test_curve_not_allocated ()
+{
+    if (!zmq_has ("curve"))
+        TEST_IGNORE_MESSAGE ("libzmq without CURVE, ignoring test.");
+
+    char server_public[41], server_secret[41];
+    char client_public[41], client_secret[41];
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_curve_keypair (server_public, server_secret));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_curve_keypair (client_public, client_secret));
+
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+    set_allocator (pull, threshold);
+    const int as_server = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_CURVE_SERVER, &as_server, sizeof as_server));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (pull, ZMQ_CURVE_SECRETKEY, server_secret, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_CURVE_SERVERKEY, server_public, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_CURVE_PUBLICKEY, client_public, 41));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (push, ZMQ_CURVE_SECRETKEY, client_secret, 41));
+    bind_and_connect (pull, push);
+
+    //  The frames hold the encrypted message, not the one received.
+    allocated = 0;
+    unsigned char *data = static_cast<unsigned char *> (malloc (large_size));
+    TEST_ASSERT_NOT_NULL (data);
+    memset (data, 'c', large_size);
+    TEST_ASSERT_EQUAL_INT (static_cast<int> (large_size),
+                           zmq_send (push, data, large_size, 0));
+    zmq_msg_t msg;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+    TEST_ASSERT_EQUAL_INT (static_cast<int> (large_size),
+                           zmq_msg_recv (&msg, pull, 0));
+    TEST_ASSERT_EQUAL_MEMORY (data, zmq_msg_data (&msg), large_size);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+    free (data);
+    TEST_ASSERT_EQUAL_INT (0, allocated);
+
+    test_context_socket_close (push);
+    test_context_socket_close (pull);
+}
+
+int ZMQ_CDECL main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_option);
+    RUN_TEST (test_recv_into_allocator);
+    RUN_TEST (test_recv_into_registered_buffer);
+    RUN_TEST (test_commands_not_allocated);
+    RUN_TEST (test_curve_not_allocated);
+    return UNITY_END ();
+}
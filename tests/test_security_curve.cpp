@@ -125,6 +125,51 @@ void test_curve_security_with_valid_credentials ()
     test_context_socket_close (client_mon);
 }
 
+static void send_messages_in_order (void *from_, void *to_)
+{
+    const int count = 1000;
+    char buffer[2048];
+    for (int i = 0; i < count; ++i) {
+        const int size = (i * 97) % static_cast<int> (sizeof (buffer));
+        memset (buffer, i & 0xff, size);
+        TEST_ASSERT_EQUAL_INT (size,
+                               TEST_ASSERT_SUCCESS_ERRNO (
+                                 zmq_send (from_, buffer, size, 0)));
+    }
+    for (int i = 0; i < count; ++i) {
+        const int size = (i * 97) % static_cast<int> (sizeof (buffer));
+        TEST_ASSERT_EQUAL_INT (size,
+                               TEST_ASSERT_SUCCESS_ERRNO (
+                                 zmq_recv (to_, buffer, sizeof (buffer), 0)));
+        for (int j = 0; j < size; ++j)
+            TEST_ASSERT_EQUAL_INT (i & 0xff, buffer[j] & 0xff);
+    }
+}
+
+//  Messages sealed and opened by the crypto threads keep their order, in
+//  both directions, along with the heartbeats in between.
+void test_curve_security_with_crypto_threads ()
+{
+    curve_client_data_t curve_client_data = {
+      valid_server_public, valid_client_public, valid_client_secret};
+    void *client = test_context_socket (ZMQ_DEALER);
+    socket_config_curve_client (client, &curve_client_data);
+    const int heartbeat_ivl = 10;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      client, ZMQ_HEARTBEAT_IVL, &heartbeat_ivl, sizeof (heartbeat_ivl)));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (client, my_endpoint));
+
+    bounce (server, client);
+    send_messages_in_order (client, server);
+    msleep (5 * heartbeat_ivl);
+    send_messages_in_order (server, client);
+    bounce (server, client);
+    test_context_socket_close (client);
+
+    int event = get_monitor_event_with_timeout (server_mon, NULL, NULL, -1);
+    assert (event == ZMQ_EVENT_HANDSHAKE_SUCCEEDED);
+}
+
 void test_curve_security_with_bogus_client_credentials ()
 {
     //  This must be caught by the ZAP handler
@@ -567,6 +612,20 @@ int ZMQ_CDECL main (void)
     shutdown_context_and_server_side (zap_thread, server, server_mon, handler);
     teardown_test_context ();
 
+#ifdef ZMQ_CRYPTO_THREADS
+    //  the same with the cryptography running on crypto threads
+    fprintf (stderr, "test_curve_security_with_crypto_threads\n");
+    setup_test_context ();
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_ctx_set (get_test_context (), ZMQ_CRYPTO_THREADS, 2));
+    setup_context_and_server_side (&handler, &zap_thread, &server, &server_mon,
+                                   my_endpoint);
+    test_curve_security_with_valid_credentials ();
+    test_curve_security_with_crypto_threads ();
+    shutdown_context_and_server_side (zap_thread, server, server_mon, handler);
+    teardown_test_context ();
+#endif
+
 #ifdef ZMQ_ACT_MILITANT
     fprintf (stderr, "libzmq with ZMQ_ACT_MILITANT, ignoring "
                      "test_curve_security_invalid_keysize as the test "
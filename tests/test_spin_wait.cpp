@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+static uint64_t get_count (void *socket_, int option_)
+{
+    uint64_t count = 0;
+    size_t size = sizeof count;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (socket_, option_, &count, &size));
+    TEST_ASSERT_EQUAL_UINT (sizeof count, size);
+    return count;
+}
+
+static void set_spin_wait (void *socket_, int spin_wait_)
+{
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (socket_, ZMQ_SPIN_WAIT, &spin_wait_, sizeof spin_wait_));
+}
+
+void test_option ()
+{
+    void *socket = test_context_socket (ZMQ_PAIR);
+
+    int value = -1;
+    size_t size = sizeof value;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (socket, ZMQ_SPIN_WAIT, &value, &size));
+    TEST_ASSERT_EQUAL_INT (0, value);
+
+    set_spin_wait (socket, 50);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (socket, ZMQ_SPIN_WAIT, &value, &size));
+    TEST_ASSERT_EQUAL_INT (50, value);
+
+    value = -1;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (socket, ZMQ_SPIN_WAIT, &value, sizeof value));
+
+    TEST_ASSERT_EQUAL_UINT64 (0, get_count (socket, ZMQ_SPIN_WAIT_HITS));
+    TEST_ASSERT_EQUAL_UINT64 (0, get_count (socket, ZMQ_SPIN_WAIT_MISSES));
+
+    test_context_socket_close (socket);
+}
+
+static void send_later (void *socket_)
+{
+    msleep (SETTLE_TIME / 4);
+    send_string_expect_success (socket_, "spin", 0);
+}
+
+void test_spin_hit ()
+{
+    void *receiver = test_context_socket (ZMQ_PAIR);
+    void *sender = test_context_socket (ZMQ_PAIR);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (receiver, "inproc://spin-hit"));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sender, "inproc://spin-hit"));
+
+    //  Spin long enough for the message sent in the meantime.
+    set_spin_wait (receiver, 10 * 1000 * 1000);
+
+    void *thread = zmq_threadstart (send_later, sender);
+    recv_string_expect_success (receiver, "spin", 0);
+    zmq_threadclose (thread);
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64 (
+      1, get_count (receiver, ZMQ_SPIN_WAIT_HITS));
+
+    //  The signal left pending by the spin doesn't show as a message.
+    char buffer[8];
+    TEST_ASSERT_FAILURE_ERRNO (
+      EAGAIN, zmq_recv (receiver, buffer, sizeof buffer, ZMQ_DONTWAIT));
+    send_string_expect_success (sender, "again", 0);
+    recv_string_expect_success (receiver, "again", 0);
+
+    test_context_socket_close (sender);
+    test_context_socket_close (receiver);
+}
+
+void test_spin_miss ()
+{
+    void *receiver = test_context_socket (ZMQ_PAIR);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (receiver, "inproc://spin-miss"));
+
+    set_spin_wait (receiver, 1000);
+    const int timeout = 50;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (receiver, ZMQ_RCVTIMEO, &timeout, sizeof timeout));
+
+    char buffer[8];
+    TEST_ASSERT_FAILURE_ERRNO (EAGAIN,
+                               zmq_recv (receiver, buffer, sizeof buffer, 0));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64 (
+      1, get_count (receiver, ZMQ_SPIN_WAIT_MISSES));
+    TEST_ASSERT_EQUAL_UINT64 (0, get_count (receiver, ZMQ_SPIN_WAIT_HITS));
+
+    test_context_socket_close (receiver);
+}
+
+int ZMQ_CDECL main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_option);
+    RUN_TEST (test_spin_hit);
+    RUN_TEST (test_spin_miss);
+    return UNITY_END ();
+}
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+//  Packs the topics into a batch, each preceded by its size as a 4-byte
+//  integer in network byte order. Returns the size of the batch.
+static size_t
+pack_topics (const char *const *topics_, int count_, unsigned char *batch_)
+{
+    size_t size = 0;
+    for (int i = 0; i < count_; ++i) {
+        const size_t topic_size = strlen (topics_[i]);
+        batch_[size++] = 0;
+        batch_[size++] = 0;
+        batch_[size++] = 0;
+        batch_[size++] = static_cast<unsigned char> (topic_size);
+        memcpy (batch_ + size, topics_[i], topic_size);
+        size += topic_size;
+    }
+    return size;
+}
+
+static void recv_notification (void *pub_, bool subscribe_, const char *topic_)
+{
+    char buffer[32];
+    const int size = TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_recv (pub_, buffer, sizeof (buffer), 0));
+    TEST_ASSERT_EQUAL_INT (strlen (topic_) + 1, size);
+    TEST_ASSERT_EQUAL_INT (subscribe_ ? 1 : 0, buffer[0]);
+    TEST_ASSERT_EQUAL_MEMORY (topic_, buffer + 1, size - 1);
+}
+
+static void subscribe_many (const char *endpoint_)
+{
+    void *pub = test_context_socket (ZMQ_XPUB);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (pub, endpoint_));
+    char endpoint[MAX_SOCKET_STRING];
+    size_t endpoint_len = sizeof (endpoint);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (pub, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_len));
+
+    void *sub = test_context_socket (ZMQ_SUB);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sub, endpoint));
+
+    //  The topics reach the publisher sorted.
+    const char *const topics[] = {"B", "A2", "A1", "A"};
+    unsigned char batch[64];
+    size_t size = pack_topics (topics, 4, batch);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (sub, ZMQ_SUBSCRIBE_MANY, batch, size));
+    recv_notification (pub, true, "A");
+    recv_notification (pub, true, "A1");
+    recv_notification (pub, true, "A2");
+    recv_notification (pub, true, "B");
+
+    int count;
+    size_t count_size = sizeof (count);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (sub, ZMQ_TOPICS_COUNT, &count, &count_size));
+    TEST_ASSERT_EQUAL_INT (4, count);
+
+    send_string_expect_success (pub, "C", 0);
+    send_string_expect_success (pub, "B1", 0);
+    recv_string_expect_success (sub, "B1", 0);
+
+    //  Topics not subscribed to are not passed upstream.
+    const char *const cancels[] = {"Z", "B", "A1"};
+    size = pack_topics (cancels, 3, batch);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (sub, ZMQ_UNSUBSCRIBE_MANY, batch, size));
+    recv_notification (pub, false, "A1");
+    recv_notification (pub, false, "B");
+
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (sub, ZMQ_TOPICS_COUNT, &count, &count_size));
+    TEST_ASSERT_EQUAL_INT (2, count);
+
+    send_string_expect_success (pub, "B1", 0);
+    send_string_expect_success (pub, "A2", 0);
+    recv_string_expect_success (sub, "A2", 0);
+
+    test_context_socket_close (sub);
+    test_context_socket_close (pub);
+}
+
+void test_subscribe_many_inproc ()
+{
+    subscribe_many ("inproc://subscribe_many");
+}
+
+void test_subscribe_many_tcp ()
+{
+    subscribe_many ("tcp://127.0.0.1:*");
+}
+
+void test_subscribe_many_before_connect ()
+{
+    void *pub = test_context_socket (ZMQ_XPUB);
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pub, endpoint, sizeof (endpoint));
+
+    //  The subscriptions are sent to the publisher in one batch once
+    //  connected, and split into single subscriptions on the wire.
+    void *sub = test_context_socket (ZMQ_SUB);
+    const char *const topics[] = {"C", "A", "B"};
+    unsigned char batch[64];
+    const size_t size = pack_topics (topics, 3, batch);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (sub, ZMQ_SUBSCRIBE_MANY, batch, size));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sub, endpoint));
+
+    recv_notification (pub, true, "A");
+    recv_notification (pub, true, "B");
+    recv_notification (pub, true, "C");
+
+    test_context_socket_close (sub);
+    test_context_socket_close (pub);
+}
+
+//  Past a few kB the subscriptions sent once connected are split into
+//  several batches.
+void test_subscribe_many_before_connect_large ()
+{
+    void *pub = test_context_socket (ZMQ_XPUB);
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pub, endpoint, sizeof (endpoint));
+
+    void *sub = test_context_socket (ZMQ_SUB);
+    const int count = 3000;
+    char topic[16];
+    for (int i = 0; i < count; ++i) {
+        snprintf (topic, sizeof topic, "topic%04d", i);
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_setsockopt (sub, ZMQ_SUBSCRIBE, topic, strlen (topic)));
+    }
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sub, endpoint));
+
+    //  Each subscription arrives once.
+    bool received[count] = {false};
+    for (int i = 0; i < count; ++i) {
+        char buffer[32];
+        const int size = TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_recv (pub, buffer, sizeof (buffer) - 1, 0));
+        TEST_ASSERT_EQUAL_INT (10, size);
+        TEST_ASSERT_EQUAL_INT (1, buffer[0]);
+        buffer[size] = 0;
+        int index = -1;
+        TEST_ASSERT_EQUAL_INT (1, sscanf (buffer + 1, "topic%d", &index));
+        TEST_ASSERT_TRUE (index >= 0 && index < count);
+        TEST_ASSERT_FALSE (received[index]);
+        received[index] = true;
+    }
+
+    test_context_socket_close (sub);
+    test_context_socket_close (pub);
+}
+
+void test_subscribe_many_invalid ()
+{
+    void *sub = test_context_socket (ZMQ_SUB);
+    const char *const topics[] = {"A", "B"};
+    unsigned char batch[64];
+    const size_t size = pack_topics (topics, 2, batch);
+
+    //  Truncated topic.
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (sub, ZMQ_SUBSCRIBE_MANY, batch, size - 1));
+    //  Truncated size.
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (sub, ZMQ_UNSUBSCRIBE_MANY, batch, 3));
+
+    //  An empty batch is a no-op.
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (sub, ZMQ_SUBSCRIBE_MANY, batch, 0));
+
+    void *pub = test_context_socket (ZMQ_PUB);
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (pub, ZMQ_SUBSCRIBE_MANY, batch, size));
+
+    //  XSUB sockets can't set a batch while sending a multipart message.
+    void *xsub = test_context_socket (ZMQ_XSUB);
+    send_string_expect_success (xsub, "A", ZMQ_SNDMORE);
+    TEST_ASSERT_FAILURE_ERRNO (
+      EFSM, zmq_setsockopt (xsub, ZMQ_SUBSCRIBE_MANY, batch, size));
+    send_string_expect_success (xsub, "B", 0);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_setsockopt (xsub, ZMQ_SUBSCRIBE_MANY, batch, size));
+
+    test_context_socket_close (xsub);
+    test_context_socket_close (pub);
+    test_context_socket_close (sub);
+}
+
+int ZMQ_CDECL main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_subscribe_many_inproc);
+    RUN_TEST (test_subscribe_many_tcp);
+    RUN_TEST (test_subscribe_many_before_connect);
+    RUN_TEST (test_subscribe_many_before_connect_large);
+    RUN_TEST (test_subscribe_many_invalid);
+    return UNITY_END ();
+}
@@ -244,6 +244,49 @@ void test_mask_shared_msg ()
     test_context_socket_close (sb);
 }
 
+void test_mask_sizes ()
+{
+    char connect_address[MAX_SOCKET_STRING];
+    size_t addr_length = sizeof (connect_address);
+    void *sb = test_context_socket (ZMQ_DEALER);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (sb, "ws://127.0.0.1:*/mask-sizes"));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, connect_address, &addr_length));
+
+    void *sc = test_context_socket (ZMQ_DEALER);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sc, connect_address));
+
+    //  Sizes around the widths of the vectorized masking steps, both
+    //  masked in place and, for shared messages, into a copy.
+    const int sizes[] = {1, 3, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 4099};
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i) {
+        for (int shared = 0; shared < 2; ++shared) {
+            zmq_msg_t msg;
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init_size (&msg, sizes[i]));
+            unsigned char *data = (unsigned char *) zmq_msg_data (&msg);
+            for (int j = 0; j < sizes[i]; j++)
+                data[j] = (unsigned char) (j * 7 + i);
+
+            zmq_msg_t copy;
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&copy));
+            if (shared)
+                TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_copy (&copy, &msg));
+
+            TEST_ASSERT_EQUAL_INT (sizes[i], zmq_msg_send (&msg, sc, 0));
+            TEST_ASSERT_EQUAL_INT (sizes[i], zmq_msg_recv (&msg, sb, 0));
+            data = (unsigned char *) zmq_msg_data (&msg);
+            for (int j = 0; j < sizes[i]; j++)
+                TEST_ASSERT_EQUAL_INT ((unsigned char) (j * 7 + i), data[j]);
+
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&copy));
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+        }
+    }
+
+    test_context_socket_close (sc);
+    test_context_socket_close (sb);
+}
+
 void test_pub_sub ()
 {
     char connect_address[MAX_SOCKET_STRING];
@@ -283,6 +326,7 @@ int ZMQ_CDECL main ()
     RUN_TEST (test_large_message);
     RUN_TEST (test_heartbeat);
     RUN_TEST (test_mask_shared_msg);
+    RUN_TEST (test_mask_sizes);
     RUN_TEST (test_pub_sub);
 
     if (zmq_has ("curve"))
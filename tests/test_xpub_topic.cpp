@@ -74,12 +74,58 @@ void test_xpub_subscribe_long_topic ()
     test_context_socket_close (sub);
 }
 
+#ifdef ZMQ_XPUB_COMPACT_TRIE
+void test_xpub_compact_trie ()
+{
+    void *xpub = test_context_socket (ZMQ_XPUB);
+    int compact = 1;
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      xpub, ZMQ_XPUB_COMPACT_TRIE, &compact, sizeof (compact)));
+    compact = 0;
+    size_t size = sizeof (compact);
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (xpub, ZMQ_XPUB_COMPACT_TRIE, &compact, &size));
+    TEST_ASSERT_EQUAL_INT (1, compact);
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_bind (xpub, bind_address));
+    size_t len = MAX_SOCKET_STRING;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (xpub, ZMQ_LAST_ENDPOINT, connect_address, &len));
+
+    void *sub = test_context_socket (ZMQ_SUB);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (sub, connect_address));
+
+    test_subscribe_cancel (xpub, sub, short_topic);
+    test_subscribe_cancel (xpub, sub, long_topic);
+
+    //  Only messages under a subscribed prefix are delivered.
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "AB", 2));
+    recv_string_expect_success (xpub, "\1AB", 0);
+
+    //  The layout cannot change once subscriptions are stored.
+    TEST_ASSERT_FAILURE_ERRNO (EINVAL,
+                               zmq_setsockopt (xpub, ZMQ_XPUB_COMPACT_TRIE,
+                                               &compact, sizeof (compact)));
+
+    send_string_expect_success (xpub, "XY", 0);
+    send_string_expect_success (xpub, "ABC", 0);
+    recv_string_expect_success (sub, "ABC", 0);
+
+    //  Clean up.
+    test_context_socket_close (xpub);
+    test_context_socket_close (sub);
+}
+#endif
+
 int ZMQ_CDECL main ()
 {
     setup_test_environment ();
 
     UNITY_BEGIN ();
     RUN_TEST (test_xpub_subscribe_long_topic);
+#ifdef ZMQ_XPUB_COMPACT_TRIE
+    RUN_TEST (test_xpub_compact_trie);
+#endif
 
     return UNITY_END ();
 }
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "testutil.hpp"
+#include "testutil_unity.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+SETUP_TEARDOWN_TESTCONTEXT
+
+static const int threshold = 64 * 1024;
+static const size_t large_size = 1024 * 1024;
+static const int message_count = 16;
+
+static int freed;
+
+static void free_fn (void *data_, void *hint_)
+{
+    LIBZMQ_UNUSED (hint_);
+    free (data_);
+    ++freed;
+}
+
+void test_option ()
+{
+    void *push = test_context_socket (ZMQ_PUSH);
+
+    int value = -1;
+    size_t size = sizeof value;
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (push, ZMQ_ZERO_COPY_SEND_THRESHOLD, &value, &size));
+    TEST_ASSERT_EQUAL_INT (0, value);
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      push, ZMQ_ZERO_COPY_SEND_THRESHOLD, &threshold, sizeof threshold));
+    TEST_ASSERT_SUCCESS_ERRNO (
+      zmq_getsockopt (push, ZMQ_ZERO_COPY_SEND_THRESHOLD, &value, &size));
+    TEST_ASSERT_EQUAL_INT (threshold, value);
+
+    value = -1;
+    TEST_ASSERT_FAILURE_ERRNO (
+      EINVAL, zmq_setsockopt (push, ZMQ_ZERO_COPY_SEND_THRESHOLD, &value,
+                              sizeof value));
+
+    test_context_socket_close (push);
+}
+
+static void test_send (const char *transport_)
+{
+    void *pull = test_context_socket (ZMQ_PULL);
+    void *push = test_context_socket (ZMQ_PUSH);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_setsockopt (
+      push, ZMQ_ZERO_COPY_SEND_THRESHOLD, &threshold, sizeof threshold));
+
+    char my_endpoint[MAX_SOCKET_STRING];
+    if (strcmp (transport_, "tcp") == 0)
+        bind_loopback_ipv4 (pull, my_endpoint, sizeof my_endpoint);
+    else
+        bind_loopback_ipc (pull, my_endpoint, sizeof my_endpoint);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, my_endpoint));
+
+    //  Alternate messages above and below the threshold, with content
+    //  owned by the application so that its release can be observed.
+    freed = 0;
+    for (int i = 0; i < message_count; ++i) {
+        const size_t size = i % 2 ? 100 : large_size;
+        unsigned char *data = static_cast<unsigned char *> (malloc (size));
+        TEST_ASSERT_NOT_NULL (data);
+        memset (data, 'a' + i, size);
+
+        zmq_msg_t msg;
+        TEST_ASSERT_SUCCESS_ERRNO (
+          zmq_msg_init_data (&msg, data, size, free_fn, NULL));
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                               zmq_msg_send (&msg, push, 0));
+    }
+
+    for (int i = 0; i < message_count; ++i) {
+        const size_t size = i % 2 ? 100 : large_size;
+        zmq_msg_t msg;
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+        TEST_ASSERT_EQUAL_INT (static_cast<int> (size),
+                               zmq_msg_recv (&msg, pull, 0));
+        const unsigned char *data =
+          static_cast<const unsigned char *> (zmq_msg_data (&msg));
+        TEST_ASSERT_EQUAL_UINT8 ('a' + i, data[0]);
+        TEST_ASSERT_EQUAL_UINT8 ('a' + i, data[size - 1]);
+        TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+    }
+
+    test_context_socket_close (push);
+    test_context_socket_close (pull);
+
+    //  All the content is released once the engines are gone.
+    teardown_test_context ();
+    TEST_ASSERT_EQUAL_INT (message_count, freed);
+    setup_test_context ();
+}
+
+void test_send_tcp ()
+{
+    test_send ("tcp");
+}
+
+void test_send_ipc ()
+{
+#if defined(ZMQ_HAVE_IPC)
+    //  Not supported on IPC; the option must be ignored.
+    test_send ("ipc");
+#else
+    TEST_IGNORE_MESSAGE ("ipc is not available");
+#endif
+}
+
+int ZMQ_CDECL main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_option);
+    RUN_TEST (test_send_tcp);
+    RUN_TEST (test_send_ipc);
+    return UNITY_END ();
+}
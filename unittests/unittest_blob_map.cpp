@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "../tests/testutil.hpp"
+
+#include <blob_map.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+
+void setUp ()
+{
+}
+void tearDown ()
+{
+}
+
+static zmq::blob_t make_key (int value_)
+{
+    char buf[32];
+    const int size = snprintf (buf, sizeof buf, "key-%d", value_);
+    return zmq::blob_t (reinterpret_cast<unsigned char *> (buf),
+                        static_cast<size_t> (size));
+}
+
+static int *find (zmq::blob_map_t<int> &map_, int value_)
+{
+    const zmq::blob_t key = make_key (value_);
+    return map_.find (key.data (), key.size ());
+}
+
+static bool erase (zmq::blob_map_t<int> &map_, int value_)
+{
+    const zmq::blob_t key = make_key (value_);
+    return map_.erase (key.data (), key.size ());
+}
+
+void test_create ()
+{
+    zmq::blob_map_t<int> map;
+    TEST_ASSERT_TRUE (map.empty ());
+    TEST_ASSERT_NULL (map.find ("key", 3));
+    TEST_ASSERT_FALSE (map.erase ("key", 3));
+}
+
+void test_insert_find ()
+{
+    zmq::blob_map_t<int> map;
+    TEST_ASSERT_TRUE (map.insert (make_key (1), 1));
+    TEST_ASSERT_FALSE (map.insert (make_key (1), 2));
+    TEST_ASSERT_EQUAL_UINT (1, map.size ());
+
+    int *value = find (map, 1);
+    TEST_ASSERT_NOT_NULL (value);
+    TEST_ASSERT_EQUAL_INT (1, *value);
+    TEST_ASSERT_NULL (find (map, 2));
+}
+
+void test_empty_key ()
+{
+    zmq::blob_map_t<int> map;
+    TEST_ASSERT_TRUE (map.insert (zmq::blob_t (), 42));
+    TEST_ASSERT_NOT_NULL (map.find (NULL, 0));
+    TEST_ASSERT_EQUAL_INT (42, *map.find (NULL, 0));
+    int value = 0;
+    TEST_ASSERT_TRUE (map.erase (NULL, 0, &value));
+    TEST_ASSERT_EQUAL_INT (42, value);
+    TEST_ASSERT_TRUE (map.empty ());
+}
+
+void test_grow_and_erase ()
+{
+    const int count = 10000;
+    zmq::blob_map_t<int> map;
+    for (int i = 0; i < count; ++i)
+        TEST_ASSERT_TRUE (map.insert (make_key (i), i));
+    TEST_ASSERT_EQUAL_UINT (count, map.size ());
+
+    //  Erasing every other key shifts entries back into the holes; the
+    //  remaining keys must all stay reachable.
+    for (int i = 0; i < count; i += 2)
+        TEST_ASSERT_TRUE (erase (map, i));
+    TEST_ASSERT_EQUAL_UINT (count / 2, map.size ());
+    for (int i = 0; i < count; ++i) {
+        int *value = find (map, i);
+        if (i % 2) {
+            TEST_ASSERT_NOT_NULL (value);
+            TEST_ASSERT_EQUAL_INT (i, *value);
+        } else
+            TEST_ASSERT_NULL (value);
+    }
+
+    for (int i = 1; i < count; i += 2)
+        TEST_ASSERT_TRUE (erase (map, i));
+    TEST_ASSERT_TRUE (map.empty ());
+}
+
+//  Keys removed in bulk are reclaimed from the arena while the remaining
+//  ones, and the keys inserted afterwards, stay reachable.
+void test_churn ()
+{
+    const int count = 2000;
+    zmq::blob_map_t<int> map;
+    for (int round = 0; round < 10; ++round) {
+        const int base = round * count;
+        for (int i = base; i < base + count; ++i)
+            TEST_ASSERT_TRUE (map.insert (make_key (i), i));
+        for (int i = base - count; i < base; ++i)
+            if (i >= 0)
+                TEST_ASSERT_TRUE (erase (map, i));
+        TEST_ASSERT_EQUAL_UINT (count, map.size ());
+        for (int i = base; i < base + count; ++i) {
+            int *value = find (map, i);
+            TEST_ASSERT_NOT_NULL (value);
+            TEST_ASSERT_EQUAL_INT (i, *value);
+        }
+    }
+}
+
+static int visited;
+
+static bool visit_until_three (int &value_)
+{
+    ++visited;
+    return value_ == 3;
+}
+
+void test_any_of ()
+{
+    zmq::blob_map_t<int> map;
+    for (int i = 0; i < 5; ++i)
+        map.insert (make_key (i), i);
+
+    visited = 0;
+    TEST_ASSERT_TRUE (map.any_of (visit_until_three));
+    TEST_ASSERT_LESS_OR_EQUAL_INT (5, visited);
+
+    erase (map, 3);
+    visited = 0;
+    TEST_ASSERT_FALSE (map.any_of (visit_until_three));
+    TEST_ASSERT_EQUAL_INT (4, visited);
+}
+
+int ZMQ_CDECL main (void)
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_create);
+    RUN_TEST (test_insert_find);
+    RUN_TEST (test_empty_key);
+    RUN_TEST (test_grow_and_erase);
+    RUN_TEST (test_churn);
+    RUN_TEST (test_any_of);
+
+    return UNITY_END ();
+}
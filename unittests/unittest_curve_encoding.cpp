@@ -13,6 +13,7 @@
 
 #include <unity.h>
 
+#include <string.h>
 #include <vector>
 
 void setUp ()
@@ -23,18 +24,10 @@ void tearDown ()
 {
 }
 
-void test_roundtrip (zmq::msg_t *msg_)
-{
 #ifdef ZMQ_HAVE_CURVE
-    const std::vector<uint8_t> original (static_cast<uint8_t *> (msg_->data ()),
-                                         static_cast<uint8_t *> (msg_->data ())
-                                           + msg_->size ());
-
-    zmq::curve_encoding_t encoding_client ("CurveZMQMESSAGEC",
-                                           "CurveZMQMESSAGES", false);
-    zmq::curve_encoding_t encoding_server ("CurveZMQMESSAGES",
-                                           "CurveZMQMESSAGEC", false);
-
+static void set_keys (zmq::curve_encoding_t &client_,
+                      zmq::curve_encoding_t &server_)
+{
     uint8_t client_public[32];
     uint8_t client_secret[32];
     TEST_ASSERT_SUCCESS_ERRNO (
@@ -46,11 +39,27 @@ void test_roundtrip (zmq::msg_t *msg_)
       crypto_box_keypair (server_public, server_secret));
 
     TEST_ASSERT_SUCCESS_ERRNO (
-      crypto_box_beforenm (encoding_client.get_writable_precom_buffer (),
+      crypto_box_beforenm (client_.get_writable_precom_buffer (),
                            server_public, client_secret));
     TEST_ASSERT_SUCCESS_ERRNO (
-      crypto_box_beforenm (encoding_server.get_writable_precom_buffer (),
+      crypto_box_beforenm (server_.get_writable_precom_buffer (),
                            client_public, server_secret));
+}
+#endif
+
+void test_roundtrip (zmq::msg_t *msg_)
+{
+#ifdef ZMQ_HAVE_CURVE
+    const std::vector<uint8_t> original (static_cast<uint8_t *> (msg_->data ()),
+                                         static_cast<uint8_t *> (msg_->data ())
+                                           + msg_->size ());
+
+    zmq::curve_encoding_t encoding_client ("CurveZMQMESSAGEC",
+                                           "CurveZMQMESSAGES", false);
+    zmq::curve_encoding_t encoding_server ("CurveZMQMESSAGES",
+                                           "CurveZMQMESSAGEC", false);
+
+    set_keys (encoding_client, encoding_server);
 
     TEST_ASSERT_SUCCESS_ERRNO (encoding_client.encode (msg_));
 
@@ -129,6 +138,48 @@ void test_roundtrip_empty_more ()
     msg.close ();
 }
 
+//  The scratch buffers don't keep the plaintext, nor the size of a large
+//  message.
+void test_scratch_cleared ()
+{
+#ifndef ZMQ_HAVE_CURVE
+    TEST_IGNORE_MESSAGE ("CURVE support is disabled");
+#else
+    zmq::curve_encoding_t encoding_client ("CurveZMQMESSAGEC",
+                                           "CurveZMQMESSAGES", false);
+    zmq::curve_encoding_t encoding_server ("CurveZMQMESSAGES",
+                                           "CurveZMQMESSAGEC", false);
+    set_keys (encoding_client, encoding_server);
+    encoding_server.set_peer_nonce (0);
+    zmq::curve_encoding_t::scratch_t scratch;
+
+    const size_t sizes[] = {256 * 1024, 1024};
+    for (size_t i = 0; i != sizeof sizes / sizeof sizes[0]; ++i) {
+        zmq::msg_t msg;
+        msg.init_size (sizes[i]);
+        memset (msg.data (), 'x', sizes[i]);
+
+        encoding_client.prepare_encode (&msg);
+        encoding_client.box (&msg, scratch);
+        int error_event_code;
+        TEST_ASSERT_SUCCESS_ERRNO (
+          encoding_server.check_validity (&msg, &error_event_code));
+        TEST_ASSERT_SUCCESS_ERRNO (
+          encoding_server.unbox (&msg, scratch, &error_event_code));
+        TEST_ASSERT_EQUAL_INT (sizes[i], msg.size ());
+        TEST_ASSERT_EACH_EQUAL_UINT8 ('x', msg.data (), sizes[i]);
+        msg.close ();
+
+        TEST_ASSERT_TRUE (scratch.plaintext.capacity ()
+                          <= zmq::crypto_max_scratch_size);
+        TEST_ASSERT_TRUE (scratch.box.capacity ()
+                          <= zmq::crypto_max_scratch_size);
+        for (size_t pos = 0; pos != scratch.plaintext.size (); ++pos)
+            TEST_ASSERT_EQUAL_UINT8 (0, scratch.plaintext[pos]);
+    }
+#endif
+}
+
 int ZMQ_CDECL main ()
 {
     setup_test_environment ();
@@ -141,6 +192,7 @@ int ZMQ_CDECL main ()
     RUN_TEST (test_roundtrip_large);
 
     RUN_TEST (test_roundtrip_empty_more);
+    RUN_TEST (test_scratch_cleared);
 
     zmq::random_close ();
 
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "../tests/testutil.hpp"
+
+#include <mpsc_queue.hpp>
+
+#include <unity.h>
+
+void setUp ()
+{
+}
+void tearDown ()
+{
+}
+
+void test_create ()
+{
+    zmq::mpsc_queue_t<int, 1> queue;
+}
+
+void test_check_read_empty ()
+{
+    zmq::mpsc_queue_t<int, 1> queue;
+    TEST_ASSERT_FALSE (queue.check_read ());
+}
+
+void test_read_empty ()
+{
+    zmq::mpsc_queue_t<int, 1> queue;
+    int read_value = -1;
+    TEST_ASSERT_FALSE (queue.read (&read_value));
+    TEST_ASSERT_EQUAL (-1, read_value);
+}
+
+void test_write_wakes_reader_once ()
+{
+    zmq::mpsc_queue_t<int, 2> queue;
+    TEST_ASSERT_FALSE (queue.check_read ());
+
+    //  Only the first write after the reader went asleep wakes it up.
+    TEST_ASSERT_FALSE (queue.write (1));
+    TEST_ASSERT_TRUE (queue.write (2));
+    TEST_ASSERT_TRUE (queue.write (3));
+
+    int read_value = -1;
+    for (int i = 1; i <= 3; i++) {
+        TEST_ASSERT_TRUE (queue.check_read ());
+        TEST_ASSERT_TRUE (queue.read (&read_value));
+        TEST_ASSERT_EQUAL_INT (i, read_value);
+    }
+    TEST_ASSERT_FALSE (queue.read (&read_value));
+    TEST_ASSERT_FALSE (queue.write (4));
+}
+
+void test_destroy_with_items_left ()
+{
+    zmq::mpsc_queue_t<int, 4> queue;
+    for (int i = 0; i != 10; i++)
+        queue.write (i);
+}
+
+const int writers = 4;
+const int writes = 10000;
+
+static void writer (void *queue_)
+{
+    zmq::mpsc_queue_t<int, 16> *queue =
+      static_cast<zmq::mpsc_queue_t<int, 16> *> (queue_);
+    static zmq::atomic_counter_t next_id;
+    const int id = next_id.add (1) % writers;
+    for (int i = 0; i != writes; i++)
+        queue->write (id * writes + i);
+}
+
+void test_concurrent_writers ()
+{
+    zmq::mpsc_queue_t<int, 16> queue;
+    void *threads[writers];
+    for (int i = 0; i != writers; i++)
+        threads[i] = zmq_threadstart (&writer, &queue);
+
+    //  The items of each writer come in the order they were written.
+    int next[writers] = {0};
+    for (int read = 0; read != writers * writes;) {
+        int value;
+        if (!queue.read (&value))
+            continue;
+        const int id = value / writes;
+        TEST_ASSERT_EQUAL_INT (next[id], value % writes);
+        next[id]++;
+        read++;
+    }
+
+    for (int i = 0; i != writers; i++)
+        zmq_threadclose (threads[i]);
+}
+
+int ZMQ_CDECL main (void)
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_create);
+    RUN_TEST (test_check_read_empty);
+    RUN_TEST (test_read_empty);
+    RUN_TEST (test_write_wakes_reader_once);
+    RUN_TEST (test_destroy_with_items_left);
+    RUN_TEST (test_concurrent_writers);
+
+    return UNITY_END ();
+}
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "../tests/testutil.hpp"
+
+#include <msg.hpp>
+
+#include <unity.h>
+
+void setUp ()
+{
+}
+void tearDown ()
+{
+}
+
+//  Large enough for the engines to gather or zero-copy the frame.
+static const size_t large_size = 64 * 1024;
+
+void test_plain_message_spans_its_data ()
+{
+    zmq::msg_t msg;
+    TEST_ASSERT_EQUAL_INT (0, msg.init_size (large_size));
+    unsigned char *const data = static_cast<unsigned char *> (msg.data ());
+    TEST_ASSERT_TRUE (msg.spans (data, large_size));
+    TEST_ASSERT_TRUE (msg.spans (data + 1, large_size - 1));
+    TEST_ASSERT_FALSE (msg.spans (data - 2, 2));
+    TEST_ASSERT_FALSE (msg.spans (data + 1, large_size));
+    TEST_ASSERT_EQUAL_INT (0, msg.close ());
+}
+
+void test_small_message_spans_nothing ()
+{
+    zmq::msg_t msg;
+    TEST_ASSERT_EQUAL_INT (0, msg.init_size (8));
+    TEST_ASSERT_FALSE (msg.spans (msg.data (), 8));
+    TEST_ASSERT_EQUAL_INT (0, msg.close ());
+}
+
+//  The frame encoded once for all subscribers must still be written
+//  straight from the message by each engine, header included.
+void test_fanned_out_frame_is_spanned ()
+{
+    zmq::msg_t msg;
+    TEST_ASSERT_EQUAL_INT (0, msg.init_size (large_size));
+    msg.encode_frame_header ();
+
+    size_t frame_size;
+    unsigned char *const frame = msg.encoded_frame (&frame_size);
+    TEST_ASSERT_NOT_NULL (frame);
+    TEST_ASSERT_EQUAL_UINT (large_size + 9, frame_size);
+    TEST_ASSERT_TRUE (msg.spans (frame, frame_size));
+    TEST_ASSERT_FALSE (msg.spans (frame - 1, frame_size));
+
+    //  As seen by the copy each engine holds.
+    zmq::msg_t copy;
+    TEST_ASSERT_EQUAL_INT (0, copy.init ());
+    TEST_ASSERT_EQUAL_INT (0, copy.copy (msg));
+    size_t copy_frame_size;
+    TEST_ASSERT_EQUAL_PTR (frame, copy.encoded_frame (&copy_frame_size));
+    TEST_ASSERT_TRUE (copy.spans (frame, copy_frame_size));
+
+    TEST_ASSERT_EQUAL_INT (0, copy.close ());
+    TEST_ASSERT_EQUAL_INT (0, msg.close ());
+}
+
+int main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+    RUN_TEST (test_plain_message_spans_its_data);
+    RUN_TEST (test_small_message_spans_nothing);
+    RUN_TEST (test_fanned_out_frame_is_spanned);
+    return UNITY_END ();
+}
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+
+#include "../tests/testutil.hpp"
+#include "../tests/testutil_unity.hpp"
+
+#include <msg.hpp>
+#include <msg_pool.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unity.h>
+
+//  The pool, once installed, serves the whole process. It is kept to this
+//  test binary so that the other tests run with the default allocator.
+
+void setUp ()
+{
+}
+void tearDown ()
+{
+}
+
+#ifdef ZMQ_HAVE_MSG_POOL
+void test_allocations_before_install_go_to_heap ()
+{
+    TEST_ASSERT_EQUAL_UINT64 (0, zmq::msg_pool_t::hits ());
+    void *const buffer = zmq::malloc (1000, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    TEST_ASSERT_NOT_NULL (buffer);
+    TEST_ASSERT_EQUAL_UINT64 (0, zmq::msg_pool_t::hits ());
+
+    //  Freed by the pool once installed.
+    TEST_ASSERT_TRUE (zmq::msg_pool_t::install ());
+    zmq::free (buffer, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    TEST_ASSERT_EQUAL_UINT64 (0, zmq::msg_pool_t::hits ());
+}
+
+void test_pool_serves_hinted_allocations ()
+{
+    TEST_ASSERT_TRUE (zmq::msg_pool_t::install ());
+    const uint64_t hits = zmq::msg_pool_t::hits ();
+
+    void *const buffer = zmq::malloc (1000, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    TEST_ASSERT_NOT_NULL (buffer);
+    memset (buffer, 1, 1000);
+    TEST_ASSERT_EQUAL_UINT64 (hits + 1, zmq::msg_pool_t::hits ());
+    zmq::free (buffer, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+
+    //  The freed buffer is handed out again.
+    void *const again = zmq::malloc (1000, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    TEST_ASSERT_EQUAL_PTR (buffer, again);
+    TEST_ASSERT_EQUAL_UINT64 (hits + 2, zmq::msg_pool_t::hits ());
+    zmq::free (again, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+}
+
+void test_heap_serves_the_rest ()
+{
+    TEST_ASSERT_TRUE (zmq::msg_pool_t::install ());
+    const uint64_t hits = zmq::msg_pool_t::hits ();
+
+    void *const unhinted = zmq::malloc (1000, ZMQ_MSG_ALLOC_HINT_NONE);
+    TEST_ASSERT_NOT_NULL (unhinted);
+    void *const large = zmq::malloc (1024 * 1024, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    TEST_ASSERT_NOT_NULL (large);
+    TEST_ASSERT_EQUAL_UINT64 (hits, zmq::msg_pool_t::hits ());
+    zmq::free (large, ZMQ_MSG_ALLOC_HINT_OUTGOING);
+    zmq::free (unhinted, ZMQ_MSG_ALLOC_HINT_NONE);
+}
+
+void test_ctx_option_installs_pool ()
+{
+#ifdef ZMQ_MSG_POOL
+    void *ctx = zmq_ctx_new ();
+    TEST_ASSERT_NOT_NULL (ctx);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_set (ctx, ZMQ_MSG_POOL, 1));
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    TEST_ASSERT_NOT_NULL (pull);
+    char endpoint[MAX_SOCKET_STRING];
+    bind_loopback_ipv4 (pull, endpoint, sizeof endpoint);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    TEST_ASSERT_NOT_NULL (push);
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_connect (push, endpoint));
+    const uint64_t hits = zmq::msg_pool_t::hits ();
+
+    //  Sizes from the smallest class up to the heap.
+    const size_t sizes[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    const int count = sizeof sizes / sizeof sizes[0];
+    char *data = static_cast<char *> (malloc (sizes[count - 1]));
+    TEST_ASSERT_NOT_NULL (data);
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < count; ++i) {
+            memset (data, 'a' + i, sizes[i]);
+            TEST_ASSERT_EQUAL_INT (static_cast<int> (sizes[i]),
+                                   zmq_send (push, data, sizes[i], 0));
+        }
+        for (int i = 0; i < count; ++i) {
+            zmq_msg_t msg;
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_init (&msg));
+            TEST_ASSERT_EQUAL_INT (static_cast<int> (sizes[i]),
+                                   TEST_ASSERT_SUCCESS_ERRNO (
+                                     zmq_msg_recv (&msg, pull, 0)));
+            memset (data, 'a' + i, sizes[i]);
+            TEST_ASSERT_EQUAL_MEMORY (data, zmq_msg_data (&msg), sizes[i]);
+            TEST_ASSERT_SUCCESS_ERRNO (zmq_msg_close (&msg));
+        }
+    }
+    free (data);
+
+    //  At least the outgoing messages that are too large to be stored
+    //  in the message itself come from the pool.
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64 (hits + 10 * 3,
+                                         zmq::msg_pool_t::hits ());
+
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (push));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_close (pull));
+    TEST_ASSERT_SUCCESS_ERRNO (zmq_ctx_term (ctx));
+#else
+    TEST_IGNORE_MESSAGE ("libzmq without draft API, ignoring test.");
+#endif
+}
+#endif
+
+int main ()
+{
+    setup_test_environment ();
+
+    UNITY_BEGIN ();
+#ifdef ZMQ_HAVE_MSG_POOL
+    RUN_TEST (test_allocations_before_install_go_to_heap);
+    RUN_TEST (test_pool_serves_hinted_allocations);
+    RUN_TEST (test_heap_serves_the_rest);
+    RUN_TEST (test_ctx_option_installs_pool);
+#endif
+    return UNITY_END ();
+}
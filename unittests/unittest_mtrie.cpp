@@ -7,6 +7,13 @@
 #endif
 
 #include <generic_mtrie_impl.hpp>
+#include <compact_mtrie_impl.hpp>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <unity.h>
 
@@ -431,6 +438,245 @@ void test_rm_with_callback_duplicate_uniq_only ()
     mtrie.rm (&pipes[1], check_count, &count, true);
 }
 
+typedef zmq::compact_mtrie_t<int> compact_mtrie_t;
+
+static compact_mtrie_t::prefix_t to_prefix (const char *name_)
+{
+    return reinterpret_cast<compact_mtrie_t::prefix_t> (name_);
+}
+
+static int compact_match_count (compact_mtrie_t &mtrie_, const char *data_)
+{
+    int count = 0;
+    mtrie_.match (to_prefix (data_), strlen (data_), mtrie_count, &count);
+    return count;
+}
+
+void test_compact_split_and_merge ()
+{
+    int pipes[4];
+    compact_mtrie_t mtrie;
+
+    //  "foobar" is stored as one edge, which the shorter keys split.
+    TEST_ASSERT_TRUE (mtrie.add (to_prefix ("foobar"), 6, &pipes[0]));
+    TEST_ASSERT_TRUE (mtrie.add (to_prefix ("foo"), 3, &pipes[1]));
+    TEST_ASSERT_TRUE (mtrie.add (to_prefix ("fox"), 3, &pipes[2]));
+    TEST_ASSERT_TRUE (mtrie.add (NULL, 0, &pipes[3]));
+    TEST_ASSERT_FALSE (mtrie.add (to_prefix ("foo"), 3, &pipes[0]));
+    TEST_ASSERT_EQUAL_INT (4, mtrie.num_prefixes ());
+
+    TEST_ASSERT_EQUAL_INT (1, compact_match_count (mtrie, "f"));
+    TEST_ASSERT_EQUAL_INT (3, compact_match_count (mtrie, "foo"));
+    TEST_ASSERT_EQUAL_INT (3, compact_match_count (mtrie, "fooba"));
+    TEST_ASSERT_EQUAL_INT (4, compact_match_count (mtrie, "foobarbaz"));
+    TEST_ASSERT_EQUAL_INT (2, compact_match_count (mtrie, "foxes"));
+    TEST_ASSERT_EQUAL_INT (1, compact_match_count (mtrie, "fob"));
+
+    TEST_ASSERT_EQUAL (compact_mtrie_t::not_found,
+                       mtrie.rm (to_prefix ("fooba"), 5, &pipes[0]));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::not_found,
+                       mtrie.rm (to_prefix ("foo"), 3, &pipes[2]));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::values_remain,
+                       mtrie.rm (to_prefix ("foo"), 3, &pipes[1]));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::last_value_removed,
+                       mtrie.rm (to_prefix ("foo"), 3, &pipes[0]));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::last_value_removed,
+                       mtrie.rm (to_prefix ("fox"), 3, &pipes[2]));
+    TEST_ASSERT_EQUAL_INT (2, mtrie.num_prefixes ());
+
+    //  The remaining edges were merged back, matching must be unaffected.
+    TEST_ASSERT_EQUAL_INT (1, compact_match_count (mtrie, "foo"));
+    TEST_ASSERT_EQUAL_INT (2, compact_match_count (mtrie, "foobar"));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::last_value_removed,
+                       mtrie.rm (to_prefix ("foobar"), 6, &pipes[0]));
+    TEST_ASSERT_EQUAL (compact_mtrie_t::last_value_removed,
+                       mtrie.rm (NULL, 0, &pipes[3]));
+    TEST_ASSERT_EQUAL_INT (0, mtrie.num_prefixes ());
+    TEST_ASSERT_EQUAL_INT (0, compact_match_count (mtrie, "foobar"));
+}
+
+static void collect_name (compact_mtrie_t::prefix_t data_,
+                          size_t len_,
+                          std::vector<std::string> *names_)
+{
+    names_->push_back (
+      std::string (reinterpret_cast<const char *> (data_), len_));
+}
+
+void test_compact_rm_with_callback ()
+{
+    int pipes[2];
+    const char *names[] = {"foo", "foobar", "bar", ""};
+    compact_mtrie_t mtrie;
+    for (size_t i = 0; i < 4; ++i) {
+        mtrie.add (to_prefix (names[i]), strlen (names[i]), &pipes[0]);
+        mtrie.add (to_prefix (names[i]), strlen (names[i]), &pipes[1]);
+    }
+
+    //  Other values remain on every prefix, only reported if asked to.
+    std::vector<std::string> removed;
+    mtrie.rm (&pipes[0], collect_name, &removed, true);
+    TEST_ASSERT_EQUAL_UINT (0, removed.size ());
+    TEST_ASSERT_EQUAL_INT (4, mtrie.num_prefixes ());
+    TEST_ASSERT_EQUAL_INT (3, compact_match_count (mtrie, "foobar"));
+
+    mtrie.rm (&pipes[1], collect_name, &removed, true);
+    std::sort (removed.begin (), removed.end ());
+    TEST_ASSERT_EQUAL_UINT (4, removed.size ());
+    TEST_ASSERT_EQUAL_STRING ("", removed[0].c_str ());
+    TEST_ASSERT_EQUAL_STRING ("bar", removed[1].c_str ());
+    TEST_ASSERT_EQUAL_STRING ("foo", removed[2].c_str ());
+    TEST_ASSERT_EQUAL_STRING ("foobar", removed[3].c_str ());
+    TEST_ASSERT_EQUAL_INT (0, mtrie.num_prefixes ());
+    TEST_ASSERT_EQUAL_INT (0, compact_match_count (mtrie, "foobar"));
+}
+
+static void collect_pipe (int *pipe_, std::vector<int *> *pipes_)
+{
+    pipes_->push_back (pipe_);
+}
+
+template <typename Mtrie>
+static std::vector<int *> matching_pipes (Mtrie &mtrie_,
+                                         const std::string &data_)
+{
+    std::vector<int *> pipes;
+    mtrie_.match (to_prefix (data_.c_str ()), data_.size (), collect_pipe,
+                  &pipes);
+    std::sort (pipes.begin (), pipes.end ());
+    return pipes;
+}
+
+static unsigned int next_random (unsigned int &seed_, unsigned int range_)
+{
+    seed_ = seed_ * 1103515245 + 12345;
+    return (seed_ >> 16) % range_;
+}
+
+static std::string random_key (unsigned int &seed_)
+{
+    //  Short keys over a small alphabet share many prefixes.
+    std::string key (next_random (seed_, 8), 'a');
+    for (size_t i = 0; i < key.size (); ++i)
+        key[i] = static_cast<char> ('a' + next_random (seed_, 3));
+    return key;
+}
+
+void test_compact_same_as_generic ()
+{
+    const int pipe_count = 8;
+    int pipes[pipe_count];
+    zmq::generic_mtrie_t<int> generic;
+    compact_mtrie_t compact;
+
+    //  Entries of the compact trie, to check num_prefixes against.
+    std::map<std::string, std::set<int *> > entries;
+
+    unsigned int seed = 42;
+    for (int i = 0; i < 20000; ++i) {
+        const std::string key = random_key (seed);
+        int *pipe = &pipes[next_random (seed, pipe_count)];
+        const zmq::generic_mtrie_t<int>::prefix_t data =
+          to_prefix (key.c_str ());
+
+        switch (next_random (seed, 8)) {
+            case 0:
+            case 1:
+            case 2:
+                TEST_ASSERT_EQUAL (generic.add (data, key.size (), pipe),
+                                   compact.add (data, key.size (), pipe));
+                entries[key].insert (pipe);
+                break;
+            case 3:
+            case 4: {
+                const int res = generic.rm (data, key.size (), pipe);
+                TEST_ASSERT_EQUAL (res, compact.rm (data, key.size (), pipe));
+                const std::map<std::string, std::set<int *> >::iterator it =
+                  entries.find (key);
+                if (it != entries.end () && it->second.erase (pipe)
+                    && it->second.empty ())
+                    entries.erase (it);
+            } break;
+            case 5: {
+                std::vector<std::string> generic_names;
+                std::vector<std::string> compact_names;
+                generic.rm (pipe, collect_name, &generic_names, true);
+                compact.rm (pipe, collect_name, &compact_names, true);
+                std::sort (generic_names.begin (), generic_names.end ());
+                std::sort (compact_names.begin (), compact_names.end ());
+                TEST_ASSERT_TRUE (generic_names == compact_names);
+                for (std::map<std::string, std::set<int *> >::iterator it =
+                       entries.begin ();
+                     it != entries.end ();) {
+                    if (it->second.erase (pipe) && it->second.empty ())
+                        entries.erase (it++);
+                    else
+                        ++it;
+                }
+            } break;
+            default:
+                TEST_ASSERT_TRUE (matching_pipes (generic, key)
+                                  == matching_pipes (compact, key));
+                break;
+        }
+        TEST_ASSERT_EQUAL_UINT (entries.size (), compact.num_prefixes ());
+    }
+}
+
+static void collect_added (const zmq::topic_t &topic_,
+                           bool added_,
+                           std::vector<bool> *added_list_)
+{
+    LIBZMQ_UNUSED (topic_);
+    added_list_->push_back (added_);
+}
+
+template <typename Mtrie> static void check_add_many (int (&pipes_)[2])
+{
+    zmq::generic_mtrie_t<int> expected;
+    Mtrie mtrie;
+
+    //  Two sorted batches per pipe, with duplicates and shared prefixes.
+    unsigned int seed = 7;
+    for (int batch = 0; batch < 4; ++batch) {
+        int *pipe = &pipes_[batch % 2];
+        std::vector<std::string> keys;
+        for (int i = 0; i < 500; ++i)
+            keys.push_back (random_key (seed));
+        std::sort (keys.begin (), keys.end ());
+
+        std::vector<zmq::topic_t> topics;
+        std::vector<bool> expected_added;
+        for (size_t i = 0; i < keys.size (); ++i) {
+            const zmq::topic_t topic = {to_prefix (keys[i].c_str ()),
+                                        keys[i].size ()};
+            topics.push_back (topic);
+            expected_added.push_back (
+              expected.add (topic.data, topic.size, pipe));
+        }
+
+        std::vector<bool> added;
+        mtrie.add_many (&topics[0], topics.size (), pipe, collect_added,
+                        &added);
+        TEST_ASSERT_TRUE (added == expected_added);
+        TEST_ASSERT_EQUAL_UINT (expected.num_prefixes (),
+                                mtrie.num_prefixes ());
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        const std::string key = random_key (seed);
+        TEST_ASSERT_TRUE (matching_pipes (expected, key)
+                          == matching_pipes (mtrie, key));
+    }
+}
+
+void test_add_many ()
+{
+    int pipes[2];
+    check_add_many<zmq::generic_mtrie_t<int> > (pipes);
+    check_add_many<compact_mtrie_t> (pipes);
+}
+
 int ZMQ_CDECL main (void)
 {
     setup_test_environment ();
@@ -463,5 +709,10 @@ int ZMQ_CDECL main (void)
     RUN_TEST (test_rm_with_callback_duplicate);
     RUN_TEST (test_rm_with_callback_duplicate_uniq_only);
 
+    RUN_TEST (test_compact_split_and_merge);
+    RUN_TEST (test_compact_rm_with_callback);
+    RUN_TEST (test_compact_same_as_generic);
+    RUN_TEST (test_add_many);
+
     return UNITY_END ();
 }
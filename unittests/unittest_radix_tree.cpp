@@ -177,6 +177,44 @@ void test_check_null_entry_added ()
     TEST_ASSERT_TRUE (tree_check (tree, "all queries return true"));
 }
 
+void test_check_long_common_prefix ()
+{
+    //  Prefixes longer than the blocks compared at once, differing at
+    //  every position of a block and past it.
+    const std::string prefix = "md.equities.us.nasdaq.level2.";
+    zmq::radix_tree_t tree;
+    TEST_ASSERT_TRUE (tree_add (tree, prefix + "AAPL"));
+    TEST_ASSERT_TRUE (tree_add (tree, prefix + "AMZN"));
+
+    TEST_ASSERT_TRUE (tree_check (tree, prefix + "AAPL"));
+    TEST_ASSERT_TRUE (tree_check (tree, prefix + "AMZN.trades"));
+    for (size_t i = 0; i < prefix.size (); ++i) {
+        std::string key = prefix + "AAPL";
+        key[i] = '_';
+        TEST_ASSERT_FALSE (tree_check (tree, key));
+    }
+    TEST_ASSERT_FALSE (tree_check (tree, prefix));
+    TEST_ASSERT_FALSE (tree_check (tree, prefix + "MSFT"));
+}
+
+void test_check_many_edges ()
+{
+    //  More edges out of a node than the first bytes searched at once.
+    const std::string prefix = "topic.";
+    zmq::radix_tree_t tree;
+    for (int c = 'A'; c <= 'Z'; c += 2)
+        TEST_ASSERT_TRUE (tree_add (tree, prefix + char (c)));
+    for (int c = 'a'; c <= 'z'; c += 2)
+        TEST_ASSERT_TRUE (tree_add (tree, prefix + char (c)));
+
+    for (int c = 'A'; c <= 'Z'; ++c)
+        TEST_ASSERT_EQUAL ((c - 'A') % 2 == 0,
+                           tree_check (tree, prefix + char (c)));
+    for (int c = 'a'; c <= 'z'; ++c)
+        TEST_ASSERT_EQUAL ((c - 'a') % 2 == 0,
+                           tree_check (tree, prefix + char (c)));
+}
+
 void test_size ()
 {
     zmq::radix_tree_t tree;
@@ -239,6 +277,66 @@ void test_apply ()
     delete vec;
 }
 
+void test_compact ()
+{
+    zmq::radix_tree_t tree;
+
+    //  Enough keys of varied lengths to use several size classes and
+    //  nodes too large for any of them.
+    std::vector<std::string> keys;
+    for (int i = 0; i < 2000; ++i) {
+        std::string key (1 + i % 40, 'k');
+        for (int n = i; n; n /= 7)
+            key.push_back (static_cast<char> ('0' + n % 7));
+        keys.push_back (key);
+    }
+    keys.push_back (std::string (600, 'x'));
+    keys.push_back (std::string (600, 'x') + "y");
+    for (size_t i = 0; i < keys.size (); ++i)
+        TEST_ASSERT_TRUE (tree_add (tree, keys[i]));
+    for (size_t i = 0; i < keys.size (); i += 3)
+        TEST_ASSERT_TRUE (tree_rm (tree, keys[i]));
+
+    tree.compact ();
+    TEST_ASSERT_EQUAL_UINT (keys.size () - (keys.size () + 2) / 3,
+                            tree.size ());
+    for (size_t i = 0; i < keys.size (); ++i)
+        if (i % 3)
+            TEST_ASSERT_TRUE (tree_check (tree, keys[i]));
+
+    std::vector<std::string> visited;
+    tree.apply (return_key, &visited);
+    TEST_ASSERT_EQUAL_UINT (tree.size (), visited.size ());
+
+    //  The compacted tree keeps working as usual.
+    for (size_t i = 0; i < keys.size (); i += 3)
+        TEST_ASSERT_TRUE (tree_add (tree, keys[i]));
+    for (size_t i = 0; i < keys.size (); ++i)
+        TEST_ASSERT_TRUE (tree_rm (tree, keys[i]));
+    TEST_ASSERT_EQUAL_UINT (0, tree.size ());
+    tree.compact ();
+    TEST_ASSERT_FALSE (tree_check (tree, keys[0]));
+    TEST_ASSERT_TRUE (tree_add (tree, keys[0]));
+    TEST_ASSERT_TRUE (tree_check (tree, keys[0]));
+}
+
+void test_compact_if_fragmented ()
+{
+    zmq::radix_tree_t tree;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 5000; ++i) {
+        char key[16];
+        snprintf (key, sizeof key, "topic.%d", i * 7919 % 100000);
+        keys.push_back (key);
+        TEST_ASSERT_TRUE (tree_add (tree, key));
+        if (i % 100 == 0)
+            tree.compact_if_fragmented ();
+    }
+    tree.compact_if_fragmented ();
+    for (size_t i = 0; i < keys.size (); ++i)
+        TEST_ASSERT_TRUE (tree_check (tree, keys[i]));
+}
+
 int ZMQ_CDECL main (void)
 {
     setup_test_environment ();
@@ -264,10 +362,15 @@ int ZMQ_CDECL main (void)
     RUN_TEST (test_check_nonexistent_entry);
     RUN_TEST (test_check_query_longer_than_entry);
     RUN_TEST (test_check_null_entry_added);
+    RUN_TEST (test_check_long_common_prefix);
+    RUN_TEST (test_check_many_edges);
 
     RUN_TEST (test_size);
 
     RUN_TEST (test_apply);
 
+    RUN_TEST (test_compact);
+    RUN_TEST (test_compact_if_fragmented);
+
     return UNITY_END ();
 }
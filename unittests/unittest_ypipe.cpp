@@ -3,6 +3,7 @@
 #include "../tests/testutil.hpp"
 
 #include <ypipe.hpp>
+#include <chunk_pool.hpp>
 
 #include <unity.h>
 
@@ -55,6 +56,61 @@ void test_write_complete_and_flush_and_check_read_and_read ()
     TEST_ASSERT_EQUAL_INT (value, read_value);
 }
 
+void test_chunks_from_pool ()
+{
+    zmq::chunk_pool_t pool (zmq::yqueue_t<int, 1>::chunk_size (), 2);
+    {
+        zmq::ypipe_t<int, 1> ypipe (&pool);
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < 4; i++)
+                ypipe.write (i, false);
+            ypipe.flush ();
+            for (int i = 0; i < 4; i++) {
+                int read_value = -1;
+                TEST_ASSERT_TRUE (ypipe.read (&read_value));
+                TEST_ASSERT_EQUAL_INT (i, read_value);
+            }
+        }
+        TEST_ASSERT_GREATER_THAN_INT (0, pool.hits ());
+    }
+
+    //  The chunks of the pipe went back to the pool, up to its size.
+    TEST_ASSERT_EQUAL_INT (2, pool.cached ());
+    TEST_ASSERT_EQUAL_INT (pool.misses (), pool.cached () + pool.drops ());
+}
+
+void test_footprint_grows_and_shrinks ()
+{
+    zmq::ypipe_t<int, 16, 2> ypipe;
+    const size_t initial_footprint = ypipe.footprint ();
+    TEST_ASSERT_GREATER_THAN (0, initial_footprint);
+
+    //  Chunks get larger as the items pile up.
+    for (int i = 0; i < 100; i++)
+        ypipe.write (i, false);
+    ypipe.flush ();
+    const size_t loaded_footprint = ypipe.footprint ();
+    TEST_ASSERT_GREATER_OR_EQUAL (100 * sizeof (int), loaded_footprint);
+    TEST_ASSERT_LESS_THAN (100 * initial_footprint, loaded_footprint);
+
+    int read_value = -1;
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE (ypipe.read (&read_value));
+        TEST_ASSERT_EQUAL_INT (i, read_value);
+    }
+    TEST_ASSERT_FALSE (ypipe.read (&read_value));
+
+    //  Once the reader keeps up, the large chunks are dropped.
+    for (int i = 0; i < 64; i++) {
+        ypipe.write (i, false);
+        TEST_ASSERT_FALSE (ypipe.flush ());
+        TEST_ASSERT_TRUE (ypipe.read (&read_value));
+        TEST_ASSERT_EQUAL_INT (i, read_value);
+        TEST_ASSERT_FALSE (ypipe.read (&read_value));
+    }
+    TEST_ASSERT_LESS_OR_EQUAL (2 * initial_footprint, ypipe.footprint ());
+}
+
 int ZMQ_CDECL main (void)
 {
     setup_test_environment ();
@@ -65,6 +121,8 @@ int ZMQ_CDECL main (void)
     RUN_TEST (test_read_empty);
     RUN_TEST (test_write_complete_and_check_read_and_read);
     RUN_TEST (test_write_complete_and_flush_and_check_read_and_read);
+    RUN_TEST (test_chunks_from_pool);
+    RUN_TEST (test_footprint_grows_and_shrinks);
 
     return UNITY_END ();
 }